@@ -58,3 +58,40 @@ oio_cache_get(struct oio_cache_s *c, const char *k, gchar **out)
 	return ((struct oio_cache_abstract_s*)c)->vtable->get(c,k,out);
 }
 
+enum oio_cache_status_e
+oio_cache_mput(struct oio_cache_s *c, const char * const *k, const char * const *v)
+{
+	g_assert(c != NULL);
+	g_assert(((struct oio_cache_abstract_s*)c)->vtable != NULL);
+	if (((struct oio_cache_abstract_s*)c)->vtable->mput)
+		return ((struct oio_cache_abstract_s*)c)->vtable->mput(c,k,v);
+
+	enum oio_cache_status_e rc = OIO_CACHE_OK;
+	for (guint i=0; k[i] ;++i) {
+		enum oio_cache_status_e cur_rc = oio_cache_put(c, k[i], v[i]);
+		if (cur_rc != OIO_CACHE_OK)
+			rc = cur_rc;
+	}
+	return rc;
+}
+
+enum oio_cache_status_e
+oio_cache_mget(struct oio_cache_s *c, const char * const *k, gchar **out)
+{
+	g_assert(c != NULL);
+	g_assert(((struct oio_cache_abstract_s*)c)->vtable != NULL);
+	for (guint i=0; k[i] ;++i)
+		out[i] = NULL;
+	if (((struct oio_cache_abstract_s*)c)->vtable->mget)
+		return ((struct oio_cache_abstract_s*)c)->vtable->mget(c,k,out);
+
+	enum oio_cache_status_e rc = OIO_CACHE_OK;
+	for (guint i=0; k[i] ;++i) {
+		enum oio_cache_status_e cur_rc = oio_cache_get(c, k[i], out+i);
+		if (cur_rc != OIO_CACHE_OK)
+			out[i] = NULL;
+		if (cur_rc != OIO_CACHE_OK && cur_rc != OIO_CACHE_NOTFOUND)
+			rc = cur_rc;
+	}
+	return rc;
+}
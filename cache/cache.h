@@ -41,6 +41,11 @@ struct oio_cache_vtable_s
 	enum oio_cache_status_e (*put) (struct oio_cache_s *self, const char *k, const char *v);
 	enum oio_cache_status_e (*del) (struct oio_cache_s *self, const char *k);
 	enum oio_cache_status_e (*get) (struct oio_cache_s *self, const char *k, gchar **out);
+
+	/* Optional batch operations, done with as few round trips as the
+	 * backend allows. When NULL, the wrappers loop on put/get. */
+	enum oio_cache_status_e (*mput) (struct oio_cache_s *self, const char * const *k, const char * const *v);
+	enum oio_cache_status_e (*mget) (struct oio_cache_s *self, const char * const *k, gchar **out);
 };
 
 /* abstract type, every implementation must inherit from */
@@ -56,6 +61,15 @@ enum oio_cache_status_e oio_cache_put(struct oio_cache_s *c, const char *k, cons
 enum oio_cache_status_e oio_cache_del(struct oio_cache_s *c, const char *k);
 enum oio_cache_status_e oio_cache_get(struct oio_cache_s *c, const char *k, gchar **out);
 
+/* Stores each k[i] with v[i]. <k> is NULL-terminated, <v> as long as <k>.
+ * Returns OIO_CACHE_OK if all the pairs have been stored. */
+enum oio_cache_status_e oio_cache_mput(struct oio_cache_s *c, const char * const *k, const char * const *v);
+
+/* Sets out[i] to the value of k[i], or to NULL when not found. <k> is
+ * NULL-terminated, <out> as long as <k>. Returns OIO_CACHE_OK if all the
+ * keys have been looked up, whether found or not. */
+enum oio_cache_status_e oio_cache_mget(struct oio_cache_s *c, const char * const *k, gchar **out);
+
 /* Implementation specifics ------------------------------------------------- */
 
 /* Returns a cache that stores nothing */
@@ -63,9 +77,16 @@ struct oio_cache_s * oio_cache_make_NOOP (void);
 
 struct lru_tree_s;
 
-/* Returns a cache that stores entries in a LRU_TREE */
+/* Returns a cache that stores entries in a LRU_TREE. The tree must compare
+ * its keys as strings, and free its keys and values with g_free(). */
 struct oio_cache_s * oio_cache_make_LRU (struct lru_tree_s *lru);
 
+/* Same as oio_cache_make_LRU(), but keeps at most <max> entries (0 for no
+ * limit), and drops those not accessed for <ttl> microseconds (0 for no
+ * expiration; with LTO_NOATIME, <ttl> counts since the insertion). */
+struct oio_cache_s * oio_cache_make_LRU_bounded (struct lru_tree_s *lru,
+		guint max, gint64 ttl);
+
 /* Returns a multi-layered cache */
 struct oio_cache_s * oio_cache_make_multilayer (GSList *caches);
 struct oio_cache_s * oio_cache_make_multilayer_var (struct oio_cache_s *first, ...);
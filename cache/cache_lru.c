@@ -38,15 +38,27 @@ struct oio_cache_LRU_s
 {
 	const struct oio_cache_vtable_s *vtable;
 	struct lru_tree_s *lru;
+	GMutex lock;
+	guint max;
+	gint64 ttl;
 };
 
 struct oio_cache_s *
 oio_cache_make_LRU (struct lru_tree_s *lru)
+{
+	return oio_cache_make_LRU_bounded (lru, 0, 0);
+}
+
+struct oio_cache_s *
+oio_cache_make_LRU_bounded (struct lru_tree_s *lru, guint max, gint64 ttl)
 {
 	EXTRA_ASSERT (lru != NULL);
 	struct oio_cache_LRU_s *self = SLICE_NEW0 (struct oio_cache_LRU_s);
 	self->vtable = &vtable_LRU;
 	self->lru = lru;
+	g_mutex_init (&self->lock);
+	self->max = max;
+	self->ttl = ttl;
 	return (struct oio_cache_s*) self;
 }
 
@@ -58,28 +70,48 @@ _lru_destroy (struct oio_cache_s *self)
 		return;
 	lru_tree_destroy (l->lru);
 	l->lru = NULL;
+	g_mutex_clear (&l->lock);
 	SLICE_FREE (struct oio_cache_LRU_s, l);
 }
 
+static void
+_lru_expire (struct oio_cache_LRU_s *l)
+{
+	if (l->ttl > 0)
+		lru_tree_remove_older (l->lru, oio_ext_monotonic_time () - l->ttl);
+	if (l->max > 0)
+		lru_tree_remove_exceeding (l->lru, l->max);
+}
+
 static enum oio_cache_status_e
 _lru_put (struct oio_cache_s *self, const char *k, const char *v)
 {
-	(void) self, (void) k, (void) v;
-	return OIO_CACHE_DISCONNECTED;
+	struct oio_cache_LRU_s *l = (struct oio_cache_LRU_s*) self;
+	g_mutex_lock (&l->lock);
+	lru_tree_insert (l->lru, g_strdup(k), g_strdup(v));
+	_lru_expire (l);
+	g_mutex_unlock (&l->lock);
+	return OIO_CACHE_OK;
 }
 
 static enum oio_cache_status_e
 _lru_del (struct oio_cache_s *self, const char *k)
 {
-	(void) self, (void) k;
-	return OIO_CACHE_NOTFOUND;
+	struct oio_cache_LRU_s *l = (struct oio_cache_LRU_s*) self;
+	g_mutex_lock (&l->lock);
+	gboolean removed = lru_tree_remove (l->lru, k);
+	g_mutex_unlock (&l->lock);
+	return removed ? OIO_CACHE_OK : OIO_CACHE_NOTFOUND;
 }
 
 static enum oio_cache_status_e
 _lru_get (struct oio_cache_s *self, const char *k, gchar **out)
 {
-	(void) self, (void) k;
+	struct oio_cache_LRU_s *l = (struct oio_cache_LRU_s*) self;
 	g_assert (out != NULL);
-	*out = NULL;
-	return OIO_CACHE_NOTFOUND;
+	g_mutex_lock (&l->lock);
+	_lru_expire (l);
+	*out = g_strdup (lru_tree_get (l->lru, k));
+	g_mutex_unlock (&l->lock);
+	return *out ? OIO_CACHE_OK : OIO_CACHE_NOTFOUND;
 }
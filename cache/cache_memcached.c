@@ -28,10 +28,13 @@ static void _memcached_destroy (struct oio_cache_s *self);
 static enum oio_cache_status_e _memcached_put (struct oio_cache_s *self, const char *k, const char *v);
 static enum oio_cache_status_e _memcached_del (struct oio_cache_s *self, const char *k);
 static enum oio_cache_status_e _memcached_get (struct oio_cache_s *self, const char *k, gchar **out);
+static enum oio_cache_status_e _memcached_mput (struct oio_cache_s *self, const char * const *k, const char * const *v);
+static enum oio_cache_status_e _memcached_mget (struct oio_cache_s *self, const char * const *k, gchar **out);
 
 static struct oio_cache_vtable_s vtable_memcached =
 {
-	_memcached_destroy, _memcached_put, _memcached_del, _memcached_get
+	_memcached_destroy, _memcached_put, _memcached_del, _memcached_get,
+	_memcached_mput, _memcached_mget
 };
 
 struct oio_cache_memcached_s
@@ -132,3 +135,77 @@ _memcached_get (struct oio_cache_s *self, const char *k, gchar **out)
 	*out = memcached_get (c->memc, k, strlen(k), &length, &flags, &rc);
 	return memcached_parse_status(rc);
 }
+
+static enum oio_cache_status_e
+_memcached_mput (struct oio_cache_s *self, const char * const *k, const char * const *v)
+{
+	struct oio_cache_memcached_s *c = (struct oio_cache_memcached_s*) self;
+	enum oio_cache_status_e status = OIO_CACHE_OK;
+
+	/* Buffer the SETs, sent together at the flush */
+	const uint64_t buffered = memcached_behavior_get (c->memc,
+			MEMCACHED_BEHAVIOR_BUFFER_REQUESTS);
+	memcached_behavior_set (c->memc, MEMCACHED_BEHAVIOR_BUFFER_REQUESTS, 1);
+	for (guint i=0; k[i] ;++i) {
+		memcached_return_t rc = memcached_set (c->memc, k[i], strlen(k[i]),
+				v[i], strlen(v[i]), (time_t)0, (uint32_t)0);
+		/* the first error tells the most, the next ones only follow */
+		if (rc != MEMCACHED_BUFFERED && rc != MEMCACHED_SUCCESS
+				&& status == OIO_CACHE_OK)
+			status = memcached_parse_status(rc);
+	}
+	memcached_return_t rc = memcached_flush_buffers (c->memc);
+	if (rc != MEMCACHED_SUCCESS && status == OIO_CACHE_OK)
+		status = memcached_parse_status(rc);
+	memcached_behavior_set (c->memc, MEMCACHED_BEHAVIOR_BUFFER_REQUESTS, buffered);
+	return status;
+}
+
+static enum oio_cache_status_e
+_memcached_mget (struct oio_cache_s *self, const char * const *k, gchar **out)
+{
+	struct oio_cache_memcached_s *c = (struct oio_cache_memcached_s*) self;
+	const guint count = g_strv_length ((gchar**)k);
+	if (!count)
+		return OIO_CACHE_OK;
+
+	/* <key,index of its first occurrence> to dispatch the values */
+	GHashTable *index = g_hash_table_new (g_str_hash, g_str_equal);
+	size_t *lengths = g_malloc (count * sizeof(size_t));
+	for (guint i=0; i<count ;++i) {
+		lengths[i] = strlen(k[i]);
+		if (!g_hash_table_contains (index, k[i]))
+			g_hash_table_insert (index, (gpointer)k[i], GUINT_TO_POINTER(i));
+	}
+
+	memcached_return_t rc = memcached_mget (c->memc, k, lengths, count);
+	if (rc == MEMCACHED_SUCCESS) {
+		memcached_result_st *res;
+		while (NULL != (res = memcached_fetch_result (c->memc, NULL, &rc))) {
+			gchar *key = g_strndup (memcached_result_key_value (res),
+					memcached_result_key_length (res));
+			gpointer pi = NULL;
+			if (g_hash_table_lookup_extended (index, key, NULL, &pi)) {
+				const guint i = GPOINTER_TO_UINT(pi);
+				g_free (out[i]);
+				out[i] = g_strndup (memcached_result_value (res),
+						memcached_result_length (res));
+			}
+			g_free (key);
+			memcached_result_free (res);
+		}
+		if (rc == MEMCACHED_END || rc == MEMCACHED_NOTFOUND)
+			rc = MEMCACHED_SUCCESS;
+	}
+
+	/* The keys asked several times */
+	for (guint i=0; i<count ;++i) {
+		const guint first = GPOINTER_TO_UINT(g_hash_table_lookup (index, k[i]));
+		if (first != i && out[first])
+			out[i] = g_strdup (out[first]);
+	}
+
+	g_hash_table_destroy (index);
+	g_free (lengths);
+	return memcached_parse_status(rc);
+}
@@ -25,10 +25,13 @@ static void _multilayer_destroy (struct oio_cache_s *self);
 static enum oio_cache_status_e _multilayer_put (struct oio_cache_s *self, const char *k, const char *v);
 static enum oio_cache_status_e _multilayer_del (struct oio_cache_s *self, const char *k);
 static enum oio_cache_status_e _multilayer_get (struct oio_cache_s *self, const char *k, gchar **out);
+static enum oio_cache_status_e _multilayer_mput (struct oio_cache_s *self, const char * const *k, const char * const *v);
+static enum oio_cache_status_e _multilayer_mget (struct oio_cache_s *self, const char * const *k, gchar **out);
 
 static struct oio_cache_vtable_s vtable_multilayer =
 {
-	_multilayer_destroy, _multilayer_put, _multilayer_del, _multilayer_get
+	_multilayer_destroy, _multilayer_put, _multilayer_del, _multilayer_get,
+	_multilayer_mput, _multilayer_mget
 };
 
 struct oio_cache_multilayer_s
@@ -108,13 +111,82 @@ _multilayer_del (struct oio_cache_s *self, const char *k)
 
 static enum oio_cache_status_e
 _multilayer_get (struct oio_cache_s *self, const char *k, gchar **out)
+{
+	const char *keys[2] = {k, NULL};
+	*out = NULL;
+	enum oio_cache_status_e rc = _multilayer_mget (self, keys, out);
+	if (rc == OIO_CACHE_OK && !*out)
+		rc = OIO_CACHE_NOTFOUND;
+	return rc;
+}
+
+static enum oio_cache_status_e
+_multilayer_mput (struct oio_cache_s *self, const char * const *k, const char * const *v)
+{
+	struct oio_cache_multilayer_s *c = (struct oio_cache_multilayer_s*) self;
+	enum oio_cache_status_e rc = OIO_CACHE_FAIL;
+	for (GSList* it = c->caches; it != NULL; it = it->next) {
+		enum oio_cache_status_e cur_rc = oio_cache_mput(it->data, k, v);
+		if (rc != OIO_CACHE_OK)
+			rc = cur_rc;
+	}
+	return rc;
+}
+
+/* Each layer is only asked the keys missed by the layers above, in one
+ * batch, and the values it found are then put in one batch in each of the
+ * layers above. */
+static enum oio_cache_status_e
+_multilayer_mget (struct oio_cache_s *self, const char * const *k, gchar **out)
 {
 	struct oio_cache_multilayer_s *c = (struct oio_cache_multilayer_s*) self;
+	const guint count = g_strv_length ((gchar**)k);
 	enum oio_cache_status_e rc = OIO_CACHE_FAIL;
+	if (!count)
+		return OIO_CACHE_OK;
+
+	const char **missed = g_malloc0 ((count + 1) * sizeof(char*));
+	guint *where = g_malloc0 (count * sizeof(guint));
+	gchar **found = g_malloc0 ((count + 1) * sizeof(gchar*));
+	const char **hit_k = g_malloc0 ((count + 1) * sizeof(char*));
+	const char **hit_v = g_malloc0 ((count + 1) * sizeof(char*));
+
 	for (GSList* it = c->caches; it != NULL; it = it->next) {
-		rc = oio_cache_get(it->data, k, out);
-		if (rc == OIO_CACHE_OK)
+		guint nb_missed = 0;
+		for (guint i=0; i<count ;++i) {
+			if (!out[i]) {
+				where[nb_missed] = i;
+				missed[nb_missed++] = k[i];
+			}
+		}
+		missed[nb_missed] = NULL;
+		if (!nb_missed)
 			break;
+
+		enum oio_cache_status_e cur_rc = oio_cache_mget(it->data, missed, found);
+		if (rc != OIO_CACHE_OK)
+			rc = cur_rc;
+
+		guint nb_hit = 0;
+		for (guint i=0; i<nb_missed ;++i) {
+			if (!found[i])
+				continue;
+			out[where[i]] = found[i];
+			hit_k[nb_hit] = missed[i];
+			hit_v[nb_hit++] = found[i];
+		}
+		hit_k[nb_hit] = hit_v[nb_hit] = NULL;
+
+		if (nb_hit > 0) {
+			for (GSList *up = c->caches; up != it; up = up->next)
+				oio_cache_mput(up->data, hit_k, hit_v);
+		}
 	}
-	return rc; 
+
+	g_free (missed);
+	g_free (where);
+	g_free (found);
+	g_free (hit_k);
+	g_free (hit_v);
+	return rc;
 }
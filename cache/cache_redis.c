@@ -28,10 +28,12 @@ static void _redis_destroy (struct oio_cache_s *self);
 static enum oio_cache_status_e _redis_put (struct oio_cache_s *self, const char *k, const char *v);
 static enum oio_cache_status_e _redis_del (struct oio_cache_s *self, const char *k);
 static enum oio_cache_status_e _redis_get (struct oio_cache_s *self, const char *k, gchar **out);
+static enum oio_cache_status_e _redis_mput (struct oio_cache_s *self, const char * const *k, const char * const *v);
+static enum oio_cache_status_e _redis_mget (struct oio_cache_s *self, const char * const *k, gchar **out);
 
 static struct oio_cache_vtable_s vtable_redis =
 {
-	_redis_destroy, _redis_put, _redis_del, _redis_get
+	_redis_destroy, _redis_put, _redis_del, _redis_get, _redis_mput, _redis_mget
 };
 
 struct oio_cache_redis_s
@@ -157,3 +159,51 @@ _redis_get (struct oio_cache_s *self, const char *k, gchar **out)
 	struct redisReply *reply = redisCommand (c->redis, "GET %s", k);
 	return redis_parse_reply (c->redis, reply, out);
 }
+
+/* The commands of a batch are all sent before the first reply is read.
+ * Once a reply is missing, the connection is lost for the next ones. */
+static enum oio_cache_status_e
+_redis_pipeline_replies (struct oio_cache_redis_s *c, guint count, gchar **out)
+{
+	enum oio_cache_status_e rc = OIO_CACHE_OK;
+	for (guint i=0; i<count && rc != OIO_CACHE_DISCONNECTED ;++i) {
+		struct redisReply *reply = NULL;
+		if (REDIS_OK != redisGetReply (c->redis, (void**)&reply))
+			reply = NULL;
+		enum oio_cache_status_e cur_rc = redis_parse_reply (c->redis, reply,
+				out ? out+i : NULL);
+		if (cur_rc == OIO_CACHE_NOTFOUND && out)
+			continue;
+		if (cur_rc != OIO_CACHE_OK)
+			rc = cur_rc;
+	}
+	return rc;
+}
+
+static enum oio_cache_status_e
+_redis_mput (struct oio_cache_s *self, const char * const *k, const char * const *v)
+{
+	struct oio_cache_redis_s *c = (struct oio_cache_redis_s*) self;
+	guint count = 0;
+	for (; k[count] ;++count) {
+		if (REDIS_OK != redisAppendCommand (c->redis, "SET %s %s", k[count], v[count])) {
+			_redis_pipeline_replies (c, count, NULL);
+			return OIO_CACHE_FAIL;
+		}
+	}
+	return _redis_pipeline_replies (c, count, NULL);
+}
+
+static enum oio_cache_status_e
+_redis_mget (struct oio_cache_s *self, const char * const *k, gchar **out)
+{
+	struct oio_cache_redis_s *c = (struct oio_cache_redis_s*) self;
+	guint count = 0;
+	for (; k[count] ;++count) {
+		if (REDIS_OK != redisAppendCommand (c->redis, "GET %s", k[count])) {
+			_redis_pipeline_replies (c, count, out);
+			return OIO_CACHE_FAIL;
+		}
+	}
+	return _redis_pipeline_replies (c, count, out);
+}
@@ -162,11 +162,28 @@ void ** oio_ext_array_concat (void **t0, void **t1) {
 
 /* -------------------------------------------------------------------------- */
 
+struct oio_ext_span_s {
+	const char *name;
+	gint64 start; /* relative to the start of the trace */
+	gint64 duration;
+};
+
+struct oio_ext_trace_s {
+	gboolean running;
+	gint64 start;
+	const char *current;
+	gchar parent[64];
+	guint count;
+	guint dropped;
+	struct oio_ext_span_s spans[OIO_TRACE_MAX_SPANS];
+};
+
 /** @private */
 struct oio_ext_local_s {
 	gchar *reqid;
 	GRand *prng;
 	gboolean is_admin;
+	struct oio_ext_trace_s trace;
 };
 
 static void _local_free (gpointer p) {
@@ -253,6 +270,144 @@ oio_ext_set_admin (const gboolean admin)
 	l->is_admin = admin;
 }
 
+/* -------------------------------------------------------------------------- */
+
+static GMutex trace_lock = {0};
+static gchar *trace_ring[OIO_TRACE_RING_SIZE] = {NULL};
+static guint trace_next = 0;
+
+void
+oio_ext_trace_start (const char *parent, gint64 start)
+{
+	struct oio_ext_trace_s *t = &(_local_ensure ()->trace);
+	t->running = TRUE;
+	t->start = start;
+	t->current = NULL;
+	g_strlcpy (t->parent, parent ? parent : "", sizeof(t->parent));
+	t->count = t->dropped = 0;
+}
+
+static gchar *
+_trace_encode (const struct oio_ext_local_s *l, gint64 total)
+{
+	const struct oio_ext_trace_s *t = &l->trace;
+	GString *gs = g_string_sized_new (128 + 64 * t->count);
+	g_string_append_c (gs, '{');
+	oio_str_gstring_append_json_pair (gs, "reqid", l->reqid);
+	g_string_append_c (gs, ',');
+	oio_str_gstring_append_json_pair (gs, "parent",
+			*t->parent ? t->parent : NULL);
+	g_string_append_c (gs, ',');
+	oio_str_gstring_append_json_pair_int (gs, "start",
+			oio_ext_real_time () - total);
+	g_string_append_c (gs, ',');
+	oio_str_gstring_append_json_pair_int (gs, "total", total);
+	g_string_append_c (gs, ',');
+	oio_str_gstring_append_json_pair_int (gs, "dropped", t->dropped);
+	g_string_append (gs, ",\"spans\":[");
+	for (guint i=0; i<t->count ;++i) {
+		const struct oio_ext_span_s *sp = t->spans + i;
+		if (i)
+			g_string_append_c (gs, ',');
+		g_string_append_c (gs, '{');
+		oio_str_gstring_append_json_pair (gs, "name", sp->name);
+		g_string_append_c (gs, ',');
+		oio_str_gstring_append_json_pair_int (gs, "at", sp->start);
+		g_string_append_c (gs, ',');
+		oio_str_gstring_append_json_pair_int (gs, "took", sp->duration);
+		g_string_append_c (gs, '}');
+	}
+	g_string_append (gs, "]}");
+	return g_string_free (gs, FALSE);
+}
+
+void
+oio_ext_trace_stop (gint64 slow)
+{
+	struct oio_ext_local_s *l = _local_ensure ();
+	struct oio_ext_trace_s *t = &l->trace;
+	if (!t->running)
+		return;
+	t->running = FALSE;
+	t->current = NULL;
+
+	const gint64 total = oio_ext_monotonic_time () - t->start;
+	if (total < slow)
+		return;
+
+	/* Encoded out of the lock, the ring only swaps pointers */
+	gchar *encoded = _trace_encode (l, total);
+	g_mutex_lock (&trace_lock);
+	gchar *old = trace_ring[trace_next];
+	trace_ring[trace_next] = encoded;
+	trace_next = (trace_next + 1) % OIO_TRACE_RING_SIZE;
+	g_mutex_unlock (&trace_lock);
+	g_free (old);
+}
+
+void
+oio_ext_trace_span (const char *name, gint64 start)
+{
+	struct oio_ext_trace_s *t = &(_local_ensure ()->trace);
+	if (!t->running)
+		return;
+	if (t->count >= OIO_TRACE_MAX_SPANS) {
+		t->dropped ++;
+		return;
+	}
+	struct oio_ext_span_s *sp = t->spans + (t->count++);
+	sp->name = name;
+	sp->start = start - t->start;
+	sp->duration = oio_ext_monotonic_time () - start;
+}
+
+const char *
+oio_ext_trace_enter (const char *name)
+{
+	struct oio_ext_trace_s *t = &(_local_ensure ()->trace);
+	const char *prev = t->current;
+	if (t->running)
+		t->current = name;
+	return prev;
+}
+
+void
+oio_ext_trace_leave (const char *name, const char *prev, gint64 start)
+{
+	oio_ext_trace_span (name, start);
+	_local_ensure ()->trace.current = prev;
+}
+
+const char *
+oio_ext_trace_context (void)
+{
+	const struct oio_ext_trace_s *t = &(_local_ensure ()->trace);
+	if (!t->running)
+		return NULL;
+	if (t->current)
+		return t->current;
+	return *t->parent ? t->parent : "root";
+}
+
+void
+oio_ext_trace_dump (GString *out)
+{
+	gboolean first = TRUE;
+	g_string_append_c (out, '[');
+	g_mutex_lock (&trace_lock);
+	for (guint i=0; i<OIO_TRACE_RING_SIZE ;++i) {
+		const gchar *s = trace_ring[(trace_next + i) % OIO_TRACE_RING_SIZE];
+		if (!s)
+			continue;
+		if (!first)
+			g_string_append_c (out, ',');
+		first = FALSE;
+		g_string_append (out, s);
+	}
+	g_mutex_unlock (&trace_lock);
+	g_string_append_c (out, ']');
+}
+
 
 /* -------------------------------------------------------------------------- */
 
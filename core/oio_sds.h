@@ -49,6 +49,48 @@ enum oio_sds_config_e
 	 * and instead sort them by score.
 	 * Expects an <int> used for its boolean value. */
 	OIOSDS_CFG_FLAG_NO_SHUFFLE,
+
+	/* Delay without a first byte from a replicated chunk before the same
+	 * range is also requested to the next replica (hedged read). The
+	 * fastest replica wins, the other is cancelled. 0 disables the hedged
+	 * reads (the default).
+	 * Expects an <int> as a number of milliseconds. */
+	OIOSDS_CFG_HEDGE_DELAY,
+
+	/* When hedged reads are enabled, the percentile of the first-byte
+	 * latencies observed on the rawx that is waited for before hedging,
+	 * if it is greater than OIOSDS_CFG_HEDGE_DELAY. Defaults to 95.
+	 * Expects an <int> between 1 and 99. */
+	OIOSDS_CFG_HEDGE_PERCENTILE,
+
+	/* How many metachunks (or sub-ranges of metachunks) are downloaded
+	 * concurrently. 1 keeps the sequential download (the default).
+	 * Expects an <int>. */
+	OIOSDS_CFG_DL_PARALLELISM,
+
+	/* Memory budget for the data downloaded in parallel that still waits
+	 * to be delivered, in order, to a sequential hook. It also bounds the
+	 * size of each sub-range. Defaults to 64MiB.
+	 * Expects an <int> as a number of bytes. */
+	OIOSDS_CFG_DL_BUFFER_SIZE,
+
+	/* How many contents are kept in the local cache of the handle, for
+	 * the downloads to spare a request to the proxy. 0 disables the local
+	 * cache (the default). Meant for contents seldom overwritten: the
+	 * entries are dropped on the local writes, when a rawx does not know a
+	 * chunk anymore, and after OIOSDS_CFG_CACHE_TTL.
+	 * Expects an <int> as a number of contents. */
+	OIOSDS_CFG_CACHE_SIZE,
+
+	/* How long a content stays in the local cache. Defaults to 60.
+	 * Expects an <int> as a number of seconds. */
+	OIOSDS_CFG_CACHE_TTL,
+
+	/* A cache shared with other clients (e.g. oio_cache_make_redis()),
+	 * asked after the local cache, that the handle takes the ownership of.
+	 * NULL disables it (the default).
+	 * Expects a <struct oio_cache_s *>. */
+	OIOSDS_CFG_CACHE_SHARED,
 };
 
 enum oio_sds_content_key_e
@@ -74,6 +74,22 @@ extern "C" {
 # define PROXYD_HEADER_ADMIN PROXYD_HEADER_PREFIX "admin"
 # endif
 
+/* in oio_ext_monotonic_time() precision. The traces of the requests that
+ * last longer are kept in memory for later inspection. */
+# ifndef OIO_TRACE_SLOW
+#  define OIO_TRACE_SLOW (500*G_TIME_SPAN_MILLISECOND)
+# endif
+
+/* How many spans are recorded per request, the others are ignored */
+# ifndef OIO_TRACE_MAX_SPANS
+#  define OIO_TRACE_MAX_SPANS 32
+# endif
+
+/* How many slow traces are kept, the oldest are dropped */
+# ifndef OIO_TRACE_RING_SIZE
+#  define OIO_TRACE_RING_SIZE 64
+# endif
+
 # ifndef PROXYD_HEADER_NOEMPTY
 #  define PROXYD_HEADER_NOEMPTY PROXYD_HEADER_PREFIX "no-empty-list"
 # endif
@@ -92,6 +108,24 @@ extern "C" {
 #  define PROXYD_DEFAULT_MAX_SERVICES 200000
 # endif
 
+/* in bytes. Above this size, a JSON reply is sent in pieces of this size
+ * with the chunked transfer-encoding, instead of being built at once. */
+# ifndef PROXYD_STREAM_CHUNK_SIZE
+#  define PROXYD_STREAM_CHUNK_SIZE (64*1024)
+# endif
+
+/* in bytes. Above this size of reply waiting to be sent, the production of a
+ * streamed reply waits for the client to read it. */
+# ifndef PROXYD_STREAM_MAX_PENDING
+#  define PROXYD_STREAM_MAX_PENDING (4*PROXYD_STREAM_CHUNK_SIZE)
+# endif
+
+/* in oio_ext_monotonic_time() precision. How long a streamed reply waits
+ * for the client to read it, before it is aborted. */
+# ifndef PROXYD_STREAM_TIMEOUT
+#  define PROXYD_STREAM_TIMEOUT (30 * G_TIME_SPAN_SECOND)
+# endif
+
 /* in oio_ext_monotonic_time() precision */
 # ifndef PROXYD_DEFAULT_TTL_CSM0
 #  define PROXYD_DEFAULT_TTL_CSM0 0
@@ -191,6 +225,11 @@ extern "C" {
 # define SQLX_SYNC_DEFAULT_ZK_TIMEOUT 8765
 #endif
 
+/* Max number of ZooKeeper operations sent in a single multi-op */
+#ifndef SQLX_SYNC_BATCH_MAX
+# define SQLX_SYNC_BATCH_MAX 128
+#endif
+
 # ifndef SQLX_CLIENT_TIMEOUT
 #  define SQLX_CLIENT_TIMEOUT 30.0
 # endif
@@ -211,6 +250,34 @@ extern "C" {
 #  define SQLX_RESYNC_TIMEOUT 30.0
 # endif
 
+/* How long a SLAVE base known to be behind its MASTER still serves the
+   reads, in microseconds */
+# ifndef SQLX_SLAVE_MAX_LAG
+#  define SQLX_SLAVE_MAX_LAG (5*G_TIME_SPAN_SECOND)
+# endif
+
+/* How long a base in WAL mode stays idle before its WAL is checkpointed,
+   in microseconds */
+# ifndef SQLX_WAL_IDLE_DELAY
+#  define SQLX_WAL_IDLE_DELAY (2*G_TIME_SPAN_SECOND)
+# endif
+
+/* How many bases already checkpointed the walk among the idle bases skips,
+   per base to checkpoint, before giving up until the next round */
+# ifndef SQLX_IDLE_VISIT_WALK
+#  define SQLX_IDLE_VISIT_WALK 4
+# endif
+
+/* In pages, the size of the WAL that triggers a checkpoint at commit time */
+# ifndef SQLX_WAL_AUTOCHECKPOINT
+#  define SQLX_WAL_AUTOCHECKPOINT 1000
+# endif
+
+/* In bytes, the size the WAL is truncated to after a checkpoint */
+# ifndef SQLX_WAL_SIZE_LIMIT
+#  define SQLX_WAL_SIZE_LIMIT (4*1024*1024)
+# endif
+
 # ifndef M2V2_CLIENT_TIMEOUT
 #  define M2V2_CLIENT_TIMEOUT 10.0
 # endif
@@ -248,6 +315,21 @@ extern "C" {
 #  define OIO_EVTQ_BUFFER_DELAY 5
 # endif
 
+/* Max size in bytes of a batch of events */
+# ifndef OIO_EVTQ_BATCH_BYTES
+#  define OIO_EVTQ_BATCH_BYTES (256*1024)
+# endif
+
+/* Max delay in milliseconds before a batch of events is sent */
+# ifndef OIO_EVTQ_BATCH_DELAY
+#  define OIO_EVTQ_BATCH_DELAY 10
+# endif
+
+/* Default size in bytes of the file where the events overflow */
+# ifndef OIO_EVTQ_SPOOL_SIZE
+#  define OIO_EVTQ_SPOOL_SIZE (256*1024*1024)
+# endif
+
 # ifndef  OIO_CFG_EVTQ_MAXPENDING
 #  define OIO_CFG_EVTQ_MAXPENDING "events-max-pending"
 # endif
@@ -256,6 +338,22 @@ extern "C" {
 #  define OIO_CFG_EVTQ_BUFFER_DELAY "events-buffer-delay"
 # endif
 
+# ifndef  OIO_CFG_EVTQ_BATCH_EVENTS
+#  define OIO_CFG_EVTQ_BATCH_EVENTS "events-batch-max-events"
+# endif
+
+# ifndef  OIO_CFG_EVTQ_BATCH_BYTES
+#  define OIO_CFG_EVTQ_BATCH_BYTES "events-batch-max-bytes"
+# endif
+
+# ifndef  OIO_CFG_EVTQ_BATCH_DELAY
+#  define OIO_CFG_EVTQ_BATCH_DELAY "events-batch-delay"
+# endif
+
+# ifndef  OIO_CFG_EVTQ_BATCH_COMPRESS
+#  define OIO_CFG_EVTQ_BATCH_COMPRESS "events-batch-compress"
+# endif
+
 /* Max number of events raised by epoll_wait */
 # ifndef  SERVER_DEFAULT_EPOLL_MAXEV
 #  define SERVER_DEFAULT_EPOLL_MAXEV 128
@@ -282,12 +380,58 @@ extern "C" {
 #  define SERVER_DEFAULT_THP_IDLE  30000
 # endif
 
+/* in bytes. The buffer where a gridd request is reassembled, when it spans
+ * several reads, is kept for the next requests of the connection unless it
+ * grew larger. */
+# ifndef  SERVER_L4V_KEEP
+#  define SERVER_L4V_KEEP  (64*1024)
+# endif
+
+/* in bytes. The name of a gridd request is copied on the stack of the worker,
+ * the longer names are rejected. */
+# ifndef  SERVER_REQNAME_MAX
+#  define SERVER_REQNAME_MAX  1024
+# endif
+
+/* in bytes. The small replies produced while a worker manages the input of
+ * a client are held until then, and sent together, until they reach this
+ * size. */
+# ifndef  SERVER_CORK_MAX
+#  define SERVER_CORK_MAX  (16*1024)
+# endif
+
+/* Max number of distinct statistics held by a server, a power of two */
+# ifndef  SERVER_STATS_MAX
+#  define SERVER_STATS_MAX  1024
+# endif
+
+/* Number of sets of counters the threads of a server are spread over */
+# ifndef  SERVER_STATS_SHARDS
+#  define SERVER_STATS_SHARDS  16
+# endif
+
+/* The latencies are known for the last SLOTS*WIDTH seconds */
+# ifndef  SERVER_STATS_LATENCY_SLOTS
+#  define SERVER_STATS_LATENCY_SLOTS  6
+# endif
+
+/* in seconds */
+# ifndef  SERVER_STATS_LATENCY_WIDTH
+#  define SERVER_STATS_LATENCY_WIDTH  10
+# endif
+
 /* How long (in microseconds) a connection might stay idle between two
  * requests */
 #ifndef  SERVER_DEFAULT_CNX_IDLE
 # define SERVER_DEFAULT_CNX_IDLE  (5 * G_TIME_SPAN_MINUTE)
 #endif
 
+/* How long (in microseconds) a suspended connection might wait to be
+ * resumed */
+#ifndef  SERVER_DEFAULT_CNX_SUSPENDED
+# define SERVER_DEFAULT_CNX_SUSPENDED  (5 * G_TIME_SPAN_MINUTE)
+#endif
+
 /* How long (in microseconds) a connection might exist since its creation
  * (whatever it is active or not) */
 #ifndef  SERVER_DEFAULT_CNX_LIFETIME
@@ -111,6 +111,42 @@ gboolean oio_ext_is_admin(void);
 
 void oio_ext_set_admin(const gboolean admin);
 
+/* Starts recording the spans of the request managed by the current thread,
+ * keyed by its request-id. 'parent' is the span of the caller that issued
+ * the request, when it comes from another service. 'start' is when the
+ * request began to be received (oio_ext_monotonic_time() precision). A
+ * trace already started in the thread is discarded. */
+void oio_ext_trace_start (const char *parent, gint64 start);
+
+/* Ends the trace of the current thread. If it lasted at least 'slow'
+ * (in oio_ext_monotonic_time() precision), it is kept in a process-wide
+ * ring of the last slow traces. */
+void oio_ext_trace_stop (gint64 slow);
+
+/* Records a span that started at 'start' and ends now. 'name' must be a
+ * static string. Does nothing if no trace has been started. */
+void oio_ext_trace_span (const char *name, gint64 start);
+
+/* Marks 'name' as the span currently running and returns the previous
+ * one, to be given back to oio_ext_trace_leave(). */
+const char * oio_ext_trace_enter (const char *name);
+
+void oio_ext_trace_leave (const char *name, const char *prev, gint64 start);
+
+/* The span currently running, to be forwarded to the services called, or
+ * NULL if no trace has been started. */
+const char * oio_ext_trace_context (void);
+
+/* Appends the slow traces kept, as a JSON array, the oldest first */
+void oio_ext_trace_dump (GString *out);
+
+#define OIO_TRACE(Name,Action) do { \
+	const gint64 _trace_start = oio_ext_monotonic_time (); \
+	const char *_trace_prev = oio_ext_trace_enter (Name); \
+	Action ; \
+	oio_ext_trace_leave (Name, _trace_prev, _trace_start); \
+} while (0)
+
 gint64 oio_ext_real_time (void);
 
 gint64 oio_ext_monotonic_time (void);
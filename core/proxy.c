@@ -168,6 +168,19 @@ _curl_content_url (struct oio_url_s *u, const char *action)
 	return hu;
 }
 
+/* For the actions reading a specific version of a content. The others, e.g.
+ * link or set_properties, reject a content ID. */
+static GString *
+_curl_content_version_url (struct oio_url_s *u, const char *action)
+{
+	GString *hu = _curl_content_url (u, action);
+	if (!hu) return NULL;
+
+	_append (hu, '&', "version", oio_url_get (u, OIOURL_VERSION));
+	_append (hu, '&', "content", oio_url_get (u, OIOURL_CONTENTID));
+	return hu;
+}
+
 /* -------------------------------------------------------------------------- */
 
 static GError *
@@ -478,7 +491,7 @@ GError *
 oio_proxy_call_content_get_properties(CURL *h, struct oio_url_s *u,
 		GString **props_str)
 {
-	GString *http_url = _curl_content_url(u, "get_properties");
+	GString *http_url = _curl_content_version_url(u, "get_properties");
 	if (!http_url)
 		return BADNS();
 
@@ -504,7 +517,7 @@ GError *
 oio_proxy_call_content_show (CURL *h, struct oio_url_s *u, GString *out,
 		gchar ***hout)
 {
-	GString *http_url = _curl_content_url (u, "show");
+	GString *http_url = _curl_content_version_url (u, "show");
 	if (!http_url) return BADNS();
 
 	struct http_ctx_s o = {
@@ -39,6 +39,7 @@ License along with this library.
 
 #include <metautils/lib/metautils.h>
 #include <metautils/lib/storage_policy.h>
+#include <cache/cache.h>
 
 struct oio_sds_s
 {
@@ -54,6 +55,20 @@ struct oio_sds_s
 	gboolean sync_after_download;
 	gboolean admin;
 	gboolean no_shuffle;  // read the highest scored chunk instead of shuffling
+	struct {
+		gint64 delay;  // microseconds, 0 disables the hedged reads
+		guint percentile;
+	} hedge;
+	struct {
+		guint parallelism;
+		gsize buffer_size;
+	} dl;
+	struct {
+		struct oio_cache_s *local;  // NULL when disabled
+		struct oio_cache_s *shared;  // NULL when disabled
+		guint max;
+		gint64 ttl;
+	} cache;
 	gchar *auth_token;
 	CURL *h;
 };
@@ -438,6 +453,11 @@ oio_sds_init (struct oio_sds_s **out, const char *ns)
 	(*out)->ecd = oio_cfg_get_ecd(ns);
 	(*out)->sync_after_download = TRUE;
 	(*out)->no_shuffle = oio_sds_no_shuffle;
+	(*out)->hedge.delay = 0;
+	(*out)->hedge.percentile = 95;
+	(*out)->dl.parallelism = 1;
+	(*out)->dl.buffer_size = 64 * 1024 * 1024;
+	(*out)->cache.ttl = 60 * G_TIME_SPAN_SECOND;
 	(*out)->admin = FALSE;
 	(*out)->h = _get_proxy_handle (*out);
 	return NULL;
@@ -452,6 +472,10 @@ oio_sds_free (struct oio_sds_s *sds)
 	oio_str_clean (&sds->proxy);
 	oio_str_clean (&sds->proxy_local);
 	oio_str_clean(&sds->ecd);
+	if (sds->cache.local)
+		oio_cache_destroy (sds->cache.local);
+	if (sds->cache.shared)
+		oio_cache_destroy (sds->cache.shared);
 	if (sds->h)
 		curl_easy_cleanup (sds->h);
 	SLICE_FREE (struct oio_sds_s, sds);
@@ -465,6 +489,22 @@ oio_sds_pfree (struct oio_sds_s **psds)
 	*psds = NULL;
 }
 
+static void
+_cache_reset_local (struct oio_sds_s *sds)
+{
+	if (sds->cache.local)
+		oio_cache_destroy (sds->cache.local);
+	sds->cache.local = NULL;
+	if (sds->cache.max > 0) {
+		/* No atime, so that the TTL bounds how long a content replaced
+		 * by another client may be served from the cache */
+		struct lru_tree_s *lru = lru_tree_create (
+				(GCompareFunc)g_strcmp0, g_free, g_free, LTO_NOATIME);
+		sds->cache.local = oio_cache_make_LRU_bounded (lru,
+				sds->cache.max, sds->cache.ttl);
+	}
+}
+
 int
 oio_sds_configure (struct oio_sds_s *sds, enum oio_sds_config_e what,
 		void *pv, unsigned int vlen)
@@ -497,6 +537,57 @@ oio_sds_configure (struct oio_sds_s *sds, enum oio_sds_config_e what,
 				return EINVAL;
 			sds->no_shuffle = BOOL(*(int*)pv);
 			return 0;
+		case OIOSDS_CFG_HEDGE_DELAY:
+			if (vlen != sizeof(int))
+				return EINVAL;
+			if (*(int*)pv < 0)
+				return ERANGE;
+			sds->hedge.delay = (gint64)(*(int*)pv) * G_TIME_SPAN_MILLISECOND;
+			return 0;
+		case OIOSDS_CFG_HEDGE_PERCENTILE:
+			if (vlen != sizeof(int))
+				return EINVAL;
+			if (*(int*)pv < 1 || *(int*)pv > 99)
+				return ERANGE;
+			sds->hedge.percentile = *(int*)pv;
+			return 0;
+		case OIOSDS_CFG_DL_PARALLELISM:
+			if (vlen != sizeof(int))
+				return EINVAL;
+			if (*(int*)pv < 1)
+				return ERANGE;
+			sds->dl.parallelism = *(int*)pv;
+			return 0;
+		case OIOSDS_CFG_DL_BUFFER_SIZE:
+			if (vlen != sizeof(int))
+				return EINVAL;
+			if (*(int*)pv < 4096)
+				return ERANGE;
+			sds->dl.buffer_size = *(int*)pv;
+			return 0;
+		case OIOSDS_CFG_CACHE_SIZE:
+			if (vlen != sizeof(int))
+				return EINVAL;
+			if (*(int*)pv < 0)
+				return ERANGE;
+			sds->cache.max = *(int*)pv;
+			_cache_reset_local (sds);
+			return 0;
+		case OIOSDS_CFG_CACHE_TTL:
+			if (vlen != sizeof(int))
+				return EINVAL;
+			if (*(int*)pv < 0)
+				return ERANGE;
+			sds->cache.ttl = (gint64)(*(int*)pv) * G_TIME_SPAN_SECOND;
+			_cache_reset_local (sds);
+			return 0;
+		case OIOSDS_CFG_CACHE_SHARED:
+			if (vlen != sizeof(struct oio_cache_s*))
+				return EINVAL;
+			if (sds->cache.shared)
+				oio_cache_destroy (sds->cache.shared);
+			sds->cache.shared = *(struct oio_cache_s**)pv;
+			return 0;
 		default:
 			return EBADSLT;
 	}
@@ -513,15 +604,115 @@ oio_sds_create (struct oio_sds_s *sds, struct oio_url_s *url)
 }
 
 
+/* Client cache of the contents ------------------------------------------- */
+
+/* The reply of a content/show is cached as its properties, one "k: v" per
+ * line, then an empty line, then the JSON array of beans. The key is the
+ * whole URL (with the content ID when set) and the version, so that each
+ * version asked explicitly has its own entry, only dropped when its chunks
+ * are gone. */
+
+static gboolean
+_cache_enabled (struct oio_sds_s *sds)
+{
+	return sds->cache.local != NULL || sds->cache.shared != NULL;
+}
+
+static gchar *
+_cache_key (struct oio_url_s *url)
+{
+	const char *version = oio_url_get (url, OIOURL_VERSION);
+	return g_strconcat (oio_url_get (url, OIOURL_WHOLE),
+			"#", version ? version : "", NULL);
+}
+
+static void
+_cache_store (struct oio_sds_s *sds, const char *k,
+		GString *body, gchar **props)
+{
+	GString *v = g_string_sized_new (body->len + 256);
+	for (gchar **p = props; p && *p && *(p+1); p += 2)
+		g_string_append_printf (v, "%s: %s\n", *p, *(p+1));
+	g_string_append_c (v, '\n');
+	g_string_append_len (v, body->str, body->len);
+
+	if (sds->cache.local)
+		oio_cache_put (sds->cache.local, k, v->str);
+	if (sds->cache.shared)
+		oio_cache_put (sds->cache.shared, k, v->str);
+	g_string_free (v, TRUE);
+}
+
+static gboolean
+_cache_load (struct oio_sds_s *sds, const char *k,
+		GString *body, gchar ***pprops)
+{
+	/* The lookup of a multilayer cache, without one that would own the
+	 * layers configured apart: the shared layer is only asked on a miss of
+	 * the local one, and its hit is back-filled in the local layer. */
+	const char *keys[2] = {k, NULL};
+	gchar *v = NULL;
+	if (sds->cache.local)
+		oio_cache_mget (sds->cache.local, keys, &v);
+	if (!v && sds->cache.shared) {
+		oio_cache_mget (sds->cache.shared, keys, &v);
+		if (v && sds->cache.local) {
+			const char *values[2] = {v, NULL};
+			oio_cache_mput (sds->cache.local, keys, values);
+		}
+	}
+	if (!v)
+		return FALSE;
+
+	GPtrArray *tmp = g_ptr_array_new_with_free_func (g_free);
+	gchar *p = v;
+	while (*p && *p != '\n') {
+		gchar *eol = strchr (p, '\n');
+		gchar *sep = strstr (p, ": ");
+		if (!eol || !sep || sep > eol)
+			break;
+		g_ptr_array_add (tmp, g_strndup (p, sep - p));
+		g_ptr_array_add (tmp, g_strndup (sep + 2, eol - sep - 2));
+		p = eol + 1;
+	}
+	if (*p != '\n') {
+		GRID_DEBUG("Invalid cache entry for [%s]", k);
+		g_ptr_array_free (tmp, TRUE);
+		g_free (v);
+		return FALSE;
+	}
+
+	g_ptr_array_add (tmp, NULL);
+	*pprops = (gchar**) g_ptr_array_free (tmp, FALSE);
+	g_string_assign (body, p + 1);
+	g_free (v);
+	return TRUE;
+}
+
+static void
+_cache_forget (struct oio_sds_s *sds, struct oio_url_s *url)
+{
+	if (!_cache_enabled (sds))
+		return;
+	gchar *k = _cache_key (url);
+	if (sds->cache.local)
+		oio_cache_del (sds->cache.local, k);
+	if (sds->cache.shared)
+		oio_cache_del (sds->cache.shared, k);
+	g_free (k);
+}
+
 /* Helper to show a content ------------------------------------------------- */
 
 typedef void oio_sds_chunk_reporter_f (gpointer data, struct chunk_s *chunk);
 
+/* <pcached> is set to TRUE when the beans come from the client cache */
 static GError *
 _show_content (struct oio_sds_s *sds, struct oio_url_s *url, void *cb_data,
 		oio_sds_info_reporter_f cb_info,
 		oio_sds_chunk_reporter_f cb_chunks,
-		oio_sds_property_reporter_f cb_props)
+		oio_sds_property_reporter_f cb_props,
+		gboolean *pcached)
 {
 	EXTRA_ASSERT (sds != NULL);
 	EXTRA_ASSERT (url != NULL);
@@ -530,11 +721,23 @@ _show_content (struct oio_sds_s *sds, struct oio_url_s *url, void *cb_data,
 	GSList *chunks = NULL;
 	GString *reply_body = g_string_new("");
 	gchar **props = NULL;
-
-	/* Get the beans */
-	err = oio_proxy_call_content_show (sds->h, url,
-		   cb_chunks ? reply_body : NULL,
-		   cb_props || cb_info ? &props : NULL);
+	const gboolean caching = _cache_enabled (sds);
+	gboolean cached = FALSE;
+
+	/* Get the beans, the whole reply when it may be cached */
+	gchar *key = caching ? _cache_key (url) : NULL;
+	if (caching)
+		cached = _cache_load (sds, key, reply_body, &props);
+	if (!cached) {
+		err = oio_proxy_call_content_show (sds->h, url,
+			   caching || cb_chunks ? reply_body : NULL,
+			   caching || cb_props || cb_info ? &props : NULL);
+		if (!err && caching)
+			_cache_store (sds, key, reply_body, props);
+	}
+	g_free (key);
+	if (pcached)
+		*pcached = cached;
 
 	/* Parse the beans */
 	if (!err && reply_body->len > 0) {
@@ -591,6 +794,9 @@ _show_content (struct oio_sds_s *sds, struct oio_url_s *url, void *cb_data,
 		chunks = NULL;
 	}
 
+	if (err && cached)
+		_cache_forget (sds, url);
+
 	g_slist_free_full (chunks, g_free);
 	if (props) g_strfreev (props);
 	g_string_free (reply_body, TRUE);
@@ -609,6 +815,14 @@ struct _download_ctx_s
 
 	struct metachunk_s **metachunks;
 	GSList *chunks;
+
+	/* Set when the destination is a regular file, so that the parallel
+	 * download may write each part at its place. -1 otherwise. */
+	int fd;
+
+	/* Set when a rawx did not know a chunk (404/410), the chunks may come
+	 * from a stale cache entry */
+	volatile gint stale;
 };
 
 static void
@@ -701,6 +915,8 @@ _download_range_from_chunk (struct _download_ctx_s *dl,
 		rc = curl_easy_getinfo (h, CURLINFO_RESPONSE_CODE, &code);
 		if (2 != (code/100))
 			err = SYSERR("Download: (%ld)", code);
+		if (code == 404 || code == 410)
+			g_atomic_int_set (&dl->stale, 1);
 	}
 
 	curl_easy_cleanup (h);
@@ -708,6 +924,345 @@ _download_range_from_chunk (struct _download_ctx_s *dl,
 	return err;
 }
 
+/* Rawx latency tracking --------------------------------------------------- */
+
+/* The first-byte latencies are kept per rawx service, for the whole process,
+ * in a small ring of the most recent samples. They drive both the order the
+ * replicas are tried in and the delay before a hedged read. */
+
+#define RAWX_LATENCY_SAMPLES 32
+#define RAWX_LATENCY_MIN_SAMPLES 8
+
+struct rawx_latency_s
+{
+	guint next;
+	guint count;
+	gint64 samples[RAWX_LATENCY_SAMPLES];
+};
+
+static GMutex rawx_latency_lock = {0};
+static GHashTable *rawx_latency = NULL;
+
+/* Extracts the "IP:PORT" part of a chunk URL */
+static const char *
+_chunk_url_service (const char *url, gchar *dst, gsize len)
+{
+	const char *p = strstr (url, "://");
+	p = p ? p + 3 : url;
+	const char *end = strchr (p, '/');
+	gsize l = end ? (gsize)(end - p) : strlen(p);
+	g_strlcpy (dst, p, MIN(l+1, len));
+	return dst;
+}
+
+static void
+_rawx_latency_record (const char *url, gint64 latency)
+{
+	gchar srv[128];
+	_chunk_url_service (url, srv, sizeof(srv));
+
+	g_mutex_lock (&rawx_latency_lock);
+	if (!rawx_latency)
+		rawx_latency = g_hash_table_new_full (g_str_hash, g_str_equal,
+				g_free, g_free);
+	struct rawx_latency_s *lat = g_hash_table_lookup (rawx_latency, srv);
+	if (!lat) {
+		lat = g_malloc0 (sizeof(struct rawx_latency_s));
+		g_hash_table_insert (rawx_latency, g_strdup(srv), lat);
+	}
+	lat->samples[lat->next] = latency;
+	lat->next = (lat->next + 1) % RAWX_LATENCY_SAMPLES;
+	lat->count = MIN(lat->count + 1, RAWX_LATENCY_SAMPLES);
+	g_mutex_unlock (&rawx_latency_lock);
+}
+
+static int
+_cmp_gint64 (const void *p0, const void *p1)
+{
+	return CMP(*(const gint64*)p0, *(const gint64*)p1);
+}
+
+/* Returns the given percentile of the first-byte latency observed for the
+ * rawx hosting the chunk, or -1 if the rawx has not been sampled enough. */
+static gint64
+_rawx_latency_percentile (const char *url, guint percentile)
+{
+	gchar srv[128];
+	gint64 tab[RAWX_LATENCY_SAMPLES];
+	guint count = 0;
+
+	_chunk_url_service (url, srv, sizeof(srv));
+	g_mutex_lock (&rawx_latency_lock);
+	struct rawx_latency_s *lat = rawx_latency ?
+		g_hash_table_lookup (rawx_latency, srv) : NULL;
+	if (lat && lat->count >= RAWX_LATENCY_MIN_SAMPLES) {
+		count = lat->count;
+		memcpy (tab, lat->samples, count * sizeof(gint64));
+	}
+	g_mutex_unlock (&rawx_latency_lock);
+
+	if (!count)
+		return -1;
+	qsort (tab, count, sizeof(gint64), _cmp_gint64);
+	return tab[((count - 1) * percentile) / 100];
+}
+
+struct _chunk_latency_s
+{
+	struct chunk_s *chunk;
+	gint64 latency;
+};
+
+static gint
+_compare_chunk_latency (gconstpointer p0, gconstpointer p1, gpointer u UNUSED)
+{
+	return CMP(((const struct _chunk_latency_s*)p0)->latency,
+			((const struct _chunk_latency_s*)p1)->latency);
+}
+
+/* Stable sort of the replicas on the median latency of their rawx. The
+ * unknown rawx come first, so that they get sampled, then the shuffling or
+ * the score decides between equivalent replicas. The median is computed
+ * once per replica, not at each comparison. */
+static GSList *
+_sort_chunks_by_latency (GSList *chunks)
+{
+	const guint count = g_slist_length (chunks);
+	struct _chunk_latency_s *tab = g_malloc (count * sizeof(*tab));
+
+	guint i = 0;
+	for (GSList *l=chunks; l ;l=l->next,++i) {
+		tab[i].chunk = l->data;
+		tab[i].latency = _rawx_latency_percentile (tab[i].chunk->url, 50);
+	}
+	g_qsort_with_data (tab, count, sizeof(*tab), _compare_chunk_latency, NULL);
+
+	GSList *result = NULL;
+	while (i-- > 0)
+		result = g_slist_prepend (result, tab[i].chunk);
+	g_free (tab);
+	return result;
+}
+
+/* Hedged reads ------------------------------------------------------------- */
+
+struct _hedge_s;
+
+struct _hedge_attempt_s
+{
+	struct _hedge_s *hedge;
+	struct chunk_s *chunk;
+	CURL *h;
+	struct oio_headers_s headers;
+	gint64 start;
+	gboolean done;
+	gboolean lost; /* aborted because another replica won */
+};
+
+struct _hedge_s
+{
+	struct _download_ctx_s *dl;
+	const struct oio_sds_dl_range_s *range;
+	size_t nbread;
+
+	/* The first attempt that received a valid byte. Only this one may feed
+	 * the user's hook, the others are aborted. */
+	struct _hedge_attempt_s *winner;
+	GPtrArray *attempts;
+	CURLM *mh;
+
+	/* Set when the user's hook refused the data, no replica will help */
+	gboolean hook_failed;
+};
+
+static size_t
+_hedge_write (char *data, size_t s, size_t n, struct _hedge_attempt_s *a)
+{
+	struct _hedge_s *hedge = a->hedge;
+	size_t total = s*n;
+
+	if (!hedge->winner) {
+		long code = 0;
+		curl_easy_getinfo (a->h, CURLINFO_RESPONSE_CODE, &code);
+		if (2 != (code/100))
+			return 0;
+		hedge->winner = a;
+		_rawx_latency_record (a->chunk->url, oio_ext_monotonic_time() - a->start);
+		GRID_TRACE("hedged read won by %s", a->chunk->url);
+	}
+	if (hedge->winner != a)
+		return 0;
+
+	if (total + hedge->nbread > hedge->range->size) {
+		GRID_WARN("server gave us more data than expected "
+				"(%"G_GSIZE_FORMAT"/%"G_GSIZE_FORMAT")",
+				total, (size_t)(hedge->range->size - hedge->nbread));
+		total = hedge->range->size - hedge->nbread;
+	}
+
+	struct oio_sds_dl_dst_s *dst = hedge->dl->dst;
+	int sent = dst->data.hook.cb(dst->data.hook.ctx,
+			(const unsigned char*)data, total);
+	if ((size_t)sent == total) {
+		hedge->nbread += (size_t) sent;
+		return s*n;
+	}
+	GRID_WARN("user callback failed: %d/%"G_GSIZE_FORMAT" bytes sent",
+			sent, total);
+	hedge->hook_failed = TRUE;
+	return sent;
+}
+
+static void
+_hedge_attempt_start (struct _hedge_s *hedge, struct chunk_s *chunk)
+{
+	gchar str_range[64] = "";
+	g_snprintf (str_range, sizeof(str_range),
+			"bytes=%"G_GSIZE_FORMAT"-%"G_GSIZE_FORMAT,
+			hedge->range->offset,
+			hedge->range->offset + hedge->range->size - 1);
+	GRID_TRACE ("%s Range:%s %s", __FUNCTION__, str_range, chunk->url);
+
+	struct _hedge_attempt_s *a = g_malloc0 (sizeof(struct _hedge_attempt_s));
+	a->hedge = hedge;
+	a->chunk = chunk;
+	a->start = oio_ext_monotonic_time ();
+	a->h = _curl_get_handle_blob ();
+	oio_headers_common (&a->headers);
+	oio_headers_add (&a->headers, "Range", str_range);
+	curl_easy_setopt (a->h, CURLOPT_HTTPHEADER, a->headers.headers);
+	curl_easy_setopt (a->h, CURLOPT_CUSTOMREQUEST, "GET");
+	curl_easy_setopt (a->h, CURLOPT_URL, chunk->url);
+	curl_easy_setopt (a->h, CURLOPT_WRITEFUNCTION, _hedge_write);
+	curl_easy_setopt (a->h, CURLOPT_WRITEDATA, a);
+	curl_easy_setopt (a->h, CURLOPT_PRIVATE, a);
+	curl_multi_add_handle (hedge->mh, a->h);
+	g_ptr_array_add (hedge->attempts, a);
+}
+
+static void
+_hedge_attempt_clean (struct _hedge_attempt_s *a)
+{
+	curl_multi_remove_handle (a->hedge->mh, a->h);
+	curl_easy_cleanup (a->h);
+	oio_headers_clear (&a->headers);
+	g_free (a);
+}
+
+/* Download the range from the first replica that answers. The next replica
+ * is solicited when the current ones failed, or when they gave no byte
+ * before the hedge delay. The replicas are consumed from <*pchunks>, and
+ * when the winner fails, those it left behind are given back there. */
+static GError *
+_download_range_from_chunks_hedged (struct _download_ctx_s *dl,
+		const struct oio_sds_dl_range_s *range, GSList **pchunks,
+		size_t *p_nbread)
+{
+	struct oio_sds_s *sds = dl->sds;
+	struct _hedge_s hedge = {
+		.dl = dl, .range = range, .nbread = 0, .winner = NULL,
+		.attempts = g_ptr_array_new (), .mh = curl_multi_init (),
+	};
+	GError *err = NULL;
+	gint64 deadline = 0;
+	int running = 0;
+
+	for (;;) {
+		gint64 now = oio_ext_monotonic_time ();
+
+		/* Solicit one more replica, if it seems necessary */
+		if (!hedge.winner && *pchunks && (!running || now >= deadline)) {
+			GSList *head = *pchunks;
+			struct chunk_s *chunk = head->data;
+			*pchunks = head->next;
+			g_slist_free_1 (head);
+			gint64 delay = _rawx_latency_percentile (chunk->url,
+					sds->hedge.percentile);
+			deadline = now + MAX(delay, sds->hedge.delay);
+			_hedge_attempt_start (&hedge, chunk);
+			running ++;
+		}
+
+		if (!running)
+			break;
+
+		long timeout = 0;
+		if (!hedge.winner && *pchunks)
+			timeout = MAX(0, (deadline - now) / G_TIME_SPAN_MILLISECOND);
+		else
+			timeout = 1000;
+		int numfds = 0;
+		curl_multi_wait (hedge.mh, NULL, 0, MAX(1, timeout), &numfds);
+		curl_multi_perform (hedge.mh, &running);
+
+		CURLMsg *msg;
+		int msgs_left = 0;
+		while ((msg = curl_multi_info_read (hedge.mh, &msgs_left))) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+			struct _hedge_attempt_s *a = NULL;
+			curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, (char**)&a);
+			a->done = TRUE;
+
+			long code = 0;
+			curl_easy_getinfo (a->h, CURLINFO_RESPONSE_CODE, &code);
+			GError *e = NULL;
+			if (msg->data.result != CURLE_OK)
+				e = SYSERR("CURL: download error [%s]: (%d) %s", a->chunk->url,
+						msg->data.result, curl_easy_strerror(msg->data.result));
+			else if (2 != (code/100))
+				e = SYSERR("Download: (%ld)", code);
+			if (code == 404 || code == 410)
+				g_atomic_int_set (&dl->stale, 1);
+
+			if (a == hedge.winner) {
+				/* the race is over, for the best or the worst */
+				g_clear_error (&err);
+				err = e;
+				goto exit;
+			} else if (e && !hedge.winner) {
+				/* Failures weight like a pretty slow rawx */
+				_rawx_latency_record (a->chunk->url, G_TIME_SPAN_SECOND +
+						oio_ext_monotonic_time() - a->start);
+				GRID_DEBUG("hedged read failed: %s", e->message);
+				g_clear_error (&err);
+				err = e;
+				/* Immediately fail over the next replica */
+				deadline = 0;
+			} else if (e) {
+				/* aborted because another replica won */
+				a->lost = TRUE;
+				g_clear_error (&e);
+			}
+		}
+	}
+
+exit:
+	/* Replicas left behind by the winner get accounted with the time they
+	 * spent without answering, a lower bound of their real latency. */
+	for (guint i=0; i<hedge.attempts->len ;++i) {
+		struct _hedge_attempt_s *a = hedge.attempts->pdata[i];
+		if (hedge.winner && !a->done && !err)
+			_rawx_latency_record (a->chunk->url,
+					oio_ext_monotonic_time() - a->start);
+		/* The replicas that did not fail may serve the rest of the range */
+		if (err && a != hedge.winner && (!a->done || a->lost))
+			*pchunks = g_slist_prepend (*pchunks, a->chunk);
+		_hedge_attempt_clean (a);
+	}
+	if (hedge.hook_failed) {
+		g_slist_free (*pchunks);
+		*pchunks = NULL;
+	}
+	g_ptr_array_free (hedge.attempts, TRUE);
+	curl_multi_cleanup (hedge.mh);
+
+	if (!hedge.winner && !err)
+		err = ERRPTF("Too many failures");
+	*p_nbread = hedge.nbread;
+	return err;
+}
+
 /* the range is relative to the segment of the metachunk
  * Until there are available chunks, take the next chunk (they are equally
  * capable replicas) and attempt a read. */
@@ -717,6 +1272,31 @@ _download_range_from_metachunk_replicated (struct _download_ctx_s *dl,
 {
 	GRID_TRACE("%s", __FUNCTION__);
 	struct oio_sds_dl_range_s r0 = *range;
+
+	if (dl->sds->hedge.delay > 0) {
+		GSList *chunks = _sort_chunks_by_latency (meta->chunks);
+		GError *err = NULL;
+		for (;;) {
+			size_t nbread = 0;
+			err = _download_range_from_chunks_hedged (dl, &r0, &chunks,
+					&nbread);
+			EXTRA_ASSERT (nbread <= r0.size);
+			dl->dst->out_size += nbread;
+			/* Only a winner that failed after some bytes leaves replicas
+			 * worth a retry, for the rest of the range. */
+			if (!err || !nbread || !chunks)
+				break;
+			GRID_DEBUG("hedged read interrupted after %"G_GSIZE_FORMAT
+					" bytes: %s", nbread, err->message);
+			g_clear_error (&err);
+			r0.offset += nbread;
+			if (r0.size != G_MAXSIZE)
+				r0.size -= nbread;
+		}
+		g_slist_free (chunks);
+		return err;
+	}
+
 	GSList *tail_chunks = meta->chunks;
 
 	while (r0.size > 0) {
@@ -857,6 +1437,216 @@ _download_range (struct _download_ctx_s *dl, struct oio_sds_dl_range_s *range)
 	return NULL;
 }
 
+/* Parallel download ------------------------------------------------------- */
+
+/* A part is a sub-range of a single metachunk, downloaded by a worker of the
+ * pool. With a file destination, each part is written at its place with
+ * pwrite(). Otherwise the parts are buffered then delivered in order to the
+ * sequential hook, and the parts in flight never exceed the memory budget. */
+
+struct _dl_parallel_s;
+
+struct _dl_part_s
+{
+	struct _dl_parallel_s *par;
+	struct metachunk_s *meta;
+	struct oio_sds_dl_range_s range;  // relative to the metachunk
+	gsize dst_offset;  // relative to the output stream
+	gsize nbread;
+	GByteArray *buf;
+	GError *err;
+	gboolean done;
+};
+
+struct _dl_parallel_s
+{
+	struct _download_ctx_s *dl;
+	GMutex lock;
+	GCond cond;
+	volatile gboolean abort;
+};
+
+static int
+_write_part (gpointer ctx, const guint8 *buf, gsize len)
+{
+	struct _dl_part_s *part = ctx;
+	if (part->buf) {
+		g_byte_array_append (part->buf, buf, len);
+		return len;
+	}
+	gsize sent = 0;
+	while (sent < len) {
+		ssize_t w = pwrite (part->par->dl->fd, buf + sent, len - sent,
+				part->dst_offset + part->nbread + sent);
+		if (w > 0)
+			sent += w;
+		else if (w < 0 && errno == EINTR)
+			continue;
+		else
+			break;
+	}
+	return sent;
+}
+
+static void
+_dl_part_run (struct _dl_part_s *part, struct _dl_parallel_s *par)
+{
+	GError *err = NULL;
+
+	if (par->abort) {
+		err = SYSERR("Download aborted");
+	} else {
+		struct oio_sds_dl_dst_s dst = {
+			.out_size = 0,
+			.type = OIO_DL_DST_HOOK_SEQUENTIAL,
+			.data = { .hook = {
+				.cb = _write_part,
+				.ctx = part,
+				.length = part->range.size,
+			} }
+		};
+		struct _download_ctx_s dl = *par->dl;
+		dl.dst = &dst;
+		oio_ext_set_reqid (dl.sds->session_id);
+		oio_ext_set_admin (dl.sds->admin);
+		err = _download_range_from_metachunk (&dl, &part->range, part->meta);
+		if (g_atomic_int_get (&dl.stale))
+			g_atomic_int_set (&par->dl->stale, 1);
+		part->nbread = dst.out_size;
+		if (!err && part->nbread != part->range.size)
+			err = SYSERR("Download: short read");
+	}
+
+	g_mutex_lock (&par->lock);
+	part->err = err;
+	part->done = TRUE;
+	if (err)
+		par->abort = TRUE;
+	g_cond_broadcast (&par->cond);
+	g_mutex_unlock (&par->lock);
+}
+
+/* Splits the range (relative to the whole content) into parts no bigger
+ * than 'max' and appends them to 'parts'. */
+static void
+_dl_split_range (struct _download_ctx_s *dl, struct oio_sds_dl_range_s *range,
+		gsize *dst_offset, gsize max, GPtrArray *parts)
+{
+	struct oio_sds_dl_range_s r0 = *range;
+
+	for (struct metachunk_s **p=dl->metachunks; *p && r0.size > 0 ;++p) {
+		if ((r0.offset < (*p)->offset)
+				|| (r0.offset >= (*p)->offset + (*p)->size))
+			continue;
+		gsize offset = r0.offset - (*p)->offset;
+		gsize size = MIN((*p)->size - offset, r0.size);
+		r0.offset += size;
+		r0.size -= size;
+		while (size > 0) {
+			struct _dl_part_s *part = g_malloc0 (sizeof(struct _dl_part_s));
+			part->meta = *p;
+			part->range.offset = offset;
+			part->range.size = MIN(size, max);
+			part->dst_offset = *dst_offset;
+			g_ptr_array_add (parts, part);
+			offset += part->range.size;
+			size -= part->range.size;
+			*dst_offset += part->range.size;
+		}
+	}
+}
+
+static GError *
+_download_parallel (struct _download_ctx_s *dl)
+{
+	struct oio_sds_s *sds = dl->sds;
+	const gboolean to_file = dl->fd >= 0;
+	const gsize max = MAX(1, sds->dl.buffer_size / sds->dl.parallelism);
+
+	GPtrArray *parts = g_ptr_array_new ();
+	gsize dst_offset = 0;
+	for (struct oio_sds_dl_range_s **p=dl->src->ranges; *p ;++p)
+		_dl_split_range (dl, *p, &dst_offset, max, parts);
+
+	struct _dl_parallel_s par = {.dl = dl, .abort = FALSE};
+	g_mutex_init (&par.lock);
+	g_cond_init (&par.cond);
+	for (guint i=0; i<parts->len ;++i)
+		((struct _dl_part_s*) parts->pdata[i])->par = &par;
+
+	GError *err = NULL;
+	GThreadPool *pool = g_thread_pool_new ((GFunc)_dl_part_run, &par,
+			sds->dl.parallelism, FALSE, &err);
+	if (err) {
+		g_prefix_error (&err, "Thread pool: ");
+		goto exit;
+	}
+
+	/* The parts are delivered in order. A file destination needs no
+	 * buffer, so every part is queued at once. Otherwise the parts are
+	 * queued as long as the buffered data fits in the budget, their buffer
+	 * allocated when queued and freed once delivered. */
+	guint launched = 0;
+	gsize buffered = 0;
+	for (guint delivered = 0; delivered < parts->len && !err ;) {
+		while (launched < parts->len) {
+			struct _dl_part_s *part = parts->pdata[launched];
+			if (!to_file && launched > delivered
+					&& buffered + part->range.size > sds->dl.buffer_size)
+				break;
+			if (!to_file) {
+				part->buf = g_byte_array_sized_new (part->range.size);
+				buffered += part->range.size;
+			}
+			g_thread_pool_push (pool, part, NULL);
+			launched ++;
+		}
+
+		struct _dl_part_s *part = parts->pdata[delivered];
+		g_mutex_lock (&par.lock);
+		while (!part->done)
+			g_cond_wait (&par.cond, &par.lock);
+		g_mutex_unlock (&par.lock);
+
+		if (part->err) {
+			err = part->err;
+			part->err = NULL;
+			break;
+		}
+		if (!to_file) {
+			int sent = dl->dst->data.hook.cb (dl->dst->data.hook.ctx,
+					part->buf->data, part->buf->len);
+			if (sent < 0 || (guint)sent != part->buf->len) {
+				err = SYSERR("user callback failed: %d/%u bytes sent",
+						sent, part->buf->len);
+				break;
+			}
+			buffered -= part->range.size;
+			g_byte_array_free (part->buf, TRUE);
+			part->buf = NULL;
+		}
+		dl->dst->out_size += part->nbread;
+		delivered ++;
+	}
+
+	par.abort = TRUE;
+	g_thread_pool_free (pool, FALSE, TRUE);
+
+exit:
+	for (guint i=0; i<parts->len ;++i) {
+		struct _dl_part_s *part = parts->pdata[i];
+		if (part->buf)
+			g_byte_array_free (part->buf, TRUE);
+		if (part->err)
+			g_clear_error (&part->err);
+		g_free (part);
+	}
+	g_ptr_array_free (parts, TRUE);
+	g_cond_clear (&par.cond);
+	g_mutex_clear (&par.lock);
+	return err;
+}
+
 static GError *
 _download (struct _download_ctx_s *dl)
 {
@@ -896,11 +1686,15 @@ _download (struct _download_ctx_s *dl)
 		dl->src->ranges = range_autov;
 	}
 
-	/* Ok, let's download each range sequentially */
 	GError *err = NULL;
-	for (struct oio_sds_dl_range_s **p=dl->src->ranges; *p ;++p) {
-		if (NULL != (err = _download_range (dl, *p)))
-			break;
+	if (dl->sds->dl.parallelism > 1) {
+		err = _download_parallel (dl);
+	} else {
+		/* Ok, let's download each range sequentially */
+		for (struct oio_sds_dl_range_s **p=dl->src->ranges; *p ;++p) {
+			if (NULL != (err = _download_range (dl, *p)))
+				break;
+		}
 	}
 
 	/* restore the caller's ranges, then cleanup */
@@ -928,17 +1722,14 @@ _write_FILE (gpointer ctx, const guint8 *buf, gsize len)
 	return sent;
 }
 
-static struct oio_error_s*
-_download_to_hook (struct oio_sds_s *sds, struct oio_sds_dl_src_s *src,
-		struct oio_sds_dl_dst_s *dst)
+/* <pstale> is set to TRUE when the chunks, taken from the client cache,
+ * were not found on the rawx. */
+static GError *
+_download_to_hook_once (struct oio_sds_s *sds, struct oio_sds_dl_src_s *src,
+		struct oio_sds_dl_dst_s *dst, int fd, gboolean *pstale)
 {
-	EXTRA_ASSERT (dst->type == OIO_DL_DST_HOOK_SEQUENTIAL);
-	dst->out_size = 0;
-	if (!dst->data.hook.cb)
-		return (struct oio_error_s*) BADREQ("Missing callback");
-	_dl_debug (__FUNCTION__, src, dst);
-
 	GError *err = NULL;
+	gboolean cached = FALSE;
 	gchar *chunk_method = NULL;
 	GSList *chunks = NULL;
 
@@ -952,13 +1743,14 @@ _download_to_hook (struct oio_sds_s *sds, struct oio_sds_dl_src_s *src,
 	}
 
 	/* Parse the beans */
-	err = _show_content (sds, src->url, NULL, _on_info, _on_chunk, NULL);
+	err = _show_content (sds, src->url, NULL, _on_info, _on_chunk, NULL,
+			&cached);
 
 	/* download from the beans */
 	if (!err) {
 		struct _download_ctx_s dl = {
 			.sds = sds, .dst = dst, .src = src, .chunk_method = chunk_method,
-			.metachunks = NULL, .chunks = chunks,
+			.metachunks = NULL, .chunks = chunks, .fd = fd, .stale = 0,
 		};
 		err = _organize_chunks(chunks, &dl.metachunks, sds->no_shuffle);
 		if (!err) {
@@ -966,11 +1758,40 @@ _download_to_hook (struct oio_sds_s *sds, struct oio_sds_dl_src_s *src,
 			err = _download (&dl);
 			_metachunk_cleanv (dl.metachunks);
 		}
+		*pstale = err != NULL && cached && g_atomic_int_get (&dl.stale);
 	}
 
 	/* cleanup and exit */
 	g_slist_free_full (chunks, g_free);
 	g_free(chunk_method);
+	return err;
+}
+
+/* 'fd' is the file descriptor of the destination file, or -1 if the
+ * destination is not a regular file. */
+static struct oio_error_s*
+_download_to_hook (struct oio_sds_s *sds, struct oio_sds_dl_src_s *src,
+		struct oio_sds_dl_dst_s *dst, int fd)
+{
+	EXTRA_ASSERT (dst->type == OIO_DL_DST_HOOK_SEQUENTIAL);
+	dst->out_size = 0;
+	if (!dst->data.hook.cb)
+		return (struct oio_error_s*) BADREQ("Missing callback");
+	_dl_debug (__FUNCTION__, src, dst);
+
+	gboolean stale = FALSE;
+	GError *err = _download_to_hook_once (sds, src, dst, fd, &stale);
+	if (err && stale) {
+		/* The content has changed since it has been cached. Retry from the
+		 * proxy, unless some data already went to the hook. */
+		_cache_forget (sds, src->url);
+		if (dst->out_size == 0) {
+			GRID_DEBUG("Stale cache entry for [%s], retrying",
+					oio_url_get (src->url, OIOURL_WHOLE));
+			g_clear_error (&err);
+			err = _download_to_hook_once (sds, src, dst, fd, &stale);
+		}
+	}
 	return (struct oio_error_s*) err;
 }
 
@@ -988,7 +1809,9 @@ _download_to_file (struct oio_sds_s *sds, struct oio_sds_dl_src_s *src,
 	if (fd < 0) {
 		err = (struct oio_error_s*) SYSERR("open() error: (%d) %s", errno, strerror(errno));
 	} else {
-		out = fdopen(fd, "a");
+		/* Not "a": glibc would set O_APPEND on the descriptor, and the
+		 * pwrite() of the parallel download would ignore their offset */
+		out = fdopen(fd, "w");
 		if (out) {
 			struct oio_sds_dl_dst_s snk0 = {
 				.out_size = 0,
@@ -999,7 +1822,7 @@ _download_to_file (struct oio_sds_s *sds, struct oio_sds_dl_src_s *src,
 					.length = (size_t)-1,
 				} }
 			};
-			err = _download_to_hook (sds, src, &snk0);
+			err = _download_to_hook (sds, src, &snk0, fd);
 			fclose (out);
 			dst->out_size = snk0.out_size;
 		}
@@ -1050,7 +1873,7 @@ _download_to_buffer (struct oio_sds_s *sds, struct oio_sds_dl_src_s *src,
 				.length = dst->data.buffer.length,
 			} }
 		};
-		err = _download_to_hook (sds, src, &dst0);
+		err = _download_to_hook (sds, src, &dst0, -1);
 		dst->out_size = dst0.out_size;
 		fclose (out);
 	}
@@ -1069,7 +1892,7 @@ oio_sds_download (struct oio_sds_s *sds, struct oio_sds_dl_src_s *dl,
 	snk->out_size = 0;
 
 	if (snk->type == OIO_DL_DST_HOOK_SEQUENTIAL)
-		return _download_to_hook (sds, dl, snk);
+		return _download_to_hook (sds, dl, snk, -1);
 	if (snk->type == OIO_DL_DST_FILE)
 		return _download_to_file (sds, dl, snk);
 	if (snk->type == OIO_DL_DST_BUFFER)
@@ -1692,6 +2515,7 @@ oio_sds_upload_commit (struct oio_sds_ul_s *ul)
 	GRID_TRACE("%s (%p) Saving %s", __FUNCTION__, ul, request_body->str);
 	GError *err = oio_proxy_call_content_create (ul->sds->h, ul->dst->url,
 			&in, reply_body);
+	_cache_forget (ul->sds, ul->dst->url);
 	if (ul->chunks_failed)
 		_chunks_remove (ul->sds->h, ul->chunks_failed);
 
@@ -2179,6 +3003,7 @@ oio_sds_link (struct oio_sds_s *sds, struct oio_url_s *url, const char *content_
 	oio_ext_set_reqid (sds->session_id);
 	oio_ext_set_admin (sds->admin);
 
+	_cache_forget (sds, url);
 	return (struct oio_error_s*) oio_proxy_call_content_link (sds->h, url, content_id);
 }
 
@@ -2209,6 +3034,7 @@ oio_sds_truncate (struct oio_sds_s *sds, struct oio_url_s *url, size_t size)
 		return (struct oio_error_s*) BADREQ("Missing argument");
 	oio_ext_set_reqid (sds->session_id);
 
+	_cache_forget (sds, url);
 	return (struct oio_error_s*) oio_proxy_call_content_truncate(
 			sds->h, url, size);
 }
@@ -2221,6 +3047,7 @@ oio_sds_delete (struct oio_sds_s *sds, struct oio_url_s *url)
 	oio_ext_set_reqid (sds->session_id);
 	oio_ext_set_admin (sds->admin);
 
+	_cache_forget (sds, url);
 	return (struct oio_error_s*) oio_proxy_call_content_delete (sds->h, url);
 }
 
@@ -2262,7 +3089,8 @@ oio_sds_show_content (struct oio_sds_s *sds, struct oio_url_s *url,
 	}
 
 	err = _show_content (sds, url, NULL,
-			cb_info? _on_info : NULL, _on_chunk, cb_props? _on_prop : NULL);
+			cb_info? _on_info : NULL, _on_chunk, cb_props? _on_prop : NULL,
+			NULL);
 	if (!err) {
 		GTree *positions_seen = g_tree_new_full(oio_str_cmp3, NULL, g_free, NULL);
 		chunks = g_slist_sort (chunks, (GCompareFunc)_compare_chunks);
@@ -2368,5 +3196,6 @@ oio_sds_set_content_properties (struct oio_sds_s *sds, struct oio_url_s *url,
 	oio_ext_set_reqid (sds->session_id);
 	oio_ext_set_admin (sds->admin);
 
+	_cache_forget (sds, url);
 	return (struct oio_error_s*) oio_proxy_call_content_set_properties(sds->h, url, values);
 }
@@ -83,6 +83,39 @@ oio_events_queue__run (struct oio_events_queue_s *self,
 	EVTQ_CALL(self,run)(self,running);
 }
 
+void
+oio_events_queue__set_batching (struct oio_events_queue_s *self,
+		guint max_events, gsize max_bytes, gint64 max_delay, gboolean compress)
+{
+	EXTRA_ASSERT (self != NULL);
+	if (VTABLE_HAS(self,struct oio_events_queue_abstract_s*,set_batching))
+		VTABLE_CALL_NOCHECK(self,struct oio_events_queue_abstract_s*,set_batching)
+			(self, max_events, max_bytes, max_delay, compress);
+}
+
+void
+oio_events_queue__get_stats (struct oio_events_queue_s *self,
+		struct oio_events_queue_stats_s *out)
+{
+	EXTRA_ASSERT (self != NULL);
+	EXTRA_ASSERT (out != NULL);
+	memset (out, 0, sizeof(*out));
+	if (VTABLE_HAS(self,struct oio_events_queue_abstract_s*,get_stats))
+		VTABLE_CALL_NOCHECK(self,struct oio_events_queue_abstract_s*,get_stats)
+			(self, out);
+}
+
+GError *
+oio_events_queue__set_spool (struct oio_events_queue_s *self,
+		const char *path, gsize max_size)
+{
+	EXTRA_ASSERT (self != NULL);
+	EXTRA_ASSERT (path != NULL);
+	if (!VTABLE_HAS(self,struct oio_events_queue_abstract_s*,set_spool))
+		return NULL;
+	EVTQ_CALL(self,set_spool)(self, path, max_size);
+}
+
 static const char *
 _has_prefix (const char *cfg, const char *prefix)
 {
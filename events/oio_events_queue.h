@@ -47,6 +47,39 @@ void oio_events_queue__set_buffering (struct oio_events_queue_s *self,
 GError * oio_events_queue__run (struct oio_events_queue_s *self,
 		gboolean (*running) (gboolean pending));
 
+/* Group up to 'max_events' events, or 'max_bytes' bytes of events, in one
+ * message to the agent, acknowledged at once. A batch is sent at most
+ * 'max_delay' microseconds after its first event. With 'compress', the
+ * batches are compressed with zlib. 'max_events' lower than 2 disables the
+ * batching. Ignored by the implementations that do not support it. */
+void oio_events_queue__set_batching (struct oio_events_queue_s *self,
+		guint max_events, gsize max_bytes, gint64 max_delay,
+		gboolean compress);
+
+struct oio_events_queue_stats_s
+{
+	guint64 received;       /* events received from the emitters */
+	guint64 sent_events;    /* events sent (alone or in a batch) */
+	guint64 sent_messages;  /* messages sent, retries included */
+	guint64 sent_bytes;     /* bytes sent, after the compression */
+	guint64 ack;            /* messages acknowledged */
+	guint64 ack_notfound;   /* unexpected acknowledgements */
+	guint pending;          /* events waiting for an acknowledgement */
+	guint spooled;          /* events waiting in the overflow spool */
+};
+
+/* Zeroes 'out' then fills the counters managed by the implementation */
+void oio_events_queue__get_stats (struct oio_events_queue_s *self,
+		struct oio_events_queue_stats_s *out);
+
+/* Let the events that do not fit in the queue overflow in a file mapped in
+ * memory, at 'path', and sized to 'max_size' bytes. The file is kept across
+ * restarts and the events it holds are sent in order once the agent catches
+ * up. To be called before oio_events_queue__run(). Ignored by the
+ * implementations that do not support it. */
+GError * oio_events_queue__set_spool (struct oio_events_queue_s *self,
+		const char *path, gsize max_size);
+
 /* -------------------------------------------------------------------------- */
 
 struct oio_url_s;
@@ -57,7 +57,8 @@ static GError * _q_run (struct oio_events_queue_s *self,
 static struct oio_events_queue_vtable_s vtable_BEANSTALKD =
 {
 	_q_destroy, _q_send, _q_send_overwritable, _q_is_stalled,
-	_q_set_max_pending, _q_set_buffering, _q_run
+	_q_set_max_pending, _q_set_buffering, _q_run, NULL, NULL,
+	NULL
 };
 
 /* Used by tests to intercept the result of the parsing of beanstalkd
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <core/internals.h>
 
 struct oio_events_queue_s;
+struct oio_events_queue_stats_s;
 
 struct oio_events_queue_vtable_s
 {
@@ -32,6 +33,12 @@ struct oio_events_queue_vtable_s
 	void (*set_max_pending) (struct oio_events_queue_s *self, guint v);
 	void (*set_buffering) (struct oio_events_queue_s *self, gint64 v);
 	GError * (*run) (struct oio_events_queue_s *self, gboolean (*) (gboolean));
+	void (*set_batching) (struct oio_events_queue_s *self, guint max_events,
+			gsize max_bytes, gint64 max_delay, gboolean compress);
+	void (*get_stats) (struct oio_events_queue_s *self,
+			struct oio_events_queue_stats_s *out);
+	GError * (*set_spool) (struct oio_events_queue_s *self,
+			const char *path, gsize max_size);
 };
 
 struct oio_events_queue_abstract_s
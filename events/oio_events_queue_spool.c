@@ -0,0 +1,247 @@
+/*
+OpenIO SDS event queue
+Copyright (C) 2016 OpenIO, original work as part of OpenIO Software Defined Storage
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <core/oio_core.h>
+#include <core/internals.h>
+#include "oio_events_queue_spool.h"
+
+#define SPOOL_MAGIC 0x4F494F53 /* "OIOS" */
+#define SPOOL_VERSION 1
+#define SPOOL_DATA_OFFSET 64
+#define SPOOL_MIN_SIZE 4096
+
+/* Lies at the beginning of the file. Each record then consists in the
+ * length of the event (32 bits, host order) followed by the event itself,
+ * without its trailing NUL. */
+struct spool_header_s
+{
+	guint32 magic;
+	guint32 version;
+	guint64 head;
+	guint64 tail;
+	guint64 count;
+};
+
+#define HDR(spool) ((struct spool_header_s*)(spool)->map)
+
+static void
+_spool_reset(struct oio_events_queue_spool_s *spool)
+{
+	struct spool_header_s *hdr = HDR(spool);
+	hdr->magic = SPOOL_MAGIC;
+	hdr->version = SPOOL_VERSION;
+	hdr->head = hdr->tail = SPOOL_DATA_OFFSET;
+	hdr->count = 0;
+	spool->full = FALSE;
+}
+
+static gboolean
+_spool_header_valid(struct oio_events_queue_spool_s *spool, gsize file_size)
+{
+	struct spool_header_s *hdr = HDR(spool);
+	return file_size >= SPOOL_DATA_OFFSET
+		&& hdr->magic == SPOOL_MAGIC
+		&& hdr->version == SPOOL_VERSION
+		&& hdr->head >= SPOOL_DATA_OFFSET
+		&& hdr->head <= hdr->tail
+		&& hdr->tail <= file_size;
+}
+
+void
+oio_events_queue_spool_init(struct oio_events_queue_spool_s *spool)
+{
+	memset(spool, 0, sizeof(*spool));
+	g_mutex_init(&(spool->lock));
+	spool->fd = -1;
+}
+
+void
+oio_events_queue_spool_clean(struct oio_events_queue_spool_s *spool)
+{
+	if (spool->map) {
+		msync(spool->map, spool->map_size, MS_SYNC);
+		munmap(spool->map, spool->map_size);
+		spool->map = NULL;
+	}
+	if (spool->fd >= 0) {
+		close(spool->fd);
+		spool->fd = -1;
+	}
+	oio_str_clean(&spool->path);
+	g_mutex_clear(&(spool->lock));
+}
+
+GError *
+oio_events_queue_spool_open(struct oio_events_queue_spool_s *spool,
+		const char *path, gsize max_size)
+{
+	EXTRA_ASSERT(spool != NULL);
+	EXTRA_ASSERT(path != NULL);
+
+	if (spool->map)
+		return BADREQ("Spool already open at [%s]", spool->path);
+	if (max_size < SPOOL_MIN_SIZE)
+		return BADREQ("Spool too small (%"G_GSIZE_FORMAT" < %d)",
+				max_size, SPOOL_MIN_SIZE);
+
+	int fd = open(path, O_RDWR|O_CREAT|O_CLOEXEC, 0644);
+	if (fd < 0)
+		return SYSERR("open(%s) failed: (%d) %s", path, errno, strerror(errno));
+
+	struct stat st = {0};
+	if (0 > fstat(fd, &st)) {
+		int errsav = errno;
+		close(fd);
+		return SYSERR("fstat(%s) failed: (%d) %s",
+				path, errsav, strerror(errsav));
+	}
+
+	/* Never shrink a file that still holds events */
+	gsize old_size = st.st_size;
+	gsize size = MAX(max_size, old_size);
+	if (size != old_size && 0 > ftruncate(fd, size)) {
+		int errsav = errno;
+		close(fd);
+		return SYSERR("ftruncate(%s) failed: (%d) %s",
+				path, errsav, strerror(errsav));
+	}
+
+	void *map = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		int errsav = errno;
+		close(fd);
+		return SYSERR("mmap(%s) failed: (%d) %s",
+				path, errsav, strerror(errsav));
+	}
+
+	g_mutex_lock(&spool->lock);
+	spool->fd = fd;
+	spool->map = map;
+	spool->map_size = size;
+	spool->path = g_strdup(path);
+	if (!_spool_header_valid(spool, old_size)) {
+		if (old_size > 0)
+			GRID_WARN("Invalid events spool [%s], reset", path);
+		_spool_reset(spool);
+	} else if (HDR(spool)->count > 0) {
+		GRID_NOTICE("Events spool [%s] holds %"G_GUINT64_FORMAT
+				" events to be replayed", path, HDR(spool)->count);
+	}
+	g_mutex_unlock(&spool->lock);
+	return NULL;
+}
+
+gboolean
+oio_events_queue_spool_is_open(struct oio_events_queue_spool_s *spool)
+{
+	return spool->map != NULL;
+}
+
+gboolean
+oio_events_queue_spool_is_full(struct oio_events_queue_spool_s *spool)
+{
+	return spool->full;
+}
+
+guint
+oio_events_queue_spool_count(struct oio_events_queue_spool_s *spool)
+{
+	if (!spool->map)
+		return 0;
+	g_mutex_lock(&spool->lock);
+	guint count = HDR(spool)->count;
+	g_mutex_unlock(&spool->lock);
+	return count;
+}
+
+gboolean
+oio_events_queue_spool_push(struct oio_events_queue_spool_s *spool,
+		const gchar *msg)
+{
+	EXTRA_ASSERT(msg != NULL);
+	if (!spool->map)
+		return FALSE;
+
+	const guint32 len = strlen(msg);
+	const gsize needed = sizeof(len) + len;
+
+	g_mutex_lock(&spool->lock);
+	struct spool_header_s *hdr = HDR(spool);
+	if (hdr->tail + needed > spool->map_size
+			&& hdr->head > SPOOL_DATA_OFFSET) {
+		/* Make room by moving the events still waiting to the beginning */
+		const gsize used = hdr->tail - hdr->head;
+		memmove(spool->map + SPOOL_DATA_OFFSET, spool->map + hdr->head, used);
+		hdr->head = SPOOL_DATA_OFFSET;
+		hdr->tail = SPOOL_DATA_OFFSET + used;
+	}
+
+	gboolean rc = FALSE;
+	if (hdr->tail + needed <= spool->map_size) {
+		guint8 *p = spool->map + hdr->tail;
+		memcpy(p, &len, sizeof(len));
+		memcpy(p + sizeof(len), msg, len);
+		/* only then make the record visible */
+		hdr->tail += needed;
+		hdr->count ++;
+		rc = TRUE;
+	}
+	spool->full = !rc;
+	g_mutex_unlock(&spool->lock);
+	return rc;
+}
+
+gchar *
+oio_events_queue_spool_pop(struct oio_events_queue_spool_s *spool)
+{
+	if (!spool->map)
+		return NULL;
+
+	gchar *msg = NULL;
+	g_mutex_lock(&spool->lock);
+	struct spool_header_s *hdr = HDR(spool);
+	if (hdr->head < hdr->tail) {
+		guint32 len = 0;
+		memcpy(&len, spool->map + hdr->head, sizeof(len));
+		if (hdr->head + sizeof(len) + len > hdr->tail) {
+			GRID_WARN("Corrupted events spool [%s], %"G_GUINT64_FORMAT
+					" events lost", spool->path, hdr->count);
+			_spool_reset(spool);
+		} else {
+			msg = g_malloc(len + 1);
+			memcpy(msg, spool->map + hdr->head + sizeof(len), len);
+			msg[len] = '\0';
+			hdr->head += sizeof(len) + len;
+			if (hdr->count > 0)
+				hdr->count --;
+			if (hdr->head >= hdr->tail)
+				_spool_reset(spool);
+			spool->full = FALSE;
+		}
+	}
+	g_mutex_unlock(&spool->lock);
+	return msg;
+}
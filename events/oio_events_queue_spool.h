@@ -0,0 +1,66 @@
+/*
+OpenIO SDS event queue
+Copyright (C) 2016 OpenIO, original work as part of OpenIO Software Defined Storage
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OIO_SDS__sqlx__oio_events_queue_spool_h
+# define OIO_SDS__sqlx__oio_events_queue_spool_h 1
+
+#include <glib.h>
+
+/* An append-only file, mapped in memory, where the events that do not fit
+ * in the queue are parked. The events are consumed in the order they have
+ * been appended, and the positions are kept in the file itself, so that the
+ * events survive a restart of the service. */
+struct oio_events_queue_spool_s
+{
+	GMutex lock;
+	gchar *path;
+	int fd;
+	guint8 *map;
+	gsize map_size;
+	/* set when an event has been refused, reset as soon as room is made */
+	gboolean full;
+};
+
+void oio_events_queue_spool_init(struct oio_events_queue_spool_s *spool);
+
+/* Unmaps and closes the file, without removing it */
+void oio_events_queue_spool_clean(struct oio_events_queue_spool_s *spool);
+
+/* Opens (and creates if necessary) the spool file at 'path', sized to
+ * 'max_size' bytes. The events left in an existing file are kept. */
+GError * oio_events_queue_spool_open(struct oio_events_queue_spool_s *spool,
+		const char *path, gsize max_size);
+
+gboolean oio_events_queue_spool_is_open(struct oio_events_queue_spool_s *spool);
+
+/* Tells if the last append has been refused for lack of room */
+gboolean oio_events_queue_spool_is_full(struct oio_events_queue_spool_s *spool);
+
+/* How many events are waiting in the spool */
+guint oio_events_queue_spool_count(struct oio_events_queue_spool_s *spool);
+
+/* Appends a copy of 'msg'. Returns FALSE if there is not enough room or if
+ * the spool is not open, then 'msg' is left to the caller. */
+gboolean oio_events_queue_spool_push(struct oio_events_queue_spool_s *spool,
+		const gchar *msg);
+
+/* Returns the oldest event (to be freed with g_free()), or NULL if the
+ * spool is empty. */
+gchar * oio_events_queue_spool_pop(struct oio_events_queue_spool_s *spool);
+
+#endif
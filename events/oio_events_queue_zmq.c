@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <glib.h>
 #include <zmq.h>
+#include <zlib.h>
 
 #include <core/oio_core.h>
 
@@ -29,9 +30,24 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "oio_events_queue_internals.h"
 #include "oio_events_queue_zmq.h"
 #include "oio_events_queue_buffer.h"
+#include "oio_events_queue_spool.h"
 
 #define HEADER_SIZE 14
 
+/* How the payload of a message is encoded. Single events are sent as is,
+ * in 3 frames. The batches are JSON arrays of events, sent with a 4th frame
+ * telling the codec. */
+enum event_codec_e
+{
+	EVT_CODEC_SINGLE = 0,
+	EVT_CODEC_BATCH,
+	EVT_CODEC_BATCH_ZLIB,
+};
+
+static const char * const codec_names[] = {
+	"", "batch", "batch+zlib"
+};
+
 struct event_s
 {
 	/* fields used as unique key */
@@ -41,7 +57,10 @@ struct event_s
 	guint16 procid;
 
 	/* and then the payload */
-	guint16 size;
+	guint8 codec;
+	guint32 size;
+	/* how many events are in the message */
+	guint32 count;
 	gint64 last_sent;
 	guint8 message[];
 };
@@ -54,11 +73,18 @@ static void _q_set_max_pending (struct oio_events_queue_s *self, guint v);
 static void _q_set_buffering(struct oio_events_queue_s *self, gint64 v);
 static GError * _q_run (struct oio_events_queue_s *self,
 		gboolean (*running) (gboolean pending));
+static void _q_set_batching (struct oio_events_queue_s *self,
+		guint max_events, gsize max_bytes, gint64 max_delay, gboolean compress);
+static void _q_get_stats (struct oio_events_queue_s *self,
+		struct oio_events_queue_stats_s *out);
+static GError * _q_set_spool (struct oio_events_queue_s *self,
+		const char *path, gsize max_size);
 
 static struct oio_events_queue_vtable_s vtable_AGENT =
 {
 	_q_destroy, _q_send, _q_send_overwritable, _q_is_stalled,
-	_q_set_max_pending, _q_set_buffering, _q_run
+	_q_set_max_pending, _q_set_buffering, _q_run,
+	_q_set_batching, _q_get_stats, _q_set_spool
 };
 
 struct _queue_AGENT_s
@@ -87,13 +113,28 @@ struct _queue_AGENT_s
 	   a stalled state. */
 	guint max_events_in_queue;
 
+	/* how many events may be grouped in a single message (the batching is
+	   disabled below 2), how big the batch may grow, and how long it may
+	   wait for more events. */
+	volatile guint batch_max_events;
+	volatile gsize batch_max_bytes;
+	volatile gint64 batch_max_delay;
+	volatile gboolean batch_compress;
+
 	/* stats on events streams, managed only by the ZMQ2AGENT thead */
 	guint64 counter_received;
 	guint64 counter_sent;
+	guint64 counter_sent_events;
+	guint64 counter_sent_bytes;
 	guint64 counter_ack;
 	guint64 counter_ack_notfound;
 
 	struct oio_events_queue_buffer_s buffer;
+
+	/* where the events overflow when the queue is full. Once an event has
+	   been spooled, the next ones are spooled too, until the spool has been
+	   drained, so that the order is kept. */
+	struct oio_events_queue_spool_s spool;
 };
 
 struct _zmq2agent_ctx_s
@@ -104,6 +145,11 @@ struct _zmq2agent_ctx_s
 	void *zpull;
 	void *zagent;
 	time_t last_error;
+
+	/* the batch being filled: a JSON array not closed yet */
+	GString *batch;
+	guint batch_count;
+	gint64 batch_start;
 };
 
 struct _gq2zmq_ctx_s
@@ -129,8 +175,13 @@ oio_events_queue_factory__create_zmq (const char *zurl,
 	self->url = g_strdup (zurl);
 	self->max_recv_per_round = 32;
 	self->max_events_in_queue = OIO_EVTQ_MAXPENDING;
+	self->batch_max_events = 1;
+	self->batch_max_bytes = OIO_EVTQ_BATCH_BYTES;
+	self->batch_max_delay = OIO_EVTQ_BATCH_DELAY * G_TIME_SPAN_MILLISECOND;
+	self->batch_compress = FALSE;
 	self->procid = getpid();
 	oio_events_queue_buffer_init(&(self->buffer), 1 * G_TIME_SPAN_SECOND);
+	oio_events_queue_spool_init(&(self->spool));
 	*out = (struct oio_events_queue_s *) self;
 	return NULL;
 }
@@ -154,6 +205,63 @@ _q_set_buffering(struct oio_events_queue_s *self, gint64 v)
 }
 
 
+static void
+_q_set_batching (struct oio_events_queue_s *self, guint max_events,
+		gsize max_bytes, gint64 max_delay, gboolean compress)
+{
+	struct _queue_AGENT_s *q = (struct _queue_AGENT_s *)self;
+	EXTRA_ASSERT (q != NULL && q->vtable == &vtable_AGENT);
+	if (q->batch_max_events != max_events || q->batch_max_bytes != max_bytes
+			|| q->batch_max_delay != max_delay
+			|| q->batch_compress != BOOL(compress)) {
+		GRID_INFO("events batching set to [%u] events, [%"G_GSIZE_FORMAT
+				"] bytes, [%"G_GINT64_FORMAT"] ms, compression [%d]",
+				max_events, max_bytes, max_delay / G_TIME_SPAN_MILLISECOND,
+				BOOL(compress));
+		q->batch_max_bytes = max_bytes;
+		q->batch_max_delay = max_delay;
+		q->batch_compress = BOOL(compress);
+		q->batch_max_events = max_events;
+	}
+}
+
+static void
+_q_get_stats (struct oio_events_queue_s *self,
+		struct oio_events_queue_stats_s *out)
+{
+	struct _queue_AGENT_s *q = (struct _queue_AGENT_s *)self;
+	EXTRA_ASSERT (q != NULL && q->vtable == &vtable_AGENT);
+	out->received = q->counter_received;
+	out->sent_events = q->counter_sent_events;
+	out->sent_messages = q->counter_sent;
+	out->sent_bytes = q->counter_sent_bytes;
+	out->ack = q->counter_ack;
+	out->ack_notfound = q->counter_ack_notfound;
+	out->pending = q->gauge_pending;
+	out->spooled = oio_events_queue_spool_count(&(q->spool));
+}
+
+static GError *
+_q_set_spool (struct oio_events_queue_s *self, const char *path,
+		gsize max_size)
+{
+	struct _queue_AGENT_s *q = (struct _queue_AGENT_s *)self;
+	EXTRA_ASSERT (q != NULL && q->vtable == &vtable_AGENT);
+	GError *err = oio_events_queue_spool_open(&(q->spool), path, max_size);
+	if (!err)
+		GRID_INFO("events spool set to [%s] (%"G_GSIZE_FORMAT" bytes)",
+				path, max_size);
+	return err;
+}
+
+/* How many events are in the memory of the process */
+static guint
+_q_backlog (struct _queue_AGENT_s *q)
+{
+	const int l = g_async_queue_length (q->queue);
+	return q->gauge_pending + (guint)(l>0?l:0);
+}
+
 static void
 _q_destroy (struct oio_events_queue_s *self)
 {
@@ -163,6 +271,7 @@ _q_destroy (struct oio_events_queue_s *self)
 	g_async_queue_unref (q->queue);
 	oio_str_clean (&q->url);
 	oio_events_queue_buffer_clean(&(q->buffer));
+	oio_events_queue_spool_clean(&(q->spool));
 	g_free (q);
 }
 
@@ -171,6 +280,16 @@ _q_send (struct oio_events_queue_s *self, gchar *msg)
 {
 	struct _queue_AGENT_s *q = (struct _queue_AGENT_s*) self;
 	EXTRA_ASSERT (q != NULL && q->vtable == &vtable_AGENT);
+	if (oio_events_queue_spool_is_open(&(q->spool))
+			&& (oio_events_queue_spool_count(&(q->spool)) > 0
+				|| _q_backlog(q) >= q->max_events_in_queue)) {
+		/* When the spool is full, the event is kept in memory, even if it
+		   then overtakes the spooled ones. */
+		if (oio_events_queue_spool_push(&(q->spool), msg)) {
+			g_free (msg);
+			return;
+		}
+	}
 	g_async_queue_push (q->queue, msg);
 }
 
@@ -186,9 +305,10 @@ _q_is_stalled (struct oio_events_queue_s *self)
 {
 	struct _queue_AGENT_s *q = (struct _queue_AGENT_s*) self;
 	EXTRA_ASSERT (q != NULL && q->vtable == &vtable_AGENT);
-	const int l = g_async_queue_length (q->queue);
-	const guint waiting = q->gauge_pending;
-	return (waiting + (guint)(l>0?l:0)) >= q->max_events_in_queue;
+	if (oio_events_queue_spool_is_open(&(q->spool))
+			&& !oio_events_queue_spool_is_full(&(q->spool)))
+		return FALSE;
+	return _q_backlog(q) >= q->max_events_in_queue;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -211,6 +331,12 @@ retry:
 	rc = zmq_send (ctx->zagent, "", 0, more|ZMQ_DONTWAIT);
 	if (rc == 0) {
 		rc = zmq_send (ctx->zagent, evt, HEADER_SIZE, more|ZMQ_DONTWAIT);
+		if (rc == HEADER_SIZE && evt->codec != EVT_CODEC_SINGLE) {
+			const char *codec = codec_names[evt->codec];
+			const int len = strlen(codec);
+			rc = zmq_send (ctx->zagent, codec, len, more|ZMQ_DONTWAIT);
+			rc = (rc == len) ? HEADER_SIZE : -1;
+		}
 		if (rc == HEADER_SIZE)
 			rc = zmq_send (ctx->zagent, evt->message, evt->size, ZMQ_DONTWAIT);
 	}
@@ -223,6 +349,8 @@ retry:
 		return FALSE;
 	} else {
 		++ ctx->q->counter_sent;
+		ctx->q->counter_sent_events += evt->count;
+		ctx->q->counter_sent_bytes += evt->size;
 		ctx->last_error = 0;
 		GRID_DEBUG("EVT:SNT %s", dbg);
 		return TRUE;
@@ -230,32 +358,103 @@ retry:
 }
 
 static gboolean
-_zmq2agent_manage_event (guint32 r, struct _zmq2agent_ctx_s *ctx, zmq_msg_t *msg)
+_zmq2agent_push_event (guint32 r, struct _zmq2agent_ctx_s *ctx,
+		const guint8 *data, gsize len, guint32 count, enum event_codec_e codec)
 {
 	const time_t now = oio_ext_monotonic_seconds();
-	if (!ctx->zagent) return TRUE;
 
-	const size_t len = zmq_msg_size(msg);
 	struct event_s *evt = g_malloc (sizeof(struct event_s) + len);
-	memcpy (evt->message, zmq_msg_data(msg), len);
+	memcpy (evt->message, data, len);
 	evt->last_sent = now;
 	evt->rand = r;
 	evt->evtid = ctx->q->counter ++;
 	evt->procid = ctx->q->procid;
+	evt->codec = codec;
 	evt->size = len;
+	evt->count = count;
 	evt->recv_time = evt->last_sent;
 
 	ctx->pending_events = g_list_prepend (ctx->pending_events, evt);
-	ctx->q->gauge_pending ++;
+	ctx->q->gauge_pending += count;
 
 	gchar strid[1+ 2*HEADER_SIZE];
 	oio_str_bin2hex(evt, HEADER_SIZE, strid, sizeof(strid));
-	GRID_DEBUG("EVT:DEF %s (%u) %.*s", strid,
-			ctx->q->gauge_pending, evt->size, evt->message);
+	if (codec == EVT_CODEC_SINGLE)
+		GRID_DEBUG("EVT:DEF %s (%u) %.*s", strid,
+				ctx->q->gauge_pending, evt->size, evt->message);
+	else
+		GRID_DEBUG("EVT:DEF %s (%u) %s %u events %u bytes", strid,
+				ctx->q->gauge_pending, codec_names[codec], count, evt->size);
 
 	return _zmq2agent_send_event (now, ctx, evt, strid);
 }
 
+/* Closes the current batch and sends it, if it is full or too old,
+ * or if 'force' is set. */
+static gboolean
+_zmq2agent_flush_batch (struct _zmq2agent_ctx_s *ctx, gboolean force)
+{
+	struct _queue_AGENT_s *q = ctx->q;
+	if (!ctx->batch_count)
+		return TRUE;
+	if (!force
+			&& ctx->batch_count < q->batch_max_events
+			&& ctx->batch->len < q->batch_max_bytes
+			&& oio_ext_monotonic_time () - ctx->batch_start < q->batch_max_delay)
+		return TRUE;
+
+	g_string_append_c (ctx->batch, ']');
+	const guint8 *data = (guint8*) ctx->batch->str;
+	gsize len = ctx->batch->len;
+	enum event_codec_e codec = EVT_CODEC_BATCH;
+
+	guint8 *zbuf = NULL;
+	if (q->batch_compress) {
+		uLongf zlen = compressBound (len);
+		zbuf = g_malloc (zlen);
+		if (Z_OK == compress2 (zbuf, &zlen, data, len, Z_BEST_SPEED)) {
+			data = zbuf;
+			len = zlen;
+			codec = EVT_CODEC_BATCH_ZLIB;
+		}
+	}
+
+	gboolean rc = _zmq2agent_push_event (oio_ext_rand_int(), ctx,
+			data, len, ctx->batch_count, codec);
+
+	g_free (zbuf);
+	g_string_truncate (ctx->batch, 0);
+	ctx->batch_count = 0;
+	return rc;
+}
+
+static gboolean
+_zmq2agent_manage_event (guint32 r, struct _zmq2agent_ctx_s *ctx, zmq_msg_t *msg)
+{
+	if (!ctx->zagent) return TRUE;
+
+	const guint8 *data = zmq_msg_data (msg);
+	const size_t len = zmq_msg_size (msg);
+
+	if (ctx->q->batch_max_events < 2) {
+		if (ctx->batch_count && !_zmq2agent_flush_batch (ctx, TRUE))
+			return FALSE;
+		return _zmq2agent_push_event (r, ctx, data, len, 1, EVT_CODEC_SINGLE);
+	}
+
+	if (!ctx->batch)
+		ctx->batch = g_string_sized_new (ctx->q->batch_max_bytes + 1);
+	if (!ctx->batch_count) {
+		g_string_append_c (ctx->batch, '[');
+		ctx->batch_start = oio_ext_monotonic_time ();
+	} else {
+		g_string_append_c (ctx->batch, ',');
+	}
+	g_string_append_len (ctx->batch, (const gchar*) data, len);
+	ctx->batch_count ++;
+	return _zmq2agent_flush_batch (ctx, FALSE);
+}
+
 static gint
 _cmp (gconstpointer a, gconstpointer b)
 {
@@ -279,9 +478,10 @@ _zmq2agent_manage_ack (struct _zmq2agent_ctx_s *ctx, zmq_msg_t *msg)
 		++ ctx->q->counter_ack_notfound;
 	} else {
 		GRID_DEBUG("EVT:ACK %s", strid);
+		struct event_s *evt = li->data;
+		ctx->q->gauge_pending -= evt->count;
 		ctx->pending_events = g_list_remove_link (ctx->pending_events, li);
 		g_list_free_full (li, g_free);
-		-- ctx->q->gauge_pending;
 		++ ctx->q->counter_ack;
 	}
 }
@@ -351,7 +551,14 @@ _zmq2agent_worker (struct _zmq2agent_ctx_s *ctx)
 	};
 
 	for (gboolean run = TRUE; run ;) {
-		int rc = zmq_poll (pi, 2, 1000);
+		/* wake up in time to send the current batch */
+		long timeout = 1000;
+		if (ctx->batch_count) {
+			gint64 left = ctx->batch_start + ctx->q->batch_max_delay
+				- oio_ext_monotonic_time ();
+			timeout = CLAMP(left / G_TIME_SPAN_MILLISECOND, 1, 1000);
+		}
+		int rc = zmq_poll (pi, 2, timeout);
 		if (rc < 0) {
 			int err = zmq_errno();
 			if (err != ETERM && err != EINTR)
@@ -364,15 +571,19 @@ _zmq2agent_worker (struct _zmq2agent_ctx_s *ctx)
 		_retry_events (ctx);
 		if (pi[0].revents)
 			run = _zmq2agent_receive_events (ctx);
+		_zmq2agent_flush_batch (ctx, !run);
 
 		/* Periodically write stats in the log */
 		gint64 now = oio_ext_monotonic_time ();
 		if ((now - last_debug) > 2 * G_TIME_SPAN_MINUTE) {
 			GRID_INFO("ZMQ2AGENT recv=%"G_GINT64_FORMAT" sent=%"G_GINT64_FORMAT
-					" ack=%"G_GINT64_FORMAT"+%"G_GINT64_FORMAT" queue=%u",
+					" events=%"G_GINT64_FORMAT" bytes=%"G_GINT64_FORMAT
+					" ack=%"G_GINT64_FORMAT"+%"G_GINT64_FORMAT" queue=%u spooled=%u",
 					ctx->q->counter_received, ctx->q->counter_sent,
+					ctx->q->counter_sent_events, ctx->q->counter_sent_bytes,
 					ctx->q->counter_ack, ctx->q->counter_ack_notfound,
-					ctx->q->gauge_pending);
+					ctx->q->gauge_pending,
+					oio_events_queue_spool_count(&(ctx->q->spool)));
 			last_debug = now;
 		}
 	}
@@ -423,13 +634,35 @@ _maybe_send_overwritable(struct oio_events_queue_s *self)
 	oio_events_queue_buffer_maybe_flush(&(q->buffer), __send, NULL);
 }
 
+/* Moves the spooled events to the agent, as long as there is room in
+ * memory. Called only when the GQueue is empty, since it holds the events
+ * older than those in the spool. */
+static gboolean
+_gq2zmq_replay_spool (struct _gq2zmq_ctx_s *ctx)
+{
+	while (_q_backlog (ctx->q) < ctx->q->max_events_in_queue) {
+		gchar *tmp = oio_events_queue_spool_pop (&(ctx->q->spool));
+		if (!tmp)
+			break;
+		if (!_forward_event (ctx->zpush, tmp))
+			return FALSE;
+	}
+	return TRUE;
+}
+
 static gpointer
 _gq2zmq_worker (struct _gq2zmq_ctx_s *ctx)
 {
 	while (ctx->running (_gq2zmq_has_pending (ctx))) {
 		_maybe_send_overwritable((struct oio_events_queue_s *)ctx->q);
-		gchar *tmp =
-			(gchar*) g_async_queue_timeout_pop (ctx->queue, G_TIME_SPAN_SECOND);
+		gint64 wait = G_TIME_SPAN_SECOND;
+		if (oio_events_queue_spool_count (&(ctx->q->spool)) > 0) {
+			if (g_async_queue_length (ctx->queue) <= 0
+					&& !_gq2zmq_replay_spool (ctx))
+				break;
+			wait = 100 * G_TIME_SPAN_MILLISECOND;
+		}
+		gchar *tmp = (gchar*) g_async_queue_timeout_pop (ctx->queue, wait);
 		if (tmp && !_forward_event (ctx->zpush, tmp))
 			break;
 	}
@@ -440,6 +673,7 @@ _gq2zmq_worker (struct _gq2zmq_ctx_s *ctx)
 			break;
 	}
 
+	/* The events still spooled are left in the file, for the next run */
 	zmq_send (ctx->zpush, "EOF", 0, 0);
 	GRID_INFO ("Thread stopping [NOTIFY-GQ2ZMQ]");
 	return ctx;
@@ -526,6 +760,7 @@ _q_run (struct oio_events_queue_s *self, gboolean (*running) (gboolean pending))
 exit:
 	if (th_gq2zmq) g_thread_join (th_gq2zmq);
 	if (zmq2agent.pending_events) g_list_free_full (zmq2agent.pending_events, g_free);
+	if (zmq2agent.batch) g_string_free (zmq2agent.batch, TRUE);
 	if (zagent) zmq_close (zagent);
 	if (zpull) zmq_close (zpull);
 	if (zpush) zmq_close (zpush);
@@ -57,6 +57,14 @@ void meta2_json_chunks_only(GString *gstr, GSList *l, gboolean extend);
  * inclusion in an existing dictionary. */
 void meta2_json_dump_all_beans(GString *gstr, GSList *beans);
 
+/** Called after each bean appended to 'gstr', that it may send and empty */
+typedef void (*meta2_json_flush_f) (GString *gstr, gpointer udata);
+
+/** Like meta2_json_dump_all_beans(), but 'flush' (if not NULL) is called
+ * between the beans, so that the output remains small. */
+void meta2_json_dump_all_beans_flushed(GString *gstr, GSList *beans,
+		meta2_json_flush_f flush, gpointer udata);
+
 /** Serialize beans to JSON.
  * The output has the form:
  *   {"type":"chunk":,...},
@@ -100,8 +100,9 @@ encode_bean (GString *g, gpointer bean)
 //------------------------------------------------------------------------------
 
 static void
-_json_BEAN_only(GString *gstr, GSList *l, gconstpointer selector,
-		gboolean extend, void (*encoder)(GString*,gpointer))
+_json_BEAN_only_flushed(GString *gstr, GSList *l, gconstpointer selector,
+		gboolean extend, void (*encoder)(GString*,gpointer),
+		meta2_json_flush_f flush, gpointer udata)
 {
 	gboolean first = TRUE;
 
@@ -117,9 +118,18 @@ _json_BEAN_only(GString *gstr, GSList *l, gconstpointer selector,
 					DESCR(l->data)->name);
 		encoder(gstr, l->data);
 		g_string_append_c (gstr, '}');
+		if (flush)
+			flush(gstr, udata);
 	}
 }
 
+static void
+_json_BEAN_only(GString *gstr, GSList *l, gconstpointer selector,
+		gboolean extend, void (*encoder)(GString*,gpointer))
+{
+	_json_BEAN_only_flushed(gstr, l, selector, extend, encoder, NULL, NULL);
+}
+
 void
 meta2_json_alias_only(GString *gstr, GSList *l, gboolean extend)
 {
@@ -146,13 +156,23 @@ meta2_json_dump_all_xbeans(GString *gstr, GSList *beans)
 
 void
 meta2_json_dump_all_beans(GString *gstr, GSList *beans)
+{
+	meta2_json_dump_all_beans_flushed(gstr, beans, NULL, NULL);
+}
+
+void
+meta2_json_dump_all_beans_flushed(GString *gstr, GSList *beans,
+		meta2_json_flush_f flush, gpointer udata)
 {
 	g_string_append(gstr, "\"aliases\":[");
-	meta2_json_alias_only(gstr, beans, FALSE);
+	_json_BEAN_only_flushed(gstr, beans, &descr_struct_ALIASES, FALSE,
+			encode_alias, flush, udata);
 	g_string_append(gstr, "],\"headers\":[");
-	meta2_json_headers_only(gstr, beans, FALSE);
+	_json_BEAN_only_flushed(gstr, beans, &descr_struct_CONTENTS_HEADERS, FALSE,
+			encode_header, flush, udata);
 	g_string_append(gstr, "],\"chunks\":[");
-	meta2_json_chunks_only(gstr, beans, FALSE);
+	_json_BEAN_only_flushed(gstr, beans, &descr_struct_CHUNKS, FALSE,
+			encode_chunk, flush, udata);
 	g_string_append(gstr, "]");
 }
 
@@ -126,6 +126,11 @@ message_marshall_gba(MESSAGE m, GError **err)
 	metautils_message_add_field_strint(m, NAME_MSGKEY_ADMIN_COMMAND,
 			oio_ext_is_admin());
 
+	/* Let the service called attach its trace to the current span */
+	const char *trace = oio_ext_trace_context ();
+	if (trace)
+		metautils_message_add_field_str(m, NAME_MSGKEY_TRACE, trace);
+
 	/*try to encode */
 	guint32 u32 = 0;
 	GByteArray *result = g_byte_array_sized_new(256);
@@ -303,3 +303,358 @@ lru_tree_remove_exceeding (struct lru_tree_s *lt, guint count)
 	}
 	return removed;
 }
+
+/* Concurrent variant ------------------------------------------------------ */
+
+#ifndef  LRU_STRIPED_DEFAULT_SEGMENTS
+# define LRU_STRIPED_DEFAULT_SEGMENTS 16
+#endif
+
+struct _cnode_s
+{
+	/* CLOCK ring, the hand goes from prev to next */
+	struct _cnode_s *prev;
+	struct _cnode_s *next;
+
+	gpointer k;
+	gpointer v;
+
+	/* Both set under the shared lock */
+	volatile gint referenced;
+	volatile gint atime; /* seconds */
+};
+
+struct _segment_s
+{
+	GRWLock lock;
+	GHashTable *nodes;
+	struct _cnode_s *hand; /* next eviction candidate, NULL if empty */
+	guint count;
+};
+
+struct lru_striped_s
+{
+	GHashFunc khash;
+	GEqualFunc kequal;
+	GDestroyNotify kfree;
+	GDestroyNotify vfree;
+	guint32 flags;
+
+	guint mask;
+	struct _segment_s segments[];
+};
+
+static gint
+_cnode_now (void)
+{
+	return oio_ext_monotonic_time () / G_TIME_SPAN_SECOND;
+}
+
+static void
+_cnode_destroy (struct lru_striped_s *ls, struct _cnode_s *node)
+{
+	if (ls->vfree && node->v)
+		ls->vfree(node->v);
+	if (ls->kfree && node->k)
+		ls->kfree(node->k);
+	SLICE_FREE(struct _cnode_s, node);
+}
+
+static void
+_ring_push_back (struct _segment_s *seg, struct _cnode_s *node)
+{
+	if (!seg->hand) {
+		node->prev = node->next = node;
+		seg->hand = node;
+	} else {
+		node->next = seg->hand;
+		node->prev = seg->hand->prev;
+		node->prev->next = node;
+		seg->hand->prev = node;
+	}
+}
+
+static void
+_ring_extract (struct _segment_s *seg, struct _cnode_s *node)
+{
+	if (node->next == node) {
+		seg->hand = NULL;
+	} else {
+		node->prev->next = node->next;
+		node->next->prev = node->prev;
+		if (seg->hand == node)
+			seg->hand = node->next;
+	}
+	node->prev = node->next = NULL;
+}
+
+static struct _segment_s *
+_segment_of (struct lru_striped_s *ls, gconstpointer k)
+{
+	guint h = ls->khash(k);
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+	return ls->segments + (h & ls->mask);
+}
+
+/* Advances the hand until an entry not referenced since the last pass */
+static struct _cnode_s *
+_segment_victim (struct _segment_s *seg)
+{
+	struct _cnode_s *node;
+	while (NULL != (node = seg->hand)) {
+		if (!g_atomic_int_get(&node->referenced))
+			return node;
+		g_atomic_int_set(&node->referenced, 0);
+		seg->hand = node->next;
+	}
+	return NULL;
+}
+
+static void
+_segment_evict (struct lru_striped_s *ls, struct _segment_s *seg,
+		struct _cnode_s *node)
+{
+	g_hash_table_remove(seg->nodes, node->k);
+	_ring_extract(seg, node);
+	-- seg->count;
+	_cnode_destroy(ls, node);
+}
+
+static void
+_segment_evict_one (struct lru_striped_s *ls, struct _segment_s *seg)
+{
+	struct _cnode_s *node = _segment_victim(seg);
+	if (node)
+		_segment_evict(ls, seg, node);
+}
+
+static guint
+_segment_share (struct lru_striped_s *ls, guint count)
+{
+	const guint nb = ls->mask + 1;
+	return count / nb + (count % nb ? 1 : 0);
+}
+
+/* Must be called with the segment locked in write mode */
+static void
+_segment_insert (struct lru_striped_s *ls, struct _segment_s *seg,
+		struct _cnode_s *node, gpointer k, gpointer v)
+{
+	if (!node) {
+		node = SLICE_NEW0(struct _cnode_s);
+		node->k = k;
+		node->v = v;
+		g_hash_table_insert(seg->nodes, k, node);
+		_ring_push_back(seg, node);
+		++ seg->count;
+	} else {
+		/* replace the key too, the table keeps a pointer to it */
+		g_hash_table_replace(seg->nodes, k, node);
+		if (ls->vfree && node->v)
+			ls->vfree(node->v);
+		if (ls->kfree && node->k)
+			ls->kfree(node->k);
+		node->k = k;
+		node->v = v;
+		node->referenced = 1;
+	}
+	node->atime = _cnode_now();
+}
+
+struct lru_striped_s*
+lru_striped_create(GHashFunc hash, GEqualFunc equal,
+		GDestroyNotify kfree, GDestroyNotify vfree, guint32 options,
+		guint nb_segments)
+{
+	EXTRA_ASSERT(hash != NULL);
+	EXTRA_ASSERT(equal != NULL);
+
+	guint nb = 1;
+	if (!nb_segments)
+		nb_segments = LRU_STRIPED_DEFAULT_SEGMENTS;
+	while (nb < nb_segments)
+		nb <<= 1;
+
+	struct lru_striped_s *ls = g_malloc0(sizeof(struct lru_striped_s)
+			+ nb * sizeof(struct _segment_s));
+	ls->khash = hash;
+	ls->kequal = equal;
+	ls->kfree = kfree;
+	ls->vfree = vfree;
+	ls->flags = options;
+	ls->mask = nb - 1;
+	for (guint i=0; i<nb ;++i) {
+		g_rw_lock_init(&ls->segments[i].lock);
+		ls->segments[i].nodes = g_hash_table_new(hash, equal);
+	}
+	return ls;
+}
+
+void
+lru_striped_destroy(struct lru_striped_s *ls)
+{
+	if (!ls)
+		return;
+
+	for (guint i=0; i<=ls->mask ;++i) {
+		struct _segment_s *seg = ls->segments + i;
+		struct _cnode_s *node;
+		while (NULL != (node = seg->hand)) {
+			_ring_extract(seg, node);
+			_cnode_destroy(ls, node);
+		}
+		g_hash_table_destroy(seg->nodes);
+		g_rw_lock_clear(&seg->lock);
+	}
+	g_free(ls);
+}
+
+void
+lru_striped_insert(struct lru_striped_s *ls, gpointer k, gpointer v)
+{
+	EXTRA_ASSERT(ls != NULL);
+	EXTRA_ASSERT(k != NULL);
+	EXTRA_ASSERT(v != NULL);
+
+	struct _segment_s *seg = _segment_of(ls, k);
+	g_rw_lock_writer_lock(&seg->lock);
+	_segment_insert(ls, seg, g_hash_table_lookup(seg->nodes, k), k, v);
+	g_rw_lock_writer_unlock(&seg->lock);
+}
+
+gboolean
+lru_striped_admit(struct lru_striped_s *ls, gpointer k, gpointer v,
+		guint count, lru_striped_admission_f admit, gpointer udata)
+{
+	EXTRA_ASSERT(ls != NULL);
+	EXTRA_ASSERT(k != NULL);
+	EXTRA_ASSERT(v != NULL);
+	EXTRA_ASSERT(admit != NULL);
+
+	gboolean admitted = TRUE;
+	struct _segment_s *seg = _segment_of(ls, k);
+	g_rw_lock_writer_lock(&seg->lock);
+	struct _cnode_s *node = g_hash_table_lookup(seg->nodes, k);
+	if (!node && count > 0 && seg->count >= _segment_share(ls, count)) {
+		struct _cnode_s *victim = _segment_victim(seg);
+		if (victim && !(admitted = admit(k, victim->k, udata))) {
+			if (ls->vfree)
+				ls->vfree(v);
+			if (ls->kfree)
+				ls->kfree(k);
+		} else if (victim) {
+			_segment_evict(ls, seg, victim);
+		}
+	}
+	if (admitted)
+		_segment_insert(ls, seg, node, k, v);
+	g_rw_lock_writer_unlock(&seg->lock);
+	return admitted;
+}
+
+gpointer
+lru_striped_get(struct lru_striped_s *ls, gconstpointer k, GBoxedCopyFunc copy)
+{
+	EXTRA_ASSERT(ls != NULL);
+	EXTRA_ASSERT(k != NULL);
+
+	gpointer result = NULL;
+	struct _segment_s *seg = _segment_of(ls, k);
+	g_rw_lock_reader_lock(&seg->lock);
+	struct _cnode_s *node = g_hash_table_lookup(seg->nodes, k);
+	if (node) {
+		if (!(ls->flags & LTO_NOATIME)) {
+			if (!g_atomic_int_get(&node->referenced))
+				g_atomic_int_set(&node->referenced, 1);
+			const gint now = _cnode_now();
+			if (g_atomic_int_get(&node->atime) != now)
+				g_atomic_int_set(&node->atime, now);
+		}
+		result = copy ? copy(node->v) : node->v;
+	}
+	g_rw_lock_reader_unlock(&seg->lock);
+	return result;
+}
+
+gboolean
+lru_striped_remove(struct lru_striped_s *ls, gconstpointer k)
+{
+	EXTRA_ASSERT(ls != NULL);
+	EXTRA_ASSERT(k != NULL);
+
+	struct _segment_s *seg = _segment_of(ls, k);
+	g_rw_lock_writer_lock(&seg->lock);
+	struct _cnode_s *node = g_hash_table_lookup(seg->nodes, k);
+	if (node) {
+		g_hash_table_remove(seg->nodes, k);
+		_ring_extract(seg, node);
+		-- seg->count;
+		_cnode_destroy(ls, node);
+	}
+	g_rw_lock_writer_unlock(&seg->lock);
+	return node != NULL;
+}
+
+guint
+lru_striped_remove_older(struct lru_striped_s *ls, gint64 oldest)
+{
+	EXTRA_ASSERT(ls != NULL);
+	const gint oldest_s = oldest / G_TIME_SPAN_SECOND;
+	guint removed = 0;
+
+	for (guint i=0; i<=ls->mask ;++i) {
+		struct _segment_s *seg = ls->segments + i;
+		GHashTableIter it;
+		gpointer k, v;
+		g_rw_lock_writer_lock(&seg->lock);
+		g_hash_table_iter_init(&it, seg->nodes);
+		while (g_hash_table_iter_next(&it, &k, &v)) {
+			struct _cnode_s *node = v;
+			if (node->atime >= oldest_s)
+				continue;
+			g_hash_table_iter_remove(&it);
+			_ring_extract(seg, node);
+			-- seg->count;
+			_cnode_destroy(ls, node);
+			++ removed;
+		}
+		g_rw_lock_writer_unlock(&seg->lock);
+	}
+	return removed;
+}
+
+guint
+lru_striped_remove_exceeding(struct lru_striped_s *ls, guint count)
+{
+	EXTRA_ASSERT(ls != NULL);
+	const guint nb = ls->mask + 1;
+	const guint share = _segment_share(ls, count);
+	guint removed = 0;
+
+	for (guint i=0; i<nb ;++i) {
+		struct _segment_s *seg = ls->segments + i;
+		g_rw_lock_writer_lock(&seg->lock);
+		while (seg->count > share) {
+			_segment_evict_one(ls, seg);
+			++ removed;
+		}
+		g_rw_lock_writer_unlock(&seg->lock);
+	}
+	return removed;
+}
+
+gint64
+lru_striped_count(struct lru_striped_s *ls)
+{
+	EXTRA_ASSERT(ls != NULL);
+	gint64 total = 0;
+	for (guint i=0; i<=ls->mask ;++i) {
+		struct _segment_s *seg = ls->segments + i;
+		g_rw_lock_reader_lock(&seg->lock);
+		total += seg->count;
+		g_rw_lock_reader_unlock(&seg->lock);
+	}
+	return total;
+}
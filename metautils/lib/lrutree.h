@@ -56,4 +56,52 @@ void lru_tree_foreach(struct lru_tree_s *lt, GTraverseFunc h, gpointer hdata);
 
 gint64 lru_tree_count(struct lru_tree_s *lt);
 
+/* Concurrent variant ------------------------------------------------------ */
+
+/* The entries are spread by hash among independently locked segments. In
+ * each segment a CLOCK replaces the LRU list: a hit only sets a reference
+ * bit under a shared lock, and the eviction gives a second chance to the
+ * entries referenced since the last pass. Expiration sweeps the whole
+ * segments in batch. The access times are kept with a one-second
+ * granularity. */
+struct lru_striped_s;
+
+/**
+ * @param nb_segments rounded up to a power of 2, 0 for a default value
+ * @param options a binary OR'ed combination of LTO_* flags.
+ */
+struct lru_striped_s* lru_striped_create(GHashFunc hash, GEqualFunc equal,
+		GDestroyNotify kfree, GDestroyNotify vfree, guint32 options,
+		guint nb_segments);
+
+void lru_striped_destroy(struct lru_striped_s *ls);
+
+void lru_striped_insert(struct lru_striped_s *ls, gpointer k, gpointer v);
+
+/* Tells if the <candidate> key deserves the room of the <victim> key */
+typedef gboolean (*lru_striped_admission_f) (gconstpointer candidate,
+		gconstpointer victim, gpointer udata);
+
+/* Like lru_striped_insert(), but when the segment of <k> already holds its
+ * share of <count> entries, the new entry replaces the next eviction
+ * candidate only if <admit> agrees. A rejected entry is freed and FALSE is
+ * returned. An existing key is always updated, and 0 means no limit. */
+gboolean lru_striped_admit(struct lru_striped_s *ls, gpointer k, gpointer v,
+		guint count, lru_striped_admission_f admit, gpointer udata);
+
+/* Returns what <copy> returned for the value found, while the segment is
+ * still locked, or the value itself if <copy> is NULL. NULL if not found. */
+gpointer lru_striped_get(struct lru_striped_s *ls, gconstpointer k,
+		GBoxedCopyFunc copy);
+
+/* Returns TRUE if the item keyed with 'k' has been removed. */
+gboolean lru_striped_remove(struct lru_striped_s *ls, gconstpointer k);
+
+guint lru_striped_remove_older(struct lru_striped_s *ls, gint64 oldest);
+
+/* Each segment keeps its share of <count> */
+guint lru_striped_remove_exceeding(struct lru_striped_s *ls, guint count);
+
+gint64 lru_striped_count(struct lru_striped_s *ls);
+
 #endif /*OIO_SDS__metautils__lib__lrutree_h*/
@@ -104,6 +104,7 @@ License along with this library.
 
 #define NAME_MSGKEY_ADMIN_COMMAND "ADM_CMD"
 #define NAME_MSGKEY_NS_STATE      "STT"
+#define NAME_MSGKEY_TRACE         "TRC"
 #define NAME_MSGKEY_WORMED        "WRM"
 
 #define NAME_MSGKEY_PREFIX_PROPERTY    "P:"
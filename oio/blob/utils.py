@@ -1,7 +1,7 @@
 from oio.common import exceptions as exc
-from oio.common.utils import read_user_xattr
+from oio.common.utils import read_user_xattr, read_packed_user_xattr
 from oio.common.constants import chunk_xattr_keys, chunk_xattr_keys_optional, \
-    volume_xattr_keys
+    chunk_xattr_packed, volume_xattr_keys
 
 
 def check_volume(volume_path):
@@ -17,7 +17,11 @@ def check_volume(volume_path):
 
 
 def read_chunk_metadata(fd):
-    raw_meta = read_user_xattr(fd)
+    # The packed attribute is authoritative, and read in one call. The
+    # individual ones are only read for the chunks written without it.
+    raw_meta = read_packed_user_xattr(fd, chunk_xattr_packed, 'grid.')
+    if raw_meta is None:
+        raw_meta = read_user_xattr(fd)
     meta = {}
     for k, v in chunk_xattr_keys.iteritems():
         if v not in raw_meta:
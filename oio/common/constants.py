@@ -68,6 +68,12 @@ chunk_xattr_keys = {
     'metachunk_size': 'grid.metachunk.size',
 }
 
+# All the chunk attributes in one value, as NUL-terminated names and values
+# without the 'grid.' prefix (see rawx-lib/src/rawx.h). Authoritative when
+# present, for the rawx and the tools: change the attributes of a chunk with
+# oio.common.utils.write_packed_user_xattr().
+chunk_xattr_packed = 'grid.packed'
+
 chunk_xattr_keys_optional = {
         'content_chunksnb': True,
         'chunk_hash': True,
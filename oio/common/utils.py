@@ -440,6 +440,45 @@ def read_user_xattr(fd):
     return meta
 
 
+def unpack_user_xattr(packed, prefix):
+    fields = packed.split('\0')
+    meta = {}
+    for i in range(0, len(fields) - 1, 2):
+        meta[prefix + fields[i]] = fields[i + 1]
+    return meta
+
+
+def pack_user_xattr(meta, prefix):
+    return ''.join('%s\0%s\0' % (k[len(prefix):], v)
+                   for k, v in meta.iteritems() if k.startswith(prefix))
+
+
+def read_packed_user_xattr(fd, key, prefix):
+    """Read the attributes packed in the single 'user.<key>' attribute,
+    with one call. Returns None when there is no such attribute."""
+    try:
+        packed = xattr.get(fd, 'user.' + key)
+    except (IOError, OSError) as e:
+        for err in 'ENOTSUP', 'EOPNOTSUPP':
+            if hasattr(errno, err) and e.errno == getattr(errno, err):
+                raise e
+        return None
+    return unpack_user_xattr(packed, prefix)
+
+
+def write_packed_user_xattr(fd, key, prefix, values):
+    """Set the attributes of 'values' (full names, without 'user.'), both
+    individually and in the packed 'user.<key>' attribute."""
+    meta = read_packed_user_xattr(fd, key, prefix)
+    if meta is None:
+        meta = read_user_xattr(fd)
+        meta.pop(key, None)
+    for k, v in values.iteritems():
+        xattr.set(fd, 'user.' + k, v)
+        meta[k] = v
+    xattr.set(fd, 'user.' + key, pack_user_xattr(meta, prefix))
+
+
 def statfs(volume):
     st = os.statvfs(volume)
     total = st.f_blocks * st.f_frsize
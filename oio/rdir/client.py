@@ -144,6 +144,16 @@ class RdirClient(Client):
         self._rdir_request(volume_id, 'POST', 'rdir/push', create=True,
                            json=body, headers=headers)
 
+    def chunk_push_many(self, volume_id, chunks):
+        """
+        Reference several chunks in the reverse directory, in one request.
+
+        :param chunks: list of dicts with 'container_id', 'content_id',
+            'chunk_id' and the 'mtime' and/or 'rtime' fields
+        """
+        self._rdir_request(volume_id, 'POST', 'rdir/push', create=True,
+                           json=list(chunks))
+
     def chunk_delete(self, volume_id, container_id, content_id, chunk_id):
         """Unreference a chunk from the reverse directory"""
         body = {'container_id': container_id,
@@ -152,11 +162,14 @@ class RdirClient(Client):
 
         self._rdir_request(volume_id, 'DELETE', 'rdir/delete', json=body)
 
-    def chunk_fetch(self, volume, limit=100, rebuild=False):
+    def chunk_fetch(self, volume, limit=100, rebuild=False,
+                    container_id=None):
         """Fetch the list of chunks belonging to the specified volume"""
         req_body = {'limit': limit}
         if rebuild:
             req_body['rebuild'] = True
+        if container_id:
+            req_body['container_id'] = container_id
 
         while True:
             resp, resp_body = self._rdir_request(volume, 'POST', 'rdir/fetch',
@@ -119,14 +119,22 @@ class Rdir(object):
     def on_rdir_push(self, req):
         volume = self._get_volume(req)
         decoded = json.loads(req.get_data())
-        data = self._check_push(decoded)
+        # A list of chunks is written in a single batch
+        if isinstance(decoded, list):
+            push = self.backend.chunk_push_many
+            args = ([self._check_push(meta) for meta in decoded], )
+            kwargs = {}
+        else:
+            push = self.backend.chunk_push
+            args = tuple()
+            kwargs = self._check_push(decoded)
 
         try:
-            self.backend.chunk_push(volume, **data)
+            push(volume, *args, **kwargs)
         except NoSuchDB:
             if req.args.get('create'):
                 self.backend.create(volume)
-                self.backend.chunk_push(volume, **data)
+                push(volume, *args, **kwargs)
             else:
                 return NotFound('No such volume')
         return Response(status=204)
@@ -158,15 +166,25 @@ class Rdir(object):
         rebuild = decoded.get('rebuild', False)
         if not isinstance(rebuild, bool):
             return BadRequest('rebuild must be true or false')
+        container_id = decoded.get('container_id')
 
-        data = self.backend.chunk_fetch(volume, start_after=start_after,
-                                        limit=limit, rebuild=rebuild)
+        data = self.backend.chunk_fetch_iter(volume, start_after=start_after,
+                                             limit=limit, rebuild=rebuild,
+                                             container_id=container_id)
 
         if pretty:
-            body = json.dumps(data, indent=4)
-        else:
-            body = json.dumps(data)
-        return Response(body, mimetype='application/json')
+            body = json.dumps(list(data), indent=4)
+            return Response(body, mimetype='application/json')
+
+        # Stream the records as they are read from the DB
+        def _stream():
+            yield '['
+            for i, record in enumerate(data):
+                if i:
+                    yield ','
+                yield json.dumps(record)
+            yield ']'
+        return Response(_stream(), mimetype='application/json')
 
     def on_rdir_status(self, req):
         volume = self._get_volume(req)
@@ -16,10 +16,12 @@
 
 import os
 import plyvel
+from collections import OrderedDict
+from threading import RLock
 from plyvel import DB
 from functools import wraps
 from oio.common.exceptions import ServerException
-from oio.common.utils import json, get_logger
+from oio.common.utils import json, get_logger, int_value, true_value
 
 
 class NoSuchDB(Exception):
@@ -37,18 +39,31 @@ def handle_db_not_found(fnc):
             raise NoSuchDB(msg)
     return _wrapped
 
-# FIXME this class is not thread-safe (see _get_db, push, lock) but it
+# FIXME this class is not thread-safe (see push, lock) but it
 # works fine with the default gunicorn sync worker and with only one worker.
 # Only one process can open a leveldb DB so if we want to use several workers,
 # we need to close/open db each time.
 # In multithreaded environement, the push function needs transaction to update
 # an entry in a consistent manner.
+# At most `max_opened_db` DB handles are kept opened, the least recently used
+# is closed first, and each of them opens at most `db_max_open_files` files.
+# The handles used by an open chunk iterator are pinned and never closed by
+# the eviction, which may then keep more than `max_opened_db` handles opened.
+# The handles and the pins are managed under `dbs_lock`.
 
 
 class RdirBackend(object):
     def __init__(self, conf):
         self.db_path = conf.get('db_path')
-        self.dbs = {}
+        # Opened DB handles, least recently used first
+        self.dbs = OrderedDict()
+        # Count of open iterators per volume, their handles are not evicted
+        self.pinned = dict()
+        self.dbs_lock = RLock()
+        self.max_opened_db = int_value(conf.get('max_opened_db'), 64)
+        self.db_max_open_files = int_value(conf.get('db_max_open_files'),
+                                           256)
+        self.db_sync = true_value(conf.get('db_sync', False))
         self.logger = get_logger(conf)
         if not os.path.exists(self.db_path):
             os.makedirs(self.db_path)
@@ -62,13 +77,44 @@ class RdirBackend(object):
 
     @handle_db_not_found
     def _get_db(self, volume_id):
-        try:
-            db = self.dbs[volume_id]
-        except KeyError:
-            db_path = self._get_db_path(volume_id)
-            self.dbs[volume_id] = DB(db_path, create_if_missing=False)
-            db = self.dbs[volume_id]
-        return db
+        with self.dbs_lock:
+            try:
+                db = self.dbs.pop(volume_id)
+            except KeyError:
+                db_path = self._get_db_path(volume_id)
+                db = DB(db_path, create_if_missing=False,
+                        max_open_files=self.db_max_open_files)
+                self._evict_dbs(self.max_opened_db - 1)
+            self.dbs[volume_id] = db
+            return db
+
+    def _evict_dbs(self, max_count):
+        """Close the least recently used DB handles not pinned by
+        an iterator, until at most `max_count` remain opened.
+        Must be called with `dbs_lock` held."""
+        if len(self.dbs) <= max_count:
+            return
+        for old_volume_id in list(self.dbs.keys()):
+            if len(self.dbs) <= max_count:
+                break
+            if self.pinned.get(old_volume_id):
+                continue
+            old_db = self.dbs.pop(old_volume_id)
+            self.logger.debug("Closing DB of volume %s", old_volume_id)
+            old_db.close()
+
+    def _pin_db(self, volume_id):
+        with self.dbs_lock:
+            self.pinned[volume_id] = self.pinned.get(volume_id, 0) + 1
+
+    def _unpin_db(self, volume_id):
+        with self.dbs_lock:
+            count = self.pinned.pop(volume_id) - 1
+            if count > 0:
+                self.pinned[volume_id] = count
+            else:
+                # The bound may have been exceeded while the handle was pinned
+                self._evict_dbs(self.max_opened_db)
 
     def _get_db_chunk(self, volume_id):
         return self._get_db(volume_id).prefixed_db("chunk|")
@@ -76,11 +122,9 @@ class RdirBackend(object):
     def _get_db_admin(self, volume_id):
         return self._get_db(volume_id).prefixed_db("admin|")
 
-    def chunk_push(self, volume_id,
-                   container_id, content_id, chunk_id, **data):
-        key = "%s|%s|%s" % (container_id, content_id, chunk_id)
-
-        value = self._get_db_chunk(volume_id).get(key.encode('utf8'))
+    @staticmethod
+    def _chunk_merge(value, data):
+        """Update the JSON-encoded record with data, return it encoded"""
         if value is not None:
             value = json.loads(value)
         else:
@@ -97,10 +141,43 @@ class RdirBackend(object):
             else:
                 raise ServerException("mtime is mandatory")
 
-        value = json.dumps(value)
+        return json.dumps(value).encode('utf8')
 
-        self._get_db_chunk(volume_id).put(key.encode('utf8'),
-                                          value.encode('utf8'))
+    def chunk_push(self, volume_id,
+                   container_id, content_id, chunk_id, **data):
+        key = "%s|%s|%s" % (container_id, content_id, chunk_id)
+        key = key.encode('utf8')
+
+        db = self._get_db_chunk(volume_id)
+        value = self._chunk_merge(db.get(key), data)
+        db.put(key, value, sync=self.db_sync)
+
+    def chunk_push_many(self, volume_id, chunks):
+        """
+        Push several chunk records in one write batch.
+
+        :param chunks: iterable of dicts with 'container_id', 'content_id',
+            'chunk_id' and the fields to be updated.
+        :returns: the number of records written
+        """
+        db = self._get_db_chunk(volume_id)
+        # Records already updated in this batch (the batch is not readable)
+        pending = dict()
+        for chunk in chunks:
+            data = dict(chunk)
+            key = "%s|%s|%s" % (data.pop('container_id'),
+                                data.pop('content_id'),
+                                data.pop('chunk_id'))
+            key = key.encode('utf8')
+            value = pending.get(key)
+            if value is None:
+                value = db.get(key)
+            pending[key] = self._chunk_merge(value, data)
+
+        with db.write_batch(sync=self.db_sync) as batch:
+            for key in sorted(pending):
+                batch.put(key, pending[key])
+        return len(pending)
 
     def chunk_delete(self, volume_id, container_id, content_id, chunk_id):
         key = "%s|%s|%s" % (container_id, content_id, chunk_id)
@@ -108,9 +185,23 @@ class RdirBackend(object):
         self._get_db_chunk(volume_id).delete(key.encode('utf8'))
 
     def chunk_fetch(self, volume_id, start_after=None,
-                    limit=None, rebuild=False):
-        result = []
-
+                    limit=None, rebuild=False, container_id=None):
+        return list(self.chunk_fetch_iter(volume_id, start_after=start_after,
+                                          limit=limit, rebuild=rebuild,
+                                          container_id=container_id))
+
+    def chunk_fetch_iter(self, volume_id, start_after=None,
+                         limit=None, rebuild=False, container_id=None):
+        """
+        Get an iterator over (key, data) tuples, in the order of the keys,
+        i.e. grouped by container. With `rebuild`, only the chunks not
+        rebuilt yet and pushed before the incident date are yielded.
+        With `container_id`, only the chunks of this container are yielded.
+        The DB is opened at once, so that a missing volume raises NoSuchDB
+        before any item is yielded, and its handle is kept opened from the
+        first item until the iterator is exhausted or closed.
+        """
+        self._get_db(volume_id)
         if start_after is not None:
             start_after = start_after.encode('utf8')
 
@@ -119,26 +210,51 @@ class RdirBackend(object):
             # No incident date set so no chunks needs to be rebuild
             self.logger.info("Fetching chunks in order to rebuild" +
                              " but no incident date set")
-            return result
-
-        db_iter = self._get_db_chunk(volume_id).iterator(
-            start=start_after,
-            include_start=False)
+            return iter([])
+
+        prefix = ''
+        if container_id is not None:
+            prefix = "%s|" % container_id
+            if start_after is not None:
+                if start_after.startswith(prefix):
+                    start_after = start_after[len(prefix):]
+                elif start_after < prefix:
+                    start_after = None
+                else:
+                    return iter([])
+
+        return self._chunk_iter(volume_id, prefix, start_after, limit,
+                                incident_date if rebuild else None)
+
+    def _chunk_iter(self, volume_id, prefix, start_after, limit,
+                    incident_date):
+        # Pinned from the first item on: an iterator never started
+        # never reaches the `finally` clause.
+        self._pin_db(volume_id)
+        db_iter = None
         count = 0
-        for key, value in db_iter:
-            if limit is not None and count >= limit:
-                self.logger.debug("Chunk fetch limit reached (%d)", limit)
-                break
-            data = json.loads(value)
-            if rebuild:
-                if data.get('rtime'):
-                    continue  # already rebuilt
-                mtime = data.get('mtime')
-                if int(mtime) > incident_date:
-                    continue  # chunk pushed after the incident
-            result.append((key, data))
-            count += 1
-        return result
+        try:
+            db = self._get_db_chunk(volume_id)
+            if prefix:
+                db = db.prefixed_db(prefix.encode('utf8'))
+            db_iter = db.iterator(start=start_after, include_start=False)
+            for key, value in db_iter:
+                if limit is not None and count >= limit:
+                    self.logger.debug("Chunk fetch limit reached (%d)", limit)
+                    break
+                data = json.loads(value)
+                if incident_date is not None:
+                    if data.get('rtime'):
+                        continue  # already rebuilt
+                    mtime = data.get('mtime')
+                    if int(mtime) > incident_date:
+                        continue  # chunk pushed after the incident
+                yield (prefix + key, data)
+                count += 1
+        finally:
+            if db_iter is not None:
+                db_iter.close()
+            self._unpin_db(volume_id)
 
     def chunk_status(self, volume_id):
         total_chunks = 0
@@ -172,7 +288,8 @@ class RdirBackend(object):
         return result
 
     def admin_set_incident_date(self, volume_id, date):
-        self._get_db_admin(volume_id).put('incident_date', str(date))
+        self._get_db_admin(volume_id).put('incident_date', str(date),
+                                          sync=self.db_sync)
 
     def admin_get_incident_date(self, volume_id):
         ret = self._get_db_admin(volume_id).get('incident_date')
@@ -210,6 +327,13 @@ class RdirBackend(object):
         return result
 
     def status(self):
-        opened_db_count = len(self.dbs)
+        with self.dbs_lock:
+            opened_db_count = len(self.dbs)
         status = {'opened_db_count': opened_db_count}
         return status
+
+    def close(self):
+        with self.dbs_lock:
+            while self.dbs:
+                _, db = self.dbs.popitem()
+                db.close()
@@ -133,6 +133,21 @@ action_forward (struct req_args_s *args)
 		return HTTPRC_DONE;
 	}
 
+	if (!g_ascii_strcasecmp (action, "traces")) {
+		args->rp->no_access();
+		MESSAGE req = metautils_message_create_named("REQ_TRACES");
+		GByteArray *encoded = message_marshall_gba_and_clean (req);
+		gchar *packed = NULL;
+		err = gridd_client_exec_and_concat_string (id, COMMON_CLIENT_TIMEOUT, encoded, &packed);
+		if (err) {
+			g_free0 (packed);
+			return _reply_common_error (args, err);
+		}
+		GString *gstr = g_string_new (packed);
+		g_free (packed);
+		return _reply_success_json (args, gstr);
+	}
+
 	if (!g_ascii_strcasecmp (action, "handlers")) {
 		args->rp->no_access();
 		MESSAGE req = metautils_message_create_named("REQ_HANDLERS");
@@ -206,6 +221,13 @@ action_cache_set_ttl_low (struct req_args_s *args)
 	return _reply_success_json (args, NULL);
 }
 
+static gdouble
+_hit_rate (guint64 hits, guint64 misses)
+{
+	const guint64 total = hits + misses;
+	return total ? (gdouble)hits / (gdouble)total : 0.0;
+}
+
 enum http_rc_e
 action_cache_status (struct req_args_s *args)
 {
@@ -214,11 +236,19 @@ action_cache_status (struct req_args_s *args)
 
 	GString *gstr = g_string_new ("{");
 	g_string_append_printf (gstr, " \"csm0\":{"
-		"\"count\":%" G_GINT64_FORMAT ",\"max\":%u,\"ttl\":%lu},",
-		s.csm0.count, s.csm0.max, s.csm0.ttl);
+		"\"count\":%" G_GINT64_FORMAT ",\"max\":%u,\"ttl\":%lu,"
+		"\"hits\":%" G_GUINT64_FORMAT ",\"misses\":%" G_GUINT64_FORMAT ","
+		"\"hit_rate\":%.4f,\"rejected\":%" G_GUINT64_FORMAT "},",
+		s.csm0.count, s.csm0.max, s.csm0.ttl,
+		s.csm0.hits, s.csm0.misses,
+		_hit_rate (s.csm0.hits, s.csm0.misses), s.csm0.rejected);
 	g_string_append_printf (gstr, " \"meta1\":{"
-		"\"count\":%" G_GINT64_FORMAT ",\"max\":%u,\"ttl\":%lu}",
-		s.services.count, s.services.max, s.services.ttl);
+		"\"count\":%" G_GINT64_FORMAT ",\"max\":%u,\"ttl\":%lu,"
+		"\"hits\":%" G_GUINT64_FORMAT ",\"misses\":%" G_GUINT64_FORMAT ","
+		"\"hit_rate\":%.4f,\"rejected\":%" G_GUINT64_FORMAT "}",
+		s.services.count, s.services.max, s.services.ttl,
+		s.services.hits, s.services.misses,
+		_hit_rate (s.services.hits, s.services.misses), s.services.rejected);
 	g_string_append_c (gstr, '}');
 	return _reply_success_json (args, gstr);
 }
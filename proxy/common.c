@@ -16,6 +16,8 @@ You should have received a copy of the GNU Affero General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <sqliterepo/gridd_client_pool.h>
+
 #include "common.h"
 
 const char *
@@ -179,16 +181,22 @@ static void _sort_services (struct client_ctx_s *ctx,
 		gboolean _slave (gconstpointer p) {
 			return service_is_slave (k, p);
 		}
+		gsize preferred = pivot;
 		switch (ctx->which) {
 			case CLIENT_PREFER_SLAVE:
-				pivot = oio_ext_array_partition ((void**)m1uv, pivot, _slave);
+				preferred = oio_ext_array_partition ((void**)m1uv, pivot, _slave);
 				break;
 			case CLIENT_PREFER_MASTER:
-				pivot = oio_ext_array_partition ((void**)m1uv, pivot, _master);
+				preferred = oio_ext_array_partition ((void**)m1uv, pivot, _master);
 				break;
 			default:
 				break;
 		}
+		/* With no master known yet, the reads are spread over all the
+		 * available replicas instead of piling up on the first one. A
+		 * SLAVE too late will redirect to its MASTER. */
+		if (preferred)
+			pivot = preferred;
 		if (pivot)
 			oio_ext_array_shuffle ((void**)m1uv, pivot);
 	}
@@ -214,118 +222,407 @@ static gboolean _on_reply (gpointer p, MESSAGE reply) {
 	return TRUE;
 }
 
-GError *gridd_request_replicated (struct client_ctx_s *ctx,
-		request_packer_f pack) {
-	GError *err = NULL;
-	EXTRA_ASSERT (ctx != NULL);
-
-	gchar *election_key = g_strconcat (ctx->name.base, "/", ctx->name.type, NULL);
-	STRING_STACKIFY(election_key);
+/* The state of a sequence of requests to the services of a reference */
+struct _replicated_s
+{
+	struct client_ctx_s *ctx;
+	gchar *election_key;
+	gchar **m1uv;
+	gchar **pu; /* the service currently contacted */
+	GByteArray *packed;
+
+	GPtrArray *urlv; /* <gchar*> */
+	GPtrArray *errorv; /* <GError*> */
+	GPtrArray *bodyv; /* <GByteArray*> */
+
+	GByteArray *body; /* reply of the current service */
+	GError *err;
+};
+
+/* Locates and sorts the services, then packs the request. Returns FALSE
+ * if there is nothing to contact, and the error is then in r->err */
+static gboolean
+_replicated_init (struct _replicated_s *r, struct client_ctx_s *ctx,
+		request_packer_f pack)
+{
+	memset (r, 0, sizeof(*r));
+	r->ctx = ctx;
+	r->election_key = g_strconcat (ctx->name.base, "/", ctx->name.type, NULL);
 
 	/* Locate the services */
-	gchar **m1uv = NULL;
-	if (*ctx->type == '#')
-		err = hc_resolve_reference_directory (resolver, ctx->url, &m1uv);
-	else
-		err = hc_resolve_reference_service (resolver, ctx->url, ctx->type, &m1uv);
+	OIO_TRACE("proxy.resolve", do {
+		if (*ctx->type == '#')
+			r->err = hc_resolve_reference_directory (resolver, ctx->url, &r->m1uv);
+		else
+			r->err = hc_resolve_reference_service (resolver, ctx->url, ctx->type, &r->m1uv);
+	} while (0));
+
+	if (r->err) {
+		EXTRA_ASSERT(r->m1uv == NULL);
+		g_prefix_error (&r->err, "Directory error: ");
+		return FALSE;
+	}
+	EXTRA_ASSERT(r->m1uv != NULL);
+	if (!*r->m1uv) {
+		r->err = NEWERROR (CODE_CONTAINER_NOTFOUND, "No service located");
+		return FALSE;
+	}
+	meta1_urlv_shift_addr (r->m1uv);
+	_sort_services (ctx, r->election_key, r->m1uv);
+
+	r->pu = r->m1uv;
+	r->urlv = g_ptr_array_new ();
+	r->errorv = g_ptr_array_new ();
+	r->bodyv = g_ptr_array_new ();
+
+	/* The services called will attach their traces to the calls */
+	const char *prev = oio_ext_trace_enter ("proxy.call");
+	r->packed = pack(sqlx_name_mutable_to_const(&ctx->name));
+	oio_ext_trace_enter (prev);
+	return TRUE;
+}
+
+/* Prepares the request to the current service, not started yet */
+static struct gridd_client_s *
+_replicated_client (struct _replicated_s *r)
+{
+	struct client_ctx_s *ctx = r->ctx;
+	struct gridd_client_s *client = NULL;
+
+	/* TODO ensure the service match the expected TYPE and SEQ */
+
+	r->body = NULL;
+	if (!ctx->decoder) {
+		client = gridd_client_create (*r->pu, r->packed, &r->body, _on_reply);
+	} else {
+		client = gridd_client_create (*r->pu, r->packed, ctx->decoder_data, ctx->decoder);
+	}
+
+	g_ptr_array_add (r->urlv, g_strdup(*r->pu));
+
+	if (ctx->which == CLIENT_RUN_ALL)
+		gridd_client_no_redirect (client);
+	return client;
+}
+
+/* Takes into account the outcome of the request to the current service.
+ * 'err' is stolen. Returns TRUE if the next service must be contacted. */
+static gboolean
+_replicated_account (struct _replicated_s *r, struct gridd_client_s *client,
+		GError *err)
+{
+	g_ptr_array_add (r->bodyv, r->body);
+	r->body = NULL;
 
 	if (err) {
-		EXTRA_ASSERT(m1uv == NULL);
-		g_prefix_error (&err, "Directory error: ");
-		return err;
+		g_ptr_array_add (r->errorv, g_error_copy(err));
 	} else {
-		EXTRA_ASSERT(m1uv != NULL);
-		if (!*m1uv) {
-			g_strfreev (m1uv);
-			return NEWERROR (CODE_CONTAINER_NOTFOUND, "No service located");
-		}
-		meta1_urlv_shift_addr (m1uv);
-		_sort_services (ctx, election_key, m1uv);
+		g_ptr_array_add (r->errorv, NEWERROR(CODE_FINAL_OK, "OK"));
 	}
 
-	/* Perform the sequence of requests. */
-	GPtrArray
-		*urlv = g_ptr_array_new (), /* <gchar*> */
-		*errorv = g_ptr_array_new (), /* <GError*> */
-		*bodyv = g_ptr_array_new (); /* <GByteArray*> */
+	/* Check for a possible redirection */
+	const char *actual = gridd_client_url (client);
+	if (actual && 0 != strcmp(actual, *r->pu)) {
+		gchar *k = g_strdup (r->election_key);
+		gchar *v = g_strdup (actual);
+		GRID_DEBUG("MASTER %s %s", v, k);
+		MASTER_WRITE(lru_tree_insert (srv_master, k, v));
+	}
 
-	GByteArray *packed = pack(sqlx_name_mutable_to_const(&ctx->name));
+	if (err && CODE_IS_NETWORK_ERROR(err->code)) {
+		service_invalidate(*r->pu);
+		g_clear_error (&err);
+	}
 
 	gboolean stop = FALSE;
-	for (gchar **pu=m1uv; *pu && !stop ;++pu) {
+	if (err) {
+		if (r->ctx->which == CLIENT_RUN_ALL)
+			g_clear_error (&err);
+		else
+			stop = TRUE;
+	} else {
+		if (r->ctx->which != CLIENT_RUN_ALL)
+			stop = TRUE;
+	}
 
-		/* TODO ensure the service match the expected TYPE and SEQ */
+	if (r->err)
+		g_clear_error (&r->err);
+	r->err = err;
+	++ r->pu;
+	return !stop && *r->pu;
+}
 
-		/* Send a unitary request now */
-		GByteArray *body = NULL;
+/* Fills the output of the client context and releases the state. Returns
+ * the error of the last service contacted, if any. */
+static GError *
+_replicated_finish (struct _replicated_s *r)
+{
+	struct client_ctx_s *ctx = r->ctx;
+
+	if (r->urlv) {
+		ctx->count = r->urlv->len;
+		g_ptr_array_add (r->urlv, NULL);
+		g_ptr_array_add (r->bodyv, NULL);
+		g_ptr_array_add (r->errorv, NULL);
+		ctx->urlv = (gchar**) g_ptr_array_free (r->urlv, FALSE);
+		ctx->bodyv = (GByteArray**) g_ptr_array_free (r->bodyv, FALSE);
+		ctx->errorv = (GError**) g_ptr_array_free (r->errorv, FALSE);
+	}
+	if (r->body)
+		g_byte_array_unref (r->body);
+	if (r->packed)
+		g_byte_array_unref (r->packed);
+	if (r->m1uv)
+		g_strfreev (r->m1uv);
+	g_free (r->election_key);
+
+	GError *err = r->err;
+	memset (r, 0, sizeof(*r));
+	return err;
+}
 
-		struct gridd_client_s *client = NULL;
+GError *gridd_request_replicated (struct client_ctx_s *ctx,
+		request_packer_f pack) {
+	EXTRA_ASSERT (ctx != NULL);
 
-		if (!ctx->decoder) {
-			client = gridd_client_create (*pu, packed, &body, _on_reply);
-		} else {
-			client = gridd_client_create (*pu, packed, ctx->decoder_data, ctx->decoder);
+	struct _replicated_s r;
+	if (_replicated_init (&r, ctx, pack)) {
+		/* Perform the sequence of requests. */
+		gboolean more = TRUE;
+		while (more) {
+			struct gridd_client_s *client = _replicated_client (&r);
+			gridd_client_start (client);
+			gridd_client_set_timeout (client, ctx->timeout);
+			GError *err = NULL;
+			OIO_TRACE("proxy.call", err = gridd_client_loop (client));
+			if (!err)
+				err = gridd_client_error (client);
+			more = _replicated_account (&r, client, err);
+			gridd_client_free (client);
 		}
+	}
+	return _replicated_finish (&r);
+}
 
-		g_ptr_array_add (urlv, g_strdup(*pu));
+/* -------------------------------------------------------------------------- */
 
-		if (ctx->which == CLIENT_RUN_ALL)
-			gridd_client_no_redirect (client);
-		gridd_client_start (client);
-		gridd_client_set_timeout (client, ctx->timeout);
-		if (!(err = gridd_client_loop (client)))
-			err = gridd_client_error (client);
+/* The requests of the handlers that do not wait for the services are
+ * managed by a single thread polling all the connections. */
+static struct gridd_client_pool_s *reactor = NULL;
+static GThread *reactor_thread = NULL;
+static GRWLock reactor_lock = {0};
+static volatile gboolean reactor_running = FALSE;
 
-		g_ptr_array_add (bodyv, body);
+struct _async_s
+{
+	struct _replicated_s r;
+	struct client_ctx_s ctx;
+	gchar *type;
+
+	/* The request's resources, that the handler gave up */
+	struct req_args_s args;
+	struct oio_requri_s ruri;
+	gchar *reqid;
+	gboolean admin;
+	gint64 tv_start;
+	gint64 tv_deferred;
+
+	client_continuation_f next;
+	GError *err;
+};
+
+struct _async_event_s
+{
+	struct event_client_s ec; /* first, freed by the pool */
+	struct _async_s *async;
+};
 
-		if (err) {
-			g_ptr_array_add (errorv, g_error_copy(err));
-		} else {
-			g_ptr_array_add (errorv, NEWERROR(CODE_FINAL_OK, "OK"));
-		}
+static void _async_defer (struct _async_s *st);
 
-		/* Check for a possible redirection */
-		const char *actual = gridd_client_url (client);
-		if (actual && 0 != strcmp(actual, *pu)) {
-			gchar *k = g_strdup(election_key);
-			gchar *v = g_strdup (actual);
-			GRID_DEBUG("MASTER %s %s", v, k);
-			MASTER_WRITE(lru_tree_insert (srv_master, k, v));
+static void
+_async_on_end (struct event_client_s *ec)
+{
+	struct _async_s *st = ((struct _async_event_s*)ec)->async;
+
+	GError *err = gridd_client_error (ec->client);
+	if (!err && !gridd_client_finished (ec->client))
+		err = NEWERROR (ERRCODE_CONN_RESET, "Connection error");
+	if (!err && !reactor_running)
+		err = BUSY("Proxy exiting");
+
+	if (_replicated_account (&st->r, ec->client, err)) {
+		if (reactor_running) {
+			_async_defer (st);
+			return;
 		}
+		if (!st->r.err)
+			st->r.err = BUSY("Proxy exiting");
+	}
 
-		if (err && CODE_IS_NETWORK_ERROR(err->code)) {
-			service_invalidate(*pu);
-			g_clear_error (&err);
-		}
+	st->err = _replicated_finish (&st->r);
+	http_request_resume (st->args.rq);
+}
+
+static void
+_async_defer (struct _async_s *st)
+{
+	struct _async_event_s *ev = g_malloc0 (sizeof(*ev));
+	ev->ec.client = _replicated_client (&st->r);
+	ev->ec.on_end = _async_on_end;
+	ev->async = st;
+	gridd_client_set_timeout (ev->ec.client, st->ctx.timeout);
+	gridd_client_pool_defer (reactor, &ev->ec);
+}
+
+static void
+_async_free (struct _async_s *st)
+{
+	client_clean (&st->ctx);
+	if (st->err)
+		g_clear_error (&st->err);
+	g_free (st->type);
+	g_free (st->reqid);
+	g_free (st);
+}
+
+/* Called in a worker thread, once all the services have been contacted */
+static enum http_rc_e
+_async_resume (gpointer udata, struct http_request_s *rq UNUSED,
+		struct http_reply_ctx_s *rp)
+{
+	struct _async_s *st = udata;
+
+	oio_ext_set_reqid (st->reqid);
+	oio_ext_set_admin (st->admin);
+	oio_ext_trace_start ("proxy.async", st->tv_start);
+	oio_ext_trace_span ("proxy.call", st->tv_deferred);
+	st->args.rp = rp;
+
+	GError *err = st->err;
+	st->err = NULL;
+	enum http_rc_e rc = st->next (&st->args, &st->ctx, err);
+
+	/* Unless the continuation has been suspended in turn, the request
+	 * ends here, instead of in the main handler. */
+	if (rc != HTTPRC_PENDING) {
+		struct path_matching_s **matchings = st->args.matchings;
+		const gint64 spent = oio_ext_monotonic_time () - st->tv_start;
+		network_server_stat_push4 (st->args.rq->client->server, TRUE,
+				(*matchings)->last->gq_count, 1, gq_count_all, 1,
+				(*matchings)->last->gq_time, spent, gq_time_all, spent);
+		grid_histogram_add ((*matchings)->last->histo, spent);
+		path_matching_cleanv (matchings);
+		oio_requri_clear (&st->ruri);
+		oio_url_pclean (&st->args.url);
+	}
+
+	oio_ext_trace_stop (OIO_TRACE_SLOW);
+	_async_free (st);
+	return rc;
+}
+
+enum http_rc_e
+gridd_request_replicated_then (struct req_args_s *args,
+		struct client_ctx_s *ctx, request_packer_f pack,
+		client_continuation_f next)
+{
+	EXTRA_ASSERT (args != NULL);
+	EXTRA_ASSERT (ctx != NULL);
+	EXTRA_ASSERT (next != NULL);
 
+	g_rw_lock_reader_lock (&reactor_lock);
+
+	if (!reactor_running) {
+		g_rw_lock_reader_unlock (&reactor_lock);
+		GError *err = gridd_request_replicated (ctx, pack);
+		enum http_rc_e rc = next (args, ctx, err);
+		client_clean (ctx);
+		return rc;
+	}
+
+	struct _async_s *st = g_malloc0 (sizeof(*st));
+	st->ctx = *ctx;
+	memset (ctx, 0, sizeof(*ctx));
+	st->type = g_strdup (st->ctx.type);
+	st->ctx.type = st->type;
+
+	if (!_replicated_init (&st->r, &st->ctx, pack)) {
+		g_rw_lock_reader_unlock (&reactor_lock);
+		GError *err = _replicated_finish (&st->r);
+		enum http_rc_e rc = next (args, &st->ctx, err);
+		_async_free (st);
+		return rc;
+	}
+
+	st->args = *args;
+	st->ruri = *args->req_uri;
+	st->args.req_uri = &st->ruri;
+	st->args.rp = NULL;
+	st->reqid = g_strdup (oio_ext_get_reqid ());
+	st->admin = oio_ext_is_admin ();
+	st->tv_start = args->rq->client->time.evt_in;
+	st->tv_deferred = oio_ext_monotonic_time ();
+	st->next = next;
+
+	http_request_suspend (args->rq, _async_resume, st);
+	_async_defer (st);
+
+	g_rw_lock_reader_unlock (&reactor_lock);
+	return HTTPRC_PENDING;
+}
+
+static gpointer
+_reactor_run (gpointer p)
+{
+	while (reactor_running) {
+		GError *err = gridd_client_pool_round (reactor, 1);
 		if (err) {
-			if (ctx->which == CLIENT_RUN_ALL) {
-				g_clear_error (&err);
-				err = NULL;
-			} else {
-				stop = TRUE;
-			}
-		} else {
-			if (ctx->which != CLIENT_RUN_ALL)
-				stop = TRUE;
+			GRID_WARN("Reactor error: (%d) %s", err->code, err->message);
+			g_clear_error (&err);
 		}
+	}
+	return p;
+}
 
-		gridd_client_free (client);
-		client = NULL;
+GError *
+proxy_reactor_start (void)
+{
+	EXTRA_ASSERT (reactor == NULL);
+
+	if (!(reactor = gridd_client_pool_create ()))
+		return SYSERR("Client pool creation failure");
+
+	reactor_running = TRUE;
+	GError *err = NULL;
+	reactor_thread = g_thread_try_new ("reactor", _reactor_run, NULL, &err);
+	if (!reactor_thread) {
+		reactor_running = FALSE;
+		gridd_client_pool_destroy (reactor);
+		reactor = NULL;
+		g_prefix_error (&err, "Reactor thread startup failure: ");
+		return err;
 	}
+	return NULL;
+}
+
+void
+proxy_reactor_stop (void)
+{
+	if (!reactor)
+		return;
 
-	g_byte_array_unref (packed);
-	g_strfreev (m1uv);
+	g_rw_lock_writer_lock (&reactor_lock);
+	reactor_running = FALSE;
+	g_rw_lock_writer_unlock (&reactor_lock);
 
-	ctx->count = urlv->len;
-	g_ptr_array_add (urlv, NULL);
-	g_ptr_array_add (bodyv, NULL);
-	g_ptr_array_add (errorv, NULL);
-	ctx->urlv = (gchar**) g_ptr_array_free (urlv, FALSE);
-	ctx->bodyv = (GByteArray**) g_ptr_array_free (bodyv, FALSE);
-	ctx->errorv = (GError**) g_ptr_array_free (errorv, FALSE);
+	if (reactor_thread) {
+		g_thread_join (reactor_thread);
+		reactor_thread = NULL;
+	}
 
-	return err;
+	/* The requests still running fail, and their continuation is called */
+	gridd_client_pool_destroy (reactor);
+	reactor = NULL;
 }
 
 /* -------------------------------------------------------------------------- */
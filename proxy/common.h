@@ -262,6 +262,29 @@ GError * _m1_locate_and_action (struct oio_url_s *url, GError * (*hook) ());
 
 GError * gridd_request_replicated (struct client_ctx_s *, request_packer_f);
 
+/* Continuation of a handler, called with the output of the services in
+ * 'ctx' and the error to be managed (then owned by the continuation). */
+typedef enum http_rc_e (*client_continuation_f) (struct req_args_s *args,
+		struct client_ctx_s *ctx, GError *err);
+
+/* Like gridd_request_replicated(), then calls 'next'. When the reactor runs,
+ * the worker thread is not held while the services are contacted: the request
+ * is suspended and HTTPRC_PENDING is returned, then 'next' is called later in
+ * a worker thread, and the request's resources (URI, matchings, URL) now
+ * belong to the continuation. The handler must return the value of this
+ * call. 'ctx' and its type are copied, but its 'decoder_data' must not
+ * point to the stack of the handler. 'ctx' is cleaned in any case. */
+enum http_rc_e gridd_request_replicated_then (struct req_args_s *args,
+		struct client_ctx_s *ctx, request_packer_f pack,
+		client_continuation_f next);
+
+/* Starts the thread that manages the requests to the services on behalf of
+ * gridd_request_replicated_then(). Until then, they are synchronous. */
+GError * proxy_reactor_start (void);
+
+/* The requests still running fail, their continuation is called. */
+void proxy_reactor_stop (void);
+
 GError * KV_read_properties (struct json_object *j, gchar ***out,
 		const char *section, gboolean fail_if_empty);
 
@@ -294,6 +317,28 @@ enum http_rc_e _reply_created (struct req_args_s *args);
 enum http_rc_e _reply_success_bytes (struct req_args_s *args, GBytes * bytes);
 enum http_rc_e _reply_success_json (struct req_args_s *args, GString * gstr);
 
+/* A successful JSON reply, appended to 'buf' piece by piece. As soon as
+ * PROXYD_STREAM_CHUNK_SIZE bytes are pending, the reply starts and they are
+ * sent as a chunk. A reply that never reaches that size is sent at once with
+ * _reply_success_json(). No error can be replied once it has started.
+ * The sending waits for a slow client, and once the client failed to receive
+ * a piece, the next ones are dropped and the reply is aborted. */
+struct reply_stream_s
+{
+	struct req_args_s *args;
+	GString *buf;
+	gboolean started;
+	gboolean failed;
+};
+
+void _reply_stream_init (struct reply_stream_s *rs, struct req_args_s *args);
+
+/* To be called between two elements, it sends 'buf' if it is big enough */
+void _reply_stream_flush (struct reply_stream_s *rs);
+
+/* Sends what remains, then releases the stream */
+enum http_rc_e _reply_stream_end (struct reply_stream_s *rs);
+
 void _append_status (GString *out, gint code, const char * msg);
 GString * _create_status (gint code, const char * msg);
 GString * _create_status_error (GError * e);
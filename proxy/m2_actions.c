@@ -38,6 +38,22 @@ _get_meta2_realtype (struct req_args_s *args, gchar *d, gsize dlen)
 	}
 }
 
+static GSList *
+_unpack_beans (struct client_ctx_s *ctx)
+{
+	GSList *out = NULL;
+	EXTRA_ASSERT(ctx->bodyv != NULL);
+	for (guint i=0; i<ctx->count ;++i) {
+		GByteArray *b = ctx->bodyv[i];
+		if (b) {
+			GSList *l = bean_sequence_unmarshall (b->data, b->len);
+			if (l)
+				out = metautils_gslist_precat (out, l);
+		}
+	}
+	return out;
+}
+
 static GError *
 _resolve_meta2 (struct req_args_s *args, enum preference_e how,
 		request_packer_f pack, GSList **out)
@@ -54,16 +70,7 @@ _resolve_meta2 (struct req_args_s *args, enum preference_e how,
 	if (err) {
 		GRID_DEBUG("M2V2 call failed: %d %s", err->code, err->message);
 	} else if (out) {
-		EXTRA_ASSERT(ctx.bodyv != NULL);
-		for (guint i=0; i<ctx.count ;++i) {
-			GByteArray *b = ctx.bodyv[i];
-			if (b) {
-				GSList *l = bean_sequence_unmarshall (b->data, b->len);
-				if (l) {
-					*out = metautils_gslist_precat (*out, l);
-				}
-			}
-		}
+		*out = _unpack_beans (&ctx);
 	}
 
 	client_clean (&ctx);
@@ -90,11 +97,17 @@ _resolve_meta2_for_list (struct req_args_s *args, request_packer_f pack,
 }
 
 static void
-_json_dump_all_beans (GString * gstr, GSList * beans)
+_stream_flush (GString *gstr UNUSED, gpointer rs)
 {
-	g_string_append_c (gstr, '{');
-	meta2_json_dump_all_beans (gstr, beans);
-	g_string_append_c (gstr, '}');
+	_reply_stream_flush (rs);
+}
+
+static void
+_json_dump_all_beans (struct reply_stream_s *rs, GSList * beans)
+{
+	g_string_append_c (rs->buf, '{');
+	meta2_json_dump_all_beans_flushed (rs->buf, beans, _stream_flush, rs);
+	g_string_append_c (rs->buf, '}');
 }
 
 static enum http_rc_e
@@ -177,8 +190,10 @@ _sort_aliases_by_name (struct bean_ALIASES_s *a0, struct bean_ALIASES_s *a1)
 }
 
 static void
-_dump_json_aliases_and_headers (GString *gstr, GSList *aliases, GTree *headers)
+_dump_json_aliases_and_headers (struct reply_stream_s *rs, GSList *aliases,
+		GTree *headers)
 {
+	GString *gstr = rs->buf;
 	g_string_append (gstr, "\"objects\":[");
 	gboolean first = TRUE;
 	for (; aliases ; aliases=aliases->next) {
@@ -227,12 +242,13 @@ _dump_json_aliases_and_headers (GString *gstr, GSList *aliases, GTree *headers)
 					CONTENTS_HEADERS_get_mime_type(h)->str);
 		}
 		g_string_append_c(gstr, '}');
+		_reply_stream_flush (rs);
 	}
 	g_string_append_c (gstr, ']');
 }
 
 static void
-_dump_json_beans (GString *gstr, GSList *beans)
+_dump_json_beans (struct reply_stream_s *rs, GSList *beans)
 {
 	GSList *aliases = NULL;
 	GTree *headers = g_tree_new ((GCompareFunc)metautils_gba_cmp);
@@ -246,15 +262,16 @@ _dump_json_beans (GString *gstr, GSList *beans)
 	}
 
 	aliases = g_slist_sort (aliases, (GCompareFunc)_sort_aliases_by_name);
-	_dump_json_aliases_and_headers (gstr, aliases, headers);
+	_dump_json_aliases_and_headers (rs, aliases, headers);
 
 	g_slist_free (aliases);
 	g_tree_destroy (headers);
 }
 
 static void
-_dump_json_prefixes (GString *gstr, GTree *tree_prefixes)
+_dump_json_prefixes (struct reply_stream_s *rs, GTree *tree_prefixes)
 {
+	GString *gstr = rs->buf;
 	gchar **prefixes = gtree_string_keys (tree_prefixes);
 	g_string_append (gstr, "\"prefixes\":[");
 	if (prefixes) {
@@ -262,6 +279,7 @@ _dump_json_prefixes (GString *gstr, GTree *tree_prefixes)
 		for (gchar **pp=prefixes; *pp ;++pp) {
 			COMA(gstr,first);
 			oio_str_gstring_append_json_quote (gstr, *pp);
+			_reply_stream_flush (rs);
 		}
 		g_free (prefixes);
 	}
@@ -296,15 +314,17 @@ _reply_list_result (struct req_args_s *args, GError * err,
 	 * in the headers. */
 	_container_new_props_to_headers (args, out->props);
 
-	GString *gstr = g_string_new ("{");
-	_dump_json_prefixes (gstr, tree_prefixes);
-	g_string_append_c (gstr, ',');
-	_dump_json_properties (gstr, out->props);
-	g_string_append_c (gstr, ',');
-	_dump_json_beans (gstr, out->beans);
-	g_string_append_c (gstr, '}');
+	struct reply_stream_s rs;
+	_reply_stream_init (&rs, args);
+	g_string_append_c (rs.buf, '{');
+	_dump_json_prefixes (&rs, tree_prefixes);
+	g_string_append_c (rs.buf, ',');
+	_dump_json_properties (rs.buf, out->props);
+	g_string_append_c (rs.buf, ',');
+	_dump_json_beans (&rs, out->beans);
+	g_string_append_c (rs.buf, '}');
 
-	return _reply_success_json (args, gstr);
+	return _reply_stream_end (&rs);
 }
 
 static enum http_rc_e
@@ -313,10 +333,11 @@ _reply_beans (struct req_args_s *args, GError * err, GSList * beans)
 	if (err)
 		return _reply_m2_error (args, err);
 
-	GString *gstr = g_string_new ("");
-	_json_dump_all_beans (gstr, beans);
+	struct reply_stream_s rs;
+	_reply_stream_init (&rs, args);
+	_json_dump_all_beans (&rs, beans);
 	_bean_cleanl2 (beans);
-	return _reply_success_json (args, gstr);
+	return _reply_stream_end (&rs);
 }
 
 static void
@@ -1723,13 +1744,26 @@ enum http_rc_e action_content_prepare (struct req_args_s *args) {
 	return rest_action (args, action_m2_content_beans);
 }
 
-enum http_rc_e action_content_show (struct req_args_s *args) {
+static enum http_rc_e _reply_content_show (struct req_args_s *args,
+		struct client_ctx_s *ctx, GError *err) {
 	GSList *beans = NULL;
-	PACKER_VOID(_pack) { return m2v2_remote_pack_GET (args->url, 0); }
-	GError *err = _resolve_meta2 (args, get_slave_preference(), _pack, &beans);
+	if (err)
+		GRID_DEBUG("M2V2 call failed: %d %s", err->code, err->message);
+	else
+		beans = _unpack_beans (ctx);
 	return _reply_simplified_beans (args, err, beans, TRUE);
 }
 
+enum http_rc_e action_content_show (struct req_args_s *args) {
+	PACKER_VOID(_pack) { return m2v2_remote_pack_GET (args->url, 0); }
+	gchar realtype[64];
+	_get_meta2_realtype (args, realtype, sizeof(realtype));
+	CLIENT_CTX(ctx, args, realtype, 1);
+	ctx.which = get_slave_preference();
+	return gridd_request_replicated_then (args, &ctx, _pack,
+			_reply_content_show);
+}
+
 enum http_rc_e action_content_delete (struct req_args_s *args) {
 	PACKER_VOID(_pack) { return m2v2_remote_pack_DEL (args->url); }
 	GError *err = _resolve_meta2 (args, CLIENT_PREFER_MASTER, _pack, NULL);
@@ -56,6 +56,8 @@ gchar *ns_name = NULL;
 gboolean flag_cache_enabled = TRUE;
 gboolean flag_local_scores = FALSE;
 gboolean flag_prefer_master = FALSE;
+static gboolean flag_async_upstream = FALSE;
+static gboolean flag_dir_admission = TRUE;
 
 struct oio_lb_world_s *lb_world = NULL;
 struct oio_lb_s *lb = NULL;
@@ -89,6 +91,15 @@ GBytes **wanted_prepared = NULL;
 
 // Misc. handlers --------------------------------------------------------------
 
+static enum http_rc_e
+action_traces(struct req_args_s *args)
+{
+	args->rp->no_access();
+	GString *gstr = g_string_sized_new (1024);
+	oio_ext_trace_dump (gstr);
+	return _reply_success_json (args, gstr);
+}
+
 static enum http_rc_e
 action_status(struct req_args_s *args)
 {
@@ -115,16 +126,36 @@ action_status(struct req_args_s *args)
 	g_string_append_printf(gstr, "gauge cache.dir.count = %"G_GINT64_FORMAT"\n", s.csm0.count);
 	g_string_append_printf(gstr, "gauge cache.dir.max = %u\n", s.csm0.max);
 	g_string_append_printf(gstr, "gauge cache.dir.ttl = %lu\n", s.csm0.ttl);
+	g_string_append_printf(gstr, "counter cache.dir.hits = %"G_GUINT64_FORMAT"\n", s.csm0.hits);
+	g_string_append_printf(gstr, "counter cache.dir.misses = %"G_GUINT64_FORMAT"\n", s.csm0.misses);
+	g_string_append_printf(gstr, "counter cache.dir.rejected = %"G_GUINT64_FORMAT"\n", s.csm0.rejected);
 
 	g_string_append_printf(gstr, "gauge cache.srv.count = %"G_GINT64_FORMAT"\n", s.services.count);
 	g_string_append_printf(gstr, "gauge cache.srv.max = %u\n", s.services.max);
 	g_string_append_printf(gstr, "gauge cache.srv.ttl = %lu\n", s.services.ttl);
+	g_string_append_printf(gstr, "counter cache.srv.hits = %"G_GUINT64_FORMAT"\n", s.services.hits);
+	g_string_append_printf(gstr, "counter cache.srv.misses = %"G_GUINT64_FORMAT"\n", s.services.misses);
+	g_string_append_printf(gstr, "counter cache.srv.rejected = %"G_GUINT64_FORMAT"\n", s.services.rejected);
 
 	gint64 cd, ck;
 	SRV_READ(cd = lru_tree_count(srv_down); ck = lru_tree_count(srv_known));
 	g_string_append_printf(gstr, "gauge down.srv = %"G_GINT64_FORMAT"\n", cd);
 	g_string_append_printf(gstr, "gauge known.srv = %"G_GINT64_FORMAT"\n", ck);
 
+	/* the latency quantiles of each route, in microseconds */
+	void _append_quantiles (const struct trie_node_s *n) {
+		if (!n->histo || !n->histo->count)
+			return;
+		const char *name = g_quark_to_string (n->gq_time);
+		g_string_append_printf(gstr, "%s.p50 = %"G_GUINT64_FORMAT"\n",
+				name, grid_histogram_quantile(n->histo, 0.5));
+		g_string_append_printf(gstr, "%s.p99 = %"G_GUINT64_FORMAT"\n",
+				name, grid_histogram_quantile(n->histo, 0.99));
+		g_string_append_printf(gstr, "%s.p999 = %"G_GUINT64_FORMAT"\n",
+				name, grid_histogram_quantile(n->histo, 0.999));
+	}
+	path_parser_foreach (path_parser, _append_quantiles);
+
 	args->rp->set_body_gstr(gstr);
 	args->rp->set_status(HTTP_CODE_OK, "OK");
 	args->rp->set_content_type("text/x-java-properties");
@@ -132,6 +163,7 @@ action_status(struct req_args_s *args)
 	return HTTPRC_DONE;
 }
 
+/* Returns NULL if the path is malformed */
 static struct path_matching_s **
 _metacd_match (const gchar *method, const gchar *path)
 {
@@ -164,14 +196,27 @@ _metacd_match (const gchar *method, const gchar *path)
 	*pk = '\0';
 
 	GRID_TRACE2("matching [%s]", key);
-	gchar **tokens = g_strsplit (key, "/", -1);
-	for (gchar **p=tokens; *p ;++p) {
-		gchar *unescaped = g_uri_unescape_string(*p,NULL);
-		oio_str_reuse(p, unescaped);
+
+	/* Split and unescape in place, on the stack */
+	guint count = 1;
+	for (const gchar *p = key; *p ;++p)
+		count += (*p == '/');
+	gchar **tokens = g_alloca ((count + 1) * sizeof(gchar*));
+	gchar **pt = tokens;
+	*(pt++) = key;
+	for (gchar *p = key; *p ;++p) {
+		if (*p == '/') {
+			*p = '\0';
+			*(pt++) = p + 1;
+		}
+	}
+	*pt = NULL;
+	for (pt = tokens; *pt ;++pt) {
+		if (!path_unescape_inplace (*pt))
+			return NULL;
 	}
-	struct path_matching_s **result = path_parser_match (path_parser, tokens);
-	g_strfreev (tokens);
-	return result;
+
+	return path_parser_match (path_parser, tokens);
 }
 
 static struct oio_url_s *
@@ -220,6 +265,9 @@ handler_action (struct http_request_s *rq, struct http_reply_ctx_s *rp)
 	const gchar *admin = g_tree_lookup (rq->tree_headers, PROXYD_HEADER_ADMIN);
 	oio_ext_set_admin(oio_str_parse_bool(admin, FALSE));
 
+	oio_ext_trace_start (NULL, rq->client->time.evt_in);
+	oio_ext_trace_span ("http.parse", rq->client->time.evt_in);
+
 	// Then parse the request to find a handler
 	struct oio_url_s *url = NULL;
 	struct oio_requri_s ruri = {NULL, NULL, NULL, NULL};
@@ -229,13 +277,19 @@ handler_action (struct http_request_s *rq, struct http_reply_ctx_s *rp)
 
 	GRID_TRACE2("URI path[%s] query[%s] fragment[%s] matches[%u]",
 			ruri.path, ruri.query, ruri.fragment,
-			g_strv_length((gchar**)matchings));
+			matchings ? g_strv_length((gchar**)matchings) : 0);
 
 	GQuark gq_count = gq_count_unexpected;
 	GQuark gq_time = gq_time_unexpected;
 
 	enum http_rc_e rc;
-	if (!*matchings) {
+	if (!matchings) {
+		rp->set_content_type ("application/json");
+		rp->set_body_gstr (g_string_new("{\"status\":400,\"message\":\"Invalid path\"}"));
+		rp->set_status (HTTP_CODE_BAD_REQUEST, "Invalid path");
+		rp->finalize ();
+		rc = HTTPRC_DONE;
+	} else if (!*matchings) {
 		rp->set_content_type ("application/json");
 		rp->set_body_gstr (g_string_new("{\"status\":404,\"message\":\"No handler found\"}"));
 		rp->set_status (HTTP_CODE_NOT_FOUND, "No handler found");
@@ -254,7 +308,15 @@ handler_action (struct http_request_s *rq, struct http_reply_ctx_s *rp)
 		gq_time = (*matchings)->last->gq_time;
 		GRID_TRACE("%s %s URL %s", __FUNCTION__, ruri.path, oio_url_get(args.url, OIOURL_WHOLE));
 		req_handler_f handler = (*matchings)->last->u;
-		rc = (*handler) (&args);
+		OIO_TRACE("proxy.handler", rc = (*handler) (&args));
+	}
+
+	if (rc == HTTPRC_PENDING) {
+		/* The continuation now owns the URI, the matchings and the URL,
+		 * and it will account the request. */
+		oio_ext_trace_stop (OIO_TRACE_SLOW);
+		oio_ext_set_reqid (NULL);
+		return rc;
 	}
 
 	gint64 spent = oio_ext_monotonic_time () - rq->client->time.evt_in;
@@ -262,10 +324,13 @@ handler_action (struct http_request_s *rq, struct http_reply_ctx_s *rp)
 	network_server_stat_push4 (rq->client->server, TRUE,
 			gq_count, 1, gq_count_all, 1,
 			gq_time, spent, gq_time_all, spent);
+	if (matchings && *matchings)
+		grid_histogram_add ((*matchings)->last->histo, spent);
 
 	path_matching_cleanv (matchings);
 	oio_requri_clear (&ruri);
 	oio_url_pclean (&url);
+	oio_ext_trace_stop (OIO_TRACE_SLOW);
 	oio_ext_set_reqid (NULL);
 	return rc;
 }
@@ -633,6 +698,11 @@ grid_main_action (void)
 		return;
 	}
 
+	if (flag_async_upstream && NULL != (err = proxy_reactor_start ())) {
+		_main_error (err);
+		return;
+	}
+
 	if (NULL != (err = network_server_run (server))) {
 		_main_error (err);
 		return;
@@ -679,8 +749,14 @@ grid_main_get_options (void)
 			"Directory 'high' (cs+meta0) TTL for cache elements"},
 		{"DirHighMax", OT_UINT, {.u = &dir_high_max},
 			"Directory 'high' (cs+meta0) MAX cached elements"},
+		{"DirAdmission", OT_BOOL, {.b = &flag_dir_admission},
+			"When a directory cache is full, only keep a new element if it\n"
+			"\t\thas been asked more often than the element it would evict."},
 		{"PreferMaster", OT_BOOL, {.b = &flag_prefer_master},
 		        "Prefer to join Master before joining slave directly"},
+		{"AsyncUpstream", OT_BOOL, {.b = &flag_async_upstream},
+			"Do not hold a worker thread while the handlers wait for the\n"
+			"\t\tservices, a single thread polls all the connections."},
 		{NULL, 0, {.i = 0}, NULL}
 	};
 
@@ -713,6 +789,9 @@ grid_main_specific_fini (void)
 	_stop_queue (&upstream_gtq, &upstream_thread);
 	_stop_queue (&downstream_gtq, &downstream_thread);
 
+	/* Before the server, so that the suspended requests are resumed */
+	proxy_reactor_stop ();
+
 	if (server) {
 		network_server_close_servers (server);
 		network_server_stop (server);
@@ -790,6 +869,7 @@ configure_request_handlers (void)
 #define SET(Url,Cb) path_parser_configure (path_parser, PROXYD_PREFIX Url, Cb)
 
 	SET("/status/#GET", action_status);
+	SET("/traces/#GET", action_traces);
 
 	SET("/forward/stats/#POST", action_forward_stats);
 	SET("/forward/$ACTION/#POST", action_forward);
@@ -941,6 +1021,8 @@ grid_main_configure (int argc, char **argv)
 	enum hc_resolver_flags_e f = 0;
 	if (!flag_cache_enabled)
 		f |= HC_RESOLVER_NOCACHE;
+	if (!flag_dir_admission)
+		f |= HC_RESOLVER_NOADMIT;
 	hc_resolver_configure (resolver, f);
 	hc_resolver_qualify (resolver, service_is_ok);
 	hc_resolver_notify (resolver, service_invalidate);
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <string.h>
 #include <metautils/lib/metautils.h>
 #include <server/internals.h>
+#include <server/stats_holder.h>
 #include "path_parser.h"
 
 /* Allocates a node an initaite it with the given word and variable. */
@@ -43,13 +44,11 @@ struct trie_node_s ** _nodev_append (struct trie_node_s **, struct trie_node_s *
 
 /* Fills the tree */
 static struct trie_node_s ** _trie_insert (const struct trie_node_s *,
-		struct trie_node_s **, gchar **, const char*, gpointer);
+		struct trie_node_s **, GHashTable *, gchar **, const char*, gpointer);
 
-/* Recursively run the tree */
-static GSList * _trie_explore (struct trie_node_s **, gchar **,
-		const struct path_matching_s *);
-
-static struct path_matching_s * _match_dup (const struct path_matching_s *m0);
+/* Recursively run the tree, and fill the path with the nodes matched */
+static gboolean _trie_match (struct trie_node_s **, GHashTable *, gchar **,
+		const struct trie_node_s **);
 
 static void _match_free (struct path_matching_s *);
 
@@ -60,6 +59,7 @@ path_parser_init (void)
 {
 	struct path_parser_s *self = g_try_malloc0 (sizeof(*self));
 	self->roots = _nodev_empty ();
+	self->words = g_hash_table_new (g_str_hash, g_str_equal);
 	return self;
 }
 
@@ -69,20 +69,37 @@ path_parser_clean (struct path_parser_s *self)
 	if (!self)
 		return;
 	_nodev_free (self->roots);
+	g_hash_table_destroy (self->words);
 	g_free (self);
 }
 
 struct path_matching_s **
 path_parser_match (struct path_parser_s *self, gchar **tokens)
 {
-	struct path_matching_s nomatch = {NULL,NULL};
-	GSList *lmatch = _trie_explore (self->roots, tokens, &nomatch);
-
-	struct path_matching_s **p, **result;
-	p = result = g_try_malloc0 ((1 + g_slist_length(lmatch)) * sizeof (struct path_matching_s*));
-	for (GSList *l=lmatch; l ;l=l->next)
-		(*p++) = l->data;
-	g_slist_free (lmatch);
+	struct path_matching_s **result =
+		g_malloc0 (2 * sizeof (struct path_matching_s*));
+
+	const guint len = g_strv_length (tokens);
+	if (!len || len > self->depth)
+		return result;
+
+	/* The nodes matched, one per token */
+	const struct trie_node_s **path = g_alloca (len * sizeof(void*));
+	if (!_trie_match (self->roots, self->words, tokens, path))
+		return result;
+
+	guint nbvars = 0;
+	for (guint i=0; i<len ;++i)
+		nbvars += path[i]->var != NULL;
+
+	struct path_matching_s *m = SLICE_NEW (struct path_matching_s);
+	m->last = path[len-1];
+	m->vars = g_malloc0 ((nbvars + 1) * sizeof(gchar*));
+	for (guint i=0, v=0; i<len ;++i) {
+		if (path[i]->var)
+			m->vars[v++] = g_strconcat (path[i]->var, "=", tokens[i], NULL);
+	}
+	result[0] = m;
 	return result;
 }
 
@@ -92,7 +109,8 @@ path_parser_configure (struct path_parser_s *self, const char *descr, void *u)
 	EXTRA_ASSERT (self != NULL);
 	EXTRA_ASSERT (descr != NULL);
 	gchar **tokens = g_strsplit (descr, "/", -1);
-	self->roots = _trie_insert (NULL, self->roots, tokens, descr, u);
+	self->depth = MAX(self->depth, g_strv_length (tokens));
+	self->roots = _trie_insert (NULL, self->roots, self->words, tokens, descr, u);
 	g_strfreev (tokens);
 }
 
@@ -128,15 +146,6 @@ path_matching_get_variable (struct path_matching_s *self, const char *name)
 
 /* ------------------------------------------------------------------------- */
 
-struct path_matching_s *
-_match_dup (const struct path_matching_s *m0)
-{
-	struct path_matching_s *m = SLICE_NEW (struct path_matching_s);
-	m->last = m0->last;
-	m->vars = m0->vars ? g_strdupv (m0->vars) : g_try_malloc0 (sizeof(gchar*));
-	return m;
-}
-
 void
 _match_free (struct path_matching_s *m)
 {
@@ -153,6 +162,8 @@ _node_init (const struct trie_node_s *parent, const gchar *word, const gchar *va
 	n->word = word ? g_strdup (word) : NULL;
 	n->var = var ? g_strdup (var) : NULL;
 	n->u = NULL;
+	n->histo = NULL;
+	n->words = g_hash_table_new (g_str_hash, g_str_equal);
 	return n;
 }
 
@@ -166,6 +177,8 @@ _node_free (struct trie_node_s *n)
 	if (n->var)
 		g_free (n->var);
 	_nodev_free (n->next);
+	g_hash_table_destroy (n->words);
+	grid_histogram_destroy (n->histo);
 	g_free (n);
 }
 
@@ -251,7 +264,7 @@ _stat_name (const char *prefix, const char *tail, gchar *d, gsize dlen)
 
 struct trie_node_s **
 _trie_insert (const struct trie_node_s *parent, struct trie_node_s **tab,
-		gchar **words, const char *descr, gpointer u)
+		GHashTable *index, gchar **words, const char *descr, gpointer u)
 {
 	EXTRA_ASSERT (tab != NULL);
 	EXTRA_ASSERT (words != NULL);
@@ -268,14 +281,18 @@ _trie_insert (const struct trie_node_s *parent, struct trie_node_s **tab,
 	if (!n) {
 		n = _node_init (parent, word, var);
 		tab = _nodev_append (tab, n);
+		if (n->word)
+			g_hash_table_insert (index, n->word, n);
 	}
 
 	// Then recurse on the next words, or mark the node as final.
 	if (*(words+1))
-		n->next = _trie_insert (n, n->next, words+1, descr, u);
+		n->next = _trie_insert (n, n->next, n->words, words+1, descr, u);
 	else {
 		gchar tmp[512];
 		n->u = u;
+		if (!n->histo)
+			n->histo = grid_histogram_create ();
 		n->gq_count = g_quark_from_string (
 				_stat_name(OIO_STAT_PREFIX_REQ, descr, tmp, sizeof(tmp)));
 		n->gq_time = g_quark_from_string (
@@ -285,46 +302,49 @@ _trie_insert (const struct trie_node_s *parent, struct trie_node_s **tab,
 	return tab;
 }
 
-GSList *
-_trie_explore (struct trie_node_s **tab, gchar **needles,
-		const struct path_matching_s *current_match)
+gboolean
+_trie_match (struct trie_node_s **tab, GHashTable *index, gchar **needles,
+		const struct trie_node_s **path)
 {
-	GSList *matches = NULL;
-
-	void step (struct path_matching_s *m) {
-		if (!needles[1]) { // potential final match
-			if (!(*tab)->u) // we matched nothing
-				_match_free (m);
-			else // final match found
-				matches = g_slist_prepend (matches, m);
-		} else { // only a partial match, so we recurse
-			GSList *local_matches = _trie_explore ((*tab)->next, needles+1, m);
-			_match_free (m);
-			if (local_matches) {
-				/* XXX(jfs): the order matters! */
-				matches = g_slist_concat (matches, local_matches);
+	EXTRA_ASSERT (needles && *needles);
+
+	/* The explicit word first, found at once, then the variables */
+	struct trie_node_s *n = g_hash_table_lookup (index, *needles);
+	for (;;) {
+		if (n) {
+			*path = n;
+			if (!needles[1]) {
+				if (n->u) // final match found
+					return TRUE;
+			} else if (_trie_match (n->next, n->words, needles+1, path+1)) {
+				return TRUE;
 			}
 		}
+		for (n = NULL; *tab && !n ;++tab) {
+			if ((*tab)->var)
+				n = *tab;
+		}
+		if (!n)
+			return FALSE;
 	}
+}
 
-	EXTRA_ASSERT (needles && *needles);
-
-	for (; *tab ;++tab) {
-		if ((*tab)->word) { // Explicit word
-			if (0 != strcmp (*needles, (*tab)->word))
-				continue;
-			struct path_matching_s *m = _match_dup (current_match);
-			m->last = *tab;
-			step (m);
-		} else { // Wildcard
-			struct path_matching_s *m = _match_dup (current_match);
-			m->last = *tab;
-			m->vars = oio_strv_append (m->vars, g_strdup_printf("%s=%s", (*tab)->var, *needles));
-			step (m);
+gboolean
+path_unescape_inplace (gchar *s)
+{
+	gchar *d = s;
+	for (; *s ;++s, ++d) {
+		if (*s == '%' && g_ascii_isxdigit(s[1]) && g_ascii_isxdigit(s[2])) {
+			*d = (g_ascii_xdigit_value(s[1]) << 4) | g_ascii_xdigit_value(s[2]);
+			if (!*d)
+				return FALSE;
+			s += 2;
+		} else {
+			*d = *s;
 		}
 	}
-
-	return matches;
+	*d = '\0';
+	return TRUE;
 }
 
 static void
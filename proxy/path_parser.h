@@ -21,6 +21,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 # include <glib.h>
 
+struct grid_histogram_s;
+
 struct path_matching_s
 {
 	const struct trie_node_s *last;
@@ -36,11 +38,19 @@ struct trie_node_s
 	gpointer u;
 	GQuark gq_count;
 	GQuark gq_time;
+	/* latencies of the requests, on the final nodes only */
+	struct grid_histogram_s *histo;
+
+	/* <gchar*,struct trie_node_s*> the explicit words among 'next' */
+	GHashTable *words;
 };
 
 struct path_parser_s
 {
 	struct trie_node_s **roots;
+	GHashTable *words;
+	/* how many words in the longest path configured */
+	guint depth;
 };
 
 /* Creates a new parser */
@@ -56,7 +66,9 @@ void path_parser_configure (struct path_parser_s *self,
 		const char *descr, void *udata);
 
 /* Run the parsing logic. Returns a NULL pointer array of matching
- * structures. The return has to be freed with path_matching_cleanv(). */
+ * structures. The return has to be freed with path_matching_cleanv().
+ * At each step, the explicit words are preferred to the variables, and only
+ * the first complete match is returned. */
 struct path_matching_s ** path_parser_match (struct path_parser_s *self,
 		gchar **tokens);
 
@@ -69,4 +81,8 @@ const gchar * path_matching_get_variable (struct path_matching_s *self,
 
 void path_matching_cleanv (struct path_matching_s **tab);
 
+/* Decodes the %XX sequences of a path token, in place. Returns FALSE if
+ * the token embeds a NUL character (%00), that would truncate it. */
+gboolean path_unescape_inplace (gchar *s);
+
 #endif /*OIO_SDS__proxy__path_parser_h*/
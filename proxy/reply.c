@@ -196,3 +196,53 @@ _reply_success_json (struct req_args_s *args, GString * gstr)
 	return _reply_json (args, code, msg, gstr);
 }
 
+void
+_reply_stream_init (struct reply_stream_s *rs, struct req_args_s *args)
+{
+	rs->args = args;
+	rs->buf = g_string_sized_new (PROXYD_STREAM_CHUNK_SIZE + 1024);
+	rs->started = FALSE;
+	rs->failed = FALSE;
+}
+
+static void
+_reply_stream_send (struct reply_stream_s *rs)
+{
+	if (!rs->started) {
+		rs->started = TRUE;
+		rs->args->rp->set_status (HTTP_CODE_OK, "OK");
+		rs->args->rp->set_content_type ("application/json");
+		rs->args->rp->set_body_streamed ();
+		rs->args->rp->finalize ();
+	}
+	/* The buffer is kept for the next piece, and dropped once the client
+	 * failed to receive the previous ones */
+	if (!rs->failed && !rs->args->rp->send_body_chunk (
+				g_bytes_new (rs->buf->str, rs->buf->len)))
+		rs->failed = TRUE;
+	g_string_set_size (rs->buf, 0);
+}
+
+void
+_reply_stream_flush (struct reply_stream_s *rs)
+{
+	if (rs->buf->len >= PROXYD_STREAM_CHUNK_SIZE)
+		_reply_stream_send (rs);
+}
+
+enum http_rc_e
+_reply_stream_end (struct reply_stream_s *rs)
+{
+	GString *buf = rs->buf;
+	rs->buf = NULL;
+	if (!rs->started)
+		return _reply_success_json (rs->args, buf);
+	if (buf->len > 0) {
+		rs->buf = buf;
+		_reply_stream_send (rs);
+		rs->buf = NULL;
+	}
+	g_string_free (buf, TRUE);
+	return rs->failed ? HTTPRC_ABORT : HTTPRC_DONE;
+}
+
@@ -28,11 +28,25 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "transport_http.h"
 
+/* Longest line accepted in the request line, headers, chunk headers */
+#ifndef HTTP_MAX_LINE_SIZE
+# define HTTP_MAX_LINE_SIZE 65536
+#endif
+
+/* Maximum size of the request line and the headers, all together */
+#ifndef HTTP_MAX_HEAD_SIZE
+# define HTTP_MAX_HEAD_SIZE (256*1024)
+#endif
+
 struct transport_client_context_s
 {
 	struct http_parser_s *parser;
 	struct http_request_s *request;
 	http_handler_f handler;
+
+	/* saved while the request is suspended */
+	gint64 tv_start;
+	gchar *uid;
 };
 
 struct req_ctx_s
@@ -48,6 +62,7 @@ struct req_ctx_s
 
 	gboolean close_after_request;
 	gboolean access_disabled;
+	gboolean suspended;
 };
 
 static int http_notify_input(struct network_client_s *clt);
@@ -56,22 +71,42 @@ static int http_notify_input(struct network_client_s *clt);
 
 enum http_parser_step_e
 {
-	STEP_FIRST_R0, STEP_FIRST_N0,
-	STEP_SEP_R0, STEP_SEP_N0,
-	STEP_HEADERS_R0, STEP_HEADERS_N0,
-	STEP_BODY_ASIS
+	STEP_COMMAND,
+	STEP_HEADERS,
+	STEP_BODY_ASIS,
+	STEP_CHUNK_SIZE,
+	STEP_CHUNK_DATA,
+	STEP_CHUNK_END,
+	STEP_TRAILERS,
+};
+
+/* A piece of the input, not NUL-terminated */
+struct http_view_s
+{
+	const gchar *ptr;
+	gsize len;
 };
 
 struct http_parser_s
 {
 	enum http_parser_step_e step;
 	GError *error;
+
+	/* Holds the beginning of a line split across several inputs. A line
+	 * received at once is parsed in place, in the input. */
 	GString *buf;
 
+	/* bytes of request line and headers read so far */
+	gsize head_size;
+
+	gboolean chunked;
+	gint64 chunk_left;
 	gint64 content_read;
 	gint64 content_length;
-	void (*command_provider)(const gchar *req, const gchar *sel, const gchar *ver);
-	void (*header_provider)(const gchar *name, const gchar *value);
+	void (*command_provider)(struct http_view_s *req,
+			struct http_view_s *sel, struct http_view_s *ver);
+	void (*header_provider)(struct http_view_s *name,
+			struct http_view_s *value);
 	void (*body_provider)(const guint8 *data, gsize data_len);
 };
 
@@ -81,70 +116,151 @@ struct http_parsing_result_s
 	enum { HPRC_SUCCESS = 0, HPRC_MORE, HPRC_ERROR } status;
 };
 
+#define VIEW_IS(V,S) ((V)->len == sizeof(S)-1 \
+		&& !g_ascii_strncasecmp((V)->ptr, (S), sizeof(S)-1))
+
 static void
-gstr_chomp(GString *gstr)
+_view_strip(struct http_view_s *v)
 {
-	if (!gstr)
-		return;
-	gchar *start, *end;
-	start = gstr->str;
-	end = start + gstr->len;
-	while (end > start && (*(end-1) == '\n' || *(end-1) == '\r'))
-		*(--end) = '\0';
+	while (v->len > 0 && g_ascii_isspace(*v->ptr)) {
+		++ v->ptr;
+		-- v->len;
+	}
+	while (v->len > 0 && g_ascii_isspace(v->ptr[v->len-1]))
+		-- v->len;
 }
 
-static gboolean
-_manage_and_renew_command(struct http_parser_s *parser, GString *buf)
+/* Locates the end of the current line with memchr(), that is vectorized
+ * in the libc, instead of looking at the bytes one by one. Returns 1 if a
+ * complete line is available in 'line' (without its CRLF), 0 if the line
+ * continues in the next input (its beginning being saved in the parser),
+ * and -1 if the line is too long. */
+static int
+_next_line(struct http_parser_s *parser, const guint8 *data, gsize available,
+		gsize *consumed, struct http_view_s *line)
 {
-	gchar *cmd, *selector, *version;
+	const guint8 *start = data + *consumed;
+	const gsize max = available - *consumed;
+	const guint8 *eol = memchr(start, '\n', max);
+	const gsize len = eol ? (gsize)(eol - start) : max;
+
+	*consumed += eol ? len + 1 : len;
+	if (!eol || parser->buf->len > 0)
+		g_string_append_len(parser->buf, (const gchar*) start, len);
+	if (parser->buf->len > HTTP_MAX_LINE_SIZE)
+		return -1;
+	if (!eol)
+		return 0;
+
+	if (parser->buf->len > 0) {
+		line->ptr = parser->buf->str;
+		line->len = parser->buf->len;
+	} else {
+		line->ptr = (const gchar*) start;
+		line->len = len;
+	}
+	if (line->len > 0 && line->ptr[line->len-1] == '\r')
+		-- line->len;
+	return 1;
+}
 
-	if (!buf->len)
+static gboolean
+_manage_command(struct http_parser_s *parser, struct http_view_s *line)
+{
+	const gchar *end = line->ptr + line->len;
+	const gchar *sp0 = memchr(line->ptr, ' ', line->len);
+	if (!sp0)
 		return FALSE;
-
-	gstr_chomp(buf);
-	cmd = buf->str;
-	selector = strchr(cmd, ' ');
-	if (!selector)
+	const gchar *sp1 = end;
+	while (sp1 > sp0 && *(sp1-1) != ' ')
+		-- sp1;
+	if (sp1 <= sp0 + 1)
 		return FALSE;
-	*(selector++) = '\0';
-	version = strrchr(selector, ' ');
-	if (!version)
+
+	struct http_view_s cmd = {line->ptr, sp0 - line->ptr};
+	struct http_view_s selector = {sp0 + 1, (sp1 - 1) - (sp0 + 1)};
+	struct http_view_s version = {sp1, end - sp1};
+	if (!cmd.len || !selector.len || !version.len)
 		return FALSE;
-	*(version++) = '\0';
 
 	if (parser->command_provider)
-		parser->command_provider(cmd, selector, version);
-
-	g_string_set_size(buf, 0);
+		parser->command_provider(&cmd, &selector, &version);
 	return TRUE;
 }
 
 static gboolean
-_manage_and_renew_header(struct http_parser_s *parser, GString *buf)
+_parse_content_length(struct http_view_s *v, gint64 *out)
 {
-	if (!buf->len)
-		return TRUE;
-
-	gstr_chomp(buf);
-	gchar *header = buf->str;
-	gchar *sep = strchr(header, ':');
-	if (!sep)
+	gint64 total = 0;
+	if (!v->len)
 		return FALSE;
-	*(sep++) = '\0';
-	if (*(sep++) != ' ')
+	for (gsize i=0; i < v->len ;++i) {
+		if (!g_ascii_isdigit(v->ptr[i]) || total > (G_MAXINT64 / 10) - 9)
+			return FALSE;
+		total = total * 10 + (v->ptr[i] - '0');
+	}
+	*out = total;
+	return TRUE;
+}
+
+static gboolean
+_manage_header(struct http_parser_s *parser, struct http_view_s *line)
+{
+	const gchar *sep = memchr(line->ptr, ':', line->len);
+	if (!sep || sep == line->ptr)
 		return FALSE;
 
-	oio_str_lower (header);
-	if (*header == 'c' && !strcmp(header, "content-length"))
-		parser->content_length = g_ascii_strtoll(sep, NULL, 10);
+	struct http_view_s name = {line->ptr, sep - line->ptr};
+	struct http_view_s value = {sep + 1, (line->ptr + line->len) - (sep + 1)};
+	_view_strip(&value);
+
+	if (VIEW_IS(&name, "content-length")) {
+		if (!_parse_content_length(&value, &parser->content_length))
+			return FALSE;
+	} else if (VIEW_IS(&name, "transfer-encoding")) {
+		/* "chunked" must be the last encoding applied */
+		static const char chunked[] = "chunked";
+		const gsize l = sizeof(chunked) - 1;
+		parser->chunked = value.len >= l
+			&& !g_ascii_strncasecmp(value.ptr + value.len - l, chunked, l);
+	}
 
 	if (parser->header_provider)
-		parser->header_provider(header, sep);
+		parser->header_provider(&name, &value);
+	return TRUE;
+}
 
-	g_string_set_size(buf, 0);
+static gboolean
+_manage_chunk_size(struct http_parser_s *parser, struct http_view_s *line)
+{
+	gint64 size = 0;
+	gsize i = 0;
+	for (; i < line->len && g_ascii_isxdigit(line->ptr[i]) ;++i) {
+		if (size > (G_MAXINT64 >> 4))
+			return FALSE;
+		size = (size << 4) + g_ascii_xdigit_value(line->ptr[i]);
+	}
+	/* the chunk extensions are ignored */
+	if (!i || (i < line->len && line->ptr[i] != ';'
+				&& !g_ascii_isspace(line->ptr[i])))
+		return FALSE;
+	parser->chunk_left = size;
 	return TRUE;
 }
 
+static gsize
+_feed_body(struct http_parser_s *parser, const guint8 *data, gsize available,
+		gint64 expected)
+{
+	gsize max = available;
+	if ((gint64)max > expected)
+		max = expected;
+	if (parser->body_provider && max > 0)
+		parser->body_provider(data, max);
+	parser->content_read += max;
+	return max;
+}
+
 static struct http_parsing_result_s
 http_parse(struct http_parser_s *parser, const guint8 *data, gsize available)
 {
@@ -160,81 +276,100 @@ http_parse(struct http_parser_s *parser, const guint8 *data, gsize available)
 	}
 
 	while (consumed < available) {
-		guint8 d = data[consumed];
-		gint64 max;
+		struct http_view_s line = {NULL, 0};
+		gsize before = consumed, got;
+		int rc;
+
 		switch (parser->step) {
 
-			case STEP_FIRST_R0:
-				if (d == '\r')
-					parser->step = STEP_FIRST_N0;
-				else
-					g_string_append_c(parser->buf, d);
-				++ consumed;
+			case STEP_COMMAND:
+			case STEP_HEADERS:
+			case STEP_CHUNK_SIZE:
+			case STEP_CHUNK_END:
+			case STEP_TRAILERS:
+				rc = _next_line(parser, data, available, &consumed, &line);
+				if (parser->step == STEP_COMMAND || parser->step == STEP_HEADERS) {
+					parser->head_size += consumed - before;
+					if (parser->head_size > HTTP_MAX_HEAD_SIZE)
+						return _build_rc(HPRC_ERROR, "Headers too large");
+				}
+				if (rc < 0)
+					return _build_rc(HPRC_ERROR, "Line too long");
+				if (rc == 0)
+					continue;
+				break;
+
+			case STEP_BODY_ASIS:
+				consumed += _feed_body(parser, data + consumed,
+						available - consumed,
+						parser->content_length - parser->content_read);
+				if (parser->content_read >= parser->content_length)
+					return _build_rc(HPRC_SUCCESS, NULL);
 				continue;
 
-			case STEP_FIRST_N0:
-				if (d == '\n') {
-					if (!_manage_and_renew_command(parser, parser->buf))
+			case STEP_CHUNK_DATA:
+				got = _feed_body(parser, data + consumed,
+						available - consumed, parser->chunk_left);
+				consumed += got;
+				parser->chunk_left -= got;
+				if (parser->chunk_left <= 0)
+					parser->step = STEP_CHUNK_END;
+				continue;
+		}
+
+		/* A complete line is available */
+		switch (parser->step) {
+
+			case STEP_COMMAND:
+				/* tolerate empty lines before the request (RFC 7230 3.5) */
+				if (line.len > 0) {
+					if (!_manage_command(parser, &line))
 						return _build_rc(HPRC_ERROR, "CMD parsing error");
-					parser->step = STEP_SEP_R0;
-					++ consumed;
-					continue;
+					parser->step = STEP_HEADERS;
 				}
-				return _build_rc(HPRC_ERROR, "CMD parsing error");
+				break;
 
-			case STEP_SEP_R0:
-				if (d == '\r')
-					parser->step = STEP_SEP_N0;
-				else {
-					if (!_manage_and_renew_header(parser, parser->buf))
+			case STEP_HEADERS:
+				if (line.len > 0) {
+					if (!_manage_header(parser, &line))
 						return _build_rc(HPRC_ERROR, "HDR parsing error");
-					g_string_append_c(parser->buf, d);
-					parser->step = STEP_HEADERS_R0;
+					break;
 				}
-				++ consumed;
-				continue;
-
-			case STEP_SEP_N0:
-				if (d == '\n') {
-					++ consumed;
-					if (!_manage_and_renew_header(parser, parser->buf))
-						return _build_rc(HPRC_ERROR, "HDR parsing error");
-					parser->step = STEP_BODY_ASIS;
-					if (parser->content_read >= parser->content_length)
-						return _build_rc(HPRC_SUCCESS, NULL);
+				g_string_set_size(parser->buf, 0);
+				if (parser->chunked) {
+					parser->step = STEP_CHUNK_SIZE;
 					continue;
 				}
-				return _build_rc(HPRC_ERROR, "SEP parsing error");
-
-			case STEP_HEADERS_R0:
-				if (d == '\r')
-					parser->step = STEP_HEADERS_N0;
-				else
-					g_string_append_c(parser->buf, d);
-				++ consumed;
+				parser->step = STEP_BODY_ASIS;
+				if (parser->content_read >= parser->content_length)
+					return _build_rc(HPRC_SUCCESS, NULL);
 				continue;
 
-			case STEP_HEADERS_N0:
-				if (d == '\n') {
-					parser->step = STEP_SEP_R0;
-					++ consumed;
-					continue;
-				}
-				return _build_rc(HPRC_ERROR, "HDR parsing error");
+			case STEP_CHUNK_SIZE:
+				if (!_manage_chunk_size(parser, &line))
+					return _build_rc(HPRC_ERROR, "Chunk size parsing error");
+				parser->step = parser->chunk_left > 0
+					? STEP_CHUNK_DATA : STEP_TRAILERS;
+				break;
+
+			case STEP_CHUNK_END:
+				if (line.len > 0)
+					return _build_rc(HPRC_ERROR, "Chunk parsing error");
+				parser->step = STEP_CHUNK_SIZE;
+				break;
+
+			case STEP_TRAILERS:
+				/* the trailers are ignored */
+				if (line.len > 0)
+					break;
+				g_string_set_size(parser->buf, 0);
+				return _build_rc(HPRC_SUCCESS, NULL);
 
 			case STEP_BODY_ASIS:
-				max = available - consumed;
-				if (max > (parser->content_length - parser->content_read))
-					max = parser->content_length - parser->content_read;
-				if (parser->body_provider)
-					parser->body_provider(data+consumed, max);
-				consumed += max;
-				parser->content_read += max;
-
-				if (parser->content_read >= parser->content_length)
-					return _build_rc(HPRC_SUCCESS, NULL);
-				continue;
+			case STEP_CHUNK_DATA:
+				g_assert_not_reached();
 		}
+		g_string_set_size(parser->buf, 0);
 	}
 
 	return _build_rc(HPRC_MORE, NULL);
@@ -243,8 +378,11 @@ http_parse(struct http_parser_s *parser, const guint8 *data, gsize available)
 static void
 http_parser_reset(struct http_parser_s *parser)
 {
-	parser->step = STEP_FIRST_R0;
+	parser->step = STEP_COMMAND;
 	g_string_set_size(parser->buf, 0);
+	parser->head_size = 0;
+	parser->chunked = FALSE;
+	parser->chunk_left = 0;
 	parser->content_read = 0;
 	parser->content_length = -1;
 	if (parser->error)
@@ -307,6 +445,7 @@ http_context_clean(struct transport_client_context_s *ctx)
 		http_parser_destroy(ctx->parser);
 	if (ctx->request)
 		http_request_clean(ctx->request);
+	oio_str_clean(&ctx->uid);
 	g_free(ctx);
 }
 
@@ -330,6 +469,25 @@ transport_http_factory0(http_handler_f hdl, struct network_client_s *client)
 	network_client_allow_input(client, TRUE);
 }
 
+void
+http_request_suspend(struct http_request_s *req,
+		http_resume_f resume, gpointer udata)
+{
+	EXTRA_ASSERT(req != NULL);
+	EXTRA_ASSERT(resume != NULL);
+	EXTRA_ASSERT(req->resume == NULL);
+	req->resume = resume;
+	req->resume_udata = udata;
+	network_client_suspend(req->client);
+}
+
+void
+http_request_resume(struct http_request_s *req)
+{
+	EXTRA_ASSERT(req != NULL);
+	network_client_resume(req->client);
+}
+
 //------------------------------------------------------------------------------
 
 static const gchar * ensure (const gchar *s) { return s && *s ? s : "-"; }
@@ -387,6 +545,8 @@ static GError *
 http_manage_request(struct req_ctx_s *r)
 {
 	gboolean finalized = 0;
+	gboolean streamed = FALSE, chunked = FALSE;
+	gsize streamed_len = 0;
 	int code = HTTP_CODE_INTERNAL_ERROR;
 	gchar *msg = NULL, *access = NULL;
 	GTree *headers = NULL;
@@ -440,6 +600,44 @@ http_manage_request(struct req_ctx_s *r)
 		return set_body_bytes (g_string_free_to_bytes (gstr));
 	}
 
+	void set_body_streamed(void) {
+		EXTRA_ASSERT(!finalized);
+		set_body_bytes(NULL);
+		streamed = TRUE;
+	}
+
+	gboolean send_body_chunk(GBytes *gb) {
+		EXTRA_ASSERT(finalized && streamed);
+		gsize len = g_bytes_get_size(gb);
+		if (!len) {
+			/* an empty chunk would end the body */
+			g_bytes_unref(gb);
+			return TRUE;
+		}
+		streamed_len += len;
+		if (chunked) {
+			GString *hdr = g_string_sized_new(20);
+			g_string_printf(hdr, "%"G_GSIZE_MODIFIER"x\r\n", len);
+			network_client_send_slab(r->client, data_slab_make_gstr(hdr));
+		}
+		network_client_send_slab(r->client, data_slab_make_gbytes(gb));
+		if (chunked)
+			network_client_send_slab(r->client,
+					data_slab_make_static_string("\r\n"));
+		/* Rather than queuing the whole body for a slow client */
+		return network_client_wait_output(r->client,
+				PROXYD_STREAM_MAX_PENDING,
+				oio_ext_monotonic_time () + PROXYD_STREAM_TIMEOUT);
+	}
+
+	void end_body_stream(gboolean complete) {
+		if (complete && chunked)
+			network_client_send_slab(r->client,
+					data_slab_make_static_string("0\r\n\r\n"));
+		streamed = FALSE;
+		_access_log(r, code, streamed_len, access);
+	}
+
 	void finalize(void) {
 		EXTRA_ASSERT(!finalized);
 		finalized = TRUE;
@@ -451,27 +649,40 @@ http_manage_request(struct req_ctx_s *r)
 		g_string_append_printf(buf, "Server: oio-proxy/%s\r\n", OIOSDS_PROJECT_VERSION);
 
 		if (0 == g_ascii_strcasecmp("HTTP/1.1", r->request->version)) {
-			// Manage the "Connection" header of http/1.1
+			// Manage the "Connection" header of http/1.1, where the
+			// connections are persistent unless explicitely closed.
 			gchar *v = g_tree_lookup(r->request->tree_headers, "connection");
-			if (v && 0 == g_ascii_strcasecmp("Keep-Alive", v)) {
-				g_string_append(buf, "Connection: Keep-Alive\r\n");
-				r->close_after_request = FALSE;
-			}
-			else {
+			if (v && 0 == g_ascii_strcasecmp("Close", v)) {
 				g_string_append(buf, "Connection: Close\r\n");
 				r->close_after_request = TRUE;
 			}
+			else {
+				g_string_append(buf, "Connection: Keep-Alive\r\n");
+				r->close_after_request = FALSE;
+			}
+			chunked = streamed;
+		} else if (streamed) {
+			// Without chunks, the end of the connection marks the end of
+			// the body.
+			r->close_after_request = TRUE;
 		}
 
 		gsize body_len = body ? g_bytes_get_size(body) : 0;
 
 		// Add body-related headers
-		if (body_len) {
+		if (streamed) {
 			if (content_type)
 				g_string_append_printf(buf, "Content-Type: %s\r\n", content_type);
-			g_string_append(buf, "Transfer-Encoding: identity\r\n");
+			if (chunked)
+				g_string_append(buf, "Transfer-Encoding: chunked\r\n");
+		} else {
+			if (body_len) {
+				if (content_type)
+					g_string_append_printf(buf, "Content-Type: %s\r\n", content_type);
+				g_string_append(buf, "Transfer-Encoding: identity\r\n");
+			}
+			g_string_append_printf(buf, "Content-Length: %"G_GSIZE_FORMAT"\r\n", body_len);
 		}
-		g_string_append_printf(buf, "Content-Length: %"G_GSIZE_FORMAT"\r\n", body_len);
 
 		// Add Custom headers
 		g_tree_foreach(headers, sender, buf);
@@ -485,7 +696,8 @@ http_manage_request(struct req_ctx_s *r)
 			network_client_send_slab(r->client, data_slab_make_gbytes(body));
 		body = NULL;
 
-		_access_log(r, code, body_len, access);
+		if (!streamed)
+			_access_log(r, code, body_len, access);
 	}
 
 	void access_tail (const char *fmt, ...) {
@@ -503,6 +715,7 @@ http_manage_request(struct req_ctx_s *r)
 	void final_error(int c_, const char *m_) {
 		if (!finalized) {
 			set_body_bytes(NULL);
+			streamed = FALSE;
 			set_status(c_, m_);
 			finalize();
 			cleanup();
@@ -519,6 +732,8 @@ http_manage_request(struct req_ctx_s *r)
 		.add_header_gstr = add_header_gstr,
 		.set_body_bytes = set_body_bytes,
 		.set_body_gstr = set_body_gstr,
+		.set_body_streamed = set_body_streamed,
+		.send_body_chunk = send_body_chunk,
 		.subject = subject,
 		.finalize = finalize,
 		.access_tail = access_tail,
@@ -533,17 +748,45 @@ http_manage_request(struct req_ctx_s *r)
 		return NULL;
 	}
 
-	enum http_rc_e rc = r->context->handler (r->request, &reply);
+	enum http_rc_e rc;
+	if (r->request->resume) {
+		http_resume_f resume = r->request->resume;
+		gpointer udata = r->request->resume_udata;
+		r->request->resume = NULL;
+		r->request->resume_udata = NULL;
+		rc = resume (udata, r->request, &reply);
+	} else {
+		rc = r->context->handler (r->request, &reply);
+	}
+
 	switch (rc) {
 		case HTTPRC_DONE:
 			EXTRA_ASSERT(finalized != FALSE);
+			if (streamed)
+				end_body_stream(TRUE);
 			cleanup();
 			oio_ext_set_reqid (NULL);
 			return NULL;
 		case HTTPRC_ABORT:
+			if (finalized && streamed) {
+				/* Too late for an error reply, the truncated body must not
+				   look complete: no last chunk, and the connection is closed */
+				end_body_stream(FALSE);
+				r->close_after_request = TRUE;
+				cleanup();
+				oio_ext_set_reqid (NULL);
+				return NEWERROR(HTTP_CODE_INTERNAL_ERROR, "HTTP handler error");
+			}
 			final_error(HTTP_CODE_INTERNAL_ERROR, "Internal error");
 			oio_ext_set_reqid (NULL);
 			return NEWERROR(HTTP_CODE_INTERNAL_ERROR, "HTTP handler error");
+		case HTTPRC_PENDING:
+			EXTRA_ASSERT(!finalized);
+			EXTRA_ASSERT(r->request->resume != NULL);
+			r->suspended = TRUE;
+			cleanup();
+			oio_ext_set_reqid (NULL);
+			return NULL;
 	}
 
 	EXTRA_ASSERT(!finalized);
@@ -559,14 +802,15 @@ http_notify_input(struct network_client_s *clt)
 {
 	struct req_ctx_s r = {0};
 
-	void command_provider(const gchar *c, const gchar *s, const gchar *v) {
-		r.request->cmd = g_ascii_strup(c, -1);
-		r.request->req_uri = g_strdup(s);
-		r.request->version = g_ascii_strup(v, -1);
+	void command_provider(struct http_view_s *c, struct http_view_s *s,
+			struct http_view_s *v) {
+		r.request->cmd = g_ascii_strup(c->ptr, c->len);
+		r.request->req_uri = g_strndup(s->ptr, s->len);
+		r.request->version = g_ascii_strup(v->ptr, v->len);
 	}
-	void header_provider(const gchar *k, const gchar *v) {
-		/* 'k' should be already lowercase */
-		g_tree_replace(r.request->tree_headers, g_strdup(k), g_strdup(v));
+	void header_provider(struct http_view_s *k, struct http_view_s *v) {
+		g_tree_replace(r.request->tree_headers,
+				g_ascii_strdown(k->ptr, k->len), g_strndup(v->ptr, v->len));
 	}
 	void body_provider(const guint8 *data, gsize data_len) {
 		g_byte_array_append(r.request->body, data, data_len);
@@ -583,7 +827,53 @@ http_notify_input(struct network_client_s *clt)
 	parser->body_provider = body_provider;
 	parser->header_provider = header_provider;
 
+	/* Returns TRUE if no other request should be read for now */
+	gboolean manage_request(void) {
+		r.close_after_request = TRUE;
+		r.access_disabled = FALSE;
+		r.suspended = FALSE;
+
+		GError *err = http_manage_request(&r);
+
+		if (r.suspended) {
+			/* The request is kept until its continuation is called */
+			r.context->tv_start = r.tv_start;
+			oio_str_reuse(&r.context->uid, r.uid);
+			r.uid = NULL;
+			return TRUE;
+		}
+
+		http_request_clean(r.request);
+		r.request = r.context->request = http_request_create(r.client);
+
+		if (err) {
+			GRID_INFO("Request management error : %d %s", err->code, err->message);
+			g_clear_error(&err);
+			network_client_allow_input(clt, FALSE);
+			network_client_close_output(clt, 0);
+			return TRUE;
+		}
+		if (r.close_after_request) {
+			GRID_DEBUG("No connection keep-alive, closing.");
+			network_client_allow_input(clt, FALSE);
+			network_client_close_output(clt, 0);
+			return TRUE;
+		}
+		return FALSE;
+	}
+
 	gboolean done = FALSE;
+
+	/* A suspended request has been resumed, its continuation has to be
+	 * called before any pipelined request is parsed. */
+	if (r.request->resume) {
+		r.tv_start = r.context->tv_start;
+		r.tv_parsed = oio_ext_monotonic_time ();
+		r.uid = r.context->uid;
+		r.context->uid = NULL;
+		done = manage_request();
+	}
+
 	while (!done && data_slab_sequence_has_data(&clt->input)) {
 
 		struct data_slab_s *slab;
@@ -614,31 +904,18 @@ http_notify_input(struct network_client_s *clt)
 
 		if (rc.status == HPRC_SUCCESS) {
 
+			/* Keep what follows the request in the slab: with pipelining,
+			   this is the beginning of the next request. */
+			if (rc.consumed < data_size)
+				data_slab_rewind(slab, data_size - rc.consumed);
+
 			// Important times are now known.$
 			// First, the last chunk of data received
 			// Second, the moment the real treatment start ... i.e. now!
 			r.tv_start = clt->time.evt_in;
 			r.tv_parsed = oio_ext_monotonic_time ();
-
-			GError *err = http_manage_request(&r);
-
 			http_parser_reset(parser);
-			http_request_clean(r.request);
-			r.request = r.context->request = http_request_create(r.client);
-
-			if (err) {
-				GRID_INFO("Request management error : %d %s", err->code, err->message);
-				g_clear_error(&err);
-				network_client_allow_input(clt, FALSE);
-				network_client_close_output(clt, 0);
-				done = TRUE;
-			}
-			else if (r.close_after_request) {
-				GRID_DEBUG("No connection keep-alive, closing.");
-				network_client_allow_input(clt, FALSE);
-				network_client_close_output(clt, 0);
-				done = TRUE;
-			}
+			done = manage_request();
 		}
 		else if (rc.status == HPRC_ERROR) {
 			GRID_DEBUG("Request parsing error");
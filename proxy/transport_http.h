@@ -25,6 +25,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /* Avoids an include */
 struct network_client_s;
 
+struct http_request_s;
+struct http_reply_ctx_s;
+
+/* Continuation of a suspended request, see http_request_suspend() */
+typedef enum http_rc_e (*http_resume_f) (gpointer udata,
+		struct http_request_s *request, struct http_reply_ctx_s *reply);
+
 struct http_request_s
 {
 	struct network_client_s *client;
@@ -38,6 +45,10 @@ struct http_request_s
 	/* all the headers mapped as <gchar*,gchar*> */
 	GTree *tree_headers;
 	GByteArray *body;
+
+	/* set while the request is suspended */
+	http_resume_f resume;
+	gpointer resume_udata;
 };
 
 struct http_reply_ctx_s
@@ -49,13 +60,26 @@ struct http_reply_ctx_s
 	void (*set_body_gstr) (GString *gstr);
 	void (*set_body_bytes) (GBytes *bytes);
 
+	/* Instead of a body set at once, the body will be sent piece by piece,
+	 * with send_body_chunk(), once finalize() has been called. It is sent
+	 * with the chunked transfer-encoding in HTTP/1.1, and ended by closing
+	 * the connection in HTTP/1.0. The body ends when the handler returns.
+	 * send_body_chunk() waits for the client when too much of the body is
+	 * pending, and returns FALSE if the client cannot receive it anymore:
+	 * the handler should then return HTTPRC_ABORT. */
+	void (*set_body_streamed) (void);
+	gboolean (*send_body_chunk) (GBytes *bytes);
+
 	void (*subject) (const char *id);
 	void (*finalize) (void);
 	void (*access_tail) (const char *fmt, ...);
 	void (*no_access) (void);
 };
 
-enum http_rc_e { HTTPRC_DONE, HTTPRC_ABORT };
+/* HTTPRC_PENDING tells the request has been suspended with
+ * http_request_suspend(): no reply has been sent yet, it will be sent by the
+ * continuation. */
+enum http_rc_e { HTTPRC_DONE, HTTPRC_ABORT, HTTPRC_PENDING };
 
 typedef enum http_rc_e (*http_handler_f) (struct http_request_s *request,
 			struct http_reply_ctx_s *reply);
@@ -77,4 +101,15 @@ void transport_http_factory0 (http_handler_f handler,
 const gchar * http_request_get_header(struct http_request_s *req,
 		const gchar *n);
 
+/** To be called by a handler that is about to return HTTPRC_PENDING, before
+ * the event it waits for can happen. The worker thread is released and the
+ * connection is not read anymore until http_request_resume() is called.
+ * Then 'resume' is called in a worker thread, with a new reply context, and
+ * the request is managed as if 'resume' was the handler. */
+void http_request_suspend(struct http_request_s *req,
+		http_resume_f resume, gpointer udata);
+
+/** Thread-safe. Schedules the continuation of a suspended request. */
+void http_request_resume(struct http_request_s *req);
+
 #endif /*OIO_SDS__proxy__transport_http_h*/
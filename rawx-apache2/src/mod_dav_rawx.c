@@ -40,12 +40,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "rawx_internals.h"
 #include "rawx_config.h"
 #include "rawx_event.h"
+#include "rawx_commit.h"
 
 static void
 _cleanup_child(dav_rawx_server_conf *conf)
 {
 	server_child_stat_fini(conf, conf->pool);
 	rawx_event_destroy();
+	rawx_commit_destroy();
 }
 
 static void
@@ -106,6 +108,8 @@ dav_rawx_merge_server_config(apr_pool_t *p, void *base, void *overrides)
 	newconf->hash_width = child->hash_width;
 	newconf->fsync_on_close = child->fsync_on_close;
 	newconf->fallocate = child->fallocate;
+	newconf->direct_io = child->direct_io;
+	newconf->fsync_dir_window = child->fsync_dir_window;
 	memcpy(newconf->docroot, child->docroot, sizeof(newconf->docroot));
 	memcpy(newconf->ns_name, child->ns_name, sizeof(newconf->ns_name));
 	update_rawx_conf(p, &(newconf->rawx_conf), newconf->ns_name);
@@ -273,6 +277,21 @@ dav_rawx_cmd_gridconfig_fsync_dir(cmd_parms *cmd, void *config, const char *arg1
 	return NULL;
 }
 
+static const char *
+dav_rawx_cmd_gridconfig_fsync_dir_window(cmd_parms *cmd, void *config, const char *arg1)
+{
+	dav_rawx_server_conf *conf;
+	(void) config;
+
+	DAV_XDEBUG_POOL(cmd->pool, 0, "%s()", __FUNCTION__);
+
+	conf = ap_get_module_config(cmd->server->module_config, &dav_rawx_module);
+	conf->fsync_dir_window = atoi(arg1);
+
+	DAV_DEBUG_POOL(cmd->pool, 0, "fsync_dir_window=[%d]", conf->fsync_dir_window);
+	return NULL;
+}
+
 static const char *
 dav_rawx_cmd_gridconfig_fallocate(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -287,6 +306,20 @@ dav_rawx_cmd_gridconfig_fallocate(cmd_parms *cmd, void *config, const char *arg1
 	return NULL;
 }
 
+static const char *
+dav_rawx_cmd_gridconfig_direct_io(cmd_parms *cmd, void *config, const char *arg1)
+{
+	dav_rawx_server_conf *conf;
+	(void) config;
+
+	DAV_XDEBUG_POOL(cmd->pool, 0, "%s()", __FUNCTION__);
+
+	conf = ap_get_module_config(cmd->server->module_config, &dav_rawx_module);
+	conf->direct_io = _str_to_boolean(arg1);
+
+	return NULL;
+}
+
 static const char *
 dav_rawx_cmd_gridconfig_dirrun(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -367,6 +400,16 @@ rawx_hook_child_init(apr_pool_t *pchild, server_rec *s)
 	}
 	g_free(event_agent_addr);
 
+	if (conf->fsync_on_close & FSYNC_ON_CHUNK_DIR) {
+		err = rawx_commit_init(
+				(gint64)conf->fsync_dir_window * G_TIME_SPAN_MILLISECOND);
+		if (NULL != err) {
+			DAV_ERROR_POOL(pchild, 0, "Failed to start the directory commits: "
+					"(%d) %s", err->code, err->message);
+			g_clear_error (&err);
+		}
+	}
+
 	oio_log_to_syslog ();
 }
 
@@ -545,7 +588,9 @@ static const command_rec dav_rawx_cmds[] =
     AP_INIT_TAKE1("grid_dir_run",     dav_rawx_cmd_gridconfig_dirrun,      NULL, RSRC_CONF, "run directory"),
     AP_INIT_TAKE1("grid_fsync",       dav_rawx_cmd_gridconfig_fsync,       NULL, RSRC_CONF, "do fsync on file close"),
     AP_INIT_TAKE1("grid_fsync_dir",   dav_rawx_cmd_gridconfig_fsync_dir,   NULL, RSRC_CONF, "do fsync on chunk direcory after renaming .pending"),
+    AP_INIT_TAKE1("grid_fsync_dir_window", dav_rawx_cmd_gridconfig_fsync_dir_window, NULL, RSRC_CONF, "how long (ms) the directory fsyncs wait to be batched"),
     AP_INIT_TAKE1("grid_fallocate",   dav_rawx_cmd_gridconfig_fallocate,   NULL, RSRC_CONF, "call fallocate when receiving a chunk"),
+    AP_INIT_TAKE1("grid_direct_io",   dav_rawx_cmd_gridconfig_direct_io,   NULL, RSRC_CONF, "write the uncompressed chunks with O_DIRECT, out of the page cache"),
     AP_INIT_TAKE1("grid_acl",         dav_rawx_cmd_gridconfig_acl,         NULL, RSRC_CONF, "enabled acl"),
     AP_INIT_TAKE1("grid_compression", dav_rawx_cmd_gridconfig_compression, NULL, RSRC_CONF, "enable compression ('zlib' or 'lzo')'"),
     AP_INIT_TAKE1(NULL,  NULL,  NULL, RSRC_CONF, NULL)
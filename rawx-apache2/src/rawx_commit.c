@@ -0,0 +1,174 @@
+/*
+OpenIO SDS rawx-apache2
+Copyright (C) 2015 OpenIO, original work as part of OpenIO Software Defined Storage
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "rawx_commit.h"
+
+/* A directory of the batch, referenced by the batch and by each waiter */
+struct commit_dir_s
+{
+	gchar *path;
+	guint refcount;
+	int err;
+	gboolean done;
+};
+
+static GThread *th_commit = NULL;
+static volatile gboolean running = FALSE;
+static gint64 commit_window = 0;
+
+static GMutex lock;
+static GCond cond_work;
+static GCond cond_done;
+
+/* <gchar*,struct commit_dir_s*>, the batch being gathered */
+static GHashTable *pending = NULL;
+
+static int
+_fsync_dir(const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return errno;
+	int err = fsync(fd) ? errno : 0;
+	close(fd);
+	return err;
+}
+
+static void
+_dir_unref(struct commit_dir_s *d)
+{
+	if (!--d->refcount) {
+		g_free(d->path);
+		g_free(d);
+	}
+}
+
+static gpointer
+_worker(gpointer p)
+{
+	g_mutex_lock(&lock);
+	for (;;) {
+		while (running && !g_hash_table_size(pending))
+			g_cond_wait(&cond_work, &lock);
+		if (!g_hash_table_size(pending))
+			break;
+
+		/* Let the batch grow a little */
+		if (commit_window > 0) {
+			g_mutex_unlock(&lock);
+			g_usleep(commit_window);
+			g_mutex_lock(&lock);
+		}
+
+		GHashTable *batch = pending;
+		pending = g_hash_table_new(g_str_hash, g_str_equal);
+		g_mutex_unlock(&lock);
+
+		GHashTableIter it;
+		gpointer k, v;
+		g_hash_table_iter_init(&it, batch);
+		while (g_hash_table_iter_next(&it, &k, &v)) {
+			struct commit_dir_s *d = v;
+			d->err = _fsync_dir(d->path);
+		}
+
+		g_mutex_lock(&lock);
+		g_hash_table_iter_init(&it, batch);
+		while (g_hash_table_iter_next(&it, &k, &v)) {
+			struct commit_dir_s *d = v;
+			d->done = TRUE;
+			_dir_unref(d);
+		}
+		g_cond_broadcast(&cond_done);
+		g_hash_table_destroy(batch);
+	}
+	g_mutex_unlock(&lock);
+	return p;
+}
+
+GError *
+rawx_commit_init(gint64 window)
+{
+	GError *err = NULL;
+
+	g_mutex_init(&lock);
+	g_cond_init(&cond_work);
+	g_cond_init(&cond_done);
+	pending = g_hash_table_new(g_str_hash, g_str_equal);
+	commit_window = window;
+
+	running = TRUE;
+	th_commit = g_thread_try_new("oio-rawx-commit", _worker, NULL, &err);
+	if (err) {
+		running = FALSE;
+		g_prefix_error(&err, "Thread creation failed: ");
+		return err;
+	}
+	return NULL;
+}
+
+void
+rawx_commit_destroy(void)
+{
+	if (!th_commit)
+		return;
+
+	g_mutex_lock(&lock);
+	running = FALSE;
+	g_cond_signal(&cond_work);
+	g_mutex_unlock(&lock);
+
+	g_thread_join(th_commit);
+	th_commit = NULL;
+	g_hash_table_destroy(pending);
+	pending = NULL;
+}
+
+int
+rawx_commit_dir(const char *dirname)
+{
+	if (!th_commit)
+		return _fsync_dir(dirname);
+
+	g_mutex_lock(&lock);
+	if (!running) {
+		g_mutex_unlock(&lock);
+		return _fsync_dir(dirname);
+	}
+	struct commit_dir_s *d = g_hash_table_lookup(pending, dirname);
+	if (!d) {
+		d = g_malloc0(sizeof(*d));
+		d->path = g_strdup(dirname);
+		d->refcount = 1;
+		g_hash_table_insert(pending, d->path, d);
+		g_cond_signal(&cond_work);
+	}
+	d->refcount ++;
+	while (!d->done)
+		g_cond_wait(&cond_done, &lock);
+	const int err = d->err;
+	_dir_unref(d);
+	g_mutex_unlock(&lock);
+	return err;
+}
@@ -0,0 +1,47 @@
+/*
+OpenIO SDS rawx-apache2
+Copyright (C) 2015 OpenIO, original work as part of OpenIO Software Defined Storage
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OIO_SDS__rawx_apache2__src__rawx_commit_h
+# define OIO_SDS__rawx_apache2__src__rawx_commit_h 1
+
+/**
+ * Start the thread that fsyncs the directories of the chunks on behalf of
+ * all the uploads of the process. The directories asked while a batch is
+ * being synced are grouped in the next batch, each directory synced once.
+ *
+ * @window how long (in microseconds) a batch waits for more directories
+ *         before being synced, 0 to sync as soon as possible.
+ *
+ * @return NULL if OK, or a GError describing the problem
+ */
+GError* rawx_commit_init(gint64 window);
+
+/**
+ * Stop the thread, after the pending directories have been synced.
+ */
+void rawx_commit_destroy(void);
+
+/**
+ * Block until a fsync() of the directory, started after the call, is done.
+ * Without the thread, the fsync() is done by the caller.
+ *
+ * @return 0 if OK, or the errno of the failed open() or fsync()
+ */
+int rawx_commit_dir(const char *dirname);
+
+#endif /*OIO_SDS__rawx_apache2__src__rawx_commit_h*/
@@ -109,6 +109,8 @@ struct dav_rawx_server_conf_s {
 	int hash_width;
 	int fsync_on_close;
 	int fallocate;
+	int direct_io;
+	int fsync_dir_window; /* milliseconds */
 	char event_agent_addr[RAWX_EVENT_ADDR_SIZE];
 	char compression_algo[64];
 
@@ -17,6 +17,10 @@ You should have received a copy of the GNU Affero General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE /* O_DIRECT, sync_file_range() */
+#endif
+
 #undef PACKAGE_BUGREPORT
 #undef PACKAGE_NAME
 #undef PACKAGE_STRING
@@ -31,6 +35,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <mod_dav.h>
 
 #include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <metautils/lib/metautils.h>
 #include <cluster/lib/gridcluster.h>
@@ -39,10 +45,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "rawx_repo_core.h"
 #include "rawx_internals.h"
 #include "rawx_event.h"
+#include "rawx_commit.h"
 
 #define DEFAULT_BLOCK_SIZE 1048576
 #define DEFAULT_COMPRESSION_ALGO "ZLIB"
 
+/* Alignment of the buffers, offsets and sizes written with O_DIRECT. Large
+ * enough for the logical block size of any device. */
+#define DIRECT_ALIGN 4096
+
 /******************** INTERNALS METHODS **************************/
 
 static void
@@ -54,13 +65,101 @@ __set_header(request_rec *r, const char *n, const char *v)
 				apr_pstrdup(r->pool, v));
 }
 
+static int
+_stream_fileno(dav_stream *stream)
+{
+	return stream->f ? fileno(stream->f) : stream->fd;
+}
+
+static void
+_stream_close(dav_stream *stream)
+{
+	if (stream->f) {
+		fclose(stream->f);
+		stream->f = NULL;
+	} else if (stream->fd >= 0) {
+		close(stream->fd);
+		stream->fd = -1;
+	}
+}
+
+/* Writes the whole buffer at the current offset of the chunk, whatever the
+ * short writes. Out of O_DIRECT, the writeback of that block is started at once and the block
+ * before is evicted from the page cache: the chunk is cold data, and the
+ * final fsync() has little left to do. */
+static int
+_write_fd(dav_stream *stream, const guint8 *buf, apr_size_t len)
+{
+	const apr_off_t start = stream->offset;
+	while (len > 0) {
+		ssize_t w = pwrite(stream->fd, buf, len, stream->offset);
+		if (w < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (w == 0) {
+			/* Nothing written without an error, looping would not help */
+			errno = ENOSPC;
+			return -1;
+		}
+		if (stream->direct && (w % DIRECT_ALIGN)) {
+			/* The rest of the block is not aligned anymore, O_DIRECT would
+			 * refuse it: it goes through the page cache instead */
+			const int flags = fcntl(stream->fd, F_GETFL);
+			if (flags < 0 || 0 != fcntl(stream->fd, F_SETFL, flags & ~O_DIRECT))
+				return -1;
+			stream->direct = FALSE;
+		}
+		buf += w;
+		len -= w;
+		stream->offset += w;
+	}
+
+	if (!stream->direct && stream->offset > start) {
+#ifdef SYNC_FILE_RANGE_WRITE
+		sync_file_range(stream->fd, start, stream->offset - start,
+				SYNC_FILE_RANGE_WRITE);
+		if (start > stream->evicted) {
+			sync_file_range(stream->fd, stream->evicted, start - stream->evicted,
+					SYNC_FILE_RANGE_WAIT_BEFORE|SYNC_FILE_RANGE_WRITE
+					|SYNC_FILE_RANGE_WAIT_AFTER);
+			posix_fadvise(stream->fd, stream->evicted, start - stream->evicted,
+					POSIX_FADV_DONTNEED);
+			stream->evicted = start;
+		}
+#endif
+	}
+	return 0;
+}
+
+/* The tail of a chunk written with O_DIRECT is padded up to the alignment,
+ * then the file is truncated to its real size. */
+static int
+_write_fd_tail(dav_stream *stream)
+{
+	if (!stream->direct || !(stream->bufsize % DIRECT_ALIGN))
+		return _write_fd(stream, stream->buffer, stream->bufsize);
+
+	const apr_off_t size = stream->offset + stream->bufsize;
+	const apr_size_t padded = APR_ALIGN(stream->bufsize, DIRECT_ALIGN);
+	memset((guint8*)stream->buffer + stream->bufsize, 0,
+			padded - stream->bufsize);
+	if (0 != _write_fd(stream, stream->buffer, padded))
+		return -1;
+	if (0 != ftruncate(stream->fd, size))
+		return -1;
+	stream->offset = size;
+	return 0;
+}
+
 static dav_error *
 _set_chunk_extended_attributes(dav_stream *stream, struct chunk_textinfo_s *cti)
 {
 	GError *ge = NULL;
 	dav_error *e = NULL;
 
-	if (!set_rawx_info_to_fd(fileno(stream->f), &ge, cti))
+	if (!set_rawx_info_to_fd(_stream_fileno(stream), &ge, cti))
 		e = server_create_and_stat_error(resource_get_server_config(stream->r), stream->p,
 				HTTP_FORBIDDEN, 0, apr_pstrdup(stream->p, gerror_get_message(ge)));
 	if (ge) g_clear_error (&ge);
@@ -74,7 +173,7 @@ _finalize_chunk_creation(dav_stream *stream)
 	int status = 0;
 
 	/* ensure to flush the FILE * buffer in system fd */
-	if(fflush(stream->f)) {
+	if (stream->f && fflush(stream->f)) {
 		DAV_ERROR_REQ(stream->r->info->request, 0, "fflush error : %s", strerror(errno));
 		e = server_create_and_stat_error(resource_get_server_config(stream->r), stream->p,
 				HTTP_INTERNAL_SERVER_ERROR, 0,
@@ -82,7 +181,7 @@ _finalize_chunk_creation(dav_stream *stream)
 	}
 
 	if (stream->fsync_on_close & FSYNC_ON_CHUNK) {
-		if (-1 == fsync(fileno(stream->f))) {
+		if (-1 == fsync(_stream_fileno(stream))) {
 			DAV_ERROR_REQ(stream->r->info->request, 0, "fsync error : %s", strerror(errno));
 			e = server_create_and_stat_error(resource_get_server_config(stream->r), stream->p,
 					HTTP_INTERNAL_SERVER_ERROR, 0,
@@ -90,7 +189,7 @@ _finalize_chunk_creation(dav_stream *stream)
 		}
 	}
 
-	fclose(stream->f);
+	_stream_close(stream);
 
 	/* Finish: move pending file to final file */
 	status = rename(stream->pathname, stream->final_pathname);
@@ -99,18 +198,12 @@ _finalize_chunk_creation(dav_stream *stream)
 				MAP_IO2HTTP(status), 0,
 				apr_pstrcat(stream->p, "rename(",stream->pathname, ", ",stream->final_pathname, ") failure : ", strerror(errno), NULL));
 	} else if (stream->fsync_on_close & FSYNC_ON_CHUNK_DIR) {
-		/* Open directory and call fsync to ensure the rename has been done */
-		int dir = open(stream->r->info->dirname, 0);
-		if (dir != -1) {
-			status = fsync(dir);
-			if (status != 0) {
-				DAV_ERROR_REQ(stream->r->info->request, 0,
-						"fsync error : %s", strerror(errno));
-			}
-			close(dir);
-		} else {
+		/* Ensure the rename has been done, with a fsync on the directory
+		 * shared with the concurrent uploads */
+		status = rawx_commit_dir(stream->r->info->dirname);
+		if (status != 0) {
 			DAV_ERROR_REQ(stream->r->info->request, 0,
-					"could not open directory to fsync: %s", strerror(errno));
+					"directory fsync error : %s", strerror(status));
 		}
 	}
 
@@ -120,7 +213,8 @@ _finalize_chunk_creation(dav_stream *stream)
 static dav_error *
 _write_data_crumble_UNCOMP(dav_stream *stream)
 {
-	if ( 1 != fwrite(stream->buffer, stream->bufsize, 1, stream->f)) {
+	if (stream->fd >= 0 ? 0 != _write_fd_tail(stream)
+			: 1 != fwrite(stream->buffer, stream->bufsize, 1, stream->f)) {
 		/* ### use something besides 500? */
 		return server_create_and_stat_error(resource_get_server_config(stream->r), stream->p,
 				HTTP_INTERNAL_SERVER_ERROR, 0,
@@ -576,10 +670,25 @@ rawx_repo_write_last_data_crumble(dav_stream *stream)
 	return e;
 }
 
+dav_error *
+rawx_repo_write_data_crumble(dav_stream *stream)
+{
+	if (stream->fd < 0)
+		return _write_data_crumble_UNCOMP(stream);
+	if (0 != _write_fd(stream, stream->buffer, stream->bufsize)) {
+		/* ### use something besides 500? */
+		return server_create_and_stat_error(resource_get_server_config(stream->r), stream->p,
+				HTTP_INTERNAL_SERVER_ERROR, 0,
+				"An error occurred while writing to a "
+				"resource.");
+	}
+	return NULL;
+}
+
 dav_error *
 rawx_repo_rollback_upload(dav_stream *stream)
 {
-	fclose(stream->f);
+	_stream_close(stream);
 	if (remove(stream->pathname) != 0) {
 		/* ### use a better description? */
 		return server_create_and_stat_error(resource_get_server_config(stream->r), stream->p,
@@ -700,6 +809,23 @@ rawx_repo_ensure_directory(const dav_resource *resource)
 	return NULL;
 }
 
+/* Without compression, the chunk can be written with pwrite() on a plain
+ * file descriptor, with O_DIRECT if the filesystem accepts it. */
+static int
+_open_fd(dav_stream *ds)
+{
+#ifdef O_DIRECT
+	int fd = open(ds->pathname, O_WRONLY|O_CREAT|O_TRUNC|O_DIRECT, 0666);
+	if (fd >= 0) {
+		ds->direct = TRUE;
+		return fd;
+	}
+	if (errno != EINVAL)
+		return -1;
+#endif
+	return open(ds->pathname, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+}
+
 dav_error *
 rawx_repo_stream_create(const dav_resource *resource, dav_stream **result)
 {
@@ -715,16 +841,29 @@ rawx_repo_stream_create(const dav_resource *resource, dav_stream **result)
 
 	dav_stream *ds = apr_pcalloc(p, sizeof(*ds));
 	ds->fsync_on_close = conf->fsync_on_close;
+	ds->fd = -1;
 	ds->p = p;
 	ds->r = resource;
 	ds->final_pathname = apr_pstrcat(p, ctx->dirname, "/", ctx->hex_chunkid, NULL);
 	ds->pathname = apr_pstrcat(p, ctx->dirname, "/", ctx->hex_chunkid, ".pending", NULL);
 
+	if (conf->compression_algo && *conf->compression_algo) {
+		should_compress = TRUE;
+		ctx->forced_cp_algo = apr_pstrdup(p, conf->compression_algo);
+	} else if (ctx->forced_cp) {
+		should_compress = !g_ascii_strncasecmp(ctx->forced_cp, "true", 4);
+	}
+	if (should_compress && !namespace_in_compression_mode(conf->rawx_conf->ni))
+		should_compress = FALSE;
+
 	/* Create busy chunk file */
 retry:
-	ds->f = fopen(ds->pathname, "w");
+	if (!should_compress && conf->direct_io)
+		ds->fd = _open_fd(ds);
+	else
+		ds->f = fopen(ds->pathname, "w");
 
-	if (!ds->f) {
+	if (!ds->f && ds->fd < 0) {
 		if (errno == ENOENT && retryable) {
 			retryable = 0;
 			dav_error *e = rawx_repo_ensure_directory (resource);
@@ -740,26 +879,25 @@ retry:
 	apr_int64_t chunk_size = 0;
 	if (ctx->chunk.chunk_size != NULL && conf->fallocate &&
 			(chunk_size = apr_strtoi64(ctx->chunk.chunk_size, NULL, 10)) > 0 &&
-			(rv = posix_fallocate(fileno(ds->f), 0, (off_t)chunk_size)) != 0) {
+			(rv = posix_fallocate(_stream_fileno(ds), 0, (off_t)chunk_size)) != 0) {
 		dav_error *err = server_create_and_stat_error(conf, p,
 				MAP_IO2HTTP(rv), 0,
 				"An error occurred while reserving storage space.");
-		fclose(ds->f);
+		_stream_close(ds);
 		unlink(ds->pathname);
 		return err;
 	}
 
-	if (conf->compression_algo && *conf->compression_algo) {
-		should_compress = TRUE;
-		ctx->forced_cp_algo = apr_pstrdup(p, conf->compression_algo);
-	} else if (ctx->forced_cp) {
-		should_compress = !g_ascii_strncasecmp(ctx->forced_cp, "true", 4);
-	}
-
-	if (!should_compress ||
-			!namespace_in_compression_mode(conf->rawx_conf->ni)) {
+	if (!should_compress) {
 		ds->blocksize = DEFAULT_BLOCK_SIZE;
-		ds->buffer = apr_pcalloc(p, ds->blocksize);
+		if (ds->fd < 0) {
+			ds->buffer = apr_pcalloc(p, ds->blocksize);
+		} else {
+			/* reused for each block, aligned for O_DIRECT */
+			ds->buffer = apr_palloc(p, ds->blocksize + DIRECT_ALIGN);
+			ds->buffer = (void*) APR_ALIGN((apr_uintptr_t)ds->buffer,
+					DIRECT_ALIGN);
+		}
 		ds->bufsize = 0;
 	} else {
 		ds->compression = TRUE;
@@ -70,6 +70,10 @@ struct dav_stream
 	apr_pool_t *p;
 	int fsync_on_close;
 	FILE *f;
+	int fd; /* instead of 'f', -1 if not used */
+	gboolean direct : 8; /* 'fd' opened with O_DIRECT */
+	apr_off_t offset; /* written to 'fd' */
+	apr_off_t evicted; /* below, dropped from the page cache */
 	gboolean compression;
 	void *buffer;
 	apr_size_t bufsize;
@@ -111,6 +115,9 @@ dav_error * rawx_repo_check_request(request_rec *req, const char *root_dir, cons
 
 dav_error * rawx_repo_configure_hash_dir(request_rec *req, dav_resource_private *ctx);
 
+/* Writes the full buffer of an uncompressed stream */
+dav_error * rawx_repo_write_data_crumble(dav_stream *stream);
+
 dav_error * rawx_repo_write_last_data_crumble(dav_stream *stream);
 
 dav_error * rawx_repo_rollback_upload(dav_stream *stream);
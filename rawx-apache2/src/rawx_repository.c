@@ -382,14 +382,9 @@ dav_rawx_write_stream(dav_stream *stream, const void *buf, apr_size_t bufsize)
 		if (stream->blocksize - stream->bufsize <=0){
 			gsize nb_write = 0;
 			if (!stream->compression) {
-				nb_write = fwrite(stream->buffer, stream->bufsize, 1, stream->f);
-				if (nb_write != 1) {
-					/* ### use something besides 500? */
-					return server_create_and_stat_error(resource_get_server_config(stream->r), stream->p,
-							HTTP_INTERNAL_SERVER_ERROR, 0,
-							"An error occurred while writing to a "
-							"resource.");
-				}
+				dav_error *e = rawx_repo_write_data_crumble(stream);
+				if (e)
+					return e;
 			} else {
 				GByteArray *gba = g_byte_array_new();
 				if (stream->comp_ctx.data_compressor(stream->buffer, stream->bufsize, gba,
@@ -416,7 +411,8 @@ dav_rawx_write_stream(dav_stream *stream, const void *buf, apr_size_t bufsize)
 					g_byte_array_free(gba, TRUE);
 			}
 
-			stream->buffer = apr_pcalloc(stream->p, stream->blocksize);
+			if (stream->fd < 0)
+				stream->buffer = apr_pcalloc(stream->p, stream->blocksize);
 			stream->bufsize = 0;
 		}
 	}
@@ -436,7 +432,8 @@ dav_rawx_seek_stream(dav_stream *stream, apr_off_t abs_pos)
 	DAV_XDEBUG_POOL(stream->p, 0, "%s(%s)", __FUNCTION__, stream->pathname);
 	TRACE("Seek stream: START please contact CDR if you get this TRACE");
 
-	if (fseek(stream->f, abs_pos, SEEK_SET) != 0) {
+	if (stream->fd >= 0 ? abs_pos != stream->offset + (apr_off_t)stream->bufsize
+			: fseek(stream->f, abs_pos, SEEK_SET) != 0) {
 		/* ### should check whether apr_file_seek set abs_pos was set to the
 		 * correct position? */
 		/* ### use something besides 500? */
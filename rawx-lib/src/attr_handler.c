@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <errno.h>
 #include <stdio.h>
@@ -65,6 +66,192 @@ retry:
 
 /* -------------------------------------------------------------------------- */
 
+#define FIELD(N,F) {N, offsetof(struct chunk_textinfo_s, F)}
+
+static const struct {
+	const char *name;
+	size_t offset;
+} fields[] = {
+	FIELD(ATTR_NAME_CONTENT_CONTAINER, container_id),
+
+	FIELD(ATTR_NAME_CONTENT_ID,      content_id),
+	FIELD(ATTR_NAME_CONTENT_PATH,    content_path),
+	FIELD(ATTR_NAME_CONTENT_VERSION, content_version),
+	FIELD(ATTR_NAME_CONTENT_SIZE,    content_size),
+	FIELD(ATTR_NAME_CONTENT_NBCHUNK, content_chunk_nb),
+
+	FIELD(ATTR_NAME_CONTENT_STGPOL,      content_storage_policy),
+	FIELD(ATTR_NAME_CONTENT_CHUNKMETHOD, content_chunk_method),
+	FIELD(ATTR_NAME_CONTENT_MIMETYPE,    content_mime_type),
+
+	FIELD(ATTR_NAME_METACHUNK_SIZE, metachunk_size),
+	FIELD(ATTR_NAME_METACHUNK_HASH, metachunk_hash),
+
+	FIELD(ATTR_NAME_CHUNK_ID,   chunk_id),
+	FIELD(ATTR_NAME_CHUNK_SIZE, chunk_size),
+	FIELD(ATTR_NAME_CHUNK_POS,  chunk_position),
+	FIELD(ATTR_NAME_CHUNK_HASH, chunk_hash),
+
+	FIELD(ATTR_NAME_CHUNK_METADATA_COMPRESS, compression_metadata),
+	FIELD(ATTR_NAME_CHUNK_COMPRESSED_SIZE,   compression_size),
+};
+
+#define FIELD_PTR(cti,i) ((gchar**)(((guint8*)(cti)) + fields[i].offset))
+
+static int
+_field_index(const char *name)
+{
+	for (guint i=0; i<G_N_ELEMENTS(fields); ++i) {
+		if (!strcmp(name, fields[i].name))
+			return i;
+	}
+	return -1;
+}
+
+static GByteArray *
+_pack(struct chunk_textinfo_s *cti)
+{
+	GByteArray *gba = g_byte_array_sized_new(512);
+	for (guint i=0; i<G_N_ELEMENTS(fields); ++i) {
+		const gchar *v = *FIELD_PTR(cti, i);
+		if (!v)
+			continue;
+		g_byte_array_append(gba, (guint8*)fields[i].name, strlen(fields[i].name) + 1);
+		g_byte_array_append(gba, (guint8*)v, strlen(v) + 1);
+	}
+	return gba;
+}
+
+/* Fills the fields of <cti> found in the packed value, unknown names
+ * are ignored. <len> counts the trailing NUL of the last value. */
+static void
+_unpack(const gchar *buf, gsize len, struct chunk_textinfo_s *cti,
+		gboolean override)
+{
+	const gchar *end = buf + len;
+	while (buf < end) {
+		const gchar *k = buf;
+		const gchar *v = k + strnlen(k, end - k) + 1;
+		if (v >= end)
+			break;
+		buf = v + strnlen(v, end - v) + 1;
+		if (buf > end)
+			break;
+		int i = _field_index(k);
+		if (i < 0)
+			continue;
+		gchar **pv = FIELD_PTR(cti, i);
+		if (override || !*pv)
+			oio_str_replace(pv, v);
+	}
+}
+
+static gchar *
+_get_packed(int fd, const char *path, gsize *plen)
+{
+	ssize_t size;
+	ssize_t s = longest_xattr;
+	gchar *buf = g_malloc(s);
+retry:
+	size = path
+		? lgetxattr(path, ATTR_DOMAIN "." ATTR_NAME_PACKED, buf, s)
+		: fgetxattr(fd, ATTR_DOMAIN "." ATTR_NAME_PACKED, buf, s);
+	if (size >= 0) {
+		*plen = size;
+		return buf;
+	}
+	if (errno == ERANGE) {
+		s = s*2;
+		longest_xattr = 1 + MAX(longest_xattr, s);
+		buf = g_realloc(buf, s);
+		goto retry;
+	}
+
+	int errsav = errno;
+	g_free(buf);
+	errno = errsav;
+	return NULL;
+}
+
+/* Best effort: the individual attributes are the ones that must be written.
+ * When the packed value cannot be (ENOSPC, E2BIG...), the former one is
+ * removed and the readers fall back to the individual attributes. Only
+ * fails if a stale packed value remains. */
+static gboolean
+_set_packed(int fd, const char *path, struct chunk_textinfo_s *cti)
+{
+	GByteArray *gba = _pack(cti);
+	int rc = path
+		? lsetxattr(path, ATTR_DOMAIN "." ATTR_NAME_PACKED, gba->data, gba->len, 0)
+		: fsetxattr(fd, ATTR_DOMAIN "." ATTR_NAME_PACKED, gba->data, gba->len, 0);
+	int errsav = errno;
+	g_byte_array_free(gba, TRUE);
+	if (rc == 0)
+		return TRUE;
+
+	GRID_DEBUG("Packed attributes not written: (%d) %s",
+			errsav, strerror(errsav));
+	rc = path
+		? lremovexattr(path, ATTR_DOMAIN "." ATTR_NAME_PACKED)
+		: fremovexattr(fd, ATTR_DOMAIN "." ATTR_NAME_PACKED);
+	if (rc == 0 || errno == ENOATTR)
+		return TRUE;
+	errno = errsav;
+	return FALSE;
+}
+
+static gboolean _get (int fd, const char *k, gchar **pv);
+
+/* Completes <cti> with the attributes already present on the file, so that
+ * a partial update does not shrink the packed value. A file bearing neither
+ * the packed value nor the container is a fresh chunk with nothing to keep. */
+static void
+_merge_existing(int fd, struct chunk_textinfo_s *cti)
+{
+	gsize len = 0;
+	gchar *packed = _get_packed(fd, NULL, &len);
+	if (packed) {
+		_unpack(packed, len, cti, FALSE);
+		g_free(packed);
+		return;
+	}
+
+	gchar *v = NULL;
+	if (!_get(fd, ATTR_DOMAIN "." ATTR_NAME_CONTENT_CONTAINER, &v))
+		return;
+	g_free(v);
+
+	for (guint i=0; i<G_N_ELEMENTS(fields); ++i) {
+		gchar **pv = FIELD_PTR(cti, i);
+		if (*pv)
+			continue;
+		gchar *k = g_strconcat(ATTR_DOMAIN ".", fields[i].name, NULL);
+		_get(fd, k, pv);
+		g_free(k);
+	}
+}
+
+/* Keeps the packed value in sync with an attribute set alone, if there is
+ * a packed value at all. */
+static gboolean
+_patch_packed(const char *p, const char *k, const char *v)
+{
+	gsize len = 0;
+	gchar *packed = _get_packed(-1, p, &len);
+	if (!packed)
+		return errno == ENOATTR;
+
+	struct chunk_textinfo_s cti = {0};
+	_unpack(packed, len, &cti, TRUE);
+	g_free(packed);
+	oio_str_replace(FIELD_PTR(&cti, _field_index(k)), v);
+	gboolean rc = _set_packed(-1, p, &cti);
+	int errsav = errno;
+	chunk_textinfo_free_content(&cti);
+	errno = errsav;
+	return rc;
+}
+
 #define SET(K,V) if (K) { \
 	if ((V) && 0 > fsetxattr(fd, ATTR_DOMAIN "." K, V, strlen(V), 0)) \
 		goto error_set_attr; \
@@ -86,6 +273,15 @@ set_rawx_info_to_fd (int fd, GError **error, struct chunk_textinfo_s *cti)
 	oio_str_upper(cti->chunk_hash);
 	oio_str_upper(cti->metachunk_hash);
 
+	/* The per-attribute values are still written for the older readers,
+	 * the packed value then spares a call per attribute to the readers
+	 * that know it. It is completed before the individual values change,
+	 * and built on a copy to leave <cti> as the caller set it. */
+	struct chunk_textinfo_s all = {0};
+	for (guint i=0; i<G_N_ELEMENTS(fields); ++i)
+		*FIELD_PTR(&all, i) = g_strdup(*FIELD_PTR(cti, i));
+	_merge_existing(fd, &all);
+
 	SET(ATTR_NAME_CONTENT_CONTAINER, cti->container_id);
 
 	SET(ATTR_NAME_CONTENT_ID,          cti->content_id);
@@ -109,10 +305,15 @@ set_rawx_info_to_fd (int fd, GError **error, struct chunk_textinfo_s *cti)
 	SET(ATTR_NAME_CHUNK_METADATA_COMPRESS, cti->compression_metadata);
 	SET(ATTR_NAME_CHUNK_COMPRESSED_SIZE,   cti->compression_size);
 
+	if (!_set_packed(fd, NULL, &all))
+		goto error_set_attr;
+
+	chunk_textinfo_free_content(&all);
 	return TRUE;
 
 error_set_attr:
 	GSETCODE(error, errno, "setxattr error: (%d) %s", errno, strerror(errno));
+	chunk_textinfo_free_content(&all);
 	return FALSE;
 }
 
@@ -137,6 +338,8 @@ set_compression_info_in_attr(const char *p, GError ** error, const char *v)
 {
 	int rc = lsetxattr(p, ATTR_DOMAIN "." ATTR_NAME_CHUNK_METADATA_COMPRESS,
 			v, strlen(v), 0);
+	if (rc == 0 && !_patch_packed(p, ATTR_NAME_CHUNK_METADATA_COMPRESS, v))
+		rc = -1;
 	if (rc < 0)
 		GSETCODE(error, errno, "setxattr error: (%d) %s", errno, strerror(errno));
 	return rc == 0;
@@ -149,6 +352,8 @@ set_chunk_compressed_size_in_attr(const char *p, GError ** error, guint32 v)
 	g_snprintf (buf, sizeof(buf), "%"G_GUINT32_FORMAT, v);
 	int rc = lsetxattr(p, ATTR_DOMAIN ATTR_NAME_CHUNK_COMPRESSED_SIZE,
 			buf, strlen(buf), 0);
+	if (rc == 0 && !_patch_packed(p, ATTR_NAME_CHUNK_COMPRESSED_SIZE, buf))
+		rc = -1;
 	if (rc < 0)
 		GSETCODE(error, errno, "setxattr error: (%d) %s", errno, strerror(errno));
 	return rc == 0;
@@ -189,6 +394,20 @@ get_rawx_info_from_fd (int fd, GError **error, struct chunk_textinfo_s *cti)
 		return TRUE;
 	}
 
+	/* One call for all the attributes, when the chunk has been written
+	 * with the packed value */
+	gsize len = 0;
+	gchar *packed = _get_packed(fd, NULL, &len);
+	if (packed) {
+		_unpack(packed, len, cti, TRUE);
+		g_free(packed);
+		return TRUE;
+	}
+	if (errno == ENOTSUP) {
+		GSETCODE(error, errno, "xatr not supported");
+		return FALSE;
+	}
+
 	if (!GET(ATTR_NAME_CONTENT_CONTAINER, cti->container_id)) {
 		/* just one check to detect unsupported xattr */
 		if (errno == ENOTSUP) {
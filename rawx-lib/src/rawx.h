@@ -49,6 +49,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 # define ATTR_NAME_CHUNK_METADATA_COMPRESS "compression.metadata"
 # define ATTR_NAME_CHUNK_COMPRESSED_SIZE   "compression.size"
 
+/* All the attributes above in a single value, as a sequence of
+ * NUL-terminated names and values. Read in one call when present, and then
+ * authoritative, for the rawx as for the python tools: the attributes of a
+ * chunk are changed through set_rawx_info_to_file() or, in python, through
+ * write_packed_user_xattr(). */
+# define ATTR_NAME_PACKED "packed"
+
 #define NS_RAWX_BUFSIZE_OPTION "rawx_bufsize"
 
 #define NS_COMPRESSION_OPTION "compression"
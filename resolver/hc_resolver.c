@@ -87,6 +87,120 @@ hc_resolver_element_create (const char * const *value)
 	return elt;
 }
 
+/* Admission --------------------------------------------------------------- */
+
+#define SKETCH_MASK (HC_RESOLVER_SKETCH_WIDTH - 1)
+
+static void
+_sketch_index(const struct hashstr_s *k, guint *idx)
+{
+	guint h = hashstr_hash(k);
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+	const guint h2 = (h * 0x9E3779B1) | 1;
+	for (guint i=0; i<HC_RESOLVER_SKETCH_DEPTH ;++i)
+		idx[i] = (h + i * h2) & SKETCH_MASK;
+}
+
+static guint
+_sketch_counter(struct hc_sketch_s *sk, guint row, guint i)
+{
+	const guint c = row * HC_RESOLVER_SKETCH_WIDTH + i;
+	const guint w = g_atomic_int_get(sk->counters + (c >> 3));
+	return (w >> ((c & 7) * 4)) & 0x0F;
+}
+
+static void
+_sketch_increment(struct hc_sketch_s *sk, guint row, guint i)
+{
+	const guint c = row * HC_RESOLVER_SKETCH_WIDTH + i;
+	volatile gint *pw = sk->counters + (c >> 3);
+	const guint shift = (c & 7) * 4;
+	for (;;) {
+		const guint w = g_atomic_int_get(pw);
+		if (((w >> shift) & 0x0F) == 0x0F)
+			return;
+		if (g_atomic_int_compare_and_exchange(pw, w, w + (1u << shift)))
+			return;
+	}
+}
+
+static gboolean
+_sketch_doorkeeper(struct hc_sketch_s *sk, const guint *idx, gboolean set)
+{
+	gboolean known = TRUE;
+	for (guint i=0; i<2 ;++i) {
+		volatile gint *pw = sk->doorkeeper + (idx[i] >> 5);
+		const guint bit = 1u << (idx[i] & 31);
+		const guint w = set ? g_atomic_int_or((volatile guint*)pw, bit)
+			: (guint) g_atomic_int_get(pw);
+		known = known && (w & bit);
+	}
+	return known;
+}
+
+/* Halves all the counters and forgets the keys seen once. The increments
+ * racing with the reset may be lost, the sketch is an estimation anyway. */
+static void
+_sketch_age(struct hc_sketch_s *sk)
+{
+	for (guint i=0; i<G_N_ELEMENTS(sk->counters) ;++i) {
+		const guint w = g_atomic_int_get(sk->counters + i);
+		g_atomic_int_set(sk->counters + i, (w >> 1) & 0x77777777);
+	}
+	for (guint i=0; i<G_N_ELEMENTS(sk->doorkeeper) ;++i)
+		g_atomic_int_set(sk->doorkeeper + i, 0);
+}
+
+static void
+_sketch_record(struct hc_sketch_s *sk, const struct hashstr_s *k, guint max)
+{
+	guint idx[HC_RESOLVER_SKETCH_DEPTH];
+	_sketch_index(k, idx);
+
+	/* The first occurence only reaches the doorkeeper */
+	if (_sketch_doorkeeper(sk, idx, TRUE)) {
+		for (guint i=0; i<HC_RESOLVER_SKETCH_DEPTH ;++i)
+			_sketch_increment(sk, i, idx[i]);
+	}
+
+	const gint limit = 10 * MIN(max, (guint)(G_MAXINT / 10));
+	const gint n = g_atomic_int_add(&sk->samples, 1) + 1;
+	if (n >= limit && g_atomic_int_compare_and_exchange(&sk->samples, n, 0))
+		_sketch_age(sk);
+}
+
+static guint
+_sketch_estimate(struct hc_sketch_s *sk, const struct hashstr_s *k)
+{
+	guint idx[HC_RESOLVER_SKETCH_DEPTH];
+	_sketch_index(k, idx);
+
+	guint freq = 0x0F;
+	for (guint i=0; i<HC_RESOLVER_SKETCH_DEPTH ;++i)
+		freq = MIN(freq, _sketch_counter(sk, i, idx[i]));
+	if (_sketch_doorkeeper(sk, idx, FALSE))
+		++ freq;
+	return freq;
+}
+
+/* TinyLFU: the candidate takes the room only if it has been asked more
+ * often than the victim, so that a scan cannot flush the popular entries. */
+static gboolean
+_sketch_admit(gconstpointer candidate, gconstpointer victim, gpointer udata)
+{
+	struct hc_sketch_s *sk = udata;
+	return _sketch_estimate(sk, candidate) > _sketch_estimate(sk, victim);
+}
+
+static gboolean
+_LRU_admission(struct hc_resolver_s *r, struct lru_ext_s *l)
+{
+	return l->max > 0
+		&& !(r->flags & (HC_RESOLVER_NOCACHE|HC_RESOLVER_NOADMIT));
+}
+
 /* Public API -------------------------------------------------------------- */
 
 struct hc_resolver_s*
@@ -96,15 +210,16 @@ hc_resolver_create(void)
 
 	resolver->csm0.max = HC_RESOLVER_DEFAULT_MAX_CSM0;
 	resolver->csm0.ttl = HC_RESOLVER_DEFAULT_TTL_CSM0;
-	resolver->csm0.cache = lru_tree_create((GCompareFunc)hashstr_quick_cmp,
-			g_free, g_free, 0);
+	resolver->csm0.cache = lru_striped_create((GHashFunc)hashstr_hash,
+			(GEqualFunc)hashstr_equal, g_free, g_free, 0, 0);
+	resolver->csm0.sketch = g_malloc0(sizeof(struct hc_sketch_s));
 
 	resolver->services.max = HC_RESOLVER_DEFAULT_MAX_SERVICES;
 	resolver->services.ttl = HC_RESOLVER_DEFAULT_TTL_SERVICES;
-	resolver->services.cache = lru_tree_create((GCompareFunc)hashstr_quick_cmp,
-			g_free, g_free, 0);
+	resolver->services.cache = lru_striped_create((GHashFunc)hashstr_hash,
+			(GEqualFunc)hashstr_equal, g_free, g_free, 0, 0);
+	resolver->services.sketch = g_malloc0(sizeof(struct hc_sketch_s));
 
-	g_mutex_init(&resolver->lock);
 	return resolver;
 }
 
@@ -139,31 +254,32 @@ hc_resolver_destroy(struct hc_resolver_s *r)
 	if (!r)
 		return;
 	if (r->csm0.cache)
-		lru_tree_destroy(r->csm0.cache);
+		lru_striped_destroy(r->csm0.cache);
 	if (r->services.cache)
-		lru_tree_destroy(r->services.cache);
-	g_mutex_clear(&r->lock);
+		lru_striped_destroy(r->services.cache);
+	g_free(r->csm0.sketch);
+	g_free(r->services.sketch);
 	g_free(r);
 }
 
 static gchar **
-hc_resolver_get_cached(struct hc_resolver_s *r, struct lru_tree_s *lru,
+hc_resolver_get_cached(struct hc_resolver_s *r, struct lru_ext_s *l,
 		const struct hashstr_s *k)
 {
-	gchar **result = NULL;
-	struct cached_element_s *elt;
-
-	g_mutex_lock(&r->lock);
-	if (NULL != (elt = lru_tree_get(lru, k)))
-		result = hc_resolver_element_extract(elt);
-	g_mutex_unlock(&r->lock);
-
+	gchar **result = lru_striped_get(l->cache, k,
+			(GBoxedCopyFunc) hc_resolver_element_extract);
+	if (result)
+		g_atomic_pointer_add(&l->hits, 1);
+	else
+		g_atomic_pointer_add(&l->misses, 1);
+	if (_LRU_admission(r, l))
+		_sketch_record(l->sketch, k, l->max);
 	return result;
 }
 
 static void
-hc_resolver_store(struct hc_resolver_s *r, struct lru_tree_s *lru,
-		const struct hashstr_s *key, const char * const *v)
+hc_resolver_store(struct hc_resolver_s *r, struct lru_ext_s *l,
+		const struct hashstr_s *key, const char * const *v, gboolean admit)
 {
 	if (!v || !*v)
 		return;
@@ -173,20 +289,20 @@ hc_resolver_store(struct hc_resolver_s *r, struct lru_tree_s *lru,
 	struct cached_element_s *elt = hc_resolver_element_create(v);
 	struct hashstr_s *k = hashstr_dup(key);
 
-	g_mutex_lock(&r->lock);
-	lru_tree_insert(lru, k, elt);
-	g_mutex_unlock(&r->lock);
+	if (!admit || !_LRU_admission(r, l))
+		lru_striped_insert(l->cache, k, elt);
+	else if (!lru_striped_admit(l->cache, k, elt, l->max,
+				_sketch_admit, l->sketch))
+		g_atomic_pointer_add(&l->rejected, 1);
 }
 
 static void
-hc_resolver_forget(struct hc_resolver_s *r, struct lru_tree_s *lru,
+hc_resolver_forget(struct hc_resolver_s *r, struct lru_ext_s *l,
 		const struct hashstr_s *k)
 {
-	if (lru) {
-		g_mutex_lock(&r->lock);
-		lru_tree_remove(lru, k);
-		g_mutex_unlock(&r->lock);
-	}
+	(void) r;
+	if (l->cache)
+		lru_striped_remove(l->cache, k);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -238,7 +354,7 @@ _resolve_meta0(struct hc_resolver_s *r, const char *ns, gchar ***result)
 	hk = _m0_key(ns);
 
 	/* Try to hit the cache */
-	if (!(*result = hc_resolver_get_cached(r, r->csm0.cache, hk))) {
+	if (!(*result = hc_resolver_get_cached(r, &r->csm0, hk))) {
 		GSList *allm0;
 
 		/* Now attempt a real resolution */
@@ -255,8 +371,8 @@ _resolve_meta0(struct hc_resolver_s *r, const char *ns, gchar ***result)
 			allm0 = NULL;
 
 			/* then fill the cache */
-			hc_resolver_store(r, r->csm0.cache, hk,
-					(const char * const *) *result);
+			hc_resolver_store(r, &r->csm0, hk,
+					(const char * const *) *result, TRUE);
 			err = NULL;
 		}
 	}
@@ -351,7 +467,7 @@ _resolve_meta1(struct hc_resolver_s *r, struct oio_url_s *u, gchar ***result)
 	hk = _m1_key (u);
 
 	/* Try to hit the cache */
-	if (!(*result = hc_resolver_get_cached(r, r->csm0.cache, hk))) {
+	if (!(*result = hc_resolver_get_cached(r, &r->csm0, hk))) {
 		/* get a meta0, then store it in the cache */
 		gchar **m0urlv = NULL;
 
@@ -362,8 +478,8 @@ _resolve_meta1(struct hc_resolver_s *r, struct oio_url_s *u, gchar ***result)
 			err = _resolve_m1_through_many_m0(r, (const char * const *)m0urlv,
 					oio_url_get_id(u), result);
 			if (!err)
-				hc_resolver_store(r, r->csm0.cache, hk,
-						(const char * const *) *result);
+				hc_resolver_store(r, &r->csm0, hk,
+						(const char * const *) *result, TRUE);
 			g_strfreev(m0urlv);
 		}
 	}
@@ -425,7 +541,7 @@ _resolve_reference_service(struct hc_resolver_s *r, struct hashstr_s *hk,
 			oio_url_get(u, OIOURL_WHOLE), s);
 
 	/* Try to hit the cache for the service itself */
-	*result = hc_resolver_get_cached(r, r->services.cache, hk);
+	*result = hc_resolver_get_cached(r, &r->services, hk);
 	if (NULL != *result) {
 		return NULL;
 	}
@@ -441,8 +557,8 @@ _resolve_reference_service(struct hc_resolver_s *r, struct hashstr_s *hk,
 	EXTRA_ASSERT((err!=NULL) ^ (*result!=NULL));
 	if (!err) {
 		/* fill the cache */
-		hc_resolver_store(r, r->services.cache, hk,
-				(const char * const *) *result);
+		hc_resolver_store(r, &r->services, hk,
+				(const char * const *) *result, TRUE);
 	}
 
 	g_strfreev(m1urlv);
@@ -524,12 +640,12 @@ hc_decache_reference(struct hc_resolver_s *r, struct oio_url_s *url)
 
 	if (r->flags & HC_RESOLVER_DECACHEM0) {
 		hk = _m0_key (oio_url_get(url, OIOURL_NS));
-		hc_resolver_forget(r, r->csm0.cache, hk);
+		hc_resolver_forget(r, &r->csm0, hk);
 		g_free(hk);
 	}
 
 	hk = _m1_key (url);
-	hc_resolver_forget(r, r->csm0.cache, hk);
+	hc_resolver_forget(r, &r->csm0, hk);
 	g_free(hk);
 }
 
@@ -548,7 +664,7 @@ hc_decache_reference_service(struct hc_resolver_s *r, struct oio_url_s *url,
 		return;
 
 	hk = _srv_key (srvtype, url);
-	hc_resolver_forget(r, r->services.cache, hk);
+	hc_resolver_forget(r, &r->services, hk);
 	g_free(hk);
 }
 
@@ -558,10 +674,8 @@ _LRU_expire(struct hc_resolver_s *r, struct lru_ext_s *l)
 	EXTRA_ASSERT(r != NULL);
 	guint count = 0;
 	const gint64 now = oio_ext_monotonic_time();
-	g_mutex_lock(&r->lock);
 	if (l->ttl > 0 && l->cache != NULL)
-		count = lru_tree_remove_older(l->cache, OLDEST(now, l->ttl));
-	g_mutex_unlock(&r->lock);
+		count = lru_striped_remove_older(l->cache, OLDEST(now, l->ttl));
 	return count;
 }
 
@@ -584,18 +698,18 @@ hc_resolver_tell (struct hc_resolver_s *r, struct oio_url_s *url,
 	if (r->flags & HC_RESOLVER_NOCACHE)
 		return;
 
+	/* Told by the service that just linked it: it will be asked soon, the
+	 * admission would reject it as never seen. The purge bounds the cache. */
 	struct hashstr_s *hk = _srv_key (srvtype, url);
-	hc_resolver_store (r, r->services.cache, hk, urlv);
+	hc_resolver_store (r, &r->services, hk, urlv, FALSE);
 	g_free (hk);
 }
 
 static guint
 _LRU_purge(struct hc_resolver_s *r, struct lru_ext_s *l)
 {
-	g_mutex_lock(&r->lock);
-	guint count = lru_tree_remove_exceeding (l->cache, l->max);
-	g_mutex_unlock(&r->lock);
-	return count;
+	(void) r;
+	return lru_striped_remove_exceeding (l->cache, l->max);
 }
 
 guint
@@ -606,28 +720,24 @@ hc_resolver_purge(struct hc_resolver_s *r)
 }
 
 static void
-_lru_flush(struct lru_tree_s *lru)
+_lru_flush(struct lru_striped_s *lru)
 {
 	if (!lru) return;
-	lru_tree_remove_exceeding (lru, 0);
+	lru_striped_remove_exceeding (lru, 0);
 }
 
 void
 hc_resolver_flush_csm0(struct hc_resolver_s *r)
 {
 	EXTRA_ASSERT(r != NULL);
-	g_mutex_lock(&r->lock);
 	_lru_flush(r->csm0.cache);
-	g_mutex_unlock(&r->lock);
 }
 
 void
 hc_resolver_flush_services(struct hc_resolver_s *r)
 {
 	EXTRA_ASSERT(r != NULL);
-	g_mutex_lock(&r->lock);
 	_lru_flush(r->services.cache);
-	g_mutex_unlock(&r->lock);
 }
 
 static void
@@ -669,13 +779,17 @@ hc_resolver_info(struct hc_resolver_s *r, struct hc_resolver_stats_s *s)
 {
 	EXTRA_ASSERT(s != NULL);
 	EXTRA_ASSERT(r != NULL);
-	g_mutex_lock(&r->lock);
 	s->csm0.max = r->csm0.max;
 	s->csm0.ttl = r->csm0.ttl / G_TIME_SPAN_SECOND;
-	s->csm0.count = lru_tree_count(r->csm0.cache);
+	s->csm0.count = lru_striped_count(r->csm0.cache);
+	s->csm0.hits = (gsize) g_atomic_pointer_get(&r->csm0.hits);
+	s->csm0.misses = (gsize) g_atomic_pointer_get(&r->csm0.misses);
+	s->csm0.rejected = (gsize) g_atomic_pointer_get(&r->csm0.rejected);
 	s->services.max = r->services.max;
 	s->services.ttl = r->services.ttl / G_TIME_SPAN_SECOND;
-	s->services.count = lru_tree_count(r->services.cache);
-	g_mutex_unlock(&r->lock);
+	s->services.count = lru_striped_count(r->services.cache);
+	s->services.hits = (gsize) g_atomic_pointer_get(&r->services.hits);
+	s->services.misses = (gsize) g_atomic_pointer_get(&r->services.misses);
+	s->services.rejected = (gsize) g_atomic_pointer_get(&r->services.rejected);
 }
 
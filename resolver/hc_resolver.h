@@ -28,6 +28,9 @@ enum hc_resolver_flags_e
 	HC_RESOLVER_NOATIME = 0x02,
 	HC_RESOLVER_NOMAX =   0x04,
 	HC_RESOLVER_DECACHEM0 = 0x08,
+	/* When a cache is full, store new entries without comparing their
+	 * recent frequency to the one of the entry to be evicted. */
+	HC_RESOLVER_NOADMIT = 0x10,
 };
 
 /** timeout (in seconds) for requests to meta0 services.
@@ -79,6 +82,7 @@ void hc_resolver_set_ttl_csm0(struct hc_resolver_s *r, gint64 d);
 /* Applies time-based cache policies. */
 guint hc_resolver_expire(struct hc_resolver_s *r);
 
+/* Caches the services just linked to <u>, bypassing the admission. */
 void hc_resolver_tell (struct hc_resolver_s *r, struct oio_url_s *u,
 		const char *srvtype, const char * const *urlv);
 
@@ -117,12 +121,18 @@ struct hc_resolver_stats_s
 		gint64 count;
 		guint max;
 		time_t ttl;
+		guint64 hits;
+		guint64 misses;
+		guint64 rejected;
 	} csm0;
 
 	struct {
 		gint64 count;
 		guint max;
 		time_t ttl;
+		guint64 hits;
+		guint64 misses;
+		guint64 rejected;
 	} services;
 };
 
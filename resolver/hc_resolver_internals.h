@@ -40,7 +40,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 # define HC_RESOLVER_DEFAULT_TTL_CSM0 0
 #endif
 
-struct lru_tree_s;
+// Counters per row of the frequency sketch, a power of 2
+#ifndef  HC_RESOLVER_SKETCH_WIDTH
+# define HC_RESOLVER_SKETCH_WIDTH 262144
+#endif
+
+#ifndef  HC_RESOLVER_SKETCH_DEPTH
+# define HC_RESOLVER_SKETCH_DEPTH 4
+#endif
+
+struct lru_striped_s;
+
+/* Count-min sketch of the recent lookups, with 4-bit counters packed 8 per
+ * word, behind a doorkeeper bitset that absorbs the keys seen only once.
+ * All the counters are halved (and the doorkeeper cleared) after a sample
+ * of 10 lookups per cached entry, so that the past popularity fades. */
+struct hc_sketch_s
+{
+	volatile gint counters[HC_RESOLVER_SKETCH_DEPTH * HC_RESOLVER_SKETCH_WIDTH / 8];
+	volatile gint doorkeeper[HC_RESOLVER_SKETCH_WIDTH / 32];
+	volatile gint samples;
+};
 
 struct cached_element_s
 {
@@ -50,14 +70,18 @@ struct cached_element_s
 
 struct lru_ext_s
 {
-	struct lru_tree_s *cache;
+	struct lru_striped_s *cache;
+	struct hc_sketch_s *sketch;
 	gint64 ttl;
 	guint max;
+
+	volatile gsize hits;
+	volatile gsize misses;
+	volatile gsize rejected;
 };
 
 struct hc_resolver_s
 {
-	GMutex lock;
 	struct lru_ext_s services;
 	struct lru_ext_s csm0;
 	enum hc_resolver_flags_e flags;
@@ -47,6 +47,15 @@ struct endpoint_s
 	gchar url[1];
 };
 
+/* Aligned on a cache line, so that the threads writing in two shards do
+ * not share any line. */
+struct server_stat_shard_s
+{
+	guint64 values[SERVER_STATS_MAX];
+} __attribute__ ((aligned (64)));
+
+struct grid_rrd_histogram_s;
+
 struct network_server_s
 {
 	struct endpoint_s **endpointv;
@@ -54,13 +63,18 @@ struct network_server_s
 	struct network_client_s *first;
 
 	GThread *thread_events;
-	GThreadPool *pool_stats;
 	GThreadPool *pool_workers;
 
 	GAsyncQueue *queue_monitor; /* from the workers to the events_thread */
 
+	/* The names of the stats are registered once in an open-addressing
+	 * table read without lock. Their values are spread over shards, each
+	 * thread incrementing the shard it has been assigned. */
 	GMutex lock_stats;
-	GArray *stats; /* <struct server_stat_s> */
+	volatile GQuark *stats_keys; /* [SERVER_STATS_MAX] */
+	struct server_stat_shard_s *stats_shards; /* [SERVER_STATS_SHARDS] */
+	struct grid_rrd_histogram_s * volatile *stats_latency; /* [SERVER_STATS_MAX] */
+	volatile gint stats_overflow; /* set once a stat did not fit */
 
 	GMutex lock_threads;
 
@@ -77,6 +91,13 @@ struct network_server_s
 	gint64 atexit_max_open_never_input; /*< max delay for cnx without any input.*/
 	gint64 atexit_max_idle; /*< max idle time since last input */
 	gint64 atexit_max_open_persist; /*< max total time for persistant cnx*/
+	gint64 atexit_max_suspended; /*< max time for a cnx to be resumed */
+
+	/* The suspended clients released by their worker, linked with their
+	 * prev/next fields, the longest suspended first. */
+	GMutex lock_parked;
+	struct network_client_s *parked_first;
+	struct network_client_s *parked_last;
 
 	GQuark gq_gauge_threads;
 	GQuark gq_gauge_cnx_current;
@@ -84,6 +105,8 @@ struct network_server_s
 	GQuark gq_gauge_cnx_maxsys;
 	GQuark gq_counter_cnx_accept;
 	GQuark gq_counter_cnx_close;
+	GQuark gq_counter_buf_alloc;
+	GQuark gq_counter_buf_reuse;
 
 	int wakeup[2];
 	int epollfd;
@@ -97,6 +120,19 @@ enum
 	NETCLIENT_OUT_CLOSED        = 0x0002,
 	NETCLIENT_OUT_CLOSE_PENDING = 0x0004,
 	NETCLIENT_IN_PAUSED         = 0x0008,
+	NETCLIENT_RESUMED           = 0x0010,
+	/* the output is held while a worker manages the input */
+	NETCLIENT_OUT_CORKED        = 0x0020,
+};
+
+/* Values of network_client_s.suspension */
+enum
+{
+	SUSPENSION_NONE = 0,
+	SUSPENSION_ASKED,   /* suspended, still held by the worker */
+	SUSPENSION_PARKED,  /* suspended, released by the worker */
+	SUSPENSION_RESUMED, /* resumed before the worker released it */
+	SUSPENSION_EXPIRED, /* parked for too long, its connection closed */
 };
 
 #endif /*OIO_SDS__server__internals_h*/
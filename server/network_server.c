@@ -26,6 +26,7 @@ License along with this library.
 #include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -76,11 +77,15 @@ static void _client_remove_from_monitored(struct network_server_s *srv,
 static void _client_add_to_monitored(struct network_server_s *srv,
 		struct network_client_s *clt);
 
+static void _client_unpark(struct network_server_s *srv,
+		struct network_client_s *clt);
+
+static gboolean _client_park(struct network_server_s *srv,
+		struct network_client_s *clt);
+
 static void _cb_worker(struct network_client_s *clt,
 		struct network_server_s *srv);
 
-static void _cb_stats(struct server_stat_msg_s *msg,
-		struct network_server_s *srv);
 
 /* Returns the number of max file descriptors for this process */
 static guint _server_get_maxfd(void);
@@ -105,6 +110,8 @@ _client_has_pending_output(struct network_client_s *client)
 static gboolean
 _client_send_pending_output(struct network_client_s *client)
 {
+	/* Whatever has been held is now flushed with the rest */
+	client->corked = 0;
 	return data_slab_sequence_send(&(client->output), client->fd);
 }
 
@@ -147,15 +154,87 @@ _server_stat_cmp (const struct server_stat_s *st0,
 	return CMP(st0->which,st1->which);
 }
 
-static guint64 *
-_stat_locate (struct network_server_s *srv, GQuark which)
+/* Returns the position of <which> in the table of the stats, or -1 if
+ * it is not present and <create> is FALSE, or if the table is full. */
+static gint
+_stat_locate (struct network_server_s *srv, GQuark which, gboolean create)
+{
+	const guint mask = SERVER_STATS_MAX - 1;
+	guint pos = (which * 2654435761u) & mask;
+	for (guint i=0; i<SERVER_STATS_MAX ;++i, pos=(pos+1)&mask) {
+		GQuark k = srv->stats_keys[pos];
+		if (k == which)
+			return pos;
+		if (k)
+			continue;
+		if (!create)
+			return -1;
+		/* The set of stats should be stable, and populated once at the
+		 * process startup, so that the lock is rarely taken. */
+		g_mutex_lock (&srv->lock_stats);
+		if (!(k = srv->stats_keys[pos]))
+			srv->stats_keys[pos] = k = which;
+		g_mutex_unlock (&srv->lock_stats);
+		if (k == which)
+			return pos;
+	}
+	if (!create)
+		return -1;
+	/* Once for the whole life of the server: the stats are pushed at each
+	 * request, and the same names would be reported again and again */
+	if (g_atomic_int_compare_and_exchange (&srv->stats_overflow, 0, 1))
+		GRID_WARN("Too many stats (%d), [%s] and the next ones ignored",
+				SERVER_STATS_MAX, g_quark_to_string (which));
+	else
+		GRID_DEBUG("Too many stats, [%s] ignored", g_quark_to_string (which));
+	return -1;
+}
+
+static struct server_stat_shard_s *
+_stat_local_shard (struct network_server_s *srv)
+{
+	static volatile guint seq = 0;
+	static GPrivate local_index = G_PRIVATE_INIT(NULL);
+
+	guint idx = GPOINTER_TO_UINT (g_private_get (&local_index));
+	if (!idx) {
+		idx = 1 + __sync_fetch_and_add (&seq, 1);
+		g_private_set (&local_index, GUINT_TO_POINTER(idx));
+	}
+	return srv->stats_shards + ((idx - 1) % SERVER_STATS_SHARDS);
+}
+
+static void
+_stat_push (struct network_server_s *srv, gboolean increment,
+		GQuark which, guint64 value)
 {
-	struct server_stat_s key = {.which=which, .value=0};
-	struct server_stat_s *p = (struct server_stat_s*) bsearch (&key,
-			srv->stats->data, srv->stats->len, sizeof(key),
-			(GCompareFunc)_server_stat_cmp);
-	g_assert (p == NULL || p->which == which);
-	return p ? &(p->value) : NULL;
+	if (!which)
+		return;
+	const gint pos = _stat_locate (srv, which, TRUE);
+	if (pos < 0)
+		return;
+
+	if (increment) {
+		/* Atomic because of the threads sharing a shard, but uncontended
+		 * most of the time */
+		guint64 *p = &(_stat_local_shard (srv)->values[pos]);
+		__sync_fetch_and_add (p, value);
+	} else {
+		/* Concurrent increments of the same stat may be lost */
+		for (guint i=0; i<SERVER_STATS_SHARDS ;++i) {
+			guint64 *p = &(srv->stats_shards[i].values[pos]);
+			__sync_lock_test_and_set (p, i ? 0 : value);
+		}
+	}
+}
+
+static guint64
+_stat_sum (struct network_server_s *srv, gint pos)
+{
+	guint64 total = 0;
+	for (guint i=0; i<SERVER_STATS_SHARDS ;++i)
+		total += ((volatile guint64*)(srv->stats_shards[i].values))[pos];
+	return total;
 }
 
 /* Public API --------------------------------------------------------------- */
@@ -173,23 +252,18 @@ network_server_stat_push4 (struct network_server_s *srv, gboolean increment,
 		GQuark k3, guint64 v3, GQuark k4, guint64 v4)
 {
 	EXTRA_ASSERT (srv != NULL);
-	struct server_stat_msg_s *m = SLICE_NEW0 (struct server_stat_msg_s);
-	m->which[0] = k1, m->which[1] = k2, m->which[2] = k3, m->which[3] = k4;
-	m->value[0] = v1, m->value[1] = v2, m->value[2] = v3, m->value[3] = v4;
-	m->increment = BOOL(increment);
-	g_thread_pool_push (srv->pool_stats, m, NULL);
+	_stat_push (srv, increment, k1, v1);
+	_stat_push (srv, increment, k2, v2);
+	_stat_push (srv, increment, k3, v3);
+	_stat_push (srv, increment, k4, v4);
 }
 
 guint64
 network_server_stat_getone (struct network_server_s *srv, GQuark which)
 {
 	EXTRA_ASSERT (srv != NULL);
-	guint64 *p, value = 0;
-	g_mutex_lock (&srv->lock_stats);
-	if (NULL != (p = _stat_locate (srv, which)))
-		value = *p;
-	g_mutex_unlock (&srv->lock_stats);
-	return value;
+	const gint pos = _stat_locate (srv, which, FALSE);
+	return pos < 0 ? 0 : _stat_sum (srv, pos);
 }
 
 GArray*
@@ -197,12 +271,50 @@ network_server_stat_getall (struct network_server_s *srv)
 {
 	EXTRA_ASSERT (srv != NULL);
 	GArray *out = g_array_new (FALSE, TRUE, sizeof(struct server_stat_s));
-	g_mutex_lock (&srv->lock_stats);
-	g_array_append_vals (out, srv->stats->data, srv->stats->len);
-	g_mutex_unlock (&srv->lock_stats);
+	for (guint pos=0; pos<SERVER_STATS_MAX ;++pos) {
+		const GQuark which = srv->stats_keys[pos];
+		if (!which)
+			continue;
+		struct server_stat_s st = {.value=_stat_sum (srv, pos), .which=which};
+		g_array_append_vals (out, &st, 1);
+	}
+	g_array_sort (out, (GCompareFunc)_server_stat_cmp);
 	return out;
 }
 
+void
+network_server_stat_latency (struct network_server_s *srv,
+		GQuark which, guint64 v)
+{
+	EXTRA_ASSERT (srv != NULL);
+	const gint pos = _stat_locate (srv, which, TRUE);
+	if (pos < 0)
+		return;
+
+	struct grid_rrd_histogram_s *rh = srv->stats_latency[pos];
+	if (!rh) {
+		g_mutex_lock (&srv->lock_stats);
+		if (!(rh = srv->stats_latency[pos]))
+			srv->stats_latency[pos] = rh = grid_rrd_histogram_create (
+					SERVER_STATS_LATENCY_SLOTS, SERVER_STATS_LATENCY_WIDTH);
+		g_mutex_unlock (&srv->lock_stats);
+	}
+	grid_rrd_histogram_add (rh, oio_ext_monotonic_seconds (), v);
+}
+
+gboolean
+network_server_stat_get_latency (struct network_server_s *srv,
+		GQuark which, struct grid_histogram_s *out)
+{
+	EXTRA_ASSERT (srv != NULL);
+	const gint pos = _stat_locate (srv, which, FALSE);
+	struct grid_rrd_histogram_s *rh = pos < 0 ? NULL : srv->stats_latency[pos];
+	if (!rh)
+		return FALSE;
+	grid_rrd_histogram_get (rh, oio_ext_monotonic_seconds (), out);
+	return TRUE;
+}
+
 struct network_server_s *
 network_server_init(void)
 {
@@ -221,12 +333,20 @@ network_server_init(void)
 	result->flag_continue = ~0;
 
 	g_mutex_init(&result->lock_stats);
-	result->stats = g_array_new (FALSE, TRUE, sizeof(struct server_stat_s));
+	result->stats_keys = g_malloc0 (SERVER_STATS_MAX * sizeof(GQuark));
+	result->stats_latency = g_malloc0 (SERVER_STATS_MAX * sizeof(gpointer));
+	void *shards = NULL;
+	if (0 != posix_memalign (&shards, sizeof(struct server_stat_shard_s),
+				SERVER_STATS_SHARDS * sizeof(struct server_stat_shard_s)))
+		g_error ("Memory allocation failure for the stats");
+	memset (shards, 0, SERVER_STATS_SHARDS * sizeof(struct server_stat_shard_s));
+	result->stats_shards = shards;
 
 	result->queue_monitor = g_async_queue_new();
 
 	result->endpointv = g_malloc0(sizeof(struct endpoint_s*));
 	g_mutex_init(&result->lock_threads);
+	g_mutex_init(&result->lock_parked);
 
 	result->cnx_max_sys = maxfd;
 	result->cnx_max = (result->cnx_max_sys * 99) / 100;
@@ -237,6 +357,7 @@ network_server_init(void)
 	result->atexit_max_open_never_input = SERVER_DEFAULT_CNX_INACTIVE;
 	result->atexit_max_idle = SERVER_DEFAULT_CNX_IDLE;
 	result->atexit_max_open_persist = SERVER_DEFAULT_CNX_LIFETIME;
+	result->atexit_max_suspended = SERVER_DEFAULT_CNX_SUSPENDED;
 
 	result->gq_gauge_threads =      g_quark_from_static_string ("gauge thread.active");
 	result->gq_gauge_cnx_current =  g_quark_from_static_string ("gauge cnx.client");
@@ -244,9 +365,9 @@ network_server_init(void)
 	result->gq_gauge_cnx_maxsys =   g_quark_from_static_string ("gauge cnx.max_sys");
 	result->gq_counter_cnx_accept = g_quark_from_static_string ("counter cnx.accept");
 	result->gq_counter_cnx_close =  g_quark_from_static_string ("counter cnx.close");
+	result->gq_counter_buf_alloc =  g_quark_from_static_string ("counter buf.alloc");
+	result->gq_counter_buf_reuse =  g_quark_from_static_string ("counter buf.reuse");
 
-	result->pool_stats =
-		g_thread_pool_new ((GFunc)_cb_stats, result, 1, TRUE, NULL);
 	result->pool_workers = g_thread_pool_new ((GFunc)_cb_worker, result,
 			SERVER_DEFAULT_THP_MAXWORKERS, FALSE, NULL);
 	g_thread_pool_set_max_unused_threads (SERVER_DEFAULT_THP_MAXUNUSED);
@@ -263,10 +384,6 @@ _stop_pools (struct network_server_s *srv)
 {
 	g_thread_pool_stop_unused_threads ();
 
-	if (srv->pool_stats) {
-		g_thread_pool_free (srv->pool_stats, FALSE, TRUE);
-		srv->pool_stats = NULL;
-	}
 	if (srv->pool_workers) {
 		g_thread_pool_free (srv->pool_workers, FALSE, TRUE);
 		srv->pool_workers = NULL;
@@ -285,6 +402,7 @@ network_server_clean(struct network_server_s *srv)
 
 	g_mutex_clear(&srv->lock_stats);
 	g_mutex_clear(&srv->lock_threads);
+	g_mutex_clear(&srv->lock_parked);
 
 	network_server_close_servers(srv);
 
@@ -294,8 +412,13 @@ network_server_clean(struct network_server_s *srv)
 		g_free(srv->endpointv);
 	}
 
-	if (srv->stats)
-		g_array_free (srv->stats, TRUE);
+	if (srv->stats_latency) {
+		for (guint i=0; i<SERVER_STATS_MAX ;++i)
+			grid_rrd_histogram_destroy (srv->stats_latency[i]);
+		g_free ((gpointer) srv->stats_latency);
+	}
+	g_free ((gpointer) srv->stats_keys);
+	free (srv->stats_shards);
 
 	metautils_pclose(&(srv->wakeup[0]));
 	metautils_pclose(&(srv->wakeup[1]));
@@ -582,19 +705,47 @@ _server_shutdown_inactive_connections(struct network_server_s *srv)
 	if (count) GRID_INFO ("%u cnx closed (idle or inactive)", count);
 }
 
+/* The connection of a client suspended for too long is closed, but the client
+ * is still expected to be resumed by the owner of its suspension, that keeps
+ * a pointer to it: it is freed then. */
+static void
+_server_expire_suspended(struct network_server_s *srv)
+{
+	guint count = 0;
+	gint64 ts = oio_ext_monotonic_time () - srv->atexit_max_suspended;
+
+	g_mutex_lock(&srv->lock_parked);
+	struct network_client_s *clt;
+	while ((clt = srv->parked_first) && clt->time.suspended < ts) {
+		_client_unpark(srv, clt);
+		g_atomic_int_set(&clt->suspension, SUSPENSION_EXPIRED);
+		GRID_DEBUG("cnx %d closed: %s", clt->fd, "suspended for too long");
+		metautils_pclose(&(clt->fd));
+		_cnx_notify_close(srv);
+		++ count;
+	}
+	g_mutex_unlock(&srv->lock_parked);
+
+	if (count) GRID_INFO ("%u cnx closed (suspended)", count);
+}
+
 static gpointer
 _thread_cb_events(gpointer d)
 {
 	metautils_ignore_signals();
 
 	struct network_server_s *srv = d;
-	for (gint64 next = 0; srv->flag_continue ;) {
+	for (gint64 next = 0, next_parked = 0; srv->flag_continue ;) {
 		_manage_events(srv);
 		gint64 now = oio_ext_monotonic_time ();
 		if (now > next) {
 			_server_shutdown_inactive_connections(srv);
 			next = now + 30 * G_TIME_SPAN_SECOND;
 		}
+		if (now > next_parked) {
+			_server_expire_suspended(srv);
+			next_parked = now + 1 * G_TIME_SPAN_SECOND;
+		}
 	}
 
 	/* XXX the server connections are being closed in the main thread that
@@ -605,12 +756,15 @@ _thread_cb_events(gpointer d)
 	srv->atexit_max_open_never_input = 5 * G_TIME_SPAN_SECOND;
 	srv->atexit_max_open_persist = 5 * G_TIME_SPAN_SECOND;
 	srv->atexit_max_idle = 1 * G_TIME_SPAN_SECOND;
+	srv->atexit_max_suspended = MIN(srv->atexit_max_suspended,
+			5 * G_TIME_SPAN_SECOND);
 
 	for (gint64 next = 0; 0 < srv->cnx_clients ;) {
 		_manage_events(srv);
 		gint64 now = oio_ext_monotonic_time ();
 		if (now > next) {
 			_server_shutdown_inactive_connections(srv);
+			_server_expire_suspended(srv);
 			next = now + 1 * G_TIME_SPAN_SECOND;
 		}
 	}
@@ -655,6 +809,11 @@ network_server_run(struct network_server_s *srv)
 				srv->gq_gauge_cnx_current, srv->cnx_clients,
 				srv->gq_counter_cnx_accept, srv->cnx_accept,
 				srv->gq_counter_cnx_close, srv->cnx_close);
+		guint64 buf_alloc = 0, buf_reuse = 0;
+		data_slab_pool_counters (&buf_alloc, &buf_reuse);
+		network_server_stat_push2 (srv, FALSE,
+				srv->gq_counter_buf_alloc, buf_alloc,
+				srv->gq_counter_buf_reuse, buf_reuse);
 	}
 
 	network_server_close_servers(srv);
@@ -877,30 +1036,22 @@ network_server_set_maxcnx(struct network_server_s *srv, guint max)
 	}
 }
 
+void
+network_server_set_max_suspended(struct network_server_s *srv, gint64 delay)
+{
+	EXTRA_ASSERT(srv != NULL);
+	srv->atexit_max_suspended = MAX(delay, 0);
+}
+
 static void
-_cb_stats(struct server_stat_msg_s *msg, struct network_server_s *srv)
+_client_resume_transport(struct network_client_s *clt)
 {
-	void _manage_at(const int n) {
-		const guint64 value = msg->value[n];
-		const GQuark which = msg->which[n];
-		if (!which)
-			return;
-		guint64 *p = _stat_locate (srv, which);
-		if (p)
-			*p = (msg->increment ? *p : 0) + value;
-		else {
-			/* The set of stats should be stable, and populated once at the
-			 * process startup. So that inserting then sorting for each stat
-			 * added shouldn't have a big impact during the server's lifetime */
-			struct server_stat_s st = {.value=value, .which=which};
-			g_array_append_vals (srv->stats, &st, 1);
-			g_array_sort (srv->stats, (GCompareFunc)_server_stat_cmp);
-		}
-	}
-	g_mutex_lock (&srv->lock_stats);
-	for (int i=0; i<4 ;++i) _manage_at (i);
-	g_mutex_unlock (&srv->lock_stats);
-	SLICE_FREE(struct server_stat_msg_s, msg);
+	if (!clt->transport.notify_input)
+		return;
+	clt->flags |= NETCLIENT_OUT_CORKED;
+	if (RC_NODATA == clt->transport.notify_input(clt))
+		clt->flags |= NETCLIENT_IN_CLOSED;
+	clt->flags &= ~NETCLIENT_OUT_CORKED;
 }
 
 static void
@@ -914,7 +1065,31 @@ _cb_worker(struct network_client_s *clt, struct network_server_s *srv)
 		return;
 	}
 
-	_client_manage_event(clt, clt->events);
+	if (clt->flags & NETCLIENT_RESUMED) {
+		clt->flags &= ~NETCLIENT_RESUMED;
+		_client_resume_transport(clt);
+	}
+
+	for (;;) {
+		if (clt->fd >= 0)
+			_client_manage_event(clt, clt->events);
+		if (!g_atomic_int_get(&clt->suspension))
+			break;
+		/* The transport waits for something: the client is now left to
+		 * whoever will call network_client_resume() */
+		if (_client_park(srv, clt))
+			return;
+		/* Already resumed, no need to give it back to the pool */
+		g_atomic_int_set(&clt->suspension, SUSPENSION_NONE);
+		_client_resume_transport(clt);
+		clt->events |= CLT_READ;
+	}
+
+	/* Resumed after its suspension expired, its connection is closed */
+	if (clt->fd < 0) {
+		_client_clean(srv, clt);
+		return;
+	}
 
 	/* re Monitor the socket */
 	if (_client_ready_for_output(clt) && _client_has_pending_output(clt))
@@ -971,6 +1146,50 @@ _client_remove_from_monitored(struct network_server_s *srv,
 	clt->next = clt->prev = NULL;
 }
 
+/* Under the lock of the parked clients */
+static void
+_client_unpark(struct network_server_s *srv, struct network_client_s *clt)
+{
+	if (clt->prev)
+		clt->prev->next = clt->next;
+	else
+		srv->parked_first = clt->next;
+	if (clt->next)
+		clt->next->prev = clt->prev;
+	else
+		srv->parked_last = clt->prev;
+	clt->next = clt->prev = NULL;
+}
+
+/* Releases a client whose suspension has been asked by its transport, unless
+ * it has already been resumed. */
+static gboolean
+_client_park(struct network_server_s *srv, struct network_client_s *clt)
+{
+	EXTRA_ASSERT(clt->prev == NULL);
+	EXTRA_ASSERT(clt->next == NULL);
+
+	gboolean parked = FALSE;
+	g_mutex_lock(&srv->lock_parked);
+	if (clt->fd < 0) {
+		/* Suspended again after its suspension expired: only the
+		 * resumption is awaited, to free it */
+		parked = g_atomic_int_compare_and_exchange(&clt->suspension,
+				SUSPENSION_ASKED, SUSPENSION_EXPIRED);
+	} else if (g_atomic_int_compare_and_exchange(&clt->suspension,
+				SUSPENSION_ASKED, SUSPENSION_PARKED)) {
+		clt->time.suspended = oio_ext_monotonic_time ();
+		if (NULL != (clt->prev = srv->parked_last))
+			clt->prev->next = clt;
+		else
+			srv->parked_first = clt;
+		srv->parked_last = clt;
+		parked = TRUE;
+	}
+	g_mutex_unlock(&srv->lock_parked);
+	return parked;
+}
+
 static void
 _client_add_to_monitored(struct network_server_s *srv,
 		struct network_client_s *clt)
@@ -1012,10 +1231,12 @@ _client_clean(struct network_server_s *srv, struct network_client_s *clt)
 
 	EXTRA_ASSERT(clt->prev == NULL);
 	EXTRA_ASSERT(clt->next == NULL);
-	EXTRA_ASSERT(clt->fd >= 0);
 
-	metautils_pclose(&(clt->fd));
-	_cnx_notify_close(srv);
+	/* Already closed if its suspension expired */
+	if (clt->fd >= 0) {
+		metautils_pclose(&(clt->fd));
+		_cnx_notify_close(srv);
+	}
 
 	clt->flags = clt->events = 0;
 	memset(&(clt->time), 0, sizeof(clt->time));
@@ -1166,9 +1387,19 @@ _client_manage_event(struct network_client_s *clt, int events)
 			}
 		}
 
-		/* Try to read some data if any available */
+		/* Do not read more while the transport is busy with a request */
+		if (g_atomic_int_get(&clt->suspension))
+			rcI = 0;
+
+		/* Try to read some data if any available. The replies are held
+		 * meanwhile, to be sent at once by the next loop. */
 		if (rcI) {
-			switch (_client_manage_input(clt)) {
+			clt->flags |= NETCLIENT_OUT_CORKED;
+			const int rc = _client_manage_input(clt);
+			clt->flags &= ~NETCLIENT_OUT_CORKED;
+			if (clt->corked)
+				rcO = 1;
+			switch (rc) {
 				case RC_ERROR:
 					clt->events |= CLT_ERROR;
 					rcI = 0;
@@ -1204,6 +1435,25 @@ network_client_send_slab(struct network_client_s *client, struct data_slab_s *ds
 		return MACRO_COND(type == STYPE_EOF, 0, -1);
 	}
 
+	/* Hold the small replies while the input is managed */
+	if (client->flags & NETCLIENT_OUT_CORKED && ds->type != STYPE_EOF) {
+		const gsize size = data_slab_size(ds);
+		if (client->corked + size < SERVER_CORK_MAX
+				&& (client->corked || !_client_has_pending_output(client))) {
+			client->corked += size;
+			data_slab_sequence_append(&(client->output), ds);
+			return 0;
+		}
+	}
+
+	/* Flush what has been held, this slab will follow */
+	if (client->corked) {
+		if (RC_ERROR == _client_manage_output(client)) {
+			data_slab_free(ds);
+			return -1;
+		}
+	}
+
 	/* Try to send the slab now, if allowed */
 	if (!_client_has_pending_output(client)) {
 		if (!data_slab_send(ds, client->fd)) {
@@ -1240,17 +1490,88 @@ network_client_close_output(struct network_client_s *clt, int now)
 		}
 		else {
 			clt->flags |= NETCLIENT_OUT_CLOSED;
+			clt->corked = 0;
 			data_slab_sequence_clean_data(&(clt->output));
 		}
 	}
 }
 
+gboolean
+network_client_wait_output(struct network_client_s *clt, gsize max,
+		gint64 deadline)
+{
+	EXTRA_ASSERT(clt != NULL);
+
+	while (data_slab_sequence_size(&(clt->output)) > max) {
+		if (clt->fd < 0 || (clt->flags & NETCLIENT_OUT_CLOSED))
+			return FALSE;
+		switch (_client_manage_output(clt)) {
+			case RC_ERROR:
+				return FALSE;
+			case RC_NOTREADY:
+				break;
+			default:
+				continue;
+		}
+		const gint64 now = oio_ext_monotonic_time ();
+		if (now >= deadline) {
+			GRID_DEBUG("fd=%d output timeout", clt->fd);
+			return FALSE;
+		}
+		struct pollfd pfd = {.fd = clt->fd, .events = POLLOUT};
+		int rc = poll(&pfd, 1, 1 + (deadline - now) / G_TIME_SPAN_MILLISECOND);
+		if (rc < 0 && errno != EINTR)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+void
+network_client_suspend(struct network_client_s *clt)
+{
+	EXTRA_ASSERT(clt != NULL);
+	EXTRA_ASSERT(g_atomic_int_get(&clt->suspension) == SUSPENSION_NONE);
+	g_atomic_int_set(&clt->suspension, SUSPENSION_ASKED);
+}
+
+void
+network_client_resume(struct network_client_s *clt)
+{
+	EXTRA_ASSERT(clt != NULL);
+
+	/* Still held by its worker, that will notice the resumption */
+	if (g_atomic_int_compare_and_exchange(&clt->suspension,
+				SUSPENSION_ASKED, SUSPENSION_RESUMED))
+		return;
+
+	struct network_server_s *srv = clt->server;
+	gboolean resumed = FALSE;
+	g_mutex_lock(&srv->lock_parked);
+	if (g_atomic_int_compare_and_exchange(&clt->suspension,
+				SUSPENSION_PARKED, SUSPENSION_NONE)) {
+		_client_unpark(srv, clt);
+		resumed = TRUE;
+	} else {
+		/* Its connection is closed: the worker lets the transport
+		 * end its request, then frees the client */
+		resumed = g_atomic_int_compare_and_exchange(&clt->suspension,
+				SUSPENSION_EXPIRED, SUSPENSION_NONE);
+	}
+	g_mutex_unlock(&srv->lock_parked);
+
+	if (resumed) {
+		clt->flags |= NETCLIENT_RESUMED;
+		clt->events = CLT_READ;
+		g_thread_pool_push(srv->pool_workers, clt, NULL);
+	}
+}
+
 void
 network_client_allow_input(struct network_client_s *clt, gboolean v)
 {
 	EXTRA_ASSERT(clt != NULL);
-	EXTRA_ASSERT(clt->fd >= 0);
 
+	/* closed meanwhile, if its suspension expired */
 	if (!clt || clt->fd < 0)
 		return;
 
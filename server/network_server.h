@@ -32,6 +32,7 @@ License along with this library.
 
 struct network_server_s;
 struct grid_stats_holder_s;
+struct grid_histogram_s;
 struct network_client_s;
 struct network_transport_s;
 struct gba_view_s;
@@ -52,13 +53,6 @@ struct server_stat_s /* stored in the server */
 	GQuark  which;
 };
 
-struct server_stat_msg_s /* sent by the workers */
-{
-	guint64  value[4];
-	GQuark   which[4];
-	gboolean increment : 1; /* FALSE -> reset */
-};
-
 typedef void (*network_transport_cleaner_f) (
 			struct transport_client_context_s*);
 
@@ -86,16 +80,22 @@ struct network_client_s
 		gint64 cnx;
 		gint64 evt_out;
 		gint64 evt_in;
+		gint64 suspended;
 	} time;
 
 	/* Pending input */
 	struct data_slab_sequence_s input;
 	/* Pending output */
 	struct data_slab_sequence_s output;
+	/* How many bytes of the pending output are held on purpose */
+	gsize corked;
 	/* What to do with pending data */
 	struct network_transport_s transport;
 	GError *current_error;
 
+	/* Managed with network_client_suspend() and network_client_resume() */
+	volatile gint suspension;
+
 	struct network_client_s *prev; /*!< XXX DO NOT USE */
 	struct network_client_s *next; /*!< XXX DO NOT USE */
 
@@ -114,6 +114,10 @@ void network_server_set_max_workers(struct network_server_s *srv, guint max);
 
 void network_server_set_maxcnx(struct network_server_s *srv, guint max);
 
+/* How long a suspended client may wait for network_client_resume() */
+void network_server_set_max_suspended(struct network_server_s *srv,
+		gint64 delay);
+
 typedef void (*network_transport_factory) (gpointer u,
 		struct network_client_s *clt);
 
@@ -158,12 +162,45 @@ guint64 network_server_stat_getone (struct network_server_s *srv, GQuark which);
 
 GArray* network_server_stat_getall (struct network_server_s *srv);
 
+/* Adds <v> to the recent distribution of the values of the stat <which>,
+ * typically a latency. */
+void network_server_stat_latency (struct network_server_s *srv,
+		GQuark which, guint64 v);
+
+/* Fills <out> with the distribution of the values pushed during the last
+ * SERVER_STATS_LATENCY_SLOTS * SERVER_STATS_LATENCY_WIDTH seconds. Returns
+ * FALSE if nothing has ever been pushed for <which> */
+gboolean network_server_stat_get_latency (struct network_server_s *srv,
+		GQuark which, struct grid_histogram_s *out);
+
 /* -------------------------------------------------------------------------- */
 
 void network_client_allow_input(struct network_client_s *clt, gboolean v);
 
 void network_client_close_output(struct network_client_s *clt, int now);
 
+/* To be called by the transport, in the worker thread currently managing the
+ * client, to bound the output queued for a slow client: the pending output is
+ * sent until at most 'max' bytes remain, waiting for the client to read it
+ * until 'deadline' (monotonic time). Returns FALSE if the output failed or if
+ * the deadline has been reached. */
+gboolean network_client_wait_output(struct network_client_s *clt, gsize max,
+		gint64 deadline);
+
+/* To be called by the transport, in the worker thread currently managing the
+ * client, when the current request waits for something that does not depend
+ * on the client. The input is not read anymore and, when the worker has
+ * finished its current round, the client is neither monitored anymore nor
+ * managed by any worker, until network_client_resume() is called.
+ * A client suspended for too long has its connection closed, but it is only
+ * freed once resumed: network_client_resume() remains mandatory. */
+void network_client_suspend(struct network_client_s *clt);
+
+/* Thread-safe. Gives back a suspended client to the pool of workers, that
+ * will call notify_input() on the transport, whether there is some input
+ * data or not. */
+void network_client_resume(struct network_client_s *clt);
+
 int network_client_send_slab(struct network_client_s *client,
 		struct data_slab_s *slab);
 
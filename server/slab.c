@@ -19,8 +19,10 @@ License along with this library.
 
 #include <stddef.h>
 #include <errno.h>
+#include <limits.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include "slab.h"
 #include "internals.h"
@@ -39,6 +41,92 @@ data_slab_type2str(struct data_slab_s *ds)
 	return "???";
 }
 
+/* The pool of the buffers of the current thread ---------------------------- */
+
+#define SLAB_POOL_SIZE 8
+#define SLAB_POOL_MAXALLOC (64*1024)
+
+/* How many slabs are gathered in a single writev(), the iovec array lies
+ * on the stack */
+#define SLAB_IOV_MAX MIN(IOV_MAX, 256)
+
+struct slab_pool_s
+{
+	guint count;
+	struct {
+		guint8 *buff;
+		gsize alloc;
+	} items[SLAB_POOL_SIZE];
+};
+
+static volatile guint64 pool_alloc = 0;
+static volatile guint64 pool_reuse = 0;
+
+static void
+_pool_free(gpointer p)
+{
+	struct slab_pool_s *pool = p;
+	for (guint i=0; i<pool->count ;++i)
+		g_free(pool->items[i].buff);
+	g_free(pool);
+}
+
+static GPrivate pool_key = G_PRIVATE_INIT(_pool_free);
+
+static struct slab_pool_s *
+_pool(void)
+{
+	struct slab_pool_s *pool = g_private_get(&pool_key);
+	if (!pool) {
+		pool = g_malloc0(sizeof(*pool));
+		g_private_set(&pool_key, pool);
+	}
+	return pool;
+}
+
+/* Returns a buffer of at least <*alloc> bytes, and sets <*alloc> to its
+ * real size */
+static guint8 *
+_pool_get(gsize *alloc)
+{
+	struct slab_pool_s *pool = _pool();
+	for (guint i=pool->count; i>0 ;--i) {
+		if (pool->items[i-1].alloc < *alloc)
+			continue;
+		guint8 *buff = pool->items[i-1].buff;
+		*alloc = pool->items[i-1].alloc;
+		pool->items[i-1] = pool->items[--pool->count];
+		__sync_fetch_and_add(&pool_reuse, 1);
+		return buff;
+	}
+	__sync_fetch_and_add(&pool_alloc, 1);
+	return g_malloc(*alloc);
+}
+
+static void
+_pool_put(guint8 *buff, gsize alloc)
+{
+	struct slab_pool_s *pool = _pool();
+	if (alloc > SLAB_POOL_MAXALLOC || pool->count >= SLAB_POOL_SIZE) {
+		g_free(buff);
+	} else {
+		pool->items[pool->count].buff = buff;
+		pool->items[pool->count].alloc = alloc;
+		pool->count ++;
+	}
+}
+
+void
+data_slab_pool_counters(guint64 *alloc, guint64 *reuse)
+{
+	if (alloc)
+		*alloc = pool_alloc;
+	if (reuse)
+		*reuse = pool_reuse;
+}
+
+/* -------------------------------------------------------------------------- */
+
 gsize
 data_slab_size(struct data_slab_s *ds)
 {
@@ -82,7 +170,10 @@ data_slab_free(struct data_slab_s *ds)
 	switch (ds->type) {
 		case STYPE_BUFFER:
 			if (ds->data.buffer.buff) {
-				g_free(ds->data.buffer.buff);
+				if (ds->pooled)
+					_pool_put(ds->data.buffer.buff, ds->data.buffer.alloc);
+				else
+					g_free(ds->data.buffer.buff);
 				ds->data.buffer.buff = NULL;
 				ds->data.buffer.start = ds->data.buffer.end = 0;
 			}
@@ -234,15 +325,91 @@ data_slab_consume(struct data_slab_s *ds, guint8 **p_data, gsize *p_size)
 	return FALSE;
 }
 
+void
+data_slab_rewind(struct data_slab_s *ds, gsize size)
+{
+	EXTRA_ASSERT(ds != NULL);
+	EXTRA_ASSERT(ds->type == STYPE_BUFFER || ds->type == STYPE_BUFFER_STATIC);
+	EXTRA_ASSERT(size <= ds->data.buffer.start);
+	ds->data.buffer.start -= MIN(size, ds->data.buffer.start);
+}
+
+static void
+_slab_skip(struct data_slab_s *ds, gsize size)
+{
+	switch (ds->type) {
+		case STYPE_BUFFER:
+		case STYPE_BUFFER_STATIC:
+			ds->data.buffer.start += (guint) size;
+			return;
+		case STYPE_GBYTES:
+			do {
+				GBytes *old = ds->data.gbytes;
+				gsize l = g_bytes_get_size (old);
+				ds->data.gbytes = g_bytes_new_from_bytes (old, size, l-size);
+				g_bytes_unref (old);
+			} while (0);
+			return;
+		case STYPE_EOF:
+			return;
+	}
+	g_assert_not_reached ();
+}
+
 gboolean
 data_slab_sequence_send(struct data_slab_sequence_s *dss, int fd)
 {
+	struct data_slab_s *ds;
+
 	if (!dss->first) {
 		g_assert_not_reached();
 		return TRUE;
 	}
 
-	return data_slab_send(dss->first, fd);
+	/* The EOF is managed alone, once all the data before it has gone */
+	if (dss->first->type == STYPE_EOF)
+		return data_slab_send(dss->first, fd);
+
+	/* Gather the slabs until the first EOF */
+	struct iovec iov[SLAB_IOV_MAX];
+	int count = 0;
+	for (ds = dss->first;
+			ds && ds->type != STYPE_EOF && count < SLAB_IOV_MAX;
+			ds = ds->next) {
+		if (!data_slab_has_data(ds))
+			continue;
+		if (ds->type == STYPE_GBYTES) {
+			gsize l = 0;
+			iov[count].iov_base = (void*) g_bytes_get_data (ds->data.gbytes, &l);
+			iov[count].iov_len = l;
+		} else {
+			iov[count].iov_base = ds->data.buffer.buff + ds->data.buffer.start;
+			iov[count].iov_len = ds->data.buffer.end - ds->data.buffer.start;
+		}
+		++ count;
+	}
+	if (!count)
+		return TRUE;
+
+	/* send */
+	errno = 0;
+	ssize_t w = writev(fd, iov, count);
+	if (w < 0)
+		return FALSE;
+
+	/* consume: the slabs entirely sent are freed at once */
+	gsize remaining = w;
+	while (NULL != (ds = dss->first) && ds->type != STYPE_EOF) {
+		gsize size = data_slab_size(ds);
+		if (remaining < size) {
+			if (remaining > 0)
+				_slab_skip(ds, remaining);
+			break;
+		}
+		remaining -= size;
+		data_slab_free(data_slab_sequence_shift(dss));
+	}
+	return TRUE;
 }
 
 void
@@ -367,11 +534,12 @@ data_slab_make_empty(gsize alloc)
 {
 	struct data_slab_s *ds = _slab();
 	ds->type = STYPE_BUFFER;
-	ds->data.buffer.buff = g_malloc(alloc);
+	ds->data.buffer.buff = _pool_get(&alloc);
 	ds->data.buffer.start = 0;
 	ds->data.buffer.end = 0;
 	ds->data.buffer.alloc = alloc;
 	ds->next = NULL;
+	ds->pooled = TRUE;
 	return ds;
 }
 
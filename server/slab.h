@@ -51,6 +51,8 @@ struct data_slab_s
 		} buffer;
 	} data;
 	struct data_slab_s *next;
+	/* the buffer returns to the pool of the thread that frees the slab */
+	gboolean pooled;
 };
 
 struct data_slab_sequence_s
@@ -75,6 +77,10 @@ gboolean data_slab_send(struct data_slab_s *ds, int fd);
 gboolean data_slab_consume(struct data_slab_s *ds, guint8 **p_data,
 		gsize *p_size);
 
+/* Gives back the last 'size' bytes returned by data_slab_consume(), i.e.
+ * the bytes that have not been used by the caller. Only for buffer slabs. */
+void data_slab_rewind(struct data_slab_s *ds, gsize size);
+
 void data_slab_trace(const gchar *tag, struct data_slab_s *ds);
 
 gsize data_slab_size(struct data_slab_s *ds);
@@ -87,6 +93,9 @@ gboolean data_slab_sequence_ready_for_data(struct data_slab_sequence_s *dss);
 
 gboolean data_slab_sequence_has_data(struct data_slab_sequence_s *dss);
 
+/* Sends in a single writev() as many slabs as possible, up to the first
+ * EOF slab, then frees the slabs entirely sent. The EOF is managed alone,
+ * when it reaches the head of the sequence. */
 gboolean data_slab_sequence_send(struct data_slab_sequence_s *dss, int fd);
 
 void data_slab_sequence_append(struct data_slab_sequence_s *dss,
@@ -104,8 +113,14 @@ gsize data_slab_sequence_size(struct data_slab_sequence_s *dss);
 
 /* Slab constructors -------------------------------------------------------- */
 
+/* The buffer comes from a small pool kept by each thread, so that the
+ * buffers of the requests managed by a worker are reused. */
 struct data_slab_s * data_slab_make_empty(gsize alloc);
 
+/* How many buffers have been allocated by data_slab_make_empty(), and
+ * how many have been reused instead. */
+void data_slab_pool_counters(guint64 *alloc, guint64 *reuse);
+
 struct data_slab_s * data_slab_make_eof(void);
 
 struct data_slab_s * data_slab_make_gbytes(GBytes *gb);
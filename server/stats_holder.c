@@ -17,6 +17,8 @@ You should have received a copy of the GNU Lesser General Public
 License along with this library.
 */
 
+#include <string.h>
+
 #include <metautils/lib/metautils.h>
 
 #include "internals.h"
@@ -162,3 +164,140 @@ grid_single_rrd_get_allmax(struct grid_single_rrd_s *gsr,
 	}
 }
 
+/* ------------------------------------------------------------------------- */
+
+struct grid_histogram_s*
+grid_histogram_create(void)
+{
+	return g_malloc0(sizeof(struct grid_histogram_s));
+}
+
+void
+grid_histogram_destroy(struct grid_histogram_s *h)
+{
+	if (h)
+		g_free(h);
+}
+
+static guint
+_histogram_index(guint64 v)
+{
+	if (v < GRID_HISTOGRAM_SUB)
+		return v;
+	const guint msb = 63 - __builtin_clzll(v);
+	const guint shift = msb - GRID_HISTOGRAM_SUBBITS;
+	const guint idx = (shift + 1) * GRID_HISTOGRAM_SUB
+		+ ((v >> shift) & (GRID_HISTOGRAM_SUB - 1));
+	return MIN(idx, GRID_HISTOGRAM_BUCKETS - 1);
+}
+
+static guint64
+_histogram_upper(guint idx)
+{
+	if (idx < GRID_HISTOGRAM_SUB)
+		return idx;
+	const guint shift = idx / GRID_HISTOGRAM_SUB - 1;
+	const guint64 sub = GRID_HISTOGRAM_SUB + idx % GRID_HISTOGRAM_SUB;
+	return ((sub + 1) << shift) - 1;
+}
+
+void
+grid_histogram_add(struct grid_histogram_s *h, guint64 v)
+{
+	EXTRA_ASSERT(h != NULL);
+	__sync_fetch_and_add(&h->buckets[_histogram_index(v)], 1);
+	__sync_fetch_and_add(&h->count, 1);
+	for (guint64 max = h->max; v > max ;max = h->max) {
+		if (__sync_bool_compare_and_swap(&h->max, max, v))
+			break;
+	}
+}
+
+guint64
+grid_histogram_quantile(struct grid_histogram_s *h, gdouble q)
+{
+	EXTRA_ASSERT(h != NULL);
+	const guint64 count = h->count;
+	if (!count)
+		return 0;
+
+	q = CLAMP(q, 0.0, 1.0);
+	const guint64 rank = MAX(1, (guint64)(q * count + 0.5));
+	guint64 seen = 0;
+	for (guint i=0; i<GRID_HISTOGRAM_BUCKETS ;++i) {
+		seen += h->buckets[i];
+		if (seen >= rank)
+			return MIN(_histogram_upper(i), h->max);
+	}
+	return h->max;
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct grid_rrd_slot_s
+{
+	time_t epoch; /* the period of <width> seconds held */
+	struct grid_histogram_s h;
+};
+
+struct grid_rrd_histogram_s
+{
+	time_t width;
+	guint slots;
+	struct grid_rrd_slot_s ring[];
+};
+
+struct grid_rrd_histogram_s*
+grid_rrd_histogram_create(guint slots, time_t width)
+{
+	EXTRA_ASSERT(slots > 0);
+	EXTRA_ASSERT(width > 0);
+
+	struct grid_rrd_histogram_s *rh = g_malloc0(
+			sizeof(struct grid_rrd_histogram_s)
+			+ slots * sizeof(struct grid_rrd_slot_s));
+	rh->width = width;
+	rh->slots = slots;
+	return rh;
+}
+
+void
+grid_rrd_histogram_destroy(struct grid_rrd_histogram_s *rh)
+{
+	if (rh)
+		g_free(rh);
+}
+
+void
+grid_rrd_histogram_add(struct grid_rrd_histogram_s *rh, time_t now, guint64 v)
+{
+	EXTRA_ASSERT(rh != NULL);
+	const time_t epoch = now / rh->width;
+	struct grid_rrd_slot_s *slot = rh->ring + (epoch % rh->slots);
+
+	/* The first to see the slot outdated recycles it */
+	const time_t old = slot->epoch;
+	if (old != epoch && __sync_bool_compare_and_swap(&slot->epoch, old, epoch))
+		memset(&slot->h, 0, sizeof(slot->h));
+	grid_histogram_add(&slot->h, v);
+}
+
+void
+grid_rrd_histogram_get(struct grid_rrd_histogram_s *rh, time_t now,
+		struct grid_histogram_s *out)
+{
+	EXTRA_ASSERT(rh != NULL);
+	EXTRA_ASSERT(out != NULL);
+	memset(out, 0, sizeof(*out));
+
+	const time_t epoch = now / rh->width;
+	for (guint i=0; i<rh->slots ;++i) {
+		const struct grid_rrd_slot_s *slot = rh->ring + i;
+		if (slot->epoch > epoch || slot->epoch + rh->slots <= epoch)
+			continue;
+		out->count += slot->h.count;
+		out->max = MAX(out->max, slot->h.max);
+		for (guint b=0; b<GRID_HISTOGRAM_BUCKETS ;++b)
+			out->buckets[b] += slot->h.buckets[b];
+	}
+}
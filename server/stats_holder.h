@@ -60,4 +60,55 @@ guint64 grid_single_rrd_get_max(struct grid_single_rrd_s *gsr,
 void grid_single_rrd_get_allmax(struct grid_single_rrd_s *gsr,
 		time_t at, time_t period, guint64 *out);
 
+/* -------------------------------------------------------------------------- */
+
+/* Each power of two is split in that many linear sub-buckets, so that the
+ * values are known with a relative precision of 1/8. */
+#define GRID_HISTOGRAM_SUBBITS 3
+#define GRID_HISTOGRAM_SUB (1 << GRID_HISTOGRAM_SUBBITS)
+/* Enough for values up to 2^40 */
+#define GRID_HISTOGRAM_BUCKETS ((40 + 1) * GRID_HISTOGRAM_SUB)
+
+/*! A histogram with logarithmic buckets, meant for latencies. Values
+ * can be added concurrently without any lock. */
+struct grid_histogram_s
+{
+	guint64 count;
+	guint64 max;
+	guint64 buckets[GRID_HISTOGRAM_BUCKETS];
+};
+
+struct grid_histogram_s* grid_histogram_create(void);
+
+void grid_histogram_destroy(struct grid_histogram_s *h);
+
+/*! Thread-safe */
+void grid_histogram_add(struct grid_histogram_s *h, guint64 v);
+
+/*! Returns the upper bound of the bucket holding the quantile <q> (in
+ * [0,1]) of the values added, or 0 if there are none. Not synchronized with
+ * the concurrent additions, the result is then approximative. */
+guint64 grid_histogram_quantile(struct grid_histogram_s *h, gdouble q);
+
+/* -------------------------------------------------------------------------- */
+
+/*! The round-robin counterpart of the histogram: the values are spread over
+ * <slots> histograms, each covering <width> seconds, so that only the
+ * distribution of the recent values is known. */
+struct grid_rrd_histogram_s;
+
+struct grid_rrd_histogram_s* grid_rrd_histogram_create(guint slots,
+		time_t width);
+
+void grid_rrd_histogram_destroy(struct grid_rrd_histogram_s *rh);
+
+/*! Thread-safe. The values added concurrently with the recycling of an
+ * old slot may be lost. */
+void grid_rrd_histogram_add(struct grid_rrd_histogram_s *rh,
+		time_t now, guint64 v);
+
+/*! Merges into <out> the slots not older than the window */
+void grid_rrd_histogram_get(struct grid_rrd_histogram_s *rh,
+		time_t now, struct grid_histogram_s *out);
+
 #endif /*OIO_SDS__server__stats_holder_h*/
@@ -42,6 +42,8 @@ struct cnx_data_s
 struct transport_client_context_s
 {
 	struct gridd_request_dispatcher_s *dispatcher;
+	/* Where a request is reassembled when it spans several slabs. Kept
+	 * across the requests of the connection. */
 	GByteArray *gba_l4v;
 	GArray *cnx_data;
 };
@@ -87,7 +89,20 @@ static void transport_gridd_notify_error(struct network_client_s *clt);
 
 static void transport_gridd_clean_context(struct transport_client_context_s *);
 
-static gboolean _client_manage_l4v(struct network_client_s *clt, GByteArray *gba);
+static gboolean _client_manage_l4v(struct network_client_s *clt,
+		const guint8 *data, gsize len);
+
+static GQuark gq_frame_copied = 0;
+static GQuark gq_frame_inplace = 0;
+static GQuark gq_frame_alloc = 0;
+
+static void __attribute__ ((constructor))
+_constructor (void)
+{
+	gq_frame_copied = g_quark_from_static_string ("counter req.frame.copied");
+	gq_frame_inplace = g_quark_from_static_string ("counter req.frame.inplace");
+	gq_frame_alloc = g_quark_from_static_string ("counter req.frame.alloc");
+}
 
 /* XXX(jfs): ugly quirk, ok, but helpful to keep simple the stats support in
    the server but allow it to reply "config volume /path/to/docroot" in its
@@ -247,25 +262,13 @@ network_client_log_access(struct log_item_s *item)
 /* -------------------------------------------------------------------------- */
 
 static guint32
-_l4v_size(GByteArray *gba)
+_l4v_size(const guint8 *data)
 {
-	EXTRA_ASSERT(gba != NULL);
-	EXTRA_ASSERT(gba->len >= 4);
-
-	guint32 size = *((guint32*)gba->data);
+	guint32 size;
+	memcpy(&size, data, sizeof(size));
 	return g_ntohl(size);
 }
 
-static struct hashstr_s *
-_request_get_name(MESSAGE req)
-{
-	gsize name_len = 0;
-	void *name = metautils_message_get_NAME(req, &name_len);
-	if (!name || !name_len)
-		return hashstr_create("");
-	return hashstr_create_len((gchar*)name, name_len);
-}
-
 static gchar *
 _req_get_hex_ID(MESSAGE req, gchar *d, gsize dsize)
 {
@@ -313,8 +316,23 @@ gba_read(GByteArray *gba, struct data_slab_s *ds, guint32 max)
 	}
 }
 
+/* Forgets the current request. The buffer is kept for the next one, unless
+ * it became too large to be kept idle with the connection. */
 static void
 _ctx_reset(struct transport_client_context_s *ctx)
+{
+	if (!ctx->gba_l4v)
+		return;
+	if (ctx->gba_l4v->len > SERVER_L4V_KEEP) {
+		g_byte_array_free(ctx->gba_l4v, TRUE);
+		ctx->gba_l4v = NULL;
+	} else {
+		g_byte_array_set_size(ctx->gba_l4v, 0);
+	}
+}
+
+static void
+_ctx_clean(struct transport_client_context_s *ctx)
 {
 	if (!ctx->gba_l4v)
 		return;
@@ -429,6 +447,23 @@ transport_gridd_notify_error(struct network_client_s *clt)
 	_ctx_reset_cnx_data(clt->transport.client_context);
 }
 
+/* Tells if the slab holds a whole request, that can then be managed
+ * without copy. Returns the size of the request, or 0 if it doesn't. */
+static gsize
+_slab_holds_l4v(struct data_slab_s *ds)
+{
+	if (ds->type != STYPE_BUFFER && ds->type != STYPE_BUFFER_STATIC)
+		return 0;
+	const gsize avail = ds->data.buffer.end - ds->data.buffer.start;
+	if (avail < 4)
+		return 0;
+	const guint32 payload_size = _l4v_size(
+			ds->data.buffer.buff + ds->data.buffer.start);
+	if (!payload_size || avail - 4 < payload_size)
+		return 0;
+	return 4 + payload_size;
+}
+
 static int
 transport_gridd_notify_input(struct network_client_s *clt)
 {
@@ -443,9 +478,6 @@ transport_gridd_notify_input(struct network_client_s *clt)
 
 		struct data_slab_s *ds;
 
-		if (!ctx->gba_l4v)
-			ctx->gba_l4v = g_byte_array_new();
-
 		if (!(ds = data_slab_sequence_shift(&(clt->input))))
 			break;
 
@@ -454,13 +486,40 @@ transport_gridd_notify_input(struct network_client_s *clt)
 			continue;
 		}
 
+		/* Most of the requests are received in one read, then they are
+		 * decoded where they lie. */
+		gsize whole = 0;
+		if ((!ctx->gba_l4v || !ctx->gba_l4v->len)
+				&& (whole = _slab_holds_l4v(ds)) > 0) {
+			guint8 *data = NULL;
+			gsize data_size = whole;
+			data_slab_consume(ds, &data, &data_size);
+			EXTRA_ASSERT(data_size == whole);
+			network_server_stat_push2(clt->server, TRUE,
+					gq_frame_inplace, 1, 0, 0);
+			gboolean ok = _client_manage_l4v(clt, data, data_size);
+			data_slab_sequence_unshift(&(clt->input), ds);
+			if (!ok) {
+				network_client_close_output(clt, FALSE);
+				GRID_WARN("fd=%d Transport error", clt->fd);
+				return RC_ERROR;
+			}
+			continue;
+		}
+
+		if (!ctx->gba_l4v) {
+			ctx->gba_l4v = g_byte_array_new();
+			network_server_stat_push2(clt->server, TRUE,
+					gq_frame_alloc, 1, 0, 0);
+		}
+
 		if (ctx->gba_l4v->len < 4) { /* read the size */
 			gba_read(ctx->gba_l4v, ds, 4);
 			data_slab_sequence_unshift(&(clt->input), ds);
 			continue;
 		}
 
-		guint32 payload_size = _l4v_size(ctx->gba_l4v);
+		guint32 payload_size = _l4v_size(ctx->gba_l4v->data);
 
 		if (!payload_size) { /* empty message : reset the buffer */
 			data_slab_sequence_unshift(&(clt->input), ds);
@@ -471,18 +530,31 @@ transport_gridd_notify_input(struct network_client_s *clt)
 		if (payload_size > (1024 * 1024 * 1024)) { /* to big */
 			GRID_WARN("fd=%d Request too big (%u)", clt->fd, payload_size);
 			data_slab_sequence_unshift(&(clt->input), ds);
-			_ctx_reset(ctx);
+			_ctx_clean(ctx);
 			network_client_close_output(clt, FALSE);
 			return RC_ERROR;
 		}
 
+		/* Reserve what is already received, the size announced by the
+		 * client is not trusted. The buffer then grows as the data
+		 * arrives. */
+		if (ctx->gba_l4v->len == 4) {
+			gsize avail = data_slab_size(ds)
+				+ data_slab_sequence_size(&(clt->input));
+			avail = MIN(payload_size, MAX(avail, SERVER_L4V_KEEP));
+			g_byte_array_set_size(ctx->gba_l4v, 4 + avail);
+			g_byte_array_set_size(ctx->gba_l4v, 4);
+		}
+
 		gba_read(ctx->gba_l4v, ds, payload_size + 4);
 		data_slab_sequence_unshift(&(clt->input), ds);
 		ds = NULL;
 		/*data_slab_sequence_trace(&(clt->input));*/
 
 		if (ctx->gba_l4v->len >= 4 + payload_size) { /* complete */
-			if (!_client_manage_l4v(clt, ctx->gba_l4v)) {
+			network_server_stat_push2(clt->server, TRUE,
+					gq_frame_copied, 1, 0, 0);
+			if (!_client_manage_l4v(clt, ctx->gba_l4v->data, ctx->gba_l4v->len)) {
 				network_client_close_output(clt, FALSE);
 				GRID_WARN("fd=%d Transport error", clt->fd);
 				return RC_ERROR;
@@ -497,7 +569,7 @@ transport_gridd_notify_input(struct network_client_s *clt)
 static void
 transport_gridd_clean_context(struct transport_client_context_s *ctx)
 {
-	_ctx_reset(ctx);
+	_ctx_clean(ctx);
 
 	if (ctx->cnx_data) {
 		_ctx_reset_cnx_data(ctx);
@@ -520,6 +592,7 @@ _notify_request(struct req_ctx_s *ctx, GQuark gq_count, GQuark gq_time)
 	network_server_stat_push4 (ctx->client->server, TRUE,
 			gq_count, 1, gq_count_all, 1,
 			gq_time, diff, gq_time_all, diff);
+	network_server_stat_latency (ctx->client->server, gq_time, diff);
 }
 
 static gsize
@@ -744,14 +817,15 @@ _request_get_cid (MESSAGE request)
 }
 
 static gboolean
-_client_manage_l4v(struct network_client_s *client, GByteArray *gba)
+_client_manage_l4v(struct network_client_s *client,
+		const guint8 *data, gsize len)
 {
 	gchar hexid[65];
 	struct req_ctx_s req_ctx = {0};
 	gboolean rc = FALSE;
 	GError *err = NULL;
 
-	EXTRA_ASSERT(gba != NULL);
+	EXTRA_ASSERT(data != NULL);
 	EXTRA_ASSERT(client != NULL);
 
 	req_ctx.uid = NULL;
@@ -762,7 +836,7 @@ _client_manage_l4v(struct network_client_s *client, GByteArray *gba)
 	req_ctx.clt_ctx = req_ctx.transport->client_context;
 	req_ctx.disp = req_ctx.clt_ctx->dispatcher;
 
-	MESSAGE request = message_unmarshall(gba->data, gba->len, &err);
+	MESSAGE request = message_unmarshall(data, len, &err);
 
 	// take the encoding into account
 	req_ctx.tv_start = client->time.evt_in;
@@ -781,10 +855,27 @@ _client_manage_l4v(struct network_client_s *client, GByteArray *gba)
 	}
 
 	req_ctx.request = request;
-	req_ctx.reqname = _request_get_name(request);
+	do { /* on the stack, it lives as long as the request */
+		gsize name_len = 0;
+		void *name = metautils_message_get_NAME(request, &name_len);
+		if (!name)
+			name_len = 0;
+		/* the client chooses the length, rejected below when too long */
+		if (name_len <= SERVER_REQNAME_MAX)
+			HASHSTR_ALLOCA_LEN(req_ctx.reqname, name, name_len);
+	} while (0);
 	req_ctx.uid = _request_get_cid(request);
 	req_ctx.reqid = _req_get_hex_ID(request, hexid, sizeof(hexid));
 	oio_ext_set_reqid(req_ctx.reqid);
+	do {
+		gchar parent[64] = "";
+		GError *e = metautils_message_extract_string(request,
+				NAME_MSGKEY_TRACE, parent, sizeof(parent));
+		if (e)
+			g_clear_error(&e);
+		oio_ext_trace_start(parent, req_ctx.tv_start);
+		oio_ext_trace_span("gridd.decode", req_ctx.tv_start);
+	} while (0);
 	rc = TRUE;
 
 	if (!req_ctx.reqname) {
@@ -805,11 +896,10 @@ label_exit:
 	metautils_message_destroy(request);
 	if (err)
 		g_clear_error(&err);
-	if (req_ctx.reqname)
-		g_free(req_ctx.reqname);
 	oio_str_clean(&req_ctx.subject);
 	oio_str_clean(&req_ctx.uid);
 	memset(&req_ctx, 0, sizeof(req_ctx));
+	oio_ext_trace_stop (OIO_TRACE_SLOW);
 	oio_ext_set_reqid (NULL);
 	return rc;
 }
@@ -898,15 +988,31 @@ dispatch_STATS(struct gridd_reply_ctx_s *reply,
 	(void) gdata, (void) hdata;
 	GByteArray *body = g_byte_array_new();
 
+	struct grid_histogram_s *histo = grid_histogram_create();
 	GArray *array = network_server_stat_getall(reply->client->server);
 	for (guint i=0; i<array->len ;++i) {
 		struct server_stat_s *st = &g_array_index (array, struct server_stat_s, i);
-		gchar tmp[256];
+		const char *name = g_quark_to_string (st->which);
+		gchar tmp[512];
 		gsize len = g_snprintf (tmp, sizeof(tmp), "%s=%"G_GUINT64_FORMAT"\n",
-				g_quark_to_string (st->which), st->value);
+				name, st->value);
 		g_byte_array_append (body, (guint8*)tmp, len);
+
+		/* the recent latency quantiles, in microseconds */
+		if (network_server_stat_get_latency(reply->client->server,
+					st->which, histo) && histo->count > 0) {
+			len = g_snprintf (tmp, sizeof(tmp),
+					"%s.p50=%"G_GUINT64_FORMAT"\n"
+					"%s.p99=%"G_GUINT64_FORMAT"\n"
+					"%s.p999=%"G_GUINT64_FORMAT"\n",
+					name, grid_histogram_quantile(histo, 0.5),
+					name, grid_histogram_quantile(histo, 0.99),
+					name, grid_histogram_quantile(histo, 0.999));
+			g_byte_array_append (body, (guint8*)tmp, MIN(len, sizeof(tmp)-1));
+		}
 	}
 	g_array_free (array, TRUE);
+	grid_histogram_destroy (histo);
 
 	if (oio_server_volume) {
 		g_byte_array_append (body,
@@ -921,6 +1027,20 @@ dispatch_STATS(struct gridd_reply_ctx_s *reply,
 	return TRUE;
 }
 
+static gboolean
+dispatch_TRACES(struct gridd_reply_ctx_s *reply,
+		gpointer gdata, gpointer hdata)
+{
+	(void) gdata, (void) hdata;
+	GString *gs = g_string_sized_new(1024);
+	oio_ext_trace_dump(gs);
+	reply->no_access();
+	reply->add_body(metautils_gba_from_string(gs->str));
+	reply->send_reply(CODE_FINAL_OK, "OK");
+	g_string_free(gs, TRUE);
+	return TRUE;
+}
+
 static gboolean
 dispatch_VERSION(struct gridd_reply_ctx_s *reply,
 		gpointer gdata, gpointer hdata)
@@ -940,6 +1060,7 @@ gridd_get_common_requests(void)
 		{"REQ_PING",      dispatch_PING,          NULL},
 		{"REQ_STATS",     dispatch_STATS,         NULL},
 		{"REQ_VERSION",   dispatch_VERSION,       NULL},
+		{"REQ_TRACES",    dispatch_TRACES,        NULL},
 		{"REQ_HANDLERS",  dispatch_LISTHANDLERS,  NULL},
 		{"REQ_KILL",      dispatch_KILL,          NULL},
 		{NULL, NULL, NULL}
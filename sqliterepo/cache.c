@@ -49,6 +49,7 @@ enum sqlx_base_status_e
 						 * to be kept open, and owner tells if the lock
 						 * os currently owned by a thread. */
 	SQLX_BASE_CLOSING, // base being closed, wait for notification and retry on it
+	SQLX_BASE_VISITED, // idle base given to the idle hook, wait and retry too
 };
 
 struct sqlx_base_s
@@ -63,6 +64,7 @@ struct sqlx_base_s
 	gpointer handle;
 
 	gint64 last_update; /*!< Changed under the global lock */
+	gint64 last_visit; /*!< Last time the idle hook has been called */
 
 	struct {
 		gint prev;
@@ -105,6 +107,7 @@ struct sqlx_cache_s
 	struct beacon_s beacon_used;
 
 	sqlx_cache_close_hook close_hook;
+	sqlx_cache_idle_hook idle_hook;
 };
 
 gint64 oio_cache_period_cond_wait = G_TIME_SPAN_SECOND;
@@ -132,6 +135,8 @@ sqlx_status_to_str(enum sqlx_base_status_e status)
 			return "USED";
 		case SQLX_BASE_CLOSING:
 			return "CLOSING";
+		case SQLX_BASE_VISITED:
+			return "VISITED";
 		default:
 			return "?";
 	}
@@ -240,6 +245,35 @@ SQLX_UNSHIFT(sqlx_cache_t *cache, sqlx_base_t *base,
 	base->last_update = oio_ext_monotonic_time ();
 }
 
+/* Unlike SQLX_UNSHIFT(), the base keeps its last_update and is inserted at
+ * its place in the list, the youngest first. The walk starts from the
+ * oldest end, where the bases put back after a visit belong. */
+static void
+SQLX_INSERT(sqlx_cache_t *cache, sqlx_base_t *base,
+		struct beacon_s *beacon, enum sqlx_base_status_e status)
+{
+	sqlx_base_t *prev = sqlx_get_by_id(cache, beacon->last);
+	while (prev && prev->last_update < base->last_update)
+		prev = sqlx_get_by_id(cache, prev->link.prev);
+
+	sqlx_base_t *next = prev
+		? sqlx_get_by_id(cache, prev->link.next)
+		: sqlx_get_by_id(cache, beacon->first);
+
+	base->link.prev = sqlx_base_get_id(prev);
+	base->link.next = sqlx_base_get_id(next);
+	if (prev)
+		prev->link.next = base->index;
+	else
+		beacon->first = base->index;
+	if (next)
+		next->link.prev = base->index;
+	else
+		beacon->last = base->index;
+
+	base->status = status;
+}
+
 static void
 sqlx_save_id(sqlx_cache_t *cache, sqlx_base_t *base)
 {
@@ -271,6 +305,7 @@ sqlx_base_remove_from_list(sqlx_cache_t *cache, sqlx_base_t *base)
 			SQLX_REMOVE(cache, base, &(cache->beacon_used));
 			return;
 		case SQLX_BASE_CLOSING:
+		case SQLX_BASE_VISITED:
 			EXTRA_ASSERT(base->link.prev < 0);
 			EXTRA_ASSERT(base->link.next < 0);
 			return;
@@ -298,6 +333,7 @@ sqlx_base_add_to_list(sqlx_cache_t *cache, sqlx_base_t *base,
 			SQLX_UNSHIFT(cache, base, &(cache->beacon_used), SQLX_BASE_USED);
 			return;
 		case SQLX_BASE_CLOSING:
+		case SQLX_BASE_VISITED:
 			base->status = status;
 			return;
 	}
@@ -398,6 +434,7 @@ _expire_base(sqlx_cache_t *cache, sqlx_base_t *b)
 	b->name = NULL;
 	b->count_open = 0;
 	b->last_update = 0;
+	b->last_visit = 0;
 	sqlx_base_move_to_list(cache, b, SQLX_BASE_FREE);
 
 	g_tree_remove(cache->bases_by_name, n);
@@ -513,6 +550,13 @@ sqlx_cache_set_close_hook(sqlx_cache_t *cache, sqlx_cache_close_hook hook)
 	cache->close_hook = hook;
 }
 
+void
+sqlx_cache_set_idle_hook(sqlx_cache_t *cache, sqlx_cache_idle_hook hook)
+{
+	EXTRA_ASSERT(cache != NULL);
+	cache->idle_hook = hook;
+}
+
 void
 sqlx_cache_set_open_timeout(sqlx_cache_t *cache, gint64 timeout)
 {
@@ -574,6 +618,7 @@ sqlx_cache_clean(sqlx_cache_t *cache)
 					sqlx_base_debug(__FUNCTION__, base);
 					break;
 				case SQLX_BASE_CLOSING:
+				case SQLX_BASE_VISITED:
 					GRID_ERROR("Base being closed while the cache is being cleaned");
 					break;
 			}
@@ -687,6 +732,7 @@ retry:
 				break;
 
 			case SQLX_BASE_CLOSING:
+			case SQLX_BASE_VISITED:
 				EXTRA_ASSERT(base->owner != NULL);
 				/* Just wait for a notification then retry
 				   XXX(jfs): do not use 'now' because it can be a fake clock */
@@ -709,6 +755,36 @@ retry:
 	return err;
 }
 
+gboolean
+sqlx_cache_peek_handle(sqlx_cache_t *cache, const hashstr_t *hname,
+		gboolean (*check) (gpointer handle))
+{
+	gboolean rc = FALSE;
+
+	EXTRA_ASSERT(cache != NULL);
+	EXTRA_ASSERT(hname != NULL);
+	EXTRA_ASSERT(check != NULL);
+
+	g_mutex_lock(&cache->lock);
+	const gint bd = sqlx_lookup_id(cache, hname);
+	if (bd >= 0) {
+		sqlx_base_t *base = GET(cache, bd);
+		switch (base->status) {
+			case SQLX_BASE_IDLE:
+			case SQLX_BASE_IDLE_HOT:
+				rc = base->handle != NULL && check(base->handle);
+				break;
+			case SQLX_BASE_USED:
+				rc = base->handle != NULL;
+				break;
+			default:
+				rc = FALSE;
+		}
+	}
+	g_mutex_unlock(&cache->lock);
+	return rc;
+}
+
 GError *
 sqlx_cache_unlock_and_close_base(sqlx_cache_t *cache, gint bd, gboolean force)
 {
@@ -757,6 +833,7 @@ sqlx_cache_unlock_and_close_base(sqlx_cache_t *cache, gint bd, gboolean force)
 			break;
 
 		case SQLX_BASE_CLOSING:
+		case SQLX_BASE_VISITED:
 			EXTRA_ASSERT(base->owner != NULL);
 			EXTRA_ASSERT(base->owner != g_thread_self());
 			err = NEWERROR(CODE_INTERNAL_ERROR, "base being closed");
@@ -838,6 +915,75 @@ sqlx_cache_expire(sqlx_cache_t *cache, guint max, gint64 duration)
 	return nb;
 }
 
+/* The lists are ordered by last_update, the oldest last: the walk stops at
+ * the first base not idle for long enough, and after a bounded number of
+ * bases already visited, because it runs under the global lock. */
+static guint
+_collect_idle(sqlx_cache_t *cache, struct beacon_s *beacon, gint64 pivot,
+		gint *tab, guint count, guint max)
+{
+	guint skipped = 0;
+	for (gint bd = beacon->last; bd >= 0 && count < max ;) {
+		sqlx_base_t *b = GET(cache, bd);
+		if (b->last_update > pivot)
+			break;
+		if (b->last_visit < b->last_update)
+			tab[count++] = bd;
+		else if (++skipped >= SQLX_IDLE_VISIT_WALK * max)
+			break;
+		bd = b->link.prev;
+	}
+	return count;
+}
+
+guint
+sqlx_cache_visit_idle(sqlx_cache_t *cache, guint max, gint64 delay)
+{
+	EXTRA_ASSERT(cache != NULL);
+	if (!cache->idle_hook || !max)
+		return 0;
+
+	gint *tab = g_malloc(max * sizeof(gint));
+	guint count = 0, nb = 0;
+
+	g_mutex_lock(&cache->lock);
+	gint64 pivot = oio_ext_monotonic_time () - delay;
+	count = _collect_idle(cache, &cache->beacon_idle, pivot, tab, count, max);
+	count = _collect_idle(cache, &cache->beacon_idle_hot, pivot, tab, count, max);
+
+	/* Each base is put back at its place in its list, it keeps its age
+	 * with regard to the expiration. */
+	for (guint i = count; i > 0 ;i--) {
+		sqlx_base_t *b = GET(cache, tab[i-1]);
+		const enum sqlx_base_status_e status0 = b->status;
+		if (status0 != SQLX_BASE_IDLE && status0 != SQLX_BASE_IDLE_HOT)
+			continue;
+
+		EXTRA_ASSERT(b->count_open == 0);
+		EXTRA_ASSERT(b->owner == NULL);
+		b->owner = g_thread_self();
+		sqlx_base_move_to_list(cache, b, SQLX_BASE_VISITED);
+
+		/* the base is ours, no need to hold the whole cache meanwhile */
+		g_mutex_unlock(&cache->lock);
+		cache->idle_hook(b->handle);
+		g_mutex_lock(&cache->lock);
+
+		b->owner = NULL;
+		b->last_visit = oio_ext_monotonic_time ();
+		sqlx_base_remove_from_list(cache, b);
+		SQLX_INSERT(cache, b, status0 == SQLX_BASE_IDLE
+				? &cache->beacon_idle : &cache->beacon_idle_hot, status0);
+		g_cond_signal(b->cond_prio);
+		g_cond_signal(b->cond);
+		++ nb;
+	}
+
+	g_mutex_unlock(&cache->lock);
+	g_free(tab);
+	return nb;
+}
+
 gpointer
 sqlx_cache_get_handle(sqlx_cache_t *cache, gint bd)
 {
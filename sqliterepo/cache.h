@@ -31,6 +31,8 @@ struct hashstr_s;
 
 typedef void (*sqlx_cache_close_hook)(gpointer);
 
+typedef void (*sqlx_cache_idle_hook)(gpointer);
+
 typedef struct sqlx_cache_s sqlx_cache_t;
 
 gpointer sqlx_cache_get_handle(sqlx_cache_t *cache, gint bd);
@@ -42,6 +44,11 @@ sqlx_cache_t * sqlx_cache_init(void);
 void sqlx_cache_set_close_hook(sqlx_cache_t *cache,
 	sqlx_cache_close_hook hook);
 
+/* The hook is called by sqlx_cache_visit_idle() with the handle of the
+ * bases left idle, while they are locked. */
+void sqlx_cache_set_idle_hook(sqlx_cache_t *cache,
+	sqlx_cache_idle_hook hook);
+
 void sqlx_cache_set_max_bases(sqlx_cache_t *cache, guint max);
 
 /* timeout in the precision of oio_ext_monotonic_time() */
@@ -56,6 +63,13 @@ void sqlx_cache_debug(sqlx_cache_t *cache);
 GError * sqlx_cache_open_and_lock_base(sqlx_cache_t *cache,
 		const struct hashstr_s *key, gboolean urgent, gint *result);
 
+/** Tells, without locking the base, if it is cached with a handle that
+ * satisfies 'check'. 'check' is called under the lock of the cache, and
+ * only on an idle base: a base in use is assumed to satisfy it. The answer
+ * may be outdated as soon as returned. */
+gboolean sqlx_cache_peek_handle(sqlx_cache_t *cache,
+		const struct hashstr_s *key, gboolean (*check) (gpointer handle));
+
 /** The invert of sqlx_cache_open_and_lock_base() */
 GError * sqlx_cache_unlock_and_close_base(sqlx_cache_t *cache, gint bd,
 		gboolean force);
@@ -65,6 +79,11 @@ guint sqlx_cache_expire_all(sqlx_cache_t *cache);
 /** Check for expired bases, then close them */
 guint sqlx_cache_expire(sqlx_cache_t *cache, guint max, gint64 duration);
 
+/** Calls the idle hook on at most 'max' bases, left idle for at least
+ * 'delay' and used since the hook has been called on them. Returns how
+ * many bases have been visited. */
+guint sqlx_cache_visit_idle(sqlx_cache_t *cache, guint max, gint64 delay);
+
 /** One statistics for each possible base's status */
 struct cache_counts_s
 {
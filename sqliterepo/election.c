@@ -104,12 +104,54 @@ struct logged_event_s
 	enum election_step_e post :8;
 };
 
+#define WHEEL_BITS   6
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_SPAN   (((gint64)1) << (WHEEL_BITS * WHEEL_LEVELS))
+
+#define SHARD_CONDS  MAX(1, SQLX_MAX_COND / SQLX_ELECTION_SHARDS)
+
+/* @private
+ * A hierarchical timer wheel, with SQLX_ELECTION_TICK as precision. Each
+ * member is chained in the slot of its next deadline, so that playing the
+ * timers only costs the members whose deadline has been reached. */
+struct timer_wheel_s
+{
+	gint64 tick; /* the next tick to be played */
+
+	/* the members whose deadline was already reached when inserted */
+	struct election_member_s *late;
+
+	struct election_member_s *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+};
+
 /* @private */
-struct deque_beacon_s
+struct election_shard_s
 {
-	guint count;
-	struct election_member_s *front;
-	struct election_member_s *back;
+	GMutex lock;
+	GTree *members_by_key;
+	GHashTable *members_by_uid;
+	guint count_by_step[STEP_MAX];
+	guint32 next_uid;
+	struct timer_wheel_s wheel;
+	GCond conds[SHARD_CONDS];
+};
+
+/* @private
+ * Shared between the member and the bases it has been granted to, so that
+ * both sides only touch it with atomic operations. The times are in
+ * seconds of oio_ext_monotonic_seconds(). */
+struct election_lease_s
+{
+	volatile gint refcount;
+
+	/* until when the LEADER status can be trusted, 0 once revoked */
+	volatile gint deadline;
+
+	/* last time the lease has been checked, reported to the member by
+	 * its timers */
+	volatile gint atime;
 };
 
 struct election_manager_s
@@ -119,19 +161,19 @@ struct election_manager_s
 	struct sqlx_peering_s *peering;
 	struct sqlx_sync_s *sync;
 
-	/* XXX(jfs): used to generate <uid> of election members */
-	volatile guint32 next_uid;
-
 	/* do not free or change the fields below */
 	const struct replication_config_s *config;
 
-	GMutex lock;
-	GTree *members_by_key;
-	struct deque_beacon_s members_by_state[STEP_MAX];
+	/* The members are spread over the shards by the hash of their key,
+	 * each shard being protected by its own lock. */
+	struct election_shard_s shards[SQLX_ELECTION_SHARDS];
 
 	/* how long we accept to wait for a status. */
 	gint64 delay_wait;
 
+	/* how long a MASTER lease is valid, 0 for no lease */
+	gint64 delay_lease;
+
 	/* how long we wait before expiring a base */
 	gint64 delay_expire_none;
 	gint64 delay_expire_final;
@@ -149,19 +191,27 @@ struct election_manager_s
 	gint64 delay_ping_final;
 	gint64 delay_ping_failed;
 
-	gboolean exiting;
+	/* set by election_manager_exit_all(), read by the members of every
+	 * shard without any lock */
+	volatile gint exiting;
 
-	req_id_t next_id;
+	/* the first shard visited by the next election_manager_play_timers(),
+	 * so that a bounded round does not always favor the first shards */
+	volatile gint next_shard;
 
-	GCond conds[SQLX_MAX_COND];
+	volatile req_id_t next_id;
 };
 
 struct election_member_s
 {
+	/* chaining in the slot of the timer wheel */
 	struct election_member_s *prev;
 	struct election_member_s *next;
+	struct election_member_s **slot;
+	gint64 deadline;
 
 	struct election_manager_s *manager;
+	struct election_shard_s *shard;
 	struct sqlx_name_mutable_s name;
 	hashstr_t *key;
 
@@ -178,6 +228,8 @@ struct election_member_s
 	gint64 master_id; /* ID of the master */
 	gchar *master_url; /* First node of the children sequence (sorted by ID) */
 
+	struct election_lease_s *lease; /* Granted once LEADER */
+
 	guint refcount;
 
 	req_id_t reqid_PIPEFROM;
@@ -234,7 +286,8 @@ static GError * _election_exit(struct election_manager_s *manager,
 		const struct sqlx_name_s *n);
 
 static enum election_status_e _election_get_status(struct election_manager_s *m,
-		const struct sqlx_name_s *n, gchar **master_url);
+		const struct sqlx_name_s *n, gchar **master_url,
+		struct election_lease_s **lease);
 
 static struct election_manager_vtable_s VTABLE =
 {
@@ -270,6 +323,8 @@ static enum sqlx_action_e _member_get_next_action (
 static gboolean wait_for_final_status(struct election_member_s *m,
 		gint64 deadline);
 
+static void member_schedule(struct election_member_s *m);
+
 static int gint64_cmp(register gint64 i1, register gint64 i2) { return CMP(i1,i2); }
 
 static int
@@ -292,76 +347,133 @@ _thlocal_get_manager (void)
 
 /* -------------------------------------------------------------------------- */
 
+static struct election_shard_s *
+_manager_get_shard (struct election_manager_s *manager, const hashstr_t *key)
+{
+	register guint h = hashstr_hash(key);
+	return manager->shards + (h % SQLX_ELECTION_SHARDS);
+}
+
+/* The UID tells the shard of the member, see _LOCKED_init_member() */
+static struct election_member_s *
+_manager_locate_by_uid (struct election_manager_s *manager, const guint32 uid)
+{
+	struct election_shard_s *shard =
+		manager->shards + (uid % SQLX_ELECTION_SHARDS);
+	g_mutex_lock (&shard->lock);
+	struct election_member_s *m =
+		g_hash_table_lookup (shard->members_by_uid, GUINT_TO_POINTER(uid));
+	if (!m)
+		g_mutex_unlock (&shard->lock);
+	return m;
+}
+
+static gint64
+_WHEEL_tick (const gint64 when)
+{
+	return when / SQLX_ELECTION_TICK;
+}
+
 static void
-_DEQUE_remove (struct election_member_s *m)
-{
-	EXTRA_ASSERT(m != NULL);
-	EXTRA_ASSERT(m->step < STEP_MAX);
-	struct deque_beacon_s *beacon = m->manager->members_by_state + m->step;
-	EXTRA_ASSERT(beacon->count > 0);
-
-	struct election_member_s *prev = m->prev, *next = m->next;
-	if (beacon->front == m) beacon->front = next;
-	if (beacon->back == m) beacon->back = prev;
-	if (prev) prev->next = next;
-	if (next) next->prev = prev;
+_WHEEL_remove (struct election_member_s *m)
+{
+	if (!m->slot)
+		return;
+	if (m->prev)
+		m->prev->next = m->next;
+	else
+		*(m->slot) = m->next;
+	if (m->next)
+		m->next->prev = m->prev;
 	m->prev = m->next = NULL;
-	-- beacon->count;
+	m->slot = NULL;
 }
 
 static void
-_DEQUE_add (struct election_member_s *m)
+_WHEEL_push (struct election_member_s **slot, struct election_member_s *m)
 {
-	EXTRA_ASSERT(m != NULL);
-	EXTRA_ASSERT(m->step < STEP_MAX);
-	EXTRA_ASSERT(m->prev == NULL);
-	EXTRA_ASSERT(m->next == NULL);
-	struct deque_beacon_s *beacon = m->manager->members_by_state + m->step;
+	EXTRA_ASSERT(m->slot == NULL);
+	m->prev = NULL;
+	m->next = *slot;
+	if (*slot)
+		(*slot)->prev = m;
+	*slot = m;
+	m->slot = slot;
+}
 
-	if (beacon->back) {
-		m->prev = beacon->back;
-		beacon->back->next = m;
-	}
-	beacon->back = m;
-	if (!beacon->front)
-		beacon->front = m;
-	++ beacon->count;
+static void
+_WHEEL_insert (struct timer_wheel_s *w, struct election_member_s *m)
+{
+	EXTRA_ASSERT(m->slot == NULL);
+	if (m->deadline == G_MAXINT64)
+		return;
+
+	gint64 when = _WHEEL_tick(m->deadline);
+	const gint64 delta = when - w->tick;
+	if (delta < 0)
+		return _WHEEL_push (&w->late, m);
+	if (delta >= WHEEL_SPAN)
+		when = w->tick + WHEEL_SPAN - 1;
+
+	/* the lowest level where the slot won't be played before 'when' */
+	guint level = 0;
+	while (level < WHEEL_LEVELS - 1
+			&& (when - w->tick) >= ((gint64)1 << (WHEEL_BITS * (level + 1))))
+		++ level;
+
+	const guint idx = (when >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	_WHEEL_push (&w->slots[level][idx], m);
 }
 
-static struct election_member_s *
-_DEQUE_locate_by_uid (struct deque_beacon_s *beacon, const guint32 uid)
+static GSList *
+_WHEEL_drain (struct election_member_s **slot, GSList *out)
 {
-	for (struct election_member_s *m=beacon->back; m ; m=m->prev) {
-		if (m->uid == uid)
-			return m;
+	while (*slot) {
+		struct election_member_s *m = *slot;
+		_WHEEL_remove (m);
+		out = g_slist_prepend (out, m);
 	}
-	return NULL;
+	return out;
 }
 
-/* Locate an item by its UID.
-   Used for long-term watchers, we target first the status usually worn by
-   items when it happens. */
-static struct election_member_s *
-_manager_locate_by_uid (struct election_manager_s *manager, const guint32 uid)
+/* Spreads the members of a slot on the lower levels */
+static void
+_WHEEL_cascade (struct timer_wheel_s *w, guint level, guint idx)
+{
+	GSList *l0 = _WHEEL_drain (&w->slots[level][idx], NULL);
+	for (GSList *l = l0; l ;l = l->next)
+		_WHEEL_insert (w, l->data);
+	g_slist_free (l0);
+}
+
+/* Extracts the members whose deadline is reached, up to 'now' */
+static GSList *
+_WHEEL_advance (struct timer_wheel_s *w, const gint64 now)
 {
-	/* We also known that we have nothing to do with a member with no
-	   election started, so we choose this as iteration stop. */
-	static const int steps[] = {
-		STEP_LEAVING, /* legitimate + short list */
-		STEP_FAILED, /* legitimate + short list */
-		STEP_LEADER, STEP_LOST,
-		STEP_PRELEAD, STEP_PRELOST,
-		STEP_CANDOK, STEP_CANDREQ,
-		STEP_NONE /* must be last */,
-	};
-
-	for (const int *p = steps; *p != STEP_NONE ; ++p) {
-		struct election_member_s *out =
-			_DEQUE_locate_by_uid (manager->members_by_state + *p, uid);
-		if (out)
-			return out;
+	const gint64 target = _WHEEL_tick(now);
+	GSList *out = _WHEEL_drain (&w->late, NULL);
+
+	if (target - w->tick >= WHEEL_SPAN) {
+		/* Not played for a while, everything is due */
+		for (guint level = 0; level < WHEEL_LEVELS ;++level) {
+			for (guint idx = 0; idx < WHEEL_SLOTS ;++idx)
+				out = _WHEEL_drain (&w->slots[level][idx], out);
+		}
+		w->tick = target + 1;
+		return out;
 	}
-	return NULL;
+
+	for (; w->tick <= target ;++ w->tick) {
+		for (guint level = 1; level < WHEEL_LEVELS ;++level) {
+			const gint64 mask = ((gint64)1 << (WHEEL_BITS * level)) - 1;
+			if (w->tick & mask)
+				break;
+			_WHEEL_cascade (w, level,
+					(w->tick >> (WHEEL_BITS * level)) & WHEEL_MASK);
+		}
+		out = _WHEEL_drain (&w->slots[0][w->tick & WHEEL_MASK], out);
+	}
+	return out;
 }
 
 /* XXX Misc helpers --------------------------------------------------------- */
@@ -478,6 +590,7 @@ election_manager_create(struct replication_config_s *config,
 	struct election_manager_s *manager = g_malloc0(sizeof(*manager));
 	manager->vtable = &VTABLE;
 	manager->delay_wait = SQLX_DELAY_MAXWAIT;
+	manager->delay_lease = SQLX_DELAY_LEASE;
 	manager->delay_expire_none = 5 * G_TIME_SPAN_MINUTE;
 	manager->delay_expire_final = 5 * G_TIME_SPAN_MINUTE;
 	manager->delay_expire_failed = 5 * G_TIME_SPAN_MINUTE;
@@ -489,11 +602,17 @@ election_manager_create(struct replication_config_s *config,
 	manager->delay_ping_failed = SQLX_DELAY_PING_FAILED;
 	manager->config = config;
 
-	g_mutex_init(&manager->lock);
-	manager->members_by_key = g_tree_new_full (hashstr_quick_cmpdata, NULL, NULL, NULL);
-
-	for (guint i=0; i<SQLX_MAX_COND ;i++)
-		g_cond_init(manager->conds + i);
+	const gint64 tick = _WHEEL_tick(oio_ext_monotonic_time ());
+	for (guint i=0; i<SQLX_ELECTION_SHARDS ;i++) {
+		struct election_shard_s *shard = manager->shards + i;
+		g_mutex_init(&shard->lock);
+		shard->members_by_key = g_tree_new_full (hashstr_quick_cmpdata,
+				NULL, NULL, NULL);
+		shard->members_by_uid = g_hash_table_new (g_direct_hash, g_direct_equal);
+		shard->wheel.tick = tick;
+		for (guint j=0; j<SHARD_CONDS ;j++)
+			g_cond_init(shard->conds + j);
+	}
 
 	*result = manager;
 	return NULL;
@@ -535,6 +654,26 @@ election_has_peers (struct election_manager_s *m, const struct sqlx_name_s *n,
 	return NULL;
 }
 
+gboolean
+election_lease_valid (struct election_lease_s *lease)
+{
+	if (!lease)
+		return FALSE;
+	const gint now = oio_ext_monotonic_seconds ();
+	if (now >= g_atomic_int_get (&lease->deadline))
+		return FALSE;
+	if (now != g_atomic_int_get (&lease->atime))
+		g_atomic_int_set (&lease->atime, now);
+	return TRUE;
+}
+
+void
+election_lease_unref (struct election_lease_s *lease)
+{
+	if (lease && g_atomic_int_dec_and_test (&lease->refcount))
+		g_free (lease);
+}
+
 GError *
 election_get_peers (struct election_manager_s *m, const struct sqlx_name_s *n,
 		gboolean nocache, gchar ***peers)
@@ -564,21 +703,16 @@ election_manager_get_mode (const struct election_manager_s *m)
 	return ((struct abstract_election_manager_s*)m)->vtable->get_mode(m);
 }
 
-static struct election_counts_s
-_NOLOCK_count (struct election_manager_s *manager)
+static void
+_NOLOCK_count (struct election_shard_s *shard, struct election_counts_s *count)
 {
-	struct election_counts_s count = {0};
-	count.none = manager->members_by_state[STEP_NONE].count;
-	count.pending += manager->members_by_state[STEP_CANDREQ].count;
-	count.pending += manager->members_by_state[STEP_CANDOK].count;
-	count.pending += manager->members_by_state[STEP_LEAVING].count;
-	count.pending += manager->members_by_state[STEP_PRELOST].count;
-	count.pending += manager->members_by_state[STEP_PRELEAD].count;
-	count.slave = manager->members_by_state[STEP_LOST].count;
-	count.master = manager->members_by_state[STEP_LEADER].count;
-	count.failed = manager->members_by_state[STEP_FAILED].count;
-	count.total = count.none + count.pending + count.master + count.slave + count.failed;
-	return count;
+	const guint *c = shard->count_by_step;
+	count->none += c[STEP_NONE];
+	count->pending += c[STEP_CANDREQ] + c[STEP_CANDOK] + c[STEP_LEAVING]
+		+ c[STEP_PRELOST] + c[STEP_PRELEAD];
+	count->slave += c[STEP_LOST];
+	count->master += c[STEP_LEADER];
+	count->failed += c[STEP_FAILED];
 }
 
 struct election_counts_s
@@ -587,9 +721,14 @@ election_manager_count(struct election_manager_s *manager)
 	MANAGER_CHECK(manager);
 	EXTRA_ASSERT (manager->vtable == &VTABLE);
 
-	g_mutex_lock(&manager->lock);
-	struct election_counts_s count = _NOLOCK_count (manager);
-	g_mutex_unlock(&manager->lock);
+	struct election_counts_s count = {0};
+	for (guint i=0; i<SQLX_ELECTION_SHARDS ;i++) {
+		struct election_shard_s *shard = manager->shards + i;
+		g_mutex_lock(&shard->lock);
+		_NOLOCK_count (shard, &count);
+		g_mutex_unlock(&shard->lock);
+	}
+	count.total = count.none + count.pending + count.master + count.slave + count.failed;
 	return count;
 }
 
@@ -629,30 +768,36 @@ _manager_clean(struct election_manager_s *manager)
 	if (!manager)
 		return;
 
-	struct election_counts_s count = _NOLOCK_count(manager);
+	struct election_counts_s count = {0};
+	for (guint i=0; i<SQLX_ELECTION_SHARDS ;i++)
+		_NOLOCK_count(manager->shards + i, &count);
+	count.total = count.none + count.pending + count.master + count.slave + count.failed;
 	GRID_DEBUG("%d elections still alive at manager shutdown: %d masters, "
 			"%d slaves, %d pending, %d failed, %d exited",
 			count.total, count.master, count.slave, count.pending,
 			count.failed, count.none);
 
-	if (manager->members_by_key)
-		g_tree_destroy (manager->members_by_key);
-
-	/* Ensure all the items are unlinked */
-	for (int i=STEP_NONE; i<STEP_MAX ;++i) {
-		struct deque_beacon_s *beacon = manager->members_by_state + i;
-		while (beacon->front != NULL) {
-			struct election_member_s *m = beacon->front;
-			_DEQUE_remove(m);
+	for (guint i=0; i<SQLX_ELECTION_SHARDS ;i++) {
+		struct election_shard_s *shard = manager->shards + i;
+
+		/* Ensure all the items are unlinked */
+		GHashTableIter iter;
+		gpointer k, v;
+		g_hash_table_iter_init (&iter, shard->members_by_uid);
+		while (g_hash_table_iter_next (&iter, &k, &v)) {
+			struct election_member_s *m = v;
+			g_hash_table_iter_steal (&iter);
+			_WHEEL_remove (m);
 			m->refcount = 0; /* ugly quirk that cope with an assert on refcount */
 			member_destroy (m);
 		}
-		g_assert (beacon->count == 0);
-	}
 
-	g_mutex_clear(&manager->lock);
-	for (guint i=0; i<SQLX_MAX_COND; i++)
-		g_cond_clear(manager->conds + i);
+		g_tree_destroy (shard->members_by_key);
+		g_hash_table_destroy (shard->members_by_uid);
+		g_mutex_clear(&shard->lock);
+		for (guint j=0; j<SHARD_CONDS; j++)
+			g_cond_clear(shard->conds + j);
+	}
 	g_free(manager);
 }
 
@@ -681,7 +826,8 @@ _manager_get_mode (const struct election_manager_s *manager)
 static req_id_t
 manager_next_reqid(struct election_manager_s *m)
 {
-	return ++ m->next_id;
+	/* the members of distinct shards share the sequence */
+	return (req_id_t) g_atomic_int_add ((volatile gint*)&m->next_id, 1) + 1;
 }
 
 static gboolean
@@ -726,14 +872,14 @@ member_unref(struct election_member_s *m)
 static GCond*
 member_get_cond(struct election_member_s *m)
 {
-	register guint h = hashstr_hash(m->key);
-	return MMANAGER(m)->conds + (h % SQLX_MAX_COND);
+	register guint h = hashstr_hash(m->key) / SQLX_ELECTION_SHARDS;
+	return m->shard->conds + (h % SHARD_CONDS);
 }
 
 static GMutex*
 member_get_lock(struct election_member_s *m)
 {
-	return &(MMANAGER(m)->lock);
+	return &(m->shard->lock);
 }
 
 static void
@@ -798,13 +944,53 @@ member_set_id(struct election_member_s *m, gint64 id)
 	member_debug(__FUNCTION__, "ID", m);
 }
 
+static void
+member_revoke_lease(struct election_member_s *m)
+{
+	if (m->lease)
+		g_atomic_int_set(&m->lease->deadline, 0);
+}
+
+/* Returns a new reference to the lease, renewed */
+static struct election_lease_s *
+member_grant_lease(struct election_member_s *m)
+{
+	EXTRA_ASSERT(m->step == STEP_LEADER);
+	const gint64 delay = m->manager->delay_lease / G_TIME_SPAN_SECOND;
+	if (delay <= 0)
+		return NULL;
+	if (!m->lease) {
+		m->lease = g_malloc0(sizeof(struct election_lease_s));
+		m->lease->refcount = 1;
+	}
+	g_atomic_int_set(&m->lease->deadline,
+			(gint) (oio_ext_monotonic_seconds() + delay));
+	g_atomic_int_inc(&m->lease->refcount);
+	return m->lease;
+}
+
+/* The checks of the lease count as accesses to the member */
+static void
+member_fold_lease(struct election_member_s *m)
+{
+	if (!m->lease)
+		return;
+	const gint64 atime =
+		((gint64) g_atomic_int_get(&m->lease->atime)) * G_TIME_SPAN_SECOND;
+	if (atime > m->last_atime)
+		m->last_atime = atime;
+}
+
 static void
 member_set_status(struct election_member_s *m, enum election_step_e s)
 {
-	_DEQUE_remove (m);
+	if (s != STEP_LEADER)
+		member_revoke_lease(m);
+	-- m->shard->count_by_step[m->step];
 	m->last_status = oio_ext_monotonic_time ();
 	m->step = s;
-	_DEQUE_add (m);
+	++ m->shard->count_by_step[m->step];
+	member_schedule (m);
 	if (STATUS_FINAL(s)) {
 		member_debug(__FUNCTION__, "FINAL", m);
 		member_signal(m);
@@ -902,6 +1088,8 @@ member_destroy(struct election_member_s *member)
 
 	EXTRA_ASSERT (member->refcount == 0);
 
+	member_revoke_lease (member);
+	election_lease_unref (member->lease);
 	oio_str_clean (&member->master_url);
 	g_free0 (member->key);
 	sqlx_name_clean (&member->name);
@@ -936,26 +1124,29 @@ member_in_group(struct election_member_s *member, GArray *i64v)
 }
 
 static struct election_member_s *
-_LOCKED_get_member (struct election_manager_s *ma, const hashstr_t *k)
+_LOCKED_get_member (struct election_shard_s *shard, const hashstr_t *k)
 {
-	struct election_member_s *m = g_tree_lookup (ma->members_by_key, k);
+	struct election_member_s *m = g_tree_lookup (shard->members_by_key, k);
 	if (m) member_ref (m);
 	return m;
 }
 
 static struct election_member_s *
 _LOCKED_init_member(struct election_manager_s *manager,
+		struct election_shard_s *shard, const hashstr_t *key,
 		const struct sqlx_name_s *n, gboolean autocreate)
 {
 	MANAGER_CHECK(manager);
 	NAME_CHECK(n);
 
-	struct hashstr_s *key = sqliterepo_hash_name(n);
-	struct election_member_s *member = _LOCKED_get_member (manager, key);
+	struct election_member_s *member = _LOCKED_get_member (shard, key);
 	if (!member && autocreate) {
 		member = g_malloc0 (sizeof(*member));
-		member->uid = manager->next_id ++;
+		/* the UID remembers the shard, see _manager_locate_by_uid() */
+		member->uid = (shard - manager->shards)
+			+ SQLX_ELECTION_SHARDS * (shard->next_uid ++);
 		member->manager = manager;
+		member->shard = shard;
 		member->last_status = oio_ext_monotonic_time ();
 		member->key = hashstr_dup(key);
 		member->name.base = g_strdup(n->base);
@@ -964,19 +1155,39 @@ _LOCKED_init_member(struct election_manager_s *manager,
 		member->myid = member->master_id = -1;
 		member->refcount = 2;
 
-		_DEQUE_add (member);
-		g_tree_replace(manager->members_by_key, member->key, member);
+		++ shard->count_by_step[member->step];
+		g_tree_replace(shard->members_by_key, member->key, member);
+		g_hash_table_insert(shard->members_by_uid,
+				GUINT_TO_POINTER(member->uid), member);
+		member_schedule (member);
 	}
+	return member;
+}
+
+/* Locks the shard of the election, that will be released with
+ * member_unlock() */
+static struct election_member_s *
+manager_lock_member(struct election_manager_s *manager,
+		const struct sqlx_name_s *n, gboolean autocreate)
+{
+	hashstr_t *key = sqliterepo_hash_name(n);
+	struct election_shard_s *shard = _manager_get_shard (manager, key);
+	g_mutex_lock (&shard->lock);
+	struct election_member_s *member =
+		_LOCKED_init_member(manager, shard, key, n, autocreate);
 	g_free(key);
+	if (!member)
+		g_mutex_unlock (&shard->lock);
 	return member;
 }
 
 static struct election_member_s *
 manager_get_member (struct election_manager_s *m, const hashstr_t *k)
 {
-	g_mutex_lock (&m->lock);
-	struct election_member_s *member = _LOCKED_get_member (m, k);
-	g_mutex_unlock (&m->lock);
+	struct election_shard_s *shard = _manager_get_shard (m, k);
+	g_mutex_lock (&shard->lock);
+	struct election_member_s *member = _LOCKED_get_member (shard, k);
+	g_mutex_unlock (&shard->lock);
 	return member;
 }
 
@@ -1007,10 +1218,13 @@ election_manager_exit_all(struct election_manager_s *manager, gint64 duration,
 	gint64 pivot = oio_ext_monotonic_time () + duration;
 
 	/* Order the nodes to exit */
-	g_mutex_lock(&manager->lock);
-	manager->exiting = TRUE;
-	g_tree_foreach (manager->members_by_key, _run_exit, NULL);
-	g_mutex_unlock(&manager->lock);
+	g_atomic_int_set(&manager->exiting, TRUE);
+	for (guint i=0; i<SQLX_ELECTION_SHARDS ;i++) {
+		struct election_shard_s *shard = manager->shards + i;
+		g_mutex_lock(&shard->lock);
+		g_tree_foreach (shard->members_by_key, _run_exit, NULL);
+		g_mutex_unlock(&shard->lock);
+	}
 
 	for (guint count; 0 < (count = manager_count_active(manager)) ;) {
 		GRID_INFO("Waiting for %u active elections", count);
@@ -1021,7 +1235,7 @@ election_manager_exit_all(struct election_manager_s *manager, gint64 duration,
 		g_usleep(500 * G_TIME_SPAN_MILLISECOND);
 	}
 	if (!persist)
-		manager->exiting = FALSE;
+		g_atomic_int_set(&manager->exiting, FALSE);
 
 	GRID_INFO("No more active elections");
 }
@@ -1106,8 +1320,9 @@ election_manager_whatabout (struct election_manager_s *m,
 	EXTRA_ASSERT(ds > 0);
 
 	hashstr_t *key = sqliterepo_hash_name(n);
-	g_mutex_lock(&m->lock);
-	struct election_member_s *member = _LOCKED_get_member(m, key);
+	struct election_shard_s *shard = _manager_get_shard (m, key);
+	g_mutex_lock(&shard->lock);
+	struct election_member_s *member = _LOCKED_get_member(shard, key);
 	g_free(key);
 
 	GString *gs = g_string_new("");
@@ -1120,7 +1335,7 @@ election_manager_whatabout (struct election_manager_s *m,
 		else
 			g_string_append (gs, "null");
 	}
-	g_mutex_unlock(&m->lock);
+	g_mutex_unlock(&shard->lock);
 
 	g_strlcpy (d, gs->str, ds);
 	g_string_free (gs, TRUE);
@@ -1219,6 +1434,14 @@ step_WatchNode_completion(int zrc, const struct Stat *s, const void *d)
 	member_unlock(member);
 }
 
+static void
+step_StrayNode_completion(int zrc, const void *d)
+{
+	(void) d;
+	if (zrc != ZOK && zrc != ZNONODE)
+		GRID_WARN("Stray election node not deleted: (%d) %s", zrc, zerror(zrc));
+}
+
 static void
 step_StartElection_completion(int zrc, const char *path, const void *d)
 {
@@ -1233,7 +1456,18 @@ step_StartElection_completion(int zrc, const char *path, const void *d)
 	else {
 		if (!path)
 			transition(member, EVT_CREATE_KO, &zrc);
-		else {
+		else if (member->step != STEP_CANDREQ) {
+			/* Created after the member gave up waiting for it: nobody
+			 * would delete the node before the session expires, and it
+			 * would take part in the elections meanwhile. */
+			member_warn("Late creation", member);
+			gint64 i64 = g_ascii_strtoll(strrchr(path, '-')+1, NULL, 10);
+			gchar *p = g_strdup_printf("%s-%010"G_GINT64_FORMAT,
+					hashstr_str(member->key), i64);
+			sqlx_sync_adelete(member->manager->sync, p, -1,
+					step_StrayNode_completion, NULL);
+			g_free(p);
+		} else {
 			gint64 i64 = g_ascii_strtoll(strrchr(path, '-')+1, NULL, 10);
 			transition(member, EVT_CREATE_OK, &i64);
 		}
@@ -1249,15 +1483,11 @@ _find_member (void *d)
 	if (!manager)
 		return NULL;
 
-	struct election_member_s *member = NULL;
-	g_mutex_lock (&manager->lock);
-	member = _manager_locate_by_uid(manager, GPOINTER_TO_UINT(d));
-	if (member) {
+	struct election_member_s *member =
+		_manager_locate_by_uid(manager, GPOINTER_TO_UINT(d));
+	if (member)
 		member_ref (member);
-		return member;
-	}
-	g_mutex_unlock (&manager->lock);
-	return NULL;
+	return member;
 }
 
 static void
@@ -1420,8 +1650,10 @@ _election_make(struct election_manager_s *m, const struct sqlx_name_s *n,
 		}
 	}
 
-	g_mutex_lock(&m->lock);
-	struct election_member_s *member = _LOCKED_init_member(m, n, op != ELOP_EXIT);
+	struct election_member_s *member = manager_lock_member(m, n, op != ELOP_EXIT);
+	if (!member)
+		return NULL;
+
 	switch (op) {
 		case ELOP_NONE:
 			member->last_atime = oio_ext_monotonic_time ();
@@ -1435,13 +1667,12 @@ _election_make(struct election_manager_s *m, const struct sqlx_name_s *n,
 			transition(member, EVT_RESYNC_REQ, NULL);
 			break;
 		case ELOP_EXIT:
-			if (member)
-				transition(member, EVT_EXITING, NULL);
+			transition(member, EVT_EXITING, NULL);
 			break;
 	}
-	if (member)
-		member_unref(member);
-	g_mutex_unlock(&m->lock);
+	member_schedule(member);
+	member_unref(member);
+	member_unlock(member);
 
 	return NULL;
 }
@@ -1504,7 +1735,8 @@ wait_for_final_status(struct election_member_s *m, gint64 deadline)
 
 static enum election_status_e
 _election_get_status(struct election_manager_s *mgr,
-		const struct sqlx_name_s *n, gchar **master_url)
+		const struct sqlx_name_s *n, gchar **master_url,
+		struct election_lease_s **lease)
 {
 	int rc;
 	gchar *url = NULL;
@@ -1514,8 +1746,7 @@ _election_get_status(struct election_manager_s *mgr,
 
 	gint64 deadline = oio_ext_monotonic_time () + mgr->delay_wait;
 
-	g_mutex_lock(&mgr->lock);
-	struct election_member_s *m = _LOCKED_init_member(mgr, n, TRUE);
+	struct election_member_s *m = manager_lock_member(mgr, n, TRUE);
 	transition(m, EVT_NONE, NULL);
 
 	if (!wait_for_final_status(m, deadline)) // TIMEOUT!
@@ -1525,6 +1756,8 @@ _election_get_status(struct election_manager_s *mgr,
 		if (rc == STEP_LOST) {
 			if (m->master_url)
 				url = g_strdup(m->master_url);
+		} else if (rc == STEP_LEADER && lease) {
+			*lease = member_grant_lease(m);
 		}
 	}
 
@@ -1653,6 +1886,9 @@ _result_GETVERS (GError *enet,
 			if (worst < 0)
 				err = NEWERROR(CODE_PIPEFROM, "One diff missed");
 		}
+		if (err && err->code == CODE_PIPEFROM
+				&& manager->config->notify_outdated)
+			manager->config->notify_outdated (manager->config->ctx, name, TRUE);
 	}
 
 	hashstr_t *key = sqliterepo_hash_name (name);
@@ -1763,7 +1999,7 @@ restart_election(struct election_member_s *member)
 		return become_leaver(member);
 
 	member_reset(member);
-	if (member->manager->exiting)
+	if (g_atomic_int_get(&member->manager->exiting))
 		return member_set_status(member, STEP_NONE);
 
 	member->requested_USE = 0;
@@ -1895,6 +2131,66 @@ _member_get_next_action (const struct election_member_s *m)
 	return ACTION_NONE;
 }
 
+/* The first moment _is_over() turns TRUE, G_MAXINT64 for never */
+static gint64
+_deadline (const gint64 last, const gint64 delay)
+{
+	return last ? last + delay + 1 : G_MAXINT64;
+}
+
+/* The first moment _member_get_next_action() might return anything but
+ * ACTION_NONE, as long as the member is left untouched. */
+static gint64
+_member_get_next_deadline (const struct election_member_s *m)
+{
+	const struct election_manager_s *M = m->manager;
+
+	switch (m->step) {
+
+		case STEP_NONE:
+			return _deadline(m->last_status, M->delay_expire_none);
+
+		case STEP_LEAVING:
+			/* Never played by the timers: only the completion of the
+			 * deletion of its node makes a member leave the step. */
+			return G_MAXINT64;
+
+		case STEP_CANDREQ:
+		case STEP_CANDOK:
+		case STEP_PRELOST:
+		case STEP_PRELEAD:
+			return MIN(MIN(_deadline(m->last_status, M->delay_fail_pending),
+					_deadline(m->last_status, M->delay_retry_pending)),
+					_deadline(m->last_USE, M->delay_ping_pending));
+
+		case STEP_LOST:
+		case STEP_LEADER:
+			return MIN(_deadline(m->last_atime, M->delay_expire_final),
+					_deadline(m->last_USE, M->delay_ping_final));
+
+		case STEP_FAILED:
+			return MIN(MIN(_deadline(m->last_atime, M->delay_expire_failed),
+					_deadline(m->last_status, M->delay_retry_failed)),
+					_deadline(m->last_USE, M->delay_ping_failed));
+	}
+
+	g_assert_not_reached ();
+	return G_MAXINT64;
+}
+
+/* (Re)places the member in the timer wheel of its shard, at its next
+ * deadline. To be called each time the member has been touched. */
+static void
+member_schedule(struct election_member_s *m)
+{
+	const gint64 deadline = _member_get_next_deadline (m);
+	if (m->slot && deadline == m->deadline)
+		return;
+	_WHEEL_remove (m);
+	m->deadline = deadline;
+	_WHEEL_insert (&m->shard->wheel, m);
+}
+
 static void
 _member_react (struct election_member_s *member,
 		enum event_type_e evt,
@@ -1948,7 +2244,7 @@ _member_react (struct election_member_s *member,
 			switch (evt) {
 				case EVT_NONE:
 					member->requested_USE = 0;
-					if (member->manager->exiting) {
+					if (g_atomic_int_get(&member->manager->exiting)) {
 						member_reset_pending (member);
 						return;
 					}
@@ -2173,7 +2469,7 @@ _member_react (struct election_member_s *member,
 		case STEP_LEAVING:
 			switch (evt) {
 				case EVT_NONE:
-					if (!member->manager->exiting)
+					if (!g_atomic_int_get(&member->manager->exiting))
 						member->requested_USE = 1;
 					return;
 				case EVT_RESYNC_REQ:
@@ -2296,7 +2592,8 @@ transition(struct election_member_s *member, enum event_type_e evt,
 	if (member->requested_USE && (member->step == STEP_NONE))
 		restart_election(member);
 
-	return _member_play_timer (member, _member_get_next_action (member));
+	_member_play_timer (member, _member_get_next_action (member));
+	member_schedule (member);
 }
 
 static void
@@ -2311,72 +2608,76 @@ transition_error(struct election_member_s *member,
 	g_assert_not_reached();
 }
 
-static GSList *
-_DEQUE_extract (struct deque_beacon_s *beacon)
-{
-	GSList *out = NULL;
-	for (struct election_member_s *m=beacon->front; m ;m=m->next)
-		out = g_slist_prepend (out, m);
-	return g_slist_reverse (out);
-}
-
-guint
-election_manager_play_timers (struct election_manager_s *manager, guint max)
+static guint
+_LOCKED_play_timers (struct election_shard_s *shard, guint max)
 {
-	static const int steps[] = {
-		STEP_NONE,
-		STEP_FAILED, STEP_LEADER, STEP_LOST,
-		//STEP_LEAVING,
-		STEP_PRELEAD, STEP_PRELOST, STEP_CANDOK, STEP_CANDREQ,
-		-1 /* stops the iteration */
-	};
-
 	guint count = 0;
 	char descr[512];
-	g_mutex_lock (&manager->lock);
-	for (const int *pi=steps; *pi >= 0 && (!max || count < max) ;++pi) {
-		struct deque_beacon_s *beacon = manager->members_by_state + *pi;
-		if (!beacon->front)
+
+	/* working on a member might reschedule it, and even other members
+	   of the shard. so working with a temp. list avoids loops and wrong
+	   game on pointers. */
+	GSList *l0 = _WHEEL_advance (&shard->wheel, oio_ext_monotonic_time ());
+	for (GSList *l=l0; l ;l=l->next) {
+		struct election_member_s *m = l->data;
+
+		/* already rescheduled by the action on another member */
+		if (m->slot)
 			continue;
-		/* working on an item of the list might alterate the list, and even
-		   move the item itself to the tail. so working with a temp. list
-		   avoids loops and wrong game on pointers. */
-		GSList *l0 = _DEQUE_extract (beacon);
-		for (GSList *l=l0; l && (!max || count < max) ;l=l->next) {
-
-			struct election_member_s *m = l->data;
-			enum sqlx_action_e action = _member_get_next_action (m);
-			if (GRID_TRACE_ENABLED()) {
-				member_descr (m, descr, sizeof(descr));
-				GRID_TRACE("action [%s] %s", _action2str(action), descr);
-			}
 
-			if (action == ACTION_EXPIRE) {
-				if (m->refcount == 1) {
-					count ++;
-					_DEQUE_remove (m);
-					g_tree_remove (manager->members_by_key, m->key);
-					member_unref (m);
-					member_destroy (m);
-				}
-			} else {
-				if (action != ACTION_NONE)
-					count ++;
+		/* Beyond the limit, the due members are kept for the next round */
+		if (max && count >= max) {
+			_WHEEL_push (&shard->wheel.late, m);
+			continue;
+		}
 
-				enum election_step_e pre = m->step;
-				_member_play_timer (m, action);
-				enum election_step_e post = m->step;
-				if (pre == post) {
-					_DEQUE_remove (m);
-					_DEQUE_add (m);
-				}
+		member_fold_lease (m);
+		enum sqlx_action_e action = _member_get_next_action (m);
+		if (GRID_TRACE_ENABLED()) {
+			member_descr (m, descr, sizeof(descr));
+			GRID_TRACE("action [%s] %s", _action2str(action), descr);
+		}
 
+		if (action == ACTION_EXPIRE) {
+			if (m->refcount == 1) {
+				count ++;
+				-- shard->count_by_step[m->step];
+				g_tree_remove (shard->members_by_key, m->key);
+				g_hash_table_remove (shard->members_by_uid,
+						GUINT_TO_POINTER(m->uid));
+				if (m->manager->config->notify_outdated)
+					m->manager->config->notify_outdated (
+							m->manager->config->ctx,
+							sqlx_name_mutable_to_const (&m->name), FALSE);
+				member_unref (m);
+				member_destroy (m);
+			} else {
+				/* still referenced, retry at the next round */
+				_WHEEL_push (&shard->wheel.late, m);
 			}
+		} else {
+			if (action != ACTION_NONE)
+				count ++;
+			_member_play_timer (m, action);
+			member_schedule (m);
 		}
-		g_slist_free (l0);
-		l0 = NULL;
 	}
-	g_mutex_unlock (&manager->lock);
+	g_slist_free (l0);
+
+	return count;
+}
 
+guint
+election_manager_play_timers (struct election_manager_s *manager, guint max)
+{
+	guint count = 0;
+	const guint first = (guint) g_atomic_int_add (&manager->next_shard, 1);
+	for (guint i=0; i<SQLX_ELECTION_SHARDS && (!max || count < max) ;++i) {
+		struct election_shard_s *shard =
+			manager->shards + ((first + i) % SQLX_ELECTION_SHARDS);
+		g_mutex_lock (&shard->lock);
+		count += _LOCKED_play_timers (shard, max ? max - count : 0);
+		g_mutex_unlock (&shard->lock);
+	}
 	return count;
 }
@@ -38,6 +38,7 @@ struct election_manager_s;
 struct sqlx_sync_s;
 struct sqlx_peering_s;
 struct sqlx_name_s;
+struct election_lease_s;
 
 struct replication_config_s
 {
@@ -70,6 +71,13 @@ struct replication_config_s
 		ELECTION_MODE_GROUP     /**< A master is found when the whole group
 								 * agree */
 	} mode; /**< Is replication activated */
+
+	/** Optional. Called with 'outdated' set when the versions exchanged
+	 * with a peer tell the local base missed changes, and unset when the
+	 * election of the base expires, so that nothing is remembered about
+	 * the bases without election. */
+	void (*notify_outdated) (gpointer ctx, const struct sqlx_name_s *n,
+			gboolean outdated);
 };
 
 struct election_manager_vtable_s
@@ -102,9 +110,11 @@ struct election_manager_vtable_s
 			const struct sqlx_name_s *n);
 
 	/** Triggers the global election mechanism then wait for a final status
-	 * have been locally hit.  */
+	 * have been locally hit. When LEADER and 'lease' is not NULL, it may
+	 * receive a reference to the MASTER lease of the base. */
 	enum election_status_e (*election_get_status) (struct election_manager_s *manager,
-			const struct sqlx_name_s *n, gchar **master_url);
+			const struct sqlx_name_s *n, gchar **master_url,
+			struct election_lease_s **lease);
 
 	GError* (*election_trigger_RESYNC) (struct election_manager_s *m,
 			const struct sqlx_name_s *n);
@@ -137,7 +147,10 @@ GError* election_get_peers (struct election_manager_s *manager,
 	((struct abstract_election_manager_s*)m)->vtable->election_exit(m,n)
 
 #define election_get_status(m,n,pmaster) \
-	((struct abstract_election_manager_s*)m)->vtable->election_get_status(m,n,pmaster)
+	((struct abstract_election_manager_s*)m)->vtable->election_get_status(m,n,pmaster,NULL)
+
+#define election_get_status_leased(m,n,pmaster,please) \
+	((struct abstract_election_manager_s*)m)->vtable->election_get_status(m,n,pmaster,please)
 
 #define election_manager_trigger_RESYNC(m,n) \
 	((struct abstract_election_manager_s*)m)->vtable->election_trigger_RESYNC(m,n)
@@ -146,6 +159,15 @@ GError* election_get_peers (struct election_manager_s *manager,
 GError * election_has_peers (struct election_manager_s *m,
 		const struct sqlx_name_s *n, gboolean nocache, gboolean *ppresent);
 
+/* A MASTER lease is granted with a LEADER status, and revoked as soon as
+ * the local member leaves that step. While it is valid, the base can be
+ * served as MASTER without asking the election manager. Its validity is
+ * checked without any lock, and the check counts as an access to the
+ * election. NULL is never valid. */
+gboolean election_lease_valid (struct election_lease_s *lease);
+
+void election_lease_unref (struct election_lease_s *lease);
+
 /* Implementation-specific operations -------------------------------------- */
 
 /* Creates the election_manager structure.  */
@@ -33,6 +33,17 @@ License along with this library.
 #  define SQLX_MAX_COND 1024
 # endif
 
+/* How many independent tables (each with its own lock and timers) the
+ * members of an election manager are spread over */
+# ifndef  SQLX_ELECTION_SHARDS
+#  define SQLX_ELECTION_SHARDS 16
+# endif
+
+/* Precision of the timers of the elections, in microseconds */
+# ifndef  SQLX_ELECTION_TICK
+#  define SQLX_ELECTION_TICK (100 * G_TIME_SPAN_MILLISECOND)
+# endif
+
 # ifndef  SQLX_MAX_BASES
 #  define SQLX_MAX_BASES 2048
 # endif
@@ -45,6 +56,12 @@ License along with this library.
 #  define SQLX_GRACE_DELAY_HOT 300L
 # endif
 
+/* How long a MASTER can trust its status without asking the election
+ * manager again, in microseconds. Counted in whole seconds. 0 disables. */
+# ifndef  SQLX_DELAY_LEASE
+#  define SQLX_DELAY_LEASE (2 * G_TIME_SPAN_SECOND)
+# endif
+
 # ifndef  SQLX_DELAY_MAXWAIT
 #  define SQLX_DELAY_MAXWAIT 5 * G_TIME_SPAN_SECOND
 # endif
@@ -124,6 +141,8 @@ struct sqlx_repository_s
 	gchar basedir[512];
 
 	GTree *schemas;
+	/* <gchar*,NULL> the base types journaled in WAL mode */
+	GTree *wal_types;
 
 	/* Not owned */
 	struct sqlx_cache_s *cache;
@@ -156,6 +175,15 @@ struct sqlx_repository_s
 	enum sqlx_sync_mode_e sync_mode_solo;
 	enum sqlx_sync_mode_e sync_mode_repli;
 
+	/* The local SLAVE bases known to be behind their MASTER, with the time
+	 * they started to lag. <hashstr_t*,gint64*>. Its size is mirrored in
+	 * 'stale_count' so that the lookups skip the lock while it is empty,
+	 * i.e. most of the time. */
+	GMutex stale_lock;
+	GHashTable *stale;
+	volatile guint stale_count;
+	gint64 max_lag;
+
 	gboolean flag_autocreate : 1;
 	gboolean flag_autovacuum : 1;
 	gboolean flag_delete_on : 1;
@@ -60,6 +60,9 @@ struct sqlx_repctx_s
 	// Count the explicit changes, those matched
 	gint32 changes;
 
+	// When the transaction started, for the request's trace
+	gint64 tv_start;
+
 	// if set, there is no replication configured, even if a replicated
 	// transaction context had been initiated.
 	char hollow : 1;
@@ -407,7 +410,7 @@ _perform_REPLICATE(struct sqlx_repctx_s *ctx)
 		return 0;
 	}
 
-	err = _replicate_on_peers(peers, ctx);
+	OIO_TRACE("sqlx.replicate", err = _replicate_on_peers(peers, ctx));
 	g_strfreev(peers);
 	context_flush_rowsets(ctx);
 
@@ -551,6 +554,7 @@ sqlx_transaction_prepare(struct sqlx_sqlite3_s *sq3,
 	repctx->hollow = !has;
 	repctx->sq3 = sq3;
 	repctx->changes = sqlite3_total_changes(sq3->db);
+	repctx->tv_start = oio_ext_monotonic_time();
 
 	if (has) {
 		repctx->resync_todo = g_ptr_array_sized_new(4);
@@ -666,7 +670,7 @@ sqlx_transaction_end(struct sqlx_repctx_s *ctx, GError *err)
 		}
 
 		/* Apply the changes on the slaves. */
-		rc = sqlx_exec(ctx->sq3->db, "COMMIT");
+		OIO_TRACE("sqlx.commit", rc = sqlx_exec(ctx->sq3->db, "COMMIT"));
 		if (rc != SQLITE_OK && rc != SQLITE_DONE) {
 			err = NEWERROR(rc, "(%s) %s%s", sqlite_strerror(rc),
 					sqlite3_errmsg(ctx->sq3->db), ctx->errors->str);
@@ -697,6 +701,7 @@ sqlx_transaction_end(struct sqlx_repctx_s *ctx, GError *err)
 	sqlite3_commit_hook(ctx->sq3->db, NULL, NULL);
 	sqlite3_rollback_hook(ctx->sq3->db, NULL, NULL);
 	sqlite3_update_hook(ctx->sq3->db, NULL, NULL);
+	oio_ext_trace_span("sqlx.tnx", ctx->tv_start);
 	sqlx_replication_free_context(ctx);
 	return err;
 }
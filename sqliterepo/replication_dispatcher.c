@@ -410,8 +410,10 @@ _restore(struct sqlx_repository_s *repo, struct sqlx_name_s *name,
 	}
 	GRID_TRACE("Restore done!");
 
-	if (!err)
+	if (!err) {
+		sqlx_repository_notify_fresh(repo, name);
 		sqlx_repository_call_change_callback(sq3);
+	}
 
 	sqlx_repository_unlock_and_close_noerror(sq3);
 	return NULL;
@@ -427,6 +429,7 @@ _restore2(struct sqlx_repository_s *repo, struct sqlx_name_s *name,
 	if (!err) {
 		err = sqlx_repository_restore_from_file(sq3, path);
 		if (!err) {
+			sqlx_repository_notify_fresh(repo, name);
 			sqlx_repository_call_change_callback(sq3);
 		}
 	}
@@ -1429,12 +1432,16 @@ _handler_REPLICATE(struct gridd_reply_ctx_s *reply,
 		return TRUE;
 	}
 
-	/* Unpack the body from the message, decode it */
+	/* Unpack the body from the message, decode it. A change that could
+	 * not be applied leaves the base behind its MASTER until resynced. */
 	err = replicate_body_parse(sq3, b, bsize);
-	if (NULL != err)
+	if (NULL != err) {
+		sqlx_repository_notify_stale(repo, CONST(&name));
 		reply->send_error(0, err);
-	else
+	} else {
+		sqlx_repository_notify_fresh(repo, CONST(&name));
 		reply->send_reply(CODE_FINAL_OK, "OK");
+	}
 
 	sqlx_repository_unlock_and_close_noerror(sq3);
 
@@ -1765,6 +1772,7 @@ _handler_RESYNC(struct gridd_reply_ctx_s *reply,
 		return TRUE;
 	}
 
+	sqlx_repository_notify_stale(repo, CONST(&name));
 	err = sqlx_repository_retore_from_master(sq3);
 	sqlx_repository_unlock_and_close_noerror(sq3);
 
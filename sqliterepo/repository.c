@@ -128,6 +128,14 @@ __delete_base(struct sqlx_sqlite3_s *sq3)
 		GRID_WARN("DELETE failed [%s][%s] (%s) : (%d) %s",
 				sq3->name.base, sq3->name.type, sq3->path,
 				errno, strerror(errno));
+	if (sq3->wal) {
+		gchar *p = g_strconcat(sq3->path, "-wal", NULL);
+		unlink(p);
+		g_free(p);
+		p = g_strconcat(sq3->path, "-shm", NULL);
+		unlink(p);
+		g_free(p);
+	}
 	sq3->deleted = 0;
 }
 
@@ -174,11 +182,51 @@ __close_base(struct sqlx_sqlite3_s *sq3)
 	oio_str_clean (&sq3->path);
 	if (sq3->admin)
 		g_tree_destroy(sq3->admin);
+	election_lease_unref(sq3->lease);
 
 	sq3->bd = -1;
 	SLICE_FREE(struct sqlx_sqlite3_s, sq3);
 }
 
+static void
+__checkpoint_base(struct sqlx_sqlite3_s *sq3)
+{
+	if (!sq3 || !sq3->db || !sq3->wal)
+		return;
+
+	int frames = 0, done = 0;
+#ifdef SQLITE_CHECKPOINT_TRUNCATE
+	int rc = sqlite3_wal_checkpoint_v2(sq3->db, NULL,
+			SQLITE_CHECKPOINT_TRUNCATE, &frames, &done);
+#else
+	int rc = sqlite3_wal_checkpoint_v2(sq3->db, NULL,
+			SQLITE_CHECKPOINT_RESTART, &frames, &done);
+#endif
+	if (rc != SQLITE_OK)
+		GRID_DEBUG("CHECKPOINT failed [%s][%s]: (%d) %s", sq3->name.base,
+				sq3->name.type, rc, sqlite_strerror(rc));
+	else if (frames > 0)
+		GRID_TRACE("CHECKPOINT [%s][%s] %d/%d frames", sq3->name.base,
+				sq3->name.type, done, frames);
+}
+
+static gboolean
+_type_is_wal(sqlx_repository_t *repo, const char *type)
+{
+	if (!g_tree_nnodes(repo->wal_types))
+		return FALSE;
+	if (g_tree_lookup_extended(repo->wal_types, type, NULL, NULL))
+		return TRUE;
+	/* Same as for the schemas, meta2.* share the setting of meta2 */
+	const char *dot = strchr(type, '.');
+	if (!dot)
+		return FALSE;
+	gchar *realtype = g_strndup(type, dot - type);
+	gboolean rc = g_tree_lookup_extended(repo->wal_types, realtype, NULL, NULL);
+	g_free(realtype);
+	return rc;
+}
+
 static int
 _schema_apply (sqlite3 *db, const char *schema)
 {
@@ -317,6 +365,12 @@ sqlx_repository_init(const gchar *vol, const struct sqlx_repo_config_s *cfg,
 	repo->hash_width = 3;
 
 	repo->schemas = g_tree_new_full(metautils_strcmp3, NULL, g_free, g_free);
+	repo->wal_types = g_tree_new_full(metautils_strcmp3, NULL, g_free, NULL);
+
+	g_mutex_init(&repo->stale_lock);
+	repo->stale = g_hash_table_new_full(
+			(GHashFunc)hashstr_hash, (GEqualFunc)hashstr_equal, g_free, g_free);
+	repo->max_lag = SQLX_SLAVE_MAX_LAG;
 
 	repo->flag_autocreate = !cfg ? TRUE : BOOL(cfg->flags & SQLX_REPO_AUTOCREATE);
 	repo->flag_autovacuum = !cfg ? FALSE : BOOL(cfg->flags & SQLX_REPO_VACUUM);
@@ -379,6 +433,12 @@ sqlx_repository_clean(sqlx_repository_t *repo)
 
 	if (repo->schemas)
 		g_tree_destroy (repo->schemas);
+	if (repo->wal_types)
+		g_tree_destroy (repo->wal_types);
+
+	if (repo->stale)
+		g_hash_table_destroy (repo->stale);
+	g_mutex_clear (&repo->stale_lock);
 
 	memset(repo, 0, sizeof(*repo));
 	g_free(repo);
@@ -448,6 +508,93 @@ sqlx_repository_configure_open_timeout(sqlx_repository_t *repo,
 	}
 }
 
+void
+sqlx_repository_configure_wal(sqlx_repository_t *repo, const char *type,
+		gboolean wal)
+{
+	EXTRA_ASSERT(repo != NULL);
+	EXTRA_ASSERT(type != NULL);
+
+	if (wal)
+		g_tree_replace(repo->wal_types, g_strdup(type), NULL);
+	else
+		g_tree_remove(repo->wal_types, type);
+	GRID_INFO("Journal mode for type [%s]: %s", type, wal ? "WAL" : "MEMORY");
+
+	if (repo->cache)
+		sqlx_cache_set_idle_hook(repo->cache, g_tree_nnodes(repo->wal_types)
+				? (sqlx_cache_idle_hook)__checkpoint_base : NULL);
+}
+
+guint
+sqlx_repository_checkpoint_idle(sqlx_repository_t *repo, guint max,
+		gint64 delay)
+{
+	EXTRA_ASSERT(repo != NULL);
+	if (!repo->cache)
+		return 0;
+	return sqlx_cache_visit_idle(repo->cache, max, delay);
+}
+
+void
+sqlx_repository_configure_max_lag(sqlx_repository_t *repo, gint64 lag)
+{
+	EXTRA_ASSERT(repo != NULL);
+	repo->max_lag = lag;
+}
+
+void
+sqlx_repository_notify_stale(sqlx_repository_t *repo,
+		const struct sqlx_name_s *n)
+{
+	EXTRA_ASSERT(repo != NULL);
+	hashstr_t *key = sqliterepo_hash_name(n);
+	g_mutex_lock(&repo->stale_lock);
+	if (!g_hash_table_lookup(repo->stale, key)) {
+		gint64 *since = g_malloc(sizeof(gint64));
+		*since = oio_ext_monotonic_time();
+		g_hash_table_insert(repo->stale, key, since);
+		g_atomic_int_set(&repo->stale_count, g_hash_table_size(repo->stale));
+		key = NULL;
+	}
+	g_mutex_unlock(&repo->stale_lock);
+	g_free(key);
+}
+
+void
+sqlx_repository_notify_fresh(sqlx_repository_t *repo,
+		const struct sqlx_name_s *n)
+{
+	EXTRA_ASSERT(repo != NULL);
+	if (!g_atomic_int_get(&repo->stale_count))
+		return;
+	hashstr_t *key = sqliterepo_hash_name(n);
+	g_mutex_lock(&repo->stale_lock);
+	g_hash_table_remove(repo->stale, key);
+	g_atomic_int_set(&repo->stale_count, g_hash_table_size(repo->stale));
+	g_mutex_unlock(&repo->stale_lock);
+	g_free(key);
+}
+
+gint64
+sqlx_repository_get_lag(sqlx_repository_t *repo, const struct sqlx_name_s *n)
+{
+	EXTRA_ASSERT(repo != NULL);
+	if (!g_atomic_int_get(&repo->stale_count))
+		return 0;
+
+	gint64 since = 0;
+	hashstr_t *key = sqliterepo_hash_name(n);
+	g_mutex_lock(&repo->stale_lock);
+	gint64 *p = g_hash_table_lookup(repo->stale, key);
+	if (p)
+		since = *p;
+	g_mutex_unlock(&repo->stale_lock);
+	g_free(key);
+
+	return since ? MAX(1, oio_ext_monotonic_time() - since) : 0;
+}
+
 void
 sqlx_repository_configure_close_callback(sqlx_repository_t *repo,
 		sqlx_repo_close_hook cb, gpointer cb_data)
@@ -726,8 +873,13 @@ retry:
 	sq3->admin = g_tree_new_full(metautils_strcmp3, NULL,
 			g_free, metautils_gba_unref);
 
+	/* The journal mode follows the configuration of the type: a base left
+	 * in WAL mode by a former configuration is switched back to MEMORY
+	 * here, which checkpoints its WAL. */
+	sq3->wal = _type_is_wal(args->repo, args->name.type);
 	sqlx_exec(handle, "PRAGMA foreign_keys = OFF");
-	sqlx_exec(handle, "PRAGMA journal_mode = MEMORY");
+	if (!sq3->wal)
+		sqlx_exec(handle, "PRAGMA journal_mode = MEMORY");
 	sqlx_exec(handle, "PRAGMA temp_store = MEMORY");
 	if (!_schema_has(sq3->db)) {
 		if (sq3->repo->page_size >= 512) {
@@ -749,6 +901,16 @@ retry:
 	sqlx_admin_save_lazy (sq3);
 	sqlx_exec (handle, "COMMIT");
 
+	/* After the creation, so that the page size has been set. The WAL is
+	 * kept small for the hot bases, the idle ones are checkpointed apart. */
+	if (sq3->wal) {
+		sqlx_exec(handle, "PRAGMA journal_mode = WAL");
+		sqlx_exec(handle, "PRAGMA wal_autocheckpoint = "
+				G_STRINGIFY(SQLX_WAL_AUTOCHECKPOINT));
+		sqlx_exec(handle, "PRAGMA journal_size_limit = "
+				G_STRINGIFY(SQLX_WAL_SIZE_LIMIT));
+	}
+
 	/* Lazy DB config */
 	if (args->is_replicated) {
 		sqlx_exec(handle, _get_pragma_sync(args->repo->sync_mode_repli));
@@ -766,8 +928,8 @@ __open_maybe_cached(struct open_args_s *args, struct sqlx_sqlite3_s **result)
 	GError *e0;
 	gint bd = -1;
 
-	e0 = sqlx_cache_open_and_lock_base(args->repo->cache, args->realname,
-		   args->urgent, &bd);
+	OIO_TRACE("sqlx.open", e0 = sqlx_cache_open_and_lock_base(
+				args->repo->cache, args->realname, args->urgent, &bd));
 	if (e0 != NULL) {
 		g_prefix_error(&e0, "cache error: ");
 		return e0;
@@ -798,12 +960,52 @@ __open_maybe_cached(struct open_args_s *args, struct sqlx_sqlite3_s **result)
 	return e0;
 }
 
+static gboolean
+_handle_leased(gpointer handle)
+{
+	return election_lease_valid(((struct sqlx_sqlite3_s*)handle)->lease);
+}
+
+/* Only locks the base if cached with a valid MASTER lease. The election
+ * cannot be asked with the base locked: settling it may require the base
+ * (resync, versions asked by the peers). */
+static GError*
+_open_leased(struct open_args_s *args, struct sqlx_sqlite3_s **result)
+{
+	gint bd = -1;
+	if (!sqlx_cache_peek_handle(args->repo->cache, args->realname,
+				_handle_leased))
+		return NULL;
+
+	GError *err = sqlx_cache_open_and_lock_base(args->repo->cache,
+			args->realname, args->urgent, &bd);
+	if (err) {
+		g_prefix_error(&err, "cache error: ");
+		return err;
+	}
+
+	struct sqlx_sqlite3_s *sq3 = sqlx_cache_get_handle(args->repo->cache, bd);
+	if (sq3 && election_lease_valid(sq3->lease)) {
+		*result = sq3;
+		return NULL;
+	}
+
+	err = sqlx_cache_unlock_and_close_base(args->repo->cache, bd, FALSE);
+	if (err) {
+		GRID_WARN("BASE unlock/close error on bd=%d : (%d) %s",
+				bd, err->code, err->message);
+		g_clear_error(&err);
+	}
+	return NULL;
+}
+
 static GError*
 _open_and_lock_base(struct open_args_s *args, enum election_status_e expected,
 		struct sqlx_sqlite3_s **result, gchar **pmaster)
 {
 	GError *err = NULL;
 	enum election_status_e status = 0;
+	struct election_lease_s *lease = NULL;
 
 	gboolean election_configured = election_manager_configured(
 			args->repo->election_manager);
@@ -820,6 +1022,22 @@ _open_and_lock_base(struct open_args_s *args, enum election_status_e expected,
 			args->is_replicated = TRUE;
 	}
 
+	/* Within its lease, a MASTER skips the election. Only for the requests
+	 * that the MASTER alone serves, on a replicated base already cached:
+	 * the others would lock the base for nothing. */
+	if (election_configured && expected == ELECTION_LEADER
+			&& args->is_replicated && args->repo->cache) {
+		*result = NULL;
+		if (NULL != (err = _open_leased(args, result)))
+			return err;
+		if (*result) {
+			if ((*result)->admin_dirty)
+				sqlx_alert_dirty_base (*result, "opened with dirty admin");
+			(*result)->election = ELECTION_LEADER;
+			return NULL;
+		}
+	}
+
 	/* Now manage the replication status */
 	if (!expected || !election_configured || !args->is_replicated) {
 		GRID_TRACE("No status (%d) expected on [%s][%s] (peers found: %s)",
@@ -828,7 +1046,9 @@ _open_and_lock_base(struct open_args_s *args, enum election_status_e expected,
 	} else {
 		gchar *url = NULL;
 
-		status = election_get_status(args->repo->election_manager, &args->name, &url);
+		OIO_TRACE("sqlx.election", status = election_get_status_leased(
+					args->repo->election_manager, &args->name, &url,
+					args->repo->cache ? &lease : NULL));
 		GRID_TRACE("Status got=%d expected=%d master=%s", status, expected, url);
 
 		switch (status) {
@@ -840,11 +1060,21 @@ _open_and_lock_base(struct open_args_s *args, enum election_status_e expected,
 						err = NEWERROR(CODE_REDIRECT, "%s", url);
 					else
 						err = NEWERROR(CODE_BADOPFORSLAVE, "not SLAVE");
+				} else if ((expected & ELECTION_LEADER) && url
+						&& args->repo->max_lag >= 0) {
+					/* A read that the MASTER could serve: the SLAVE only
+					 * serves it if not too far behind */
+					const gint64 lag = sqlx_repository_get_lag(
+							args->repo, &args->name);
+					if (lag > args->repo->max_lag)
+						err = NEWERROR(CODE_REDIRECT, "%s", url);
 				}
 				break;
 			case ELECTION_LEADER:
 				if (!(expected & ELECTION_LEADER))
 					err = NEWERROR(CODE_BADOPFORSLAVE, "not SLAVE");
+				/* What lagged as a SLAVE has been synced when elected */
+				sqlx_repository_notify_fresh(args->repo, &args->name);
 				break;
 			case ELECTION_FAILED:
 				err = NEWERROR(CODE_INTERNAL_ERROR, "Election failed [%s][%s]",
@@ -863,7 +1093,13 @@ _open_and_lock_base(struct open_args_s *args, enum election_status_e expected,
 		if ((*result)->admin_dirty)
 			sqlx_alert_dirty_base (*result, "opened with dirty admin");
 		(*result)->election = status;
+		if (lease) {
+			election_lease_unref((*result)->lease);
+			(*result)->lease = lease;
+			lease = NULL;
+		}
 	}
+	election_lease_unref(lease);
 	return err;
 }
 
@@ -1328,6 +1564,11 @@ sqlx_repository_dump_base_fd(struct sqlx_sqlite3_s *sq3,
 						sqlite_strerror(rc), errno, strerror(errno));
 			} else {
 				err = _backup_main(sq3->db, dst);
+				/* The backup read the WAL through the connection, but the
+				 * copied header still tells WAL: the dump must be a plain
+				 * base, readable without its WAL */
+				if (!err && sq3->wal)
+					sqlx_exec(dst, "PRAGMA journal_mode = DELETE");
 			}
 			_close_handle(&dst);
 			unlink(path);
@@ -1415,7 +1656,12 @@ sqlx_repository_restore_from_file(struct sqlx_sqlite3_s *sq3,
 				sqlite_strerror(rc), errno, strerror(errno));
 		g_prefix_error(&err, "Invalid raw SQLite base: ");
 	} else { /* Backup now! */
+		/* No backup into a WAL base with a different page size */
+		if (sq3->wal)
+			sqlx_exec(sq3->db, "PRAGMA journal_mode = DELETE");
 		err = _backup_main(src, sq3->db);
+		if (sq3->wal)
+			sqlx_exec(sq3->db, "PRAGMA journal_mode = WAL");
 		_close_handle(&src);
 		sqlx_admin_reload(sq3);
 	}
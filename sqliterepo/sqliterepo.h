@@ -111,10 +111,12 @@ struct sqlx_sqlite3_s
 	GTree *admin; // <gchar*,GByteArray*>
 	gint bd; // ID in cache
 	enum election_status_e election; // set at open(), reset at close()
+	struct election_lease_s *lease; // MASTER lease, kept while cached
 
 	gboolean admin_dirty : 8;
 	gboolean deleted : 8;
 	gboolean no_peers : 8; // Prevent get_peers()
+	gboolean wal : 8; // journaled in WAL mode
 };
 
 struct sqlx_repo_config_s
@@ -197,6 +199,40 @@ GError* sqlx_repository_configure_type(sqlx_repository_t *repo,
 void sqlx_repository_configure_open_timeout(sqlx_repository_t *repo,
 		gint64 timeout);
 
+/* Journal the bases of the given type in WAL mode instead of in memory.
+ * Their WAL is checkpointed when they are idle, by
+ * sqlx_repository_checkpoint_idle(). */
+void sqlx_repository_configure_wal(sqlx_repository_t *repo,
+		const char *type, gboolean wal);
+
+/* Checkpoints the WAL of at most 'max' bases left idle for at least
+ * 'delay' (oio_ext_monotonic_time() precision). Returns how many bases
+ * have been visited. */
+guint sqlx_repository_checkpoint_idle(sqlx_repository_t *repo,
+		guint max, gint64 delay);
+
+/* Set how long a SLAVE base behind its MASTER still serves the reads
+ * (SQLX_OPEN_MASTERSLAVE), beyond they are redirected to the MASTER. A
+ * negative value lets the SLAVE serve whatever its lag. Precision uniform
+ * with oio_ext_monotonic_time(). */
+void sqlx_repository_configure_max_lag(sqlx_repository_t *repo,
+		gint64 lag);
+
+/* Tells the local copy of the base missed a change from its MASTER */
+void sqlx_repository_notify_stale(sqlx_repository_t *repo,
+		const struct sqlx_name_s *n);
+
+/* Tells the local copy of the base caught up with its MASTER, or that its
+ * state is not tracked anymore (its election expired, the next one will
+ * compare the versions again) */
+void sqlx_repository_notify_fresh(sqlx_repository_t *repo,
+		const struct sqlx_name_s *n);
+
+/* How long the local copy of the base has been behind its MASTER, 0 if it
+ * is not known to be late. */
+gint64 sqlx_repository_get_lag(sqlx_repository_t *repo,
+		const struct sqlx_name_s *n);
+
 void sqlx_repository_configure_close_callback(sqlx_repository_t *repo,
 		sqlx_repo_close_hook cb, gpointer cb_data);
 
@@ -76,6 +76,10 @@ static int _awget_siblings (struct sqlx_sync_s *ss, const char *path,
 static void _set_exit_hook(struct sqlx_sync_s *ss, void (*on_exit_hook) (void*),
 		void *on_exit_ctx);
 
+static int _amulti (struct sqlx_sync_s *ss, int count, const zoo_op_t *ops,
+		zoo_op_result_t *results, void_completion_t completion,
+		const void *data);
+
 static struct sqlx_sync_vtable_s VTABLE =
 {
 	_clear,
@@ -87,7 +91,8 @@ static struct sqlx_sync_vtable_s VTABLE =
 	_awget,
 	_awget_children,
 	_awget_siblings,
-	_set_exit_hook
+	_set_exit_hook,
+	_amulti
 };
 
 struct sqlx_sync_s*
@@ -344,6 +349,857 @@ _awget_siblings (struct sqlx_sync_s *ss, const char *path,
 	return rc;
 }
 
+static int
+_amulti (struct sqlx_sync_s *ss, int count, const zoo_op_t *ops,
+		zoo_op_result_t *results, void_completion_t completion, const void *data)
+{
+	EXTRA_ASSERT(ss != NULL);
+	EXTRA_ASSERT(ss->vtable == &VTABLE);
+
+	/* zoo_amulti() serializes the ops before returning, a temporary copy
+	 * with the real paths is enough. */
+	zoo_op_t *real = g_memdup(ops, count * sizeof(zoo_op_t));
+	gchar **paths = g_malloc0(count * sizeof(gchar*));
+	for (int i=0; i<count ;i++) {
+		switch (ops[i].type) {
+			case ZOO_CREATE_OP:
+				paths[i] = _realpath(ss, ops[i].create_op.path);
+				real[i].create_op.path = paths[i];
+				break;
+			case ZOO_DELETE_OP:
+				paths[i] = _realpath(ss, ops[i].delete_op.path);
+				real[i].delete_op.path = paths[i];
+				break;
+			case ZOO_SETDATA_OP:
+				paths[i] = _realpath(ss, ops[i].set_op.path);
+				real[i].set_op.path = paths[i];
+				break;
+			case ZOO_CHECK_OP:
+				paths[i] = _realpath(ss, ops[i].check_op.path);
+				real[i].check_op.path = paths[i];
+				break;
+		}
+	}
+
+	int rc = zoo_amulti(ss->zh, count, real, results, completion, data);
+	GRID_TRACE2("SYNC multi(%d) = %d", count, rc);
+
+	for (int i=0; i<count ;i++)
+		g_free(paths[i]);
+	g_free(paths);
+	g_free(real);
+	return rc;
+}
+
+/* Batching wrapper --------------------------------------------------------- */
+
+/* Large enough for any mangled path of an election node */
+#define BATCH_PATHLEN 1024
+
+struct sqlx_sync_batch_s
+{
+	struct sqlx_sync_vtable_s *vtable;
+	struct sqlx_sync_s *sub;
+
+	/* how many leading characters of a path tell its directory */
+	guint dirlen;
+
+	GMutex lock;
+
+	/* the creations arrived while another is in flight */
+	GPtrArray *creations;
+	gboolean creating;
+
+	/* <gchar*,struct batch_dir_s*> */
+	GHashTable *dirs;
+
+	/* Completes the operations that failed in the thread that issued
+	 * them, once accepted: <struct batch_failure_s*> */
+	GThreadPool *failures;
+};
+
+struct batch_create_s
+{
+	struct sqlx_sync_batch_s *batch;
+	gchar *path;
+	gchar *value;
+	int vlen;
+	int flags;
+	string_completion_t completion;
+	const void *data;
+};
+
+struct batch_multi_s
+{
+	struct sqlx_sync_batch_s *batch;
+	guint count;
+	struct batch_create_s **items;
+	zoo_op_t *ops;
+	zoo_op_result_t *results;
+	gchar *buffers;
+};
+
+struct batch_watch_s
+{
+	gchar *path;
+	watcher_fn watcher;
+	void *watcher_ctx;
+	/* at most one is set */
+	stat_completion_t on_stat;
+	strings_completion_t on_list;
+	const void *data;
+};
+
+struct batch_dir_s
+{
+	struct sqlx_sync_batch_s *batch;
+
+	/* any path in the directory, to be given to awget_siblings() */
+	gchar *sample;
+
+	/* served by the listing in flight */
+	GSList *waiting;
+	/* arrived after the listing in flight has been sent */
+	GSList *next;
+	/* nodes known to be present, whose watcher waits for their deletion.
+	 * A set of <struct batch_watch_s*>, on the path and the watcher. */
+	GHashTable *watched;
+
+	gboolean listing;
+	/* the children changed while listing */
+	gboolean dirty;
+};
+
+/* What to call once the lock released. A copy, because the entry may be
+ * freed meanwhile. */
+struct batch_notify_s
+{
+	struct batch_watch_s w;
+	int rc;
+	int type;
+	int state;
+};
+
+/* One of 'create' or 'watch' is set */
+struct batch_failure_s
+{
+	int rc;
+	struct batch_create_s *create;
+	struct batch_watch_s *watch;
+};
+
+static void _batch_clear (struct sqlx_sync_s *ss);
+
+static GError* _batch_open (struct sqlx_sync_s *ss);
+
+static void _batch_close (struct sqlx_sync_s *ss);
+
+static int _batch_acreate (struct sqlx_sync_s *ss, const char *path,
+		const char *v, int vlen, int flags, string_completion_t completion,
+		const void *data);
+
+static int _batch_adelete (struct sqlx_sync_s *ss, const char *path,
+		int version, void_completion_t completion, const void *data);
+
+static int _batch_awexists (struct sqlx_sync_s *ss, const char *path,
+		watcher_fn watcher, void* watcherCtx,
+		stat_completion_t completion, const void *data);
+
+static int _batch_awget (struct sqlx_sync_s *ss, const char *path,
+		watcher_fn watcher, void* watcherCtx,
+		data_completion_t completion, const void *data);
+
+static int _batch_awget_children (struct sqlx_sync_s *ss, const char *path,
+		watcher_fn watcher, void* watcherCtx,
+		strings_completion_t completion, const void *data);
+
+static int _batch_awget_siblings (struct sqlx_sync_s *ss, const char *path,
+		watcher_fn watcher, void* watcherCtx,
+		strings_completion_t completion, const void *data);
+
+static void _batch_set_exit_hook(struct sqlx_sync_s *ss,
+		void (*on_exit_hook) (void*), void *on_exit_ctx);
+
+static struct sqlx_sync_vtable_s VTABLE_BATCH =
+{
+	_batch_clear,
+	_batch_open,
+	_batch_close,
+	_batch_acreate,
+	_batch_adelete,
+	_batch_awexists,
+	_batch_awget,
+	_batch_awget_children,
+	_batch_awget_siblings,
+	_batch_set_exit_hook,
+	NULL
+};
+
+#define BATCH(ss) ((struct sqlx_sync_batch_s*)(ss))
+
+static void
+_batch_create_free (struct batch_create_s *c)
+{
+	if (!c)
+		return;
+	g_free (c->path);
+	g_free (c->value);
+	g_free (c);
+}
+
+static void
+_batch_watch_free (struct batch_watch_s *w)
+{
+	if (!w)
+		return;
+	g_free (w->path);
+	g_free (w);
+}
+
+static guint
+_batch_watch_hash (gconstpointer p)
+{
+	const struct batch_watch_s *w = p;
+	return g_str_hash (w->path) ^ g_direct_hash (w->watcher)
+		^ g_direct_hash (w->watcher_ctx);
+}
+
+static gboolean
+_batch_watch_equal (gconstpointer p0, gconstpointer p1)
+{
+	const struct batch_watch_s *w0 = p0, *w1 = p1;
+	return w0->watcher == w1->watcher && w0->watcher_ctx == w1->watcher_ctx
+		&& !strcmp (w0->path, w1->path);
+}
+
+static void
+_batch_dir_free (struct batch_dir_s *dir)
+{
+	if (!dir)
+		return;
+	g_slist_free_full (dir->waiting, (GDestroyNotify)_batch_watch_free);
+	g_slist_free_full (dir->next, (GDestroyNotify)_batch_watch_free);
+	g_hash_table_destroy (dir->watched);
+	g_free (dir->sample);
+	g_free (dir);
+}
+
+static void _batch_fail (gpointer p, gpointer u);
+
+struct sqlx_sync_s *
+sqlx_sync_factory__create_batch(struct sqlx_sync_s *sub, guint w, guint d)
+{
+	EXTRA_ASSERT(sub != NULL);
+	struct sqlx_sync_batch_s *b = g_malloc0(sizeof(*b));
+	b->vtable = &VTABLE_BATCH;
+	b->sub = sub;
+	/* Same as in _realdirname() */
+	switch (MIN(d,2)) {
+		case 0:
+			b->dirlen = 0;
+			break;
+		case 1:
+			b->dirlen = CLAMP(w, 1, 3);
+			break;
+		default:
+			b->dirlen = 2 * CLAMP(w, 1, 2);
+			break;
+	}
+	g_mutex_init (&b->lock);
+	b->creations = g_ptr_array_new ();
+	b->dirs = g_hash_table_new_full (g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify)_batch_dir_free);
+	b->failures = g_thread_pool_new (_batch_fail, b, 1, FALSE, NULL);
+	return (struct sqlx_sync_s*) b;
+}
+
+static void
+_batch_clear (struct sqlx_sync_s *ss)
+{
+	struct sqlx_sync_batch_s *b = BATCH(ss);
+	EXTRA_ASSERT(b->vtable == &VTABLE_BATCH);
+
+	/* First, so that no completion comes after */
+	sqlx_sync_clear (b->sub);
+	b->sub = NULL;
+	g_thread_pool_free (b->failures, FALSE, TRUE);
+
+	/* The operations never sent are reported as the pending ones are when
+	 * the connection is closed */
+	for (guint i=0; i<b->creations->len ;i++) {
+		struct batch_create_s *c = b->creations->pdata[i];
+		if (c->completion)
+			c->completion (ZCLOSING, NULL, c->data);
+		_batch_create_free (c);
+	}
+	g_ptr_array_free (b->creations, TRUE);
+	g_hash_table_destroy (b->dirs);
+	g_mutex_clear (&b->lock);
+	g_free (b);
+}
+
+static GError *
+_batch_open (struct sqlx_sync_s *ss)
+{
+	EXTRA_ASSERT(BATCH(ss)->vtable == &VTABLE_BATCH);
+	return sqlx_sync_open (BATCH(ss)->sub);
+}
+
+static void
+_batch_close (struct sqlx_sync_s *ss)
+{
+	EXTRA_ASSERT(BATCH(ss)->vtable == &VTABLE_BATCH);
+	sqlx_sync_close (BATCH(ss)->sub);
+}
+
+static void
+_batch_set_exit_hook(struct sqlx_sync_s *ss, void (*on_exit_hook) (void*),
+		void *on_exit_ctx)
+{
+	EXTRA_ASSERT(BATCH(ss)->vtable == &VTABLE_BATCH);
+	sqlx_sync_set_exit_hook (BATCH(ss)->sub, on_exit_hook, on_exit_ctx);
+}
+
+static int
+_batch_adelete (struct sqlx_sync_s *ss, const char *path, int version,
+		void_completion_t completion, const void *data)
+{
+	EXTRA_ASSERT(BATCH(ss)->vtable == &VTABLE_BATCH);
+	return sqlx_sync_adelete (BATCH(ss)->sub, path, version, completion, data);
+}
+
+static int
+_batch_awget_children (struct sqlx_sync_s *ss, const char *path,
+		watcher_fn watcher, void* watcherCtx,
+		strings_completion_t completion, const void *data)
+{
+	EXTRA_ASSERT(BATCH(ss)->vtable == &VTABLE_BATCH);
+	return sqlx_sync_awget_children (BATCH(ss)->sub, path,
+			watcher, watcherCtx, completion, data);
+}
+
+/* Creations ------------------------------------------------------------------
+ * A creation arriving while none is in flight is sent at once, alone. The
+ * next ones are queued, then sent all together when the one in flight
+ * completes. Under a low load, the latency is then unchanged.
+ * The completions are never called from the thread that issued the
+ * operation: it may hold a lock the completion needs. So when the sending
+ * fails there, the creations queued meanwhile are failed by another
+ * thread. */
+
+static void _batch_next_creations (struct sqlx_sync_batch_s *b);
+
+static void _batch_created_alone (int rc, const char *value,
+		const void *data);
+
+static void _batch_notify (GArray *notifications, zhandle_t *zh,
+		const struct String_vector *sv);
+
+static void _batch_notify_push (GArray *notifications,
+		struct batch_watch_s *w, int rc, int type, int state, gboolean done);
+
+static void
+_batch_defer_failure (struct sqlx_sync_batch_s *b, int rc,
+		struct batch_create_s *c, struct batch_watch_s *w)
+{
+	struct batch_failure_s *f = g_malloc0 (sizeof(*f));
+	f->rc = rc;
+	f->create = c;
+	f->watch = w;
+	g_thread_pool_push (b->failures, f, NULL);
+}
+
+static void
+_batch_fail (gpointer p, gpointer u)
+{
+	(void) u;
+	struct batch_failure_s *f = p;
+	if (f->create)
+		_batch_created_alone (f->rc, NULL, f->create);
+	if (f->watch) {
+		/* a watch without a request is lost like after a failed listing */
+		GArray *notifications = g_array_new (FALSE, FALSE,
+				sizeof(struct batch_notify_s));
+		const gboolean request = f->watch->on_stat || f->watch->on_list;
+		_batch_notify_push (notifications, f->watch, f->rc,
+				request ? 0 : ZOO_NOTWATCHING_EVENT,
+				request ? 0 : ZOO_CONNECTED_STATE, TRUE);
+		_batch_notify (notifications, NULL, NULL);
+		g_array_free (notifications, TRUE);
+	}
+	g_free (f);
+}
+
+static void
+_batch_created_alone (int rc, const char *value, const void *data)
+{
+	struct batch_create_s *c = (struct batch_create_s *) data;
+	if (c->completion)
+		c->completion (rc, value, c->data);
+	_batch_create_free (c);
+}
+
+static void
+_batch_created_first (int rc, const char *value, const void *data)
+{
+	struct batch_create_s *c = (struct batch_create_s *) data;
+	struct sqlx_sync_batch_s *b = c->batch;
+	_batch_created_alone (rc, value, data);
+	_batch_next_creations (b);
+}
+
+static int
+_batch_send_alone (struct batch_create_s *c, string_completion_t completion)
+{
+	return sqlx_sync_acreate (c->batch->sub, c->path, c->value, c->vlen,
+			c->flags, completion, c);
+}
+
+static void
+_batch_multi_free (struct batch_multi_s *m)
+{
+	g_free (m->items);
+	g_free (m->ops);
+	g_free (m->results);
+	g_free (m->buffers);
+	g_free (m);
+}
+
+static void
+_batch_created_multi (int rc, const void *data)
+{
+	struct batch_multi_s *m = (struct batch_multi_s *) data;
+	struct sqlx_sync_batch_s *b = m->batch;
+
+	GRID_TRACE("SYNC batch of %u creations: %d", m->count, rc);
+	if (rc == ZOK) {
+		for (guint i=0; i<m->count ;i++) {
+			zoo_op_result_t *r = m->results + i;
+			_batch_created_alone (r->err,
+					r->err == ZOK ? r->value : NULL, m->items[i]);
+		}
+	} else if (rc < ZAPIERROR || rc == ZUNIMPLEMENTED) {
+		/* The transaction has been refused because of (at least) one of the
+		 * creations, the others must not fail with it. Or the server does
+		 * not know the multi-ops. */
+		for (guint i=0; i<m->count ;i++) {
+			struct batch_create_s *c = m->items[i];
+			int zrc = _batch_send_alone (c, _batch_created_alone);
+			if (zrc != ZOK)
+				_batch_created_alone (zrc, NULL, c);
+		}
+	} else {
+		for (guint i=0; i<m->count ;i++)
+			_batch_created_alone (rc, NULL, m->items[i]);
+	}
+
+	_batch_multi_free (m);
+	_batch_next_creations (b);
+}
+
+/* Only called by the completions */
+static void
+_batch_next_creations (struct sqlx_sync_batch_s *b)
+{
+	for (;;) {
+		g_mutex_lock (&b->lock);
+		const guint count = MIN(b->creations->len, SQLX_SYNC_BATCH_MAX);
+		struct batch_create_s **items = NULL;
+		if (!count) {
+			b->creating = FALSE;
+		} else {
+			items = g_memdup (b->creations->pdata, count * sizeof(void*));
+			g_ptr_array_remove_range (b->creations, 0, count);
+		}
+		g_mutex_unlock (&b->lock);
+
+		if (!count)
+			return;
+
+		if (count == 1) {
+			struct batch_create_s *c = items[0];
+			g_free (items);
+			int zrc = _batch_send_alone (c, _batch_created_first);
+			if (zrc == ZOK)
+				return;
+			_batch_created_alone (zrc, NULL, c);
+			continue;
+		}
+
+		struct batch_multi_s *m = g_malloc0 (sizeof(*m));
+		m->batch = b;
+		m->count = count;
+		m->items = items;
+		m->ops = g_malloc0 (count * sizeof(zoo_op_t));
+		m->results = g_malloc0 (count * sizeof(zoo_op_result_t));
+		m->buffers = g_malloc0 (count * BATCH_PATHLEN);
+		for (guint i=0; i<count ;i++) {
+			struct batch_create_s *c = items[i];
+			zoo_create_op_init (m->ops + i, c->path, c->value, c->vlen,
+					&ZOO_OPEN_ACL_UNSAFE, c->flags,
+					m->buffers + i * BATCH_PATHLEN, BATCH_PATHLEN);
+		}
+
+		int zrc = sqlx_sync_amulti (b->sub, count, m->ops, m->results,
+				_batch_created_multi, m);
+		if (zrc == ZOK)
+			return;
+		for (guint i=0; i<count ;i++)
+			_batch_created_alone (zrc, NULL, items[i]);
+		_batch_multi_free (m);
+	}
+}
+
+static int
+_batch_acreate (struct sqlx_sync_s *ss, const char *path, const char *v,
+		int vlen, int flags, string_completion_t completion, const void *data)
+{
+	struct sqlx_sync_batch_s *b = BATCH(ss);
+	EXTRA_ASSERT(b->vtable == &VTABLE_BATCH);
+
+	if (!b->sub->vtable->amulti)
+		return sqlx_sync_acreate (b->sub, path, v, vlen, flags,
+				completion, data);
+
+	struct batch_create_s *c = g_malloc0 (sizeof(*c));
+	c->batch = b;
+	c->path = g_strdup (path);
+	c->value = (v && vlen > 0) ? g_memdup (v, vlen) : NULL;
+	c->vlen = c->value ? vlen : -1;
+	c->flags = flags;
+	c->completion = completion;
+	c->data = data;
+
+	g_mutex_lock (&b->lock);
+	const gboolean first = !b->creating;
+	if (first)
+		b->creating = TRUE;
+	else
+		g_ptr_array_add (b->creations, c);
+	g_mutex_unlock (&b->lock);
+
+	if (!first)
+		return ZOK;
+
+	int rc = _batch_send_alone (c, _batch_created_first);
+	if (rc != ZOK) {
+		_batch_create_free (c);
+		g_mutex_lock (&b->lock);
+		b->creating = FALSE;
+		GPtrArray *queued = b->creations;
+		b->creations = g_ptr_array_new ();
+		g_mutex_unlock (&b->lock);
+		for (guint i=0; i<queued->len ;i++)
+			_batch_defer_failure (b, rc, queued->pdata[i], NULL);
+		g_ptr_array_free (queued, TRUE);
+	}
+	return rc;
+}
+
+/* Watches --------------------------------------------------------------------
+ * The watchers of the nodes are kept locally, per directory, and a single
+ * watch is set on the children of the directory. Each listing tells which
+ * watched nodes have disappeared, and it serves all the requests arrived
+ * before it has been sent. */
+
+static void _batch_listed (int rc, const struct String_vector *sv,
+		const void *data);
+
+static void
+_batch_dir_watcher (zhandle_t *zh, int type, int state, const char *path,
+		void *ctx);
+
+static struct batch_dir_s *
+_batch_get_dir (struct sqlx_sync_batch_s *b, const char *path)
+{
+	gchar *k = g_strndup (path, b->dirlen);
+	struct batch_dir_s *dir = g_hash_table_lookup (b->dirs, k);
+	if (dir) {
+		g_free (k);
+	} else {
+		dir = g_malloc0 (sizeof(*dir));
+		dir->batch = b;
+		dir->sample = g_strdup (path);
+		dir->watched = g_hash_table_new_full (_batch_watch_hash,
+				_batch_watch_equal, (GDestroyNotify)_batch_watch_free, NULL);
+		g_hash_table_insert (b->dirs, k, dir);
+	}
+	return dir;
+}
+
+static int
+_batch_send_listing (struct batch_dir_s *dir)
+{
+	return sqlx_sync_awget_siblings (dir->batch->sub, dir->sample,
+			_batch_dir_watcher, dir, _batch_listed, dir);
+}
+
+static void
+_batch_notify (GArray *notifications, zhandle_t *zh,
+		const struct String_vector *sv)
+{
+	static const struct Stat stat = {0};
+	for (guint i=0; i<notifications->len ;i++) {
+		struct batch_notify_s *n =
+			&g_array_index (notifications, struct batch_notify_s, i);
+		struct batch_watch_s *w = &n->w;
+		if (n->type)
+			w->watcher (zh, n->type, n->state, w->path, w->watcher_ctx);
+		else if (w->on_list)
+			w->on_list (n->rc, n->rc == ZOK ? sv : NULL, w->data);
+		else if (w->on_stat)
+			w->on_stat (n->rc, n->rc == ZOK ? &stat : NULL, w->data);
+		g_free (w->path);
+	}
+}
+
+/* Frees the entry if 'done' */
+static void
+_batch_notify_push (GArray *notifications, struct batch_watch_s *w,
+		int rc, int type, int state, gboolean done)
+{
+	struct batch_notify_s n = {*w, rc, type, state};
+	n.w.path = g_strdup (w->path);
+	g_array_append_vals (notifications, &n, 1);
+	if (done)
+		_batch_watch_free (w);
+}
+
+/* Like ZooKeeper, a watcher is registered once per node */
+static void
+_batch_watched_add (struct batch_dir_s *dir, struct batch_watch_s *w)
+{
+	if (g_hash_table_contains (dir->watched, w))
+		_batch_watch_free (w);
+	else
+		g_hash_table_add (dir->watched, w);
+}
+
+static void
+_batch_listed (int rc, const struct String_vector *sv, const void *data)
+{
+	struct batch_dir_s *dir = (struct batch_dir_s *) data;
+	struct sqlx_sync_batch_s *b = dir->batch;
+	GArray *notifications = g_array_new (FALSE, FALSE,
+			sizeof(struct batch_notify_s));
+
+	GHashTable *present = g_hash_table_new (g_str_hash, g_str_equal);
+	if (rc == ZOK && sv) {
+		for (int32_t i=0; i<sv->count ;i++)
+			g_hash_table_add (present, sv->data[i]);
+	}
+
+	g_mutex_lock (&b->lock);
+
+	/* First the watchers of the nodes that disappeared. Without a listing,
+	 * the watch on the directory is not set anymore. */
+	GHashTableIter iter;
+	gpointer k;
+	g_hash_table_iter_init (&iter, dir->watched);
+	while (g_hash_table_iter_next (&iter, &k, NULL)) {
+		struct batch_watch_s *w = k;
+		if (rc != ZOK) {
+			g_hash_table_iter_steal (&iter);
+			_batch_notify_push (notifications, w, rc,
+					ZOO_NOTWATCHING_EVENT, ZOO_CONNECTED_STATE, TRUE);
+		} else if (!g_hash_table_contains (present, w->path)) {
+			g_hash_table_iter_steal (&iter);
+			_batch_notify_push (notifications, w, rc,
+					ZOO_DELETED_EVENT, ZOO_CONNECTED_STATE, TRUE);
+		}
+	}
+
+	/* Then the requests served by that listing */
+	GSList *waiting = g_slist_reverse (dir->waiting);
+	dir->waiting = NULL;
+	for (GSList *l=waiting; l ;l=l->next) {
+		struct batch_watch_s *w = l->data;
+		if (w->on_list) {
+			_batch_notify_push (notifications, w, rc, 0, 0, TRUE);
+			continue;
+		}
+		const gboolean here = (rc == ZOK)
+			&& g_hash_table_contains (present, w->path);
+		if (here) {
+			if (w->on_stat)
+				_batch_notify_push (notifications, w, ZOK, 0, 0, FALSE);
+			_batch_watched_add (dir, w);
+		} else if (w->on_stat) {
+			_batch_notify_push (notifications, w,
+					rc == ZOK ? ZNONODE : rc, 0, 0, TRUE);
+		} else { /* a watch without a request, the node is already gone */
+			_batch_notify_push (notifications, w, rc,
+					rc == ZOK ? ZOO_DELETED_EVENT : ZOO_NOTWATCHING_EVENT,
+					ZOO_CONNECTED_STATE, TRUE);
+		}
+	}
+	g_slist_free (waiting);
+
+	const gboolean again = dir->next != NULL
+		|| (dir->dirty && g_hash_table_size (dir->watched) > 0);
+	dir->dirty = FALSE;
+	dir->waiting = g_slist_reverse (dir->next);
+	dir->next = NULL;
+	dir->listing = again;
+
+	g_mutex_unlock (&b->lock);
+
+	_batch_notify (notifications, NULL, sv);
+	g_array_free (notifications, TRUE);
+	g_hash_table_destroy (present);
+
+	if (again) {
+		int zrc = _batch_send_listing (dir);
+		if (zrc != ZOK)
+			_batch_listed (zrc, NULL, dir);
+	}
+}
+
+static void
+_batch_dir_watcher (zhandle_t *zh, int type, int state, const char *path,
+		void *ctx)
+{
+	(void) path;
+	struct batch_dir_s *dir = ctx;
+	struct sqlx_sync_batch_s *b = dir->batch;
+
+	if (type == ZOO_SESSION_EVENT) {
+		/* Like ZooKeeper does, tell all the watchers. After an expiration,
+		 * no watch survives. */
+		GArray *notifications = g_array_new (FALSE, FALSE,
+				sizeof(struct batch_notify_s));
+		const gboolean expired = (state == ZOO_EXPIRED_SESSION_STATE);
+		g_mutex_lock (&b->lock);
+		GHashTableIter iter;
+		gpointer k;
+		g_hash_table_iter_init (&iter, dir->watched);
+		while (g_hash_table_iter_next (&iter, &k, NULL)) {
+			if (expired)
+				g_hash_table_iter_steal (&iter);
+			_batch_notify_push (notifications, k, ZOK, type, state, expired);
+		}
+		g_mutex_unlock (&b->lock);
+		_batch_notify (notifications, zh, NULL);
+		g_array_free (notifications, TRUE);
+		return;
+	}
+
+	/* The watch is consumed, list again to set it back */
+	g_mutex_lock (&b->lock);
+	gboolean again = FALSE;
+	if (dir->listing)
+		dir->dirty = TRUE;
+	else if (g_hash_table_size (dir->watched) > 0)
+		again = dir->listing = TRUE;
+	g_mutex_unlock (&b->lock);
+
+	if (again) {
+		int zrc = _batch_send_listing (dir);
+		if (zrc != ZOK)
+			_batch_listed (zrc, NULL, dir);
+	}
+}
+
+static int
+_batch_watch (struct sqlx_sync_batch_s *b, struct batch_watch_s *w)
+{
+	g_mutex_lock (&b->lock);
+	struct batch_dir_s *dir = _batch_get_dir (b, w->path);
+	const gboolean first = !dir->listing;
+	if (first) {
+		dir->listing = TRUE;
+		dir->waiting = g_slist_prepend (dir->waiting, w);
+	} else {
+		dir->next = g_slist_prepend (dir->next, w);
+	}
+	g_mutex_unlock (&b->lock);
+
+	if (!first)
+		return ZOK;
+
+	int rc = _batch_send_listing (dir);
+	if (rc != ZOK) {
+		/* The requests queued meanwhile by the other threads have been
+		 * accepted, they fail the same way but from another thread */
+		g_mutex_lock (&b->lock);
+		GSList *queued = g_slist_remove (dir->waiting, w);
+		queued = g_slist_concat (queued, dir->next);
+		dir->waiting = dir->next = NULL;
+		dir->listing = FALSE;
+		g_mutex_unlock (&b->lock);
+		_batch_watch_free (w);
+		for (GSList *l=queued; l ;l=l->next)
+			_batch_defer_failure (b, rc, NULL, l->data);
+		g_slist_free (queued);
+	}
+	return rc;
+}
+
+static struct batch_watch_s *
+_batch_watch_new (const char *path, watcher_fn watcher, void *watcher_ctx)
+{
+	struct batch_watch_s *w = g_malloc0 (sizeof(*w));
+	w->path = g_strdup (path);
+	w->watcher = watcher;
+	w->watcher_ctx = watcher_ctx;
+	return w;
+}
+
+static int
+_batch_awexists (struct sqlx_sync_s *ss, const char *path,
+		watcher_fn watcher, void* watcherCtx,
+		stat_completion_t completion, const void *data)
+{
+	struct sqlx_sync_batch_s *b = BATCH(ss);
+	EXTRA_ASSERT(b->vtable == &VTABLE_BATCH);
+
+	if (!watcher || !completion)
+		return sqlx_sync_awexists (b->sub, path, watcher, watcherCtx,
+				completion, data);
+
+	struct batch_watch_s *w = _batch_watch_new (path, watcher, watcherCtx);
+	w->on_stat = completion;
+	w->data = data;
+	return _batch_watch (b, w);
+}
+
+static int
+_batch_awget (struct sqlx_sync_s *ss, const char *path,
+		watcher_fn watcher, void* watcherCtx,
+		data_completion_t completion, const void *data)
+{
+	struct sqlx_sync_batch_s *b = BATCH(ss);
+	EXTRA_ASSERT(b->vtable == &VTABLE_BATCH);
+
+	/* The content is still read on the node, only the watch is shared */
+	int rc = sqlx_sync_awget (b->sub, path, NULL, NULL, completion, data);
+	if (rc != ZOK || !watcher)
+		return rc;
+
+	int zrc = _batch_watch (b, _batch_watch_new (path, watcher, watcherCtx));
+	if (zrc != ZOK)
+		GRID_WARN("SYNC watch lost on [%s]: (%d) %s", path, zrc, zerror(zrc));
+	return rc;
+}
+
+static int
+_batch_awget_siblings (struct sqlx_sync_s *ss, const char *path,
+		watcher_fn watcher, void* watcherCtx,
+		strings_completion_t completion, const void *data)
+{
+	struct sqlx_sync_batch_s *b = BATCH(ss);
+	EXTRA_ASSERT(b->vtable == &VTABLE_BATCH);
+
+	if (watcher || !completion)
+		return sqlx_sync_awget_siblings (b->sub, path, watcher, watcherCtx,
+				completion, data);
+
+	struct batch_watch_s *w = _batch_watch_new (path, NULL, NULL);
+	w->on_list = completion;
+	w->data = data;
+	return _batch_watch (b, w);
+}
+
 /* -------------------------------------------------------------------------- */
 
 static void _direct_destroy (struct sqlx_peering_s *self);
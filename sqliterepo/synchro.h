@@ -63,6 +63,13 @@ struct sqlx_sync_vtable_s
 	 * sqlx_sync_create() */
 	void (*set_exit_hook) (struct sqlx_sync_s *ss,
 			void (*on_exit) (void*), void *on_exit_ctx);
+
+	/** Optional, NULL when not supported. Sends the 'count' operations in a
+	 * single transaction, like zoo_amulti(). The paths are mangled as for
+	 * the other operations. */
+	int (*amulti) (struct sqlx_sync_s *ss, int count, const zoo_op_t *ops,
+			zoo_op_result_t *results, void_completion_t completion,
+			const void *data);
 };
 
 struct abstract_sqlx_sync_s
@@ -100,6 +107,9 @@ struct abstract_sqlx_sync_s
 #define sqlx_sync_set_exit_hook(ss,hook,data) \
 	((struct abstract_sqlx_sync_s*)(ss))->vtable->set_exit_hook(ss, hook, data)
 
+#define sqlx_sync_amulti(ss, count, ops, results, completion, data) \
+	((struct abstract_sqlx_sync_s*)(ss))->vtable->amulti(ss, count, ops, results, completion, data)
+
 /** Initiates a sqlx synchronizer based on ZooKeeper.
  * @param url the Zookeeper connection string */
 struct sqlx_sync_s * sqlx_sync_create(const char *url);
@@ -108,6 +118,18 @@ void sqlx_sync_set_prefix(struct sqlx_sync_s *ss, const gchar *prefix);
 
 void sqlx_sync_set_hash(struct sqlx_sync_s *ss, guint witdth, guint depth);
 
+/** Wraps 'sub' (that becomes owned by the wrapper) to save round trips
+ * and watches on the server:
+ * - the creations issued while others are in flight are grouped in a
+ *   single multi-op, if 'sub' supports them;
+ * - the watches set by awexists() and awget() are replaced by a single
+ *   watch on the children of the (hashed) directory of the node, the
+ *   events being dispatched locally to the watchers of each node;
+ * - the listings of the same directory are shared.
+ * 'width' and 'depth' must be the hash given to 'sub'. */
+struct sqlx_sync_s * sqlx_sync_factory__create_batch(struct sqlx_sync_s *sub,
+		guint width, guint depth);
+
 /* -------------------------------------------------------------------------- */
 
 struct sqlx_name_s;
@@ -117,6 +117,10 @@ static struct grid_main_option_s common_options[] =
 			"(milliseconds). -1 means wait forever, 0 return "
 			"immediately." },
 
+	{"SlaveMaxLag", OT_INT64, {.i64=&SRV.slave_max_lag},
+		"How long a SLAVE base behind its MASTER still serves the reads "
+			"(milliseconds). -1 means whatever the lag." },
+
 	{"MaxBases", OT_UINT, {.u = &SRV.cfg_max_bases},
 		"Limits the number of concurrent open bases (0=automatic)" },
 	{"MaxPassive", OT_UINT, {.u = &SRV.cfg_max_passive},
@@ -129,11 +133,24 @@ static struct grid_main_option_s common_options[] =
 	{"PageSize", OT_UINT, {.u=&SRV.cfg_page_size},
 		"Page size of SQLite databases (0=use sqlite default)" },
 
+	{"EventsSpool", OT_STRING, {.str = &SRV.events_spool},
+		"Path to a file where the events overflow when the event-agent "
+			"is too slow. They are sent later, in order."},
+	{"EventsSpoolSize", OT_INT64, {.i64 = &SRV.events_spool_size},
+		"Size in bytes of the events spool file"},
+
 	{"CacheEnabled", OT_BOOL, {.b = &SRV.flag_cached_bases},
 		"If set, each base will be cached in a way it won't be accessed"
 			" by several requests in the same time."},
 	{"DeleteEnabled", OT_BOOL, {.b = &SRV.flag_delete_on},
 		"If not set, prevents deleting database files from disk"},
+	{"ZkBatchEnabled", OT_BOOL, {.b = &SRV.flag_zk_batch},
+		"If set, the ZooKeeper nodes of the elections are created in batches,"
+			" and a single watch is set per directory of nodes. Off by"
+			" default."},
+	{"WalEnabled", OT_BOOL, {.b = &SRV.flag_wal},
+		"If set, the bases are journaled in WAL mode, and their WAL is"
+			" checkpointed by the admin thread when they get idle."},
 
 	{NULL, 0, {.i=0}, NULL}
 };
@@ -154,6 +171,16 @@ _get_version(gpointer ctx, const struct sqlx_name_s *n, GTree **result)
 	return sqlx_repository_get_version2(PSRV(ctx)->repository, n, result);
 }
 
+static void
+_notify_outdated(gpointer ctx, const struct sqlx_name_s *n, gboolean outdated)
+{
+	EXTRA_ASSERT(ctx != NULL);
+	if (outdated)
+		sqlx_repository_notify_stale(PSRV(ctx)->repository, n);
+	else
+		sqlx_repository_notify_fresh(PSRV(ctx)->repository, n);
+}
+
 // sqlite_service configuration steps ------------------------------------------
 
 static gboolean
@@ -320,6 +347,11 @@ _configure_synchronism(struct sqlx_service_s *ss)
 	sqlx_sync_set_hash(ss->sync, ss->service_config->zk_hash_width,
 			ss->service_config->zk_hash_depth);
 
+	if (ss->flag_zk_batch)
+		ss->sync = sqlx_sync_factory__create_batch(ss->sync,
+				ss->service_config->zk_hash_width,
+				ss->service_config->zk_hash_depth);
+
 	GError *err = sqlx_sync_open(ss->sync);
 	if (err != NULL) {
 		GRID_WARN("SYNC init error: (%d) %s", err->code, err->message);
@@ -339,6 +371,7 @@ _configure_replication(struct sqlx_service_s *ss)
 	replication_config.ctx = ss;
 	replication_config.get_local_url = _get_url;
 	replication_config.get_version = _get_version;
+	replication_config.notify_outdated = _notify_outdated;
 	replication_config.get_peers = (GError* (*)(gpointer, const struct sqlx_name_s*,
 				gboolean, gchar ***)) ss->service_config->get_peers;
 
@@ -390,6 +423,14 @@ _configure_backend(struct sqlx_service_s *ss)
 	sqlx_repository_configure_open_timeout (ss->repository,
 			ss->open_timeout * G_TIME_SPAN_MILLISECOND);
 
+	sqlx_repository_configure_max_lag (ss->repository,
+			ss->slave_max_lag < 0 ? -1
+			: ss->slave_max_lag * G_TIME_SPAN_MILLISECOND);
+
+	if (ss->flag_wal)
+		sqlx_repository_configure_wal (ss->repository,
+				ss->service_config->srvtype, TRUE);
+
 	sqlx_repository_configure_hash (ss->repository,
 			ss->service_config->repo_hash_width,
 			ss->service_config->repo_hash_depth);
@@ -436,6 +477,16 @@ _configure_events_queue (struct sqlx_service_s *ss)
 		return FALSE;
 	}
 
+	if (ss->events_spool && ss->events_spool->len > 0) {
+		err = oio_events_queue__set_spool(ss->events_queue,
+				ss->events_spool->str, (gsize) MAX(ss->events_spool_size, 0));
+		if (err) {
+			GRID_WARN("Events spool failure: (%d) %s", err->code, err->message);
+			g_clear_error(&err);
+			return FALSE;
+		}
+	}
+
 	GRID_INFO("Event queue ready, connected to [%s]", url);
 	return TRUE;
 }
@@ -556,16 +607,22 @@ sqlx_service_set_defaults(void)
 {
 	SRV.max_elections_timers_per_round = SQLX_MAX_TIMER_PER_ROUND;
 	SRV.open_timeout = DEFAULT_CACHE_OPEN_TIMEOUT / G_TIME_SPAN_MILLISECOND;
+	SRV.slave_max_lag = SQLX_SLAVE_MAX_LAG / G_TIME_SPAN_MILLISECOND;
 
 	SRV.cfg_max_bases = 0;
 	SRV.cfg_max_passive = 0;
 	SRV.cfg_max_active = 0;
 	SRV.cfg_max_workers = 200;
 	SRV.cfg_page_size = SQLX_DEFAULT_PAGE_SIZE;
+	SRV.events_spool_size = OIO_EVTQ_SPOOL_SIZE;
 	SRV.flag_replicable = TRUE;
 	SRV.flag_autocreate = TRUE;
 	SRV.flag_delete_on = TRUE;
 	SRV.flag_cached_bases = TRUE;
+	/* Opt-in: the batches change how the election nodes are created and
+	 * watched, and used to leave the queued operations hanging when a
+	 * batch could not be sent. */
+	SRV.flag_zk_batch = FALSE;
 
 	SRV.sync_mode_solo = 1;
 	SRV.sync_mode_repli = 0;
@@ -649,6 +706,10 @@ sqlx_service_specific_fini(void)
 		g_string_free(SRV.url, TRUE);
 		SRV.url = NULL;
 	}
+	if (SRV.events_spool) {
+		g_string_free(SRV.events_spool, TRUE);
+		SRV.events_spool = NULL;
+	}
 	if (SRV.zk_url)
 		oio_str_clean(&SRV.zk_url);
 
@@ -788,6 +849,11 @@ _task_expire_bases(gpointer p)
 		if (count)
 			GRID_DEBUG("Expired %u bases", count);
 	}
+
+	guint count = sqlx_repository_checkpoint_idle(PSRV(p)->repository,
+			100, SQLX_WAL_IDLE_DELAY);
+	if (count)
+		GRID_DEBUG("Checkpointed %u bases", count);
 }
 
 static void
@@ -887,6 +953,23 @@ _task_reconfigure_events (gpointer p)
 		oio_events_queue__set_buffering(PSRV(p)->events_queue,
 				i64 * G_TIME_SPAN_SECOND);
 	}
+
+	const gchar *srvtype = PSRV(p)->service_config->srvtype;
+	gint64 batch_events = namespace_info_get_srv_param_i64(ni, NULL, srvtype,
+			OIO_CFG_EVTQ_BATCH_EVENTS, 1);
+	gint64 batch_bytes = namespace_info_get_srv_param_i64(ni, NULL, srvtype,
+			OIO_CFG_EVTQ_BATCH_BYTES, OIO_EVTQ_BATCH_BYTES);
+	gint64 batch_delay = namespace_info_get_srv_param_i64(ni, NULL, srvtype,
+			OIO_CFG_EVTQ_BATCH_DELAY, OIO_EVTQ_BATCH_DELAY);
+	gint64 batch_compress = namespace_info_get_srv_param_i64(ni, NULL, srvtype,
+			OIO_CFG_EVTQ_BATCH_COMPRESS, 0);
+	if (batch_events >= 0 && batch_events < G_MAXUINT
+			&& batch_bytes > 0 && batch_bytes < G_MAXUINT
+			&& batch_delay >= 0 && batch_delay < 60000) {
+		oio_events_queue__set_batching(PSRV(p)->events_queue,
+				(guint) batch_events, (gsize) batch_bytes,
+				batch_delay * G_TIME_SPAN_MILLISECOND, batch_compress != 0);
+	}
 }
 
 GError*
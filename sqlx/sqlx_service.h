@@ -115,6 +115,7 @@ struct sqlx_service_s
 	/* This is configured during the "configure" step, and can be overriden
 	   in the _post_config hook. */
 	gint64 open_timeout;
+	gint64 slave_max_lag;
 	guint max_bases;
 	guint max_passive;
 	guint max_active;
@@ -132,6 +133,10 @@ struct sqlx_service_s
 
 	guint cfg_page_size;
 
+	// Path to the file where the events overflow (no spool if NULL)
+	GString *events_spool;
+	gint64 events_spool_size;
+
 	guint sync_mode_repli;
 	guint sync_mode_solo;
 
@@ -144,6 +149,12 @@ struct sqlx_service_s
 	// Are DB autocreations enabled?
 	gboolean flag_autocreate;
 
+	// Journal the bases in WAL mode, checkpointed when idle
+	gboolean flag_wal;
+
+	// Group the ZooKeeper creations and share the watches per directory
+	gboolean flag_zk_batch;
+
 	// Turn to TRUE to avoid locking the repository volume
 	gboolean flag_nolock;
 
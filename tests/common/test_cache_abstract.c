@@ -61,3 +61,61 @@ test_cache_cycle (struct oio_cache_s *c)
 	test_not_found (c, k);
 }
 
+
+#define BATCH 64
+
+/* Stores and fetches a batch larger than the usual socket buffers, with
+ * values embedding the separators of the text protocols, a key asked twice
+ * and a key never stored. */
+static void
+test_cache_batch (struct oio_cache_s *c)
+{
+	gchar *keys[BATCH + 3] = {NULL};
+	gchar *values[BATCH + 1] = {NULL};
+	gchar *out[BATCH + 3] = {NULL};
+	for (guint i=0; i<BATCH ;++i) {
+		keys[i] = g_strdup_printf ("batch-%u-%"G_GINT64_FORMAT, i,
+				oio_ext_monotonic_time ());
+		values[i] = g_strdup_printf ("value %u\r\nEND\r\n%0*u", i, 1024, i);
+	}
+
+	g_assert_nonnull (c);
+	enum oio_cache_status_e rc = oio_cache_mput (c,
+			(const char * const *) keys, (const char * const *) values);
+	if (rc != OIO_CACHE_OK) {
+		g_assert_cmpint (rc, ==, OIO_CACHE_DISCONNECTED);
+		goto exit;
+	}
+
+	/* the buffered requests have been flushed, single requests still work */
+	test_found (c, keys[0], values[0]);
+	g_assert_cmpint (OIO_CACHE_OK, ==, oio_cache_put (c, keys[0], values[0]));
+	test_found (c, keys[BATCH - 1], values[BATCH - 1]);
+
+	keys[BATCH] = keys[0];
+	keys[BATCH + 1] = "batch-NOTFOUND";
+	rc = oio_cache_mget (c, (const char * const *) keys, out);
+	g_assert_cmpint (rc, ==, OIO_CACHE_OK);
+	for (guint i=0; i<BATCH ;++i)
+		g_assert_cmpstr (out[i], ==, values[i]);
+	g_assert_cmpstr (out[BATCH], ==, values[0]);
+	g_assert_null (out[BATCH + 1]);
+	for (guint i=0; i<BATCH + 2 ;++i) {
+		g_free (out[i]);
+		out[i] = NULL;
+	}
+	keys[BATCH] = keys[BATCH + 1] = NULL;
+
+	for (guint i=0; i<BATCH ;++i)
+		g_assert_cmpint (OIO_CACHE_OK, ==, oio_cache_del (c, keys[i]));
+	rc = oio_cache_mget (c, (const char * const *) keys, out);
+	g_assert_cmpint (rc, ==, OIO_CACHE_OK);
+	for (guint i=0; i<BATCH ;++i)
+		g_assert_null (out[i]);
+
+exit:
+	for (guint i=0; i<BATCH ;++i) {
+		g_free (keys[i]);
+		g_free (values[i]);
+	}
+}
@@ -0,0 +1,233 @@
+/*
+OpenIO SDS tests
+Copyright (C) 2015 OpenIO, original work as part of OpenIO Software Defined Storage
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+/* A minimal HTTP/1.0 server for the tests. Each connection is served by its
+ * own thread and carries a single request, then the server closes it. */
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+
+struct http_mock_s;
+
+/* <headers> maps the lowercased header names to their values. The handler
+ * fills <code>, <rep_headers> ("Name: value\r\n" lines) and <body>. */
+typedef void (*http_mock_handler_f) (struct http_mock_s *mock,
+		const char *method, const char *path, GHashTable *headers,
+		int *code, GString *rep_headers, GString *body);
+
+struct http_mock_s
+{
+	int fd;
+	guint16 port;
+	gchar url[64];
+	GThread *th;
+	volatile gboolean running;
+
+	http_mock_handler_f handler;
+	gpointer udata;
+
+	volatile gint active;
+	volatile gint inflight;
+	volatile gint max_inflight;
+	volatile gint requests;
+};
+
+struct http_mock_cnx_s
+{
+	struct http_mock_s *mock;
+	int fd;
+};
+
+static void
+_mock_write_all (int fd, const char *buf, gsize len)
+{
+	while (len > 0) {
+		ssize_t w = write (fd, buf, len);
+		if (w < 0 && errno == EINTR)
+			continue;
+		if (w <= 0)
+			return;
+		buf += w;
+		len -= w;
+	}
+}
+
+static gpointer
+_mock_serve (gpointer p)
+{
+	struct http_mock_cnx_s *cnx = p;
+	struct http_mock_s *mock = cnx->mock;
+	GString *in = g_string_new ("");
+
+	const gint inflight = g_atomic_int_add (&mock->inflight, 1) + 1;
+	for (;;) {
+		gint max = g_atomic_int_get (&mock->max_inflight);
+		if (max >= inflight || g_atomic_int_compare_and_exchange (
+					&mock->max_inflight, max, inflight))
+			break;
+	}
+
+	/* Read the request line and the headers */
+	gchar buf[4096];
+	while (!strstr (in->str, "\r\n\r\n")) {
+		ssize_t r = read (cnx->fd, buf, sizeof(buf));
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			goto exit;
+		g_string_append_len (in, buf, r);
+	}
+
+	gchar **lines = g_strsplit (in->str, "\r\n", -1);
+	gchar **tokens = g_strsplit (lines[0], " ", 3);
+	GHashTable *headers = g_hash_table_new_full (g_str_hash, g_str_equal,
+			g_free, g_free);
+	for (gchar **l = lines + 1; *l && **l ;++l) {
+		gchar *sep = strchr (*l, ':');
+		if (!sep)
+			continue;
+		gchar *k = g_ascii_strdown (*l, sep - *l);
+		g_hash_table_replace (headers, k, g_strdup (g_strstrip (sep + 1)));
+	}
+
+	/* Consume the body, so that closing the connection does not reset it
+	 * before the client reads the reply */
+	const char *cl = g_hash_table_lookup (headers, "content-length");
+	if (cl) {
+		const gsize expected = (strstr (in->str, "\r\n\r\n") - in->str) + 4
+			+ g_ascii_strtoull (cl, NULL, 10);
+		while (in->len < expected) {
+			ssize_t r = read (cnx->fd, buf, sizeof(buf));
+			if (r < 0 && errno == EINTR)
+				continue;
+			if (r <= 0)
+				break;
+			g_string_append_len (in, buf, r);
+		}
+	}
+
+	int code = 500;
+	GString *rep_headers = g_string_new ("");
+	GString *body = g_string_new ("");
+	if (g_strv_length (tokens) >= 2) {
+		g_atomic_int_inc (&mock->requests);
+		mock->handler (mock, tokens[0], tokens[1], headers,
+				&code, rep_headers, body);
+	}
+
+	GString *out = g_string_new ("");
+	g_string_append_printf (out, "HTTP/1.0 %d Mock\r\n", code);
+	if (!strstr (rep_headers->str, "Content-Length"))
+		g_string_append_printf (out, "Content-Length: %"G_GSIZE_FORMAT"\r\n",
+				body->len);
+	g_string_append (out, rep_headers->str);
+	g_string_append (out, "Connection: close\r\n\r\n");
+	g_string_append_len (out, body->str, body->len);
+	_mock_write_all (cnx->fd, out->str, out->len);
+
+	g_string_free (out, TRUE);
+	g_string_free (body, TRUE);
+	g_string_free (rep_headers, TRUE);
+	g_hash_table_destroy (headers);
+	g_strfreev (tokens);
+	g_strfreev (lines);
+exit:
+	g_atomic_int_add (&mock->inflight, -1);
+	close (cnx->fd);
+	g_free (cnx);
+	g_string_free (in, TRUE);
+	g_atomic_int_add (&mock->active, -1);
+	return NULL;
+}
+
+static gpointer
+_mock_accept (gpointer p)
+{
+	struct http_mock_s *mock = p;
+	while (g_atomic_int_get (&mock->running)) {
+		struct pollfd pfd = {.fd = mock->fd, .events = POLLIN};
+		if (poll (&pfd, 1, 100) <= 0)
+			continue;
+		int fd = accept (mock->fd, NULL, NULL);
+		if (fd < 0)
+			continue;
+		struct http_mock_cnx_s *cnx = g_malloc0 (sizeof(*cnx));
+		cnx->mock = mock;
+		cnx->fd = fd;
+		g_atomic_int_inc (&mock->active);
+		g_thread_unref (g_thread_new ("mock", _mock_serve, cnx));
+	}
+	return p;
+}
+
+static struct http_mock_s *
+http_mock_start (http_mock_handler_f handler, gpointer udata)
+{
+	struct http_mock_s *mock = g_malloc0 (sizeof(*mock));
+	mock->handler = handler;
+	mock->udata = udata;
+
+	struct sockaddr_in sin = {0};
+	socklen_t slen = sizeof(sin);
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+	mock->fd = socket (AF_INET, SOCK_STREAM, 0);
+	g_assert_cmpint (mock->fd, >=, 0);
+	g_assert_cmpint (0, ==, bind (mock->fd, (struct sockaddr*)&sin, slen));
+	g_assert_cmpint (0, ==, listen (mock->fd, 64));
+	g_assert_cmpint (0, ==, getsockname (mock->fd,
+				(struct sockaddr*)&sin, &slen));
+	mock->port = ntohs (sin.sin_port);
+	g_snprintf (mock->url, sizeof(mock->url), "127.0.0.1:%u", mock->port);
+
+	mock->running = TRUE;
+	mock->th = g_thread_new ("mock-accept", _mock_accept, mock);
+	return mock;
+}
+
+static void
+http_mock_stop (struct http_mock_s *mock)
+{
+	g_atomic_int_set (&mock->running, FALSE);
+	g_thread_join (mock->th);
+	while (g_atomic_int_get (&mock->active) > 0)
+		g_usleep (G_TIME_SPAN_MILLISECOND);
+	close (mock->fd);
+	g_free (mock);
+}
+
+/* Parses a "bytes=A-B" range, both bounds included */
+static gboolean
+http_mock_range (GHashTable *headers, gsize *pstart, gsize *pend)
+{
+	const char *r = g_hash_table_lookup (headers, "range");
+	if (!r || !g_str_has_prefix (r, "bytes="))
+		return FALSE;
+	gchar *end = NULL;
+	*pstart = g_ascii_strtoull (r + 6, &end, 10);
+	if (!end || *end != '-')
+		return FALSE;
+	*pend = g_ascii_strtoull (end + 1, NULL, 10);
+	return *pend >= *pstart;
+}
@@ -35,10 +35,23 @@ test_cache_cycle_memcached (void)
 	oio_cache_destroy (c);
 }
 
+static void
+test_cache_batch_memcached (void)
+{
+	char *ip = "127.0.0.1";
+	int port = 11211;
+
+	struct oio_cache_s *c = oio_cache_make_memcached (ip, port);
+
+	test_cache_batch (c);
+	oio_cache_destroy (c);
+}
+
 int
 main(int argc, char **argv)
 {
 	HC_TEST_INIT(argc,argv);
 	g_test_add_func("/cache/cycle/memcached", test_cache_cycle_memcached);
+	g_test_add_func("/cache/batch/memcached", test_cache_batch_memcached);
 	return g_test_run();
 }
@@ -36,10 +36,24 @@ test_cache_cycle_redis (void)
 	oio_cache_destroy (c);
 }
 
+static void
+test_cache_batch_redis (void)
+{
+	char *ip = "127.0.0.1";
+	int port = 6379;
+	struct timeval timeout = {0,0};
+
+	struct oio_cache_s *c = oio_cache_make_redis (ip, port, timeout);
+
+	test_cache_batch (c);
+	oio_cache_destroy (c);
+}
+
 int
 main(int argc, char **argv)
 {
 	HC_TEST_INIT(argc,argv);
 	g_test_add_func("/cache/cycle/redis", test_cache_cycle_redis);
+	g_test_add_func("/cache/batch/redis", test_cache_batch_redis);
 	return g_test_run();
 }
@@ -19,6 +19,7 @@
 
 import sys
 import json
+import time
 import threading
 import BaseHTTPServer
 from ctypes import cdll
@@ -44,8 +45,10 @@ class DumbHttpMock(BaseHTTPServer.BaseHTTPRequestHandler):
                             "invalid header value got: %s, expected: %s" %
                             (str(self.headers[k]), str(v)))
 
-        # Reply
-        pcode, phdr, pbody = rep
+        # Reply, after an optional delay
+        if len(rep) > 3:
+            time.sleep(rep[3])
+        pcode, phdr, pbody = rep[:3]
         self.send_response(pcode)
         for k, v in phdr.items():
             self.send_header(k, v)
@@ -172,6 +175,74 @@ def test_get(lib):
             s.join()
 
 
+# Values of enum oio_sds_config_e
+OIOSDS_CFG_HEDGE_DELAY = 6
+
+
+def _show(urls, chunks, size):
+    """Expectation of a content/show returning the replicas of one chunk,
+    each on its own rawx."""
+    czero = "0" * 63
+    hash_zero = "0" * 32
+    return (("/v3.0/NS/content/show?acct=ACCT&ref=JFS&path=plop", {}, ""),
+            (200, {"x-oio-content-meta-chunk-method": "plain"}, json.dumps([
+                {"url": "http://%s/%s%d" % (u, czero, c),
+                 "pos": "0", "size": size, "hash": hash_zero}
+                for u, c in zip(urls, chunks)])))
+
+
+def _chunk(c, rng):
+    return ("/%s%d" % ("0" * 63, c), {"Range": "bytes=%d-%d" % rng}, "")
+
+
+def test_get_hedged(lib):
+    http, services, urls = [], [], []
+    for _ in range(3):
+        http.append(BaseHTTPServer.HTTPServer(("127.0.0.1", 0), DumbHttpMock))
+    for h in http:
+        urls.append(http2url(h))
+        services.append(Service(h))
+    proxy, rawx = http[0], http[1:]
+
+    a, b = "a" * 64, "b" * 64
+    proxy.expectations = [
+        _show(urls[1:], (1, 2), 64),
+        _show(urls[1:], (3, 4), 64),
+        _show(urls[1:], (5, 6), 64),
+    ]
+    rawx[0].expectations = [
+        # a failing replica is immediately failed over
+        (_chunk(1, (0, 63)), (500, {}, "")),
+        # the winner dies after 32 bytes, the rest comes from the next one
+        (_chunk(3, (0, 63)), (200, {"Content-Length": "64"}, a[:32])),
+        # a slow replica gets hedged
+        (_chunk(5, (0, 63)), (200, {}, a, 1.0)),
+    ]
+    rawx[1].expectations = [
+        (_chunk(2, (0, 63)), (200, {}, b)),
+        (_chunk(4, (32, 63)), (200, {}, b[32:])),
+        (_chunk(6, (0, 63)), (200, {}, b)),
+    ]
+    for s in services:
+        s.start()
+
+    cfg = json.dumps({"NS": {"proxy": urls[0]}})
+    try:
+        lib.test_get_content(cfg, "NS", "NS/ACCT/JFS//plop", b,
+                             OIOSDS_CFG_HEDGE_DELAY, 100)
+        lib.test_get_content(cfg, "NS", "NS/ACCT/JFS//plop", a[:32] + b[32:],
+                             OIOSDS_CFG_HEDGE_DELAY, 100)
+        lib.test_get_content(cfg, "NS", "NS/ACCT/JFS//plop", b,
+                             OIOSDS_CFG_HEDGE_DELAY, 100)
+    finally:
+        for h in http:
+            h.shutdown()
+        for s in services:
+            s.join()
+    for h in http:
+        assert(0 == len(h.expectations))
+
+
 def test_has(lib):
     proxy = BaseHTTPServer.HTTPServer(("127.0.0.1", 0), DumbHttpMock)
     proxy.expectations = [
@@ -326,4 +397,5 @@ if __name__ == '__main__':
     lib.setup()
     test_has(lib)
     test_get(lib)
+    test_get_hedged(lib)
     test_list(lib)
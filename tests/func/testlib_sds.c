@@ -35,6 +35,8 @@ void test_has_fail (const char *strcfg, const char *ns, const char *url);
 void test_get_fail (const char *strcfg, const char *ns, const char *url);
 void test_get_success (const char *strcfg, const char *ns, const char *url,
 		size_t count);
+void test_get_content (const char *strcfg, const char *ns, const char *url,
+		const char *expected, int what, int value);
 
 void test_list_badarg (const char *strcfg, const char *ns);
 void test_list_fail (const char *strcfg, const char *ns, const char *url);
@@ -287,6 +289,41 @@ test_get_success (const char *strcfg, const char *ns, const char *strurl,
 	_test_wrap_url (strcfg, ns, strurl, _hook);
 }
 
+static gint
+_append (void *i, const unsigned char *b, size_t l)
+{
+	g_string_append_len ((GString*)i, (const char*)b, l);
+	return l;
+}
+
+/* Downloads the whole content after the SDK option <what> has been set to
+ * <value> (when <what> is not 0), and checks the bytes received. */
+void
+test_get_content (const char *strcfg, const char *ns, const char *strurl,
+		const char *expected, int what, int value)
+{
+	GString *out = g_string_new ("");
+	void _hook (struct oio_sds_s *sds, struct oio_url_s *url) {
+		if (what)
+			g_assert_cmpint (0, ==, oio_sds_configure (sds, what,
+						&value, sizeof(value)));
+		struct oio_sds_dl_src_s src = { .url = url, .ranges = NULL };
+		struct oio_sds_dl_dst_s dst = {
+			.type = OIO_DL_DST_HOOK_SEQUENTIAL,
+			.data = { .hook = {
+				.cb = _append,
+				.ctx = out,
+				.length = (size_t)-1,
+			} }
+		};
+		struct oio_error_s *err = oio_sds_download (sds, &src, &dst);
+		g_assert_no_error ((GError*)err);
+		g_assert_cmpstr (out->str, ==, expected);
+	}
+	_test_wrap_url (strcfg, ns, strurl, _hook);
+	g_string_free (out, TRUE);
+}
+
 void
 test_list_badarg (const char *strcfg, const char *ns)
 {
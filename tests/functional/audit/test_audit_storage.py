@@ -2,12 +2,13 @@ import hashlib
 
 import os
 
-from oio.common.utils import get_logger, cid_from_name, xattr
+from oio.common.utils import get_logger, cid_from_name, \
+    write_packed_user_xattr
 from oio.blob.auditor import BlobAuditorWorker
 from oio.common import exceptions as exc
 from oio.container.client import ContainerClient
 from oio.blob.client import BlobClient
-from oio.common.constants import chunk_xattr_keys
+from oio.common.constants import chunk_xattr_keys, chunk_xattr_packed
 from tests.utils import BaseTestCase, random_str, random_id
 
 
@@ -106,6 +107,10 @@ class TestBlobAuditorFunctional(BaseTestCase):
             self.account, self.ref, self.content.path, self.chunk.size,
             self.hash_rand, data=[self.chunk_proxy])
 
+    def _set_xattr(self, key, value):
+        write_packed_user_xattr(self.chunk_path, chunk_xattr_packed, 'grid.',
+                                {key: value})
+
     def test_chunk_audit(self):
         self.init_content()
         self.auditor.chunk_audit(self.chunk_path)
@@ -138,53 +143,41 @@ class TestBlobAuditorFunctional(BaseTestCase):
 
     def test_xattr_bad_chunk_size(self):
         self.init_content()
-        xattr.setxattr(
-            self.chunk_path, 'user.' + chunk_xattr_keys['chunk_size'], '-1')
+        self._set_xattr(chunk_xattr_keys['chunk_size'], '-1')
 
         self.assertRaises(exc.FaultyChunk, self.auditor.chunk_audit,
                           self.chunk_path)
 
     def test_xattr_bad_chunk_hash(self):
         self.init_content()
-        xattr.setxattr(
-            self.chunk_path, 'user.' + chunk_xattr_keys['chunk_hash'],
-            'WRONG_HASH')
+        self._set_xattr(chunk_xattr_keys['chunk_hash'], 'WRONG_HASH')
         self.assertRaises(exc.CorruptedChunk, self.auditor.chunk_audit,
                           self.chunk_path)
 
     def test_xattr_bad_content_path(self):
         self.init_content()
-        xattr.setxattr(
-            self.chunk_path, 'user.' + chunk_xattr_keys['content_path'],
-            'WRONG_PATH')
+        self._set_xattr(chunk_xattr_keys['content_path'], 'WRONG_PATH')
 
         self.assertRaises(exc.OrphanChunk, self.auditor.chunk_audit,
                           self.chunk_path)
 
     def test_xattr_bad_chunk_id(self):
         self.init_content()
-        xattr.setxattr(
-            self.chunk_path, 'user.' + chunk_xattr_keys['chunk_id'],
-            'WRONG_ID')
+        self._set_xattr(chunk_xattr_keys['chunk_id'], 'WRONG_ID')
 
         self.assertRaises(exc.OrphanChunk, self.auditor.chunk_audit,
                           self.chunk_path)
 
     def test_xattr_bad_content_container(self):
         self.init_content()
-        xattr.setxattr(
-            self.chunk_path, 'user.' + chunk_xattr_keys['container_id'],
-            self.bad_container_id)
+        self._set_xattr(chunk_xattr_keys['container_id'],
+                        self.bad_container_id)
         self.assertRaises(exc.OrphanChunk, self.auditor.chunk_audit,
                           self.chunk_path)
 
     def test_xattr_bad_chunk_position(self):
         self.init_content()
-        xattr.setxattr(self.chunk_path, 'user.grid.chunk.position', '42')
-
-        xattr.setxattr(
-            self.chunk_path, 'user.' + chunk_xattr_keys['chunk_pos'],
-            '42')
+        self._set_xattr(chunk_xattr_keys['chunk_pos'], '42')
         self.assertRaises(exc.FaultyChunk, self.auditor.chunk_audit,
                           self.chunk_path)
 
@@ -1,7 +1,8 @@
 import unittest
 import logging
 from cStringIO import StringIO
-from oio.common.utils import get_logger
+from oio.common.utils import get_logger, pack_user_xattr, \
+    unpack_user_xattr
 
 
 class TestUtils(unittest.TestCase):
@@ -18,3 +19,18 @@ class TestUtils(unittest.TestCase):
         logger = get_logger(conf, 'test')
         logger.debug('msg3')
         self.assertEqual(sio.getvalue(), 'msg1\nmsg3\n')
+
+    def test_unpack_user_xattr(self):
+        packed = 'chunk.id\0ABCD\0content.path\0a=b;c\0'
+        self.assertEqual(unpack_user_xattr(packed, 'grid.'),
+                         {'grid.chunk.id': 'ABCD',
+                          'grid.content.path': 'a=b;c'})
+        self.assertEqual(unpack_user_xattr('', 'grid.'), {})
+
+    def test_pack_user_xattr(self):
+        meta = {'grid.chunk.id': 'ABCD', 'grid.content.path': 'a=b;c',
+                'other.key': 'ignored'}
+        packed = pack_user_xattr(meta, 'grid.')
+        self.assertEqual(packed.count('\0'), 4)
+        del meta['other.key']
+        self.assertEqual(unpack_user_xattr(packed, 'grid.'), meta)
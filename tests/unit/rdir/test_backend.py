@@ -226,6 +226,104 @@ class TestRdirBackend(unittest.TestCase):
                 {"mtime": 2})]:
             self.assertTrue(c in data)
 
+    def test_chunk_push_many(self):
+        self.rdir.chunk_push(self.volume, self.container_0, self.content_0,
+                             self.chunk_0, mtime=1)
+        count = self.rdir.chunk_push_many(self.volume, [
+            {'container_id': self.container_1, 'content_id': self.content_0,
+             'chunk_id': self.chunk_0, 'mtime': 2},
+            {'container_id': self.container_0, 'content_id': self.content_0,
+             'chunk_id': self.chunk_0, 'rtime': 3},
+            {'container_id': self.container_1, 'content_id': self.content_0,
+             'chunk_id': self.chunk_0, 'rtime': 4}])
+        self.assertEqual(count, 2)
+        data = self.rdir.chunk_fetch(self.volume)
+        self.assertEqual(data, [
+            ("%s|%s|%s" %
+                (self.container_0, self.content_0, self.chunk_0),
+                {'mtime': 1, 'rtime': 3}),
+            ("%s|%s|%s" %
+                (self.container_1, self.content_0, self.chunk_0),
+                {'mtime': 2, 'rtime': 4})
+        ])
+
+    def test_fetch_container(self):
+        for container in (self.container_0, self.container_1,
+                          self.container_2):
+            self.rdir.chunk_push(self.volume, container, self.content_0,
+                                 self.chunk_0, mtime=1)
+            self.rdir.chunk_push(self.volume, container, self.content_1,
+                                 self.chunk_0, mtime=2)
+
+        data = self.rdir.chunk_fetch(self.volume,
+                                     container_id=self.container_1)
+        self.assertEqual(data, [
+            ("%s|%s|%s" %
+                (self.container_1, self.content_0, self.chunk_0),
+                {'mtime': 1}),
+            ("%s|%s|%s" %
+                (self.container_1, self.content_1, self.chunk_0),
+                {'mtime': 2})
+        ])
+
+        data = self.rdir.chunk_fetch(
+            self.volume, container_id=self.container_1,
+            start_after="%s|%s|%s" %
+            (self.container_1, self.content_0, self.chunk_0))
+        self.assertEqual(data, [
+            ("%s|%s|%s" %
+                (self.container_1, self.content_1, self.chunk_0),
+                {'mtime': 2})
+        ])
+
+        data = self.rdir.chunk_fetch(
+            self.volume, container_id=self.container_1,
+            start_after="%s|%s|%s" %
+            (self.container_2, self.content_0, self.chunk_0))
+        self.assertEqual(data, [])
+
+    def test_opened_db_bound(self):
+        rdir = RdirBackend(dict(self.conf, max_opened_db=2))
+        volumes = [random_id(32) for _ in range(3)]
+        for volume in volumes:
+            rdir.create(volume)
+            rdir.chunk_push(volume, self.container_0, self.content_0,
+                            self.chunk_0, mtime=1)
+        self.assertEqual(rdir.status(), {'opened_db_count': 2})
+        self.assertEqual(list(rdir.dbs.keys()), volumes[1:])
+        # the closed DB is reopened on demand
+        data = rdir.chunk_fetch(volumes[0])
+        self.assertEqual(len(data), 1)
+        self.assertEqual(list(rdir.dbs.keys()), [volumes[2], volumes[0]])
+        rdir.close()
+
+    def test_opened_db_pinned_by_iterator(self):
+        rdir = RdirBackend(dict(self.conf, max_opened_db=1))
+        volumes = [random_id(32) for _ in range(2)]
+        for volume in volumes:
+            rdir.create(volume)
+            for content in (self.content_0, self.content_1):
+                rdir.chunk_push(volume, self.container_0, content,
+                                self.chunk_0, mtime=1)
+        it = rdir.chunk_fetch_iter(volumes[0])
+        self.assertEqual(next(it)[1], {'mtime': 1})
+        # the DB of the iterator is not closed by the eviction
+        rdir.chunk_push(volumes[1], self.container_1, self.content_0,
+                        self.chunk_0, mtime=1)
+        self.assertEqual(list(rdir.dbs.keys()), volumes)
+        self.assertEqual(next(it)[1], {'mtime': 1})
+        self.assertRaises(StopIteration, next, it)
+        # then the bound applies again
+        self.assertEqual(list(rdir.dbs.keys()), volumes[1:])
+        self.assertEqual(rdir.pinned, {})
+        rdir.close()
+
+    def test_fetch_iter_no_such_db(self):
+        # raised at once, not when the first item is read
+        self.assertRaises(NoSuchDB, self.rdir.chunk_fetch_iter,
+                          "mynewvolume")
+        self.assertEqual(self.rdir.pinned, {})
+
     def test_rdir_status(self):
         # initial pushes
         self.rdir.chunk_push(self.volume, self.container_0, self.content_0,
@@ -76,6 +76,21 @@ class TestRdirServer(unittest.TestCase):
             ]
         ])
 
+    def test_push_many(self):
+        meta_1 = dict(self.meta, chunk_id=random_id(64))
+        resp = self.app.post("/v1/rdir/push",
+                             query_string={'vol': self.volume},
+                             data=json.dumps([self.meta, meta_1]),
+                             content_type="application/json")
+        self.assertEqual(resp.status_code, 204)
+
+        resp = self.app.post("/v1/rdir/fetch",
+                             query_string={'vol': self.volume},
+                             data=json.dumps({}),
+                             content_type="application/json")
+        self.assertEqual(resp.status_code, 200)
+        self.assertEqual(len(json.loads(resp.data)), 2)
+
     def test_push_missing_fields(self):
         for k in ['container_id', 'content_id', 'chunk_id']:
             save = self.meta.pop(k)
@@ -138,6 +153,14 @@ class TestRdirServer(unittest.TestCase):
         self.assertEqual(resp.status_code, 200)
         self.assertEqual(json.loads(resp.data), [])
 
+    def test_fetch_no_such_volume(self):
+        # a clean error, not a 200 with a truncated body
+        resp = self.app.post("/v1/rdir/fetch",
+                             query_string={'vol': "testvolume2"},
+                             data=json.dumps({}),
+                             content_type="application/json")
+        self.assertEqual(resp.status_code, 404)
+
     def test_rdir_status(self):
         resp = self.app.get("/v1/rdir/status",
                             query_string={'vol': self.volume})
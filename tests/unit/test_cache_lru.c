@@ -43,6 +43,42 @@ test_cache_cycle_lru (void)
 	oio_cache_destroy (c);
 }
 
+static void
+test_cache_lru_bounded (void)
+{
+	struct lru_tree_s *lru = lru_tree_create (
+			(GCompareFunc)g_strcmp0, g_free, g_free, 0);
+	struct oio_cache_s *c = oio_cache_make_LRU_bounded (lru, 2, 0);
+
+	g_assert_cmpint (OIO_CACHE_OK, ==, oio_cache_put (c, "k0", "v0"));
+	g_assert_cmpint (OIO_CACHE_OK, ==, oio_cache_put (c, "k1", "v1"));
+	test_found (c, "k0", "v0");
+	g_assert_cmpint (OIO_CACHE_OK, ==, oio_cache_put (c, "k2", "v2"));
+
+	/* k1 was the least recently used */
+	test_not_found (c, "k1");
+	test_found (c, "k0", "v0");
+	test_found (c, "k2", "v2");
+
+	g_assert_cmpint (OIO_CACHE_OK, ==, oio_cache_del (c, "k0"));
+	g_assert_cmpint (OIO_CACHE_NOTFOUND, ==, oio_cache_del (c, "k0"));
+	oio_cache_destroy (c);
+}
+
+static void
+test_cache_lru_ttl (void)
+{
+	struct lru_tree_s *lru = lru_tree_create (
+			(GCompareFunc)g_strcmp0, g_free, g_free, LTO_NOATIME);
+	struct oio_cache_s *c = oio_cache_make_LRU_bounded (lru, 0,
+			G_TIME_SPAN_MILLISECOND);
+
+	g_assert_cmpint (OIO_CACHE_OK, ==, oio_cache_put (c, "k", "v"));
+	g_usleep (2 * G_TIME_SPAN_MILLISECOND);
+	test_not_found (c, "k");
+	oio_cache_destroy (c);
+}
+
 static void
 test_cache_cycle_multilayer (void)
 {
@@ -59,6 +95,51 @@ test_cache_cycle_multilayer (void)
 	oio_cache_destroy (c);
 }
 
+static void
+test_cache_batch_lru (void)
+{
+	struct oio_cache_s *c = oio_cache_make_LRU (lru_tree_create (
+			(GCompareFunc)g_strcmp0, g_free, g_free, 0));
+	test_cache_batch (c);
+	oio_cache_destroy (c);
+}
+
+static void
+test_cache_batch_noop (void)
+{
+	struct oio_cache_s *c = oio_cache_make_NOOP ();
+	test_cache_batch (c);
+	oio_cache_destroy (c);
+}
+
+static void
+test_cache_multilayer_mget (void)
+{
+	struct oio_cache_s *c0 = oio_cache_make_LRU (lru_tree_create (
+			(GCompareFunc)g_strcmp0, g_free, g_free, 0));
+	struct oio_cache_s *c1 = oio_cache_make_LRU (lru_tree_create (
+			(GCompareFunc)g_strcmp0, g_free, g_free, 0));
+	struct oio_cache_s *c = oio_cache_make_multilayer_var (c0, c1, NULL);
+
+	const char *k[] = {"k0", "k1", NULL};
+	const char *v[] = {"v0", "v1", NULL};
+	g_assert_cmpint (OIO_CACHE_OK, ==, oio_cache_mput (c1, k, v));
+	g_assert_cmpint (OIO_CACHE_OK, ==, oio_cache_del (c1, "k1"));
+
+	/* k0 only in the lower layer, k1 nowhere */
+	gchar *out[2] = {NULL, NULL};
+	g_assert_cmpint (OIO_CACHE_OK, ==, oio_cache_mget (c, k, out));
+	g_assert_cmpstr (out[0], ==, "v0");
+	g_assert_null (out[1]);
+	g_free (out[0]);
+
+	/* k0 has been back-filled in the upper layer */
+	test_found (c0, "k0", "v0");
+	test_not_found (c0, "k1");
+
+	oio_cache_destroy (c);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -66,6 +147,11 @@ main (int argc, char **argv)
 	g_test_add_func("/cache/cycle/noop", test_cache_cycle_noop);
 	g_test_add_func("/cache/cycle/lru", test_cache_cycle_lru);
 	g_test_add_func("/cache/cycle/multilayer", test_cache_cycle_multilayer);
+	g_test_add_func("/cache/lru/bounded", test_cache_lru_bounded);
+	g_test_add_func("/cache/lru/ttl", test_cache_lru_ttl);
+	g_test_add_func("/cache/batch/noop", test_cache_batch_noop);
+	g_test_add_func("/cache/batch/lru", test_cache_batch_lru);
+	g_test_add_func("/cache/multilayer/mget", test_cache_multilayer_mget);
 	return g_test_run();
 }
 
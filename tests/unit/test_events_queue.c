@@ -17,7 +17,10 @@ You should have received a copy of the GNU Affero General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <unistd.h>
+
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <zmq.h>
 
 #include <core/oio_core.h>
@@ -47,6 +50,65 @@ test_queue_stalled (void)
 	oio_events_queue__destroy (q);
 }
 
+static void
+test_queue_batching (void)
+{
+	struct oio_events_queue_s *q = NULL;
+	GError *err = oio_events_queue_factory__create ("inproc://Y", &q);
+	g_assert_no_error (err);
+	g_assert_nonnull (q);
+	oio_events_queue__set_batching (q, 8, 1024*1024, G_TIME_SPAN_SECOND, TRUE);
+
+	for (guint i=0; i<20 ;++i)
+		oio_events_queue__send (q, g_strdup ("{}"));
+	oio_events_queue__run (q, immediately_done);
+
+	/* the incomplete batch has been flushed at the exit */
+	struct oio_events_queue_stats_s stats = {0};
+	oio_events_queue__get_stats (q, &stats);
+	g_assert_cmpuint (stats.received, ==, 20);
+	g_assert_cmpuint (stats.pending, ==, 20);
+	g_assert_cmpuint (stats.ack, ==, 0);
+	oio_events_queue__destroy (q);
+}
+
+static void
+test_queue_spool (void)
+{
+	gchar *path = NULL;
+	int fd = g_file_open_tmp ("test-events-spool-XXXXXX", &path, NULL);
+	g_assert_cmpint (fd, >=, 0);
+	close (fd);
+
+	struct oio_events_queue_s *q = NULL;
+	GError *err = oio_events_queue_factory__create ("inproc://Z", &q);
+	g_assert_no_error (err);
+	oio_events_queue__set_max_pending (q, 10);
+	err = oio_events_queue__set_spool (q, path, 64*1024);
+	g_assert_no_error (err);
+
+	/* the overflow goes to the spool, and the queue never stalls */
+	for (guint i=0; i<30 ;++i)
+		oio_events_queue__send (q, g_strdup ("{}"));
+	g_assert_false (oio_events_queue__is_stalled (q));
+	struct oio_events_queue_stats_s stats = {0};
+	oio_events_queue__get_stats (q, &stats);
+	g_assert_cmpuint (stats.spooled, ==, 20);
+	oio_events_queue__destroy (q);
+
+	/* the spooled events survive a restart */
+	err = oio_events_queue_factory__create ("inproc://Z", &q);
+	g_assert_no_error (err);
+	err = oio_events_queue__set_spool (q, path, 64*1024);
+	g_assert_no_error (err);
+	oio_events_queue__get_stats (q, &stats);
+	g_assert_cmpuint (stats.spooled, ==, 20);
+	oio_events_queue__destroy (q);
+
+	g_unlink (path);
+	g_free (path);
+}
+
 static void
 test_queue_init (void)
 {
@@ -70,5 +132,7 @@ main(int argc, char **argv)
 	HC_TEST_INIT(argc,argv);
 	g_test_add_func("/events/queue/init", test_queue_init);
 	g_test_add_func("/events/queue/clogged", test_queue_stalled);
+	g_test_add_func("/events/queue/batching", test_queue_batching);
+	g_test_add_func("/events/queue/spool", test_queue_spool);
 	return g_test_run();
 }
@@ -16,6 +16,8 @@ You should have received a copy of the GNU Lesser General Public
 License along with this library.
 */
 
+#include <string.h>
+
 #include <glib.h>
 #include <core/oiolog.h>
 #include <core/oioext.h>
@@ -76,6 +78,45 @@ test_partition (void)
 		g_assert_false (_is_even (tab[i]));
 }
 
+static void
+test_trace (void)
+{
+	/* without a trace started, nothing is recorded nor propagated */
+	g_assert_null (oio_ext_trace_context ());
+	OIO_TRACE("test.none", g_assert_null (oio_ext_trace_context ()));
+
+	oio_ext_set_reqid ("0123456789ABCDEF");
+	oio_ext_trace_start ("caller.span", oio_ext_monotonic_time () - 1);
+	g_assert_cmpstr (oio_ext_trace_context (), ==, "caller.span");
+	OIO_TRACE("test.outer", do {
+		g_assert_cmpstr (oio_ext_trace_context (), ==, "test.outer");
+		OIO_TRACE("test.inner",
+				g_assert_cmpstr (oio_ext_trace_context (), ==, "test.inner"));
+		g_assert_cmpstr (oio_ext_trace_context (), ==, "test.outer");
+	} while (0));
+	g_assert_cmpstr (oio_ext_trace_context (), ==, "caller.span");
+
+	/* a fast trace is not kept */
+	oio_ext_trace_stop (G_TIME_SPAN_HOUR);
+	g_assert_null (oio_ext_trace_context ());
+	GString *gs = g_string_new ("");
+	oio_ext_trace_dump (gs);
+	g_assert_cmpstr (gs->str, ==, "[]");
+
+	/* a slow one is */
+	oio_ext_trace_start (NULL, oio_ext_monotonic_time ());
+	for (guint i=0; i<OIO_TRACE_MAX_SPANS+2 ;++i)
+		oio_ext_trace_span ("test.span", oio_ext_monotonic_time ());
+	oio_ext_trace_stop (0);
+	g_string_set_size (gs, 0);
+	oio_ext_trace_dump (gs);
+	g_assert_nonnull (strstr (gs->str, "\"reqid\":\"0123456789ABCDEF\""));
+	g_assert_nonnull (strstr (gs->str, "\"dropped\":2"));
+	g_assert_nonnull (strstr (gs->str, "\"name\":\"test.span\""));
+	g_string_free (gs, TRUE);
+	oio_ext_set_reqid (NULL);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -83,6 +124,7 @@ main (int argc, char **argv)
 	g_test_add_func("/core/ext/array/partition", test_partition);
 	g_test_add_func("/core/ext/list/shuffle", test_shuffle_list);
 	g_test_add_func("/core/ext/array/shuffle", test_shuffle_array);
+	g_test_add_func("/core/ext/trace", test_trace);
 	return g_test_run();
 }
 
@@ -0,0 +1,179 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2015-2016 OpenIO, as part of OpenIO Software Defined Storage
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+#include <core/oio_core.h>
+#include <metautils/lib/metautils.h>
+#include <sqliterepo/gridd_client_pool.h>
+
+/* The pool polls the clients in a single thread, as the reactor of the
+ * proxy does, and calls their on_end hook once they are done. */
+
+struct test_event_s
+{
+	struct event_client_s ec; /* first, freed by the pool */
+	gint *ended;
+	GError **err;
+};
+
+static void
+_on_end (struct event_client_s *ec)
+{
+	struct test_event_s *ev = (struct test_event_s*) ec;
+	*(ev->err) = gridd_client_error (ec->client);
+	if (!*(ev->err) && !gridd_client_finished (ec->client))
+		*(ev->err) = NEWERROR (ERRCODE_CONN_RESET, "Not finished");
+	++ *(ev->ended);
+}
+
+/* A listening socket that never accepts: the connections are established
+ * by the kernel, but no reply will ever come. Its address is written in
+ * 'url', unless the socket is closed when 'listening' is FALSE, so that the
+ * connections are refused. */
+static int
+_silent_service (gchar *url, gsize len, gboolean listening)
+{
+	struct sockaddr_in sin = {0};
+	socklen_t slen = sizeof(sin);
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+	int fd = socket (AF_INET, SOCK_STREAM, 0);
+	g_assert_cmpint (fd, >=, 0);
+	g_assert_cmpint (0, ==, bind (fd, (struct sockaddr*)&sin, slen));
+	if (listening)
+		g_assert_cmpint (0, ==, listen (fd, 8));
+	g_assert_cmpint (0, ==, getsockname (fd, (struct sockaddr*)&sin, &slen));
+	g_snprintf (url, len, "127.0.0.1:%u", ntohs (sin.sin_port));
+	if (!listening)
+		metautils_pclose (&fd);
+	return fd;
+}
+
+static void
+_defer (struct gridd_client_pool_s *pool, const gchar *url, gdouble timeout,
+		gint *ended, GError **err)
+{
+	static guint8 c = 0;
+	GByteArray *req = g_byte_array_append (g_byte_array_new (), &c, 1);
+	struct test_event_s *ev = g_malloc0 (sizeof(*ev));
+	ev->ec.client = gridd_client_create_empty ();
+	ev->ec.on_end = _on_end;
+	ev->ended = ended;
+	ev->err = err;
+	g_assert_no_error (gridd_client_request (ev->ec.client, req, NULL, NULL));
+	g_assert_no_error (gridd_client_connect_url (ev->ec.client, url));
+	gridd_client_set_timeout (ev->ec.client, timeout);
+	g_byte_array_unref (req);
+	gridd_client_pool_defer (pool, &ev->ec);
+}
+
+/* Runs the rounds of the pool until 'ended' reaches 'expected', returns the
+ * time spent */
+static gint64
+_run_until (struct gridd_client_pool_s *pool, gint *ended, gint expected)
+{
+	const gint64 start = oio_ext_monotonic_time ();
+	while (*ended < expected) {
+		g_assert_cmpint (oio_ext_monotonic_time () - start, <,
+				10 * G_TIME_SPAN_SECOND);
+		g_assert_no_error (gridd_client_pool_round (pool, 1));
+	}
+	return oio_ext_monotonic_time () - start;
+}
+
+static void
+test_timeout (void)
+{
+	gchar url[64];
+	int fd = _silent_service (url, sizeof(url), TRUE);
+	struct gridd_client_pool_s *pool = gridd_client_pool_create ();
+	g_assert_nonnull (pool);
+
+	gint ended = 0;
+	GError *err = NULL;
+	_defer (pool, url, 0.5, &ended, &err);
+	const gint64 spent = _run_until (pool, &ended, 1);
+
+	/* the timeouts are checked every second */
+	g_assert_error (err, GQ(), ERRCODE_READ_TIMEOUT);
+	g_assert_cmpint (spent, >=, 500 * G_TIME_SPAN_MILLISECOND);
+	g_assert_cmpint (spent, <, 3 * G_TIME_SPAN_SECOND);
+	g_clear_error (&err);
+
+	gridd_client_pool_destroy (pool);
+	metautils_pclose (&fd);
+}
+
+static void
+test_refused (void)
+{
+	gchar url[64];
+	_silent_service (url, sizeof(url), FALSE);
+	struct gridd_client_pool_s *pool = gridd_client_pool_create ();
+
+	gint ended = 0;
+	GError *err = NULL;
+	_defer (pool, url, 30.0, &ended, &err);
+	const gint64 spent = _run_until (pool, &ended, 1);
+
+	/* reported at once, not at the timeout */
+	g_assert_nonnull (err);
+	g_assert_cmpint (spent, <, 2 * G_TIME_SPAN_SECOND);
+	g_clear_error (&err);
+
+	gridd_client_pool_destroy (pool);
+}
+
+static void
+test_destroy_pending (void)
+{
+	gchar url[64];
+	int fd = _silent_service (url, sizeof(url), TRUE);
+	struct gridd_client_pool_s *pool = gridd_client_pool_create ();
+
+	/* one running, one still waiting to be started */
+	gint ended = 0;
+	GError *err0 = NULL, *err1 = NULL;
+	_defer (pool, url, 30.0, &ended, &err0);
+	g_assert_no_error (gridd_client_pool_round (pool, 0));
+	_defer (pool, url, 30.0, &ended, &err1);
+	g_assert_cmpint (ended, ==, 0);
+
+	/* both are ended, the running one with an error */
+	gridd_client_pool_destroy (pool);
+	g_assert_cmpint (ended, ==, 2);
+	g_assert_nonnull (err0);
+	g_clear_error (&err0);
+	g_clear_error (&err1);
+	metautils_pclose (&fd);
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT (argc, argv);
+	g_test_add_func ("/sqliterepo/client_pool/timeout", test_timeout);
+	g_test_add_func ("/sqliterepo/client_pool/refused", test_refused);
+	g_test_add_func ("/sqliterepo/client_pool/destroy", test_destroy_pending);
+	return g_test_run ();
+}
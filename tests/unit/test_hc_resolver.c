@@ -0,0 +1,213 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2015-2016 OpenIO, as part of OpenIO Software Defined Storage
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <glib.h>
+
+#include "../../resolver/hc_resolver.c"
+
+#define HOT   256
+#define SCAN  20000
+
+static const char * const srv[] = {"127.0.0.1:6000", NULL};
+
+/* Asks the services cache as the resolver does, and fills it on a miss.
+ * Returns TRUE on a hit. */
+static gboolean
+_lookup (struct hc_resolver_s *r, const struct hashstr_s *k)
+{
+	gchar **v = hc_resolver_get_cached (r, &r->services, k);
+	if (v) {
+		g_strfreev (v);
+		return TRUE;
+	}
+	hc_resolver_store (r, &r->services, k, srv, TRUE);
+	return FALSE;
+}
+
+static gboolean
+_cached (struct hc_resolver_s *r, const struct hashstr_s *k)
+{
+	gchar **v = lru_striped_get (r->services.cache, k,
+			(GBoxedCopyFunc) hc_resolver_element_extract);
+	g_strfreev (v);
+	return v != NULL;
+}
+
+static struct hashstr_s **
+_keys (const char *prefix, guint count)
+{
+	struct hashstr_s **keys = g_malloc0 ((count + 1) * sizeof(void*));
+	for (guint i=0; i<count ;++i)
+		keys[i] = hashstr_printf ("%s-%u", prefix, i);
+	return keys;
+}
+
+static void
+_keys_free (struct hashstr_s **keys)
+{
+	for (struct hashstr_s **p=keys; *p ;++p)
+		g_free (*p);
+	g_free (keys);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void
+test_sketch (void)
+{
+	struct hc_sketch_s *sk = g_malloc0 (sizeof(struct hc_sketch_s));
+	struct hashstr_s *k = hashstr_create ("key");
+	struct hashstr_s *other = hashstr_create ("other");
+
+	/* The first occurence only reaches the doorkeeper */
+	g_assert_cmpuint (0, ==, _sketch_estimate (sk, k));
+	_sketch_record (sk, k, 1000);
+	g_assert_cmpuint (1, ==, _sketch_estimate (sk, k));
+	g_assert_cmpuint (0, ==, _sketch_estimate (sk, other));
+
+	/* The counters saturate */
+	for (guint i=0; i<7 ;++i)
+		_sketch_record (sk, k, 1000);
+	g_assert_cmpuint (8, ==, _sketch_estimate (sk, k));
+	for (guint i=0; i<32 ;++i)
+		_sketch_record (sk, k, 1000);
+	g_assert_cmpuint (16, ==, _sketch_estimate (sk, k));
+	g_assert_true (_sketch_admit (k, other, sk));
+	g_assert_false (_sketch_admit (other, k, sk));
+
+	/* The aging halves the counters and forgets the doorkeeper */
+	_sketch_age (sk);
+	g_assert_cmpuint (7, ==, _sketch_estimate (sk, k));
+
+	/* ... and happens by itself after 10 times the size of the cache */
+	sk->samples = 0;
+	for (guint i=0; i<9 ;++i)
+		_sketch_record (sk, other, 1);
+	g_assert_cmpuint (9, ==, _sketch_estimate (sk, other));
+	_sketch_record (sk, other, 1);
+	g_assert_cmpuint (4, ==, _sketch_estimate (sk, other));
+	g_assert_cmpuint (3, ==, _sketch_estimate (sk, k));
+
+	g_free (other);
+	g_free (k);
+	g_free (sk);
+}
+
+static void
+test_scan (void)
+{
+	struct hc_resolver_s *r = hc_resolver_create ();
+	hc_resolver_set_max_services (r, 1024);
+	struct hashstr_s **hot = _keys ("hot", HOT);
+	struct hashstr_s **scan = _keys ("scan", SCAN);
+
+	for (guint round=0; round<8 ;++round) {
+		for (guint i=0; i<HOT ;++i)
+			_lookup (r, hot[i]);
+	}
+	for (guint i=0; i<HOT ;++i)
+		g_assert_true (_cached (r, hot[i]));
+
+	/* A one-off scan, several times as large as the cache and long enough
+	 * to age the sketch, interleaved with the usual traffic */
+	for (guint i=0; i<SCAN ;++i) {
+		g_assert_false (_lookup (r, scan[i]));
+		_lookup (r, hot[i % HOT]);
+	}
+
+	/* The popular entries survived, the scan was mostly rejected and the
+	 * cache stayed within its bounds */
+	guint hits = 0;
+	for (guint i=0; i<HOT ;++i)
+		hits += _lookup (r, hot[i]);
+	g_assert_cmpuint (hits, >=, HOT - HOT / 100);
+	g_assert_cmpuint (r->services.rejected, >=, SCAN / 2);
+	g_assert_cmpint (lru_striped_count (r->services.cache), <=, 1024);
+
+	_keys_free (scan);
+	_keys_free (hot);
+	hc_resolver_destroy (r);
+}
+
+static void
+test_scan_noadmit (void)
+{
+	struct hc_resolver_s *r = hc_resolver_create ();
+	hc_resolver_configure (r, HC_RESOLVER_NOADMIT);
+	hc_resolver_set_max_services (r, 1024);
+	struct hashstr_s **hot = _keys ("hot", HOT);
+	struct hashstr_s **scan = _keys ("scan", SCAN);
+
+	/* Without admission, everything enters and only the purge trims */
+	for (guint i=0; i<HOT ;++i)
+		_lookup (r, hot[i]);
+	for (guint i=0; i<SCAN ;++i)
+		_lookup (r, scan[i]);
+	g_assert_cmpuint (r->services.rejected, ==, 0);
+	g_assert_cmpint (lru_striped_count (r->services.cache), ==, HOT + SCAN);
+	g_assert_cmpuint (hc_resolver_purge (r), ==, HOT + SCAN - 1024);
+
+	_keys_free (scan);
+	_keys_free (hot);
+	hc_resolver_destroy (r);
+}
+
+static void
+test_tell (void)
+{
+	struct hc_resolver_s *r = hc_resolver_create ();
+	hc_resolver_set_max_services (r, 1024);
+	struct hashstr_s **hot = _keys ("hot", 2 * 1024);
+
+	/* Every segment full of entries often asked, without aging */
+	for (guint round=0; round<4 ;++round) {
+		for (guint i=0; i<2 * 1024 ;++i)
+			_lookup (r, hot[i]);
+	}
+
+	/* A service never asked is rejected by the admission... */
+	struct oio_url_s *url = oio_url_init ("NS/ACCT/JFS");
+	struct hashstr_s *k = _srv_key ("meta2", url);
+	g_assert_false (_lookup (r, k));
+	g_assert_false (_cached (r, k));
+	g_assert_cmpuint (r->services.rejected, >, 0);
+
+	/* ... unless told by the service that just linked it */
+	hc_resolver_tell (r, url, "meta2", srv);
+	g_assert_true (_cached (r, k));
+
+	/* Then the purge bounds the cache again */
+	hc_resolver_purge (r);
+	g_assert_cmpint (lru_striped_count (r->services.cache), <=, 1024);
+
+	g_free (k);
+	oio_url_pclean (&url);
+	_keys_free (hot);
+	hc_resolver_destroy (r);
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT (argc, argv);
+	g_test_add_func ("/resolver/sketch", test_sketch);
+	g_test_add_func ("/resolver/admission/scan", test_scan);
+	g_test_add_func ("/resolver/admission/noadmit", test_scan_noadmit);
+	g_test_add_func ("/resolver/admission/tell", test_tell);
+	return g_test_run ();
+}
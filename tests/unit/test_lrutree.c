@@ -20,11 +20,13 @@ License along with this library.
 #include <core/oio_core.h>
 #include <metautils/lib/lrutree.h>
 
-int
-main(int argc, char **argv)
-{
-	HC_TEST_INIT(argc,argv);
+#define BENCH_THREADS 8
+#define BENCH_KEYS 4096
+#define BENCH_OPS 200000
 
+static void
+test_tree (void)
+{
 	struct lru_tree_s *lt = lru_tree_create(
 			(GCompareFunc)g_strcmp0, g_free, NULL, 0);
 	g_assert(lt != NULL);
@@ -46,6 +48,195 @@ main(int argc, char **argv)
 	lru_tree_foreach(lt, _func, NULL);
 
 	lru_tree_destroy(lt);
-	return 0;
 }
 
+static void
+test_striped (void)
+{
+	struct lru_striped_s *ls = lru_striped_create(
+			g_str_hash, g_str_equal, g_free, g_free, 0, 4);
+	g_assert(ls != NULL);
+
+	lru_striped_insert(ls, g_strdup("plop"), g_strdup("0"));
+	lru_striped_insert(ls, g_strdup("plop"), g_strdup("1"));
+	lru_striped_insert(ls, g_strdup("plip"), g_strdup("2"));
+	g_assert_cmpint(2, ==, lru_striped_count(ls));
+
+	gchar *v = lru_striped_get(ls, "plop", (GBoxedCopyFunc)g_strdup);
+	g_assert_cmpstr(v, ==, "1");
+	g_free(v);
+	g_assert_null(lru_striped_get(ls, "plup", NULL));
+
+	g_assert_true(lru_striped_remove(ls, "plip"));
+	g_assert_false(lru_striped_remove(ls, "plip"));
+	g_assert_cmpint(1, ==, lru_striped_count(ls));
+
+	/* Nothing is older than the past */
+	g_assert_cmpuint(0, ==, lru_striped_remove_older(ls, 0));
+	g_assert_cmpuint(1, ==, lru_striped_remove_older(ls,
+			oio_ext_monotonic_time() + 2 * G_TIME_SPAN_SECOND));
+	g_assert_cmpint(0, ==, lru_striped_count(ls));
+
+	lru_striped_destroy(ls);
+}
+
+static void
+test_striped_clock (void)
+{
+	/* a single segment, for a deterministic eviction order */
+	struct lru_striped_s *ls = lru_striped_create(
+			g_str_hash, g_str_equal, g_free, NULL, 0, 1);
+
+	for (int i=0; i<4 ;++i)
+		lru_striped_insert(ls, g_strdup_printf("k%d", i), GINT_TO_POINTER(1));
+
+	/* the referenced entries get a second chance */
+	g_assert_nonnull(lru_striped_get(ls, "k0", NULL));
+	g_assert_nonnull(lru_striped_get(ls, "k2", NULL));
+	g_assert_cmpuint(2, ==, lru_striped_remove_exceeding(ls, 2));
+	g_assert_nonnull(lru_striped_get(ls, "k0", NULL));
+	g_assert_null(lru_striped_get(ls, "k1", NULL));
+	g_assert_nonnull(lru_striped_get(ls, "k2", NULL));
+	g_assert_null(lru_striped_get(ls, "k3", NULL));
+
+	g_assert_cmpuint(2, ==, lru_striped_remove_exceeding(ls, 0));
+	lru_striped_destroy(ls);
+}
+
+static gboolean
+_admit_if_even (gconstpointer candidate, gconstpointer victim, gpointer u)
+{
+	(void) victim, (void) u;
+	const char *k = candidate;
+	return (k[1] - '0') % 2 == 0;
+}
+
+static void
+test_striped_admit (void)
+{
+	struct lru_striped_s *ls = lru_striped_create(
+			g_str_hash, g_str_equal, g_free, NULL, 0, 1);
+
+	for (int i=0; i<3 ;++i)
+		lru_striped_insert(ls, g_strdup_printf("k%d", i), GINT_TO_POINTER(1));
+	g_assert_true(lru_striped_admit(ls, g_strdup("k3"),
+			GINT_TO_POINTER(1), 0, _admit_if_even, NULL));
+	g_assert_true(lru_striped_remove(ls, "k3"));
+
+	/* over the limit, a rejected entry evicts nothing */
+	g_assert_false(lru_striped_admit(ls, g_strdup("k5"),
+			GINT_TO_POINTER(1), 2, _admit_if_even, NULL));
+	g_assert_null(lru_striped_get(ls, "k5", NULL));
+	g_assert_cmpint(3, ==, lru_striped_count(ls));
+
+	/* an admitted entry takes the room of the eviction candidate */
+	g_assert_true(lru_striped_admit(ls, g_strdup("k4"),
+			GINT_TO_POINTER(1), 2, _admit_if_even, NULL));
+	g_assert_nonnull(lru_striped_get(ls, "k4", NULL));
+	g_assert_null(lru_striped_get(ls, "k0", NULL));
+	g_assert_cmpint(3, ==, lru_striped_count(ls));
+
+	/* a known key is always updated */
+	g_assert_true(lru_striped_admit(ls, g_strdup("k1"),
+			GINT_TO_POINTER(2), 2, _admit_if_even, NULL));
+	g_assert_cmpint(2, ==, GPOINTER_TO_INT(lru_striped_get(ls, "k1", NULL)));
+
+	lru_striped_destroy(ls);
+}
+
+/* Contended benchmark ----------------------------------------------------- */
+
+struct bench_s
+{
+	gchar **keys;
+	gboolean (*op) (struct bench_s *b, guint i);
+	struct lru_tree_s *lt;
+	GMutex lock;
+	struct lru_striped_s *ls;
+};
+
+static gboolean
+_bench_tree (struct bench_s *b, guint i)
+{
+	const gchar *k = b->keys[i % BENCH_KEYS];
+	g_mutex_lock(&b->lock);
+	gboolean hit = NULL != lru_tree_get(b->lt, k);
+	if (!hit)
+		lru_tree_insert(b->lt, g_strdup(k), GINT_TO_POINTER(1));
+	g_mutex_unlock(&b->lock);
+	return hit;
+}
+
+static gboolean
+_bench_striped (struct bench_s *b, guint i)
+{
+	const gchar *k = b->keys[i % BENCH_KEYS];
+	gboolean hit = NULL != lru_striped_get(b->ls, k, NULL);
+	if (!hit)
+		lru_striped_insert(b->ls, g_strdup(k), GINT_TO_POINTER(1));
+	return hit;
+}
+
+static gpointer
+_bench_worker (gpointer p)
+{
+	struct bench_s *b = p;
+	GRand *r = g_rand_new();
+	for (guint i=0; i<BENCH_OPS ;++i)
+		b->op(b, g_rand_int(r));
+	g_rand_free(r);
+	return NULL;
+}
+
+static gint64
+_bench_run (struct bench_s *b)
+{
+	GThread *th[BENCH_THREADS];
+	const gint64 start = g_get_monotonic_time();
+	for (guint i=0; i<BENCH_THREADS ;++i)
+		th[i] = g_thread_new("bench", _bench_worker, b);
+	for (guint i=0; i<BENCH_THREADS ;++i)
+		g_thread_join(th[i]);
+	return g_get_monotonic_time() - start;
+}
+
+static void
+test_striped_contended (void)
+{
+	struct bench_s b = {0};
+	b.keys = g_malloc0((BENCH_KEYS + 1) * sizeof(gchar*));
+	for (guint i=0; i<BENCH_KEYS ;++i)
+		b.keys[i] = g_strdup_printf("%08X", i);
+
+	b.lt = lru_tree_create((GCompareFunc)g_strcmp0, g_free, NULL, 0);
+	g_mutex_init(&b.lock);
+	b.op = _bench_tree;
+	const gint64 t_tree = _bench_run(&b);
+	g_assert_cmpint(BENCH_KEYS, ==, lru_tree_count(b.lt));
+	lru_tree_destroy(b.lt);
+	g_mutex_clear(&b.lock);
+
+	b.ls = lru_striped_create(g_str_hash, g_str_equal, g_free, NULL, 0, 0);
+	b.op = _bench_striped;
+	const gint64 t_striped = _bench_run(&b);
+	g_assert_cmpint(BENCH_KEYS, ==, lru_striped_count(b.ls));
+	lru_striped_destroy(b.ls);
+
+	const gdouble ops = BENCH_THREADS * BENCH_OPS;
+	g_test_message("%u threads, mutex+tree %.0f op/s, striped %.0f op/s",
+			BENCH_THREADS, ops * G_TIME_SPAN_SECOND / MAX(t_tree, 1),
+			ops * G_TIME_SPAN_SECOND / MAX(t_striped, 1));
+	g_strfreev(b.keys);
+}
+
+int
+main(int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func("/metautils/lru/tree", test_tree);
+	g_test_add_func("/metautils/lru/striped", test_striped);
+	g_test_add_func("/metautils/lru/striped/clock", test_striped_clock);
+	g_test_add_func("/metautils/lru/striped/admit", test_striped_admit);
+	g_test_add_func("/metautils/lru/striped/contended", test_striped_contended);
+	return g_test_run();
+}
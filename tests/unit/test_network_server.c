@@ -0,0 +1,711 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2015-2016 OpenIO, as part of OpenIO Software Defined Storage
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+#include <core/oio_core.h>
+#include <metautils/lib/metautils.h>
+#include <server/network_server.h>
+#include <server/slab.h>
+#include <server/internals.h>
+
+/* A line-based transport: each line is echoed, unless it asks the client
+ * to be suspended. The lines received meanwhile are managed once the client
+ * is resumed. A FLOOD line is answered with FLOOD_COUNT blocks, the output
+ * waiting for the client to read when more than FLOOD_PENDING blocks are
+ * queued. A CORK line is answered with CORK_COUNT short lines, that must be
+ * held, then a block too large to be held, and a last short line. */
+
+#define FLOOD_COUNT 1024
+#define FLOOD_PENDING 4
+#define CORK_COUNT 64
+
+static guint8 flood[64 * 1024];
+
+struct line_ctx_s
+{
+	GString *pending;
+	gboolean suspended;
+};
+
+static struct network_client_s * volatile suspended_clt = NULL;
+static volatile gint cleaned = 0;
+static volatile gint flooded = 0;
+static volatile gint corked = 0;
+
+static void
+_line_clean (struct line_ctx_s *ctx)
+{
+	g_string_free (ctx->pending, TRUE);
+	g_free (ctx);
+	g_atomic_int_inc (&cleaned);
+}
+
+static int
+_line_notify_input (struct network_client_s *clt)
+{
+	struct line_ctx_s *ctx = (struct line_ctx_s*) clt->transport.client_context;
+
+	if (ctx->suspended) {
+		ctx->suspended = FALSE;
+		network_client_send_slab (clt,
+				data_slab_make_static_string ("RESUMED\n"));
+	}
+
+	while (data_slab_sequence_has_data (&clt->input)) {
+		struct data_slab_s *slab = data_slab_sequence_shift (&clt->input);
+		guint8 *data = NULL;
+		gsize len = G_MAXSIZE;
+		if (data_slab_consume (slab, &data, &len) && data && len)
+			g_string_append_len (ctx->pending, (gchar*)data, len);
+		data_slab_free (slab);
+	}
+
+	gchar *eol;
+	while (!ctx->suspended && (eol = strchr (ctx->pending->str, '\n'))) {
+		gchar *line = g_strndup (ctx->pending->str, eol - ctx->pending->str);
+		g_string_erase (ctx->pending, 0, (eol - ctx->pending->str) + 1);
+
+		if (!strcmp (line, "SUSPEND") || !strcmp (line, "SUSPEND_RESUME")) {
+			ctx->suspended = TRUE;
+			network_client_suspend (clt);
+			g_atomic_pointer_set (&suspended_clt, clt);
+			/* resumed while still held by the worker */
+			if (!strcmp (line, "SUSPEND_RESUME"))
+				network_client_resume (clt);
+		} else if (!strcmp (line, "FLOOD")) {
+			gboolean ok = TRUE;
+			for (int i = 0; ok && i < FLOOD_COUNT ;++i) {
+				network_client_send_slab (clt,
+						data_slab_make_static_buffer (flood, sizeof(flood)));
+				ok = network_client_wait_output (clt,
+						FLOOD_PENDING * sizeof(flood),
+						oio_ext_monotonic_time () + G_TIME_SPAN_SECOND);
+				g_assert_cmpuint (data_slab_sequence_size (&clt->output), <=,
+						FLOOD_PENDING * sizeof(flood));
+			}
+			g_atomic_int_set (&flooded, ok ? 1 : -1);
+			if (!ok) {
+				network_client_allow_input (clt, FALSE);
+				network_client_close_output (clt, 1);
+			}
+		} else if (!strcmp (line, "CORK")) {
+			gsize held = 0;
+			for (int i = 0; i < CORK_COUNT ;++i) {
+				gchar *reply = g_strdup_printf ("R%02d\n", i);
+				held += strlen (reply);
+				network_client_send_slab (clt, data_slab_make_string (reply));
+				g_free (reply);
+			}
+			/* Nothing sent yet, the block flushes them and follows */
+			gboolean ok = (clt->corked == held);
+			network_client_send_slab (clt,
+					data_slab_make_static_buffer (flood, sizeof(flood)));
+			ok = ok && !clt->corked;
+			network_client_send_slab (clt,
+					data_slab_make_static_string ("END\n"));
+			g_atomic_int_set (&corked, ok ? 1 : -1);
+		} else {
+			GString *reply = g_string_new ("ECHO ");
+			g_string_append (reply, line);
+			g_string_append_c (reply, '\n');
+			network_client_send_slab (clt, data_slab_make_gstr (reply));
+		}
+		g_free (line);
+	}
+
+	return clt->transport.waiting_for_close ? RC_NODATA : RC_PROCESSED;
+}
+
+static void
+_line_factory (gpointer u UNUSED, struct network_client_s *clt)
+{
+	struct line_ctx_s *ctx = g_malloc0 (sizeof(*ctx));
+	ctx->pending = g_string_new ("");
+	clt->transport.client_context = (struct transport_client_context_s*) ctx;
+	clt->transport.clean_context = (network_transport_cleaner_f) _line_clean;
+	clt->transport.notify_input = _line_notify_input;
+	clt->transport.notify_error = NULL;
+	network_client_allow_input (clt, TRUE);
+}
+
+/* Helpers ----------------------------------------------------------------- */
+
+struct test_server_s
+{
+	struct network_server_s *srv;
+	GThread *th;
+};
+
+static gpointer
+_server_run (gpointer p)
+{
+	g_assert_no_error (network_server_run ((struct network_server_s *)p));
+	return p;
+}
+
+static void
+_server_start (struct test_server_s *ts, gint64 max_suspended)
+{
+	g_atomic_pointer_set (&suspended_clt, NULL);
+	g_atomic_int_set (&cleaned, 0);
+	g_atomic_int_set (&flooded, 0);
+	g_atomic_int_set (&corked, 0);
+	ts->srv = network_server_init ();
+	if (max_suspended > 0)
+		network_server_set_max_suspended (ts->srv, max_suspended);
+	network_server_bind_host (ts->srv, "127.0.0.1:0", NULL, _line_factory);
+	g_assert_no_error (network_server_open_servers (ts->srv));
+	ts->th = g_thread_new ("server", _server_run, ts->srv);
+}
+
+static void
+_server_join (struct test_server_s *ts)
+{
+	network_server_stop (ts->srv);
+	g_thread_join (ts->th);
+	ts->th = NULL;
+}
+
+static void
+_server_clean (struct test_server_s *ts)
+{
+	if (ts->th)
+		_server_join (ts);
+	network_server_close_servers (ts->srv);
+	network_server_clean (ts->srv);
+}
+
+static int
+_connect (struct test_server_s *ts)
+{
+	gchar **urlv = network_server_endpoints (ts->srv);
+	GError *err = NULL;
+	int fd = sock_connect (urlv[0], &err);
+	g_assert_no_error (err);
+	g_strfreev (urlv);
+	return fd;
+}
+
+static void
+_send (int fd, const gchar *s)
+{
+	struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+	g_assert_cmpint (1, ==, poll (&pfd, 1, 5000));
+	g_assert_cmpint (strlen (s), ==, write (fd, s, strlen (s)));
+}
+
+/* Reads until 'expected' is received, or the connection is closed if it is
+ * NULL. */
+static void
+_expect (int fd, const gchar *expected)
+{
+	GString *in = g_string_new ("");
+	const gint64 deadline = oio_ext_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+	while (!expected || in->len < strlen (expected)) {
+		const gint64 left = deadline - oio_ext_monotonic_time ();
+		g_assert_cmpint (left, >, 0);
+		struct pollfd pfd = {.fd = fd, .events = POLLIN};
+		if (poll (&pfd, 1, left / G_TIME_SPAN_MILLISECOND) <= 0)
+			continue;
+		gchar buf[256];
+		ssize_t r = read (fd, buf, sizeof(buf));
+		if (r < 0 && (errno == EAGAIN || errno == EINTR))
+			continue;
+		if (r <= 0)
+			break;
+		g_string_append_len (in, buf, r);
+	}
+	if (expected)
+		g_assert_cmpstr (in->str, ==, expected);
+	else
+		g_assert_cmpuint (in->len, ==, 0);
+	g_string_free (in, TRUE);
+}
+
+static void
+_expect_nothing (int fd, gint64 delay)
+{
+	struct pollfd pfd = {.fd = fd, .events = POLLIN};
+	g_assert_cmpint (0, ==, poll (&pfd, 1, delay / G_TIME_SPAN_MILLISECOND));
+}
+
+static struct network_client_s *
+_wait_suspended (void)
+{
+	struct network_client_s *clt = NULL;
+	for (int i = 0; i < 5000 && !clt ;++i) {
+		if (!(clt = g_atomic_pointer_get (&suspended_clt)))
+			g_usleep (G_TIME_SPAN_MILLISECOND);
+	}
+	g_assert_nonnull (clt);
+	g_atomic_pointer_set (&suspended_clt, NULL);
+	return clt;
+}
+
+static void
+_wait_cleaned (gint expected)
+{
+	for (int i = 0; i < 5000 ;++i) {
+		if (g_atomic_int_get (&cleaned) >= expected)
+			break;
+		g_usleep (G_TIME_SPAN_MILLISECOND);
+	}
+	g_assert_cmpint (g_atomic_int_get (&cleaned), ==, expected);
+}
+
+/* Tests ------------------------------------------------------------------- */
+
+static void
+test_echo (void)
+{
+	struct test_server_s ts = {0};
+	_server_start (&ts, 0);
+	int fd = _connect (&ts);
+	_send (fd, "A\nB\n");
+	_expect (fd, "ECHO A\nECHO B\n");
+	_send (fd, "C\n");
+	_expect (fd, "ECHO C\n");
+	metautils_pclose (&fd);
+	_wait_cleaned (1);
+	_server_clean (&ts);
+}
+
+static void
+test_suspend_resume (void)
+{
+	struct test_server_s ts = {0};
+	_server_start (&ts, 0);
+	int fd = _connect (&ts);
+
+	/* nothing is managed while the client is suspended */
+	_send (fd, "SUSPEND\nPING\n");
+	struct network_client_s *clt = _wait_suspended ();
+	_send (fd, "PONG\n");
+	_expect_nothing (fd, 200 * G_TIME_SPAN_MILLISECOND);
+
+	/* then all the pending input is */
+	network_client_resume (clt);
+	_expect (fd, "RESUMED\nECHO PING\nECHO PONG\n");
+
+	/* and the client is monitored again */
+	_send (fd, "AGAIN\n");
+	_expect (fd, "ECHO AGAIN\n");
+
+	metautils_pclose (&fd);
+	_wait_cleaned (1);
+	_server_clean (&ts);
+}
+
+static void
+test_resume_while_held (void)
+{
+	struct test_server_s ts = {0};
+	_server_start (&ts, 0);
+	int fd = _connect (&ts);
+
+	_send (fd, "SUSPEND_RESUME\nPING\n");
+	_expect (fd, "RESUMED\nECHO PING\n");
+	_send (fd, "AGAIN\n");
+	_expect (fd, "ECHO AGAIN\n");
+
+	metautils_pclose (&fd);
+	_wait_cleaned (1);
+	_server_clean (&ts);
+}
+
+static void
+test_suspend_expired (void)
+{
+	struct test_server_s ts = {0};
+	_server_start (&ts, 100 * G_TIME_SPAN_MILLISECOND);
+	int fd = _connect (&ts);
+
+	/* the connection of a client suspended for too long is closed */
+	_send (fd, "SUSPEND\nPING\n");
+	struct network_client_s *clt = _wait_suspended ();
+	_expect (fd, NULL);
+	metautils_pclose (&fd);
+
+	/* but the client is freed only once resumed */
+	g_assert_cmpint (0, ==, g_atomic_int_get (&cleaned));
+	network_client_resume (clt);
+	_wait_cleaned (1);
+
+	/* other clients are not affected */
+	fd = _connect (&ts);
+	_send (fd, "A\n");
+	_expect (fd, "ECHO A\n");
+	metautils_pclose (&fd);
+	_server_clean (&ts);
+}
+
+static void
+test_suspend_at_exit (void)
+{
+	struct test_server_s ts = {0};
+	_server_start (&ts, 0);
+	int fd = _connect (&ts);
+
+	_send (fd, "SUSPEND\n");
+	struct network_client_s *clt = _wait_suspended ();
+
+	/* the server does not wait for the suspended client forever */
+	_server_join (&ts);
+	_expect (fd, NULL);
+	metautils_pclose (&fd);
+
+	network_client_resume (clt);
+	_wait_cleaned (1);
+	_server_clean (&ts);
+}
+
+/* Reads until the connection is closed, after 'delay' */
+static gsize
+_drain (int fd, gint64 delay)
+{
+	g_usleep (delay);
+	gsize total = 0;
+	for (;;) {
+		struct pollfd pfd = {.fd = fd, .events = POLLIN};
+		g_assert_cmpint (poll (&pfd, 1, 10000), >, 0);
+		gchar buf[65536];
+		ssize_t r = read (fd, buf, sizeof(buf));
+		if (r < 0 && (errno == EAGAIN || errno == EINTR))
+			continue;
+		if (r <= 0)
+			return total;
+		total += r;
+		if (total >= FLOOD_COUNT * sizeof(flood))
+			return total;
+	}
+}
+
+static void
+test_output_read (void)
+{
+	struct test_server_s ts = {0};
+	_server_start (&ts, 0);
+	int fd = _connect (&ts);
+
+	_send (fd, "FLOOD\n");
+	g_assert_cmpuint (_drain (fd, 0), ==, FLOOD_COUNT * sizeof(flood));
+	g_assert_cmpint (g_atomic_int_get (&flooded), ==, 1);
+	_send (fd, "A\n");
+	_expect (fd, "ECHO A\n");
+
+	metautils_pclose (&fd);
+	_wait_cleaned (1);
+	_server_clean (&ts);
+}
+
+static void
+test_output_stalled (void)
+{
+	struct test_server_s ts = {0};
+	_server_start (&ts, 0);
+	int fd = _connect (&ts);
+
+	/* the output waiting for a client that does not read is bounded, then
+	 * the client is given up */
+	_send (fd, "FLOOD\n");
+	g_assert_cmpuint (_drain (fd, 3 * G_TIME_SPAN_SECOND), <,
+			FLOOD_COUNT * sizeof(flood));
+	g_assert_cmpint (g_atomic_int_get (&flooded), ==, -1);
+
+	metautils_pclose (&fd);
+	_wait_cleaned (1);
+	_server_clean (&ts);
+}
+
+static void
+test_output_corked (void)
+{
+	struct test_server_s ts = {0};
+	_server_start (&ts, 0);
+	int fd = _connect (&ts);
+
+	/* the small replies are held while the input is managed, and the order
+	 * of the stream is kept when a large reply flushes them */
+	_send (fd, "CORK\n");
+	GString *expected = g_string_new ("");
+	for (int i = 0; i < CORK_COUNT ;++i)
+		g_string_append_printf (expected, "R%02d\n", i);
+	g_string_append_len (expected, (gchar*) flood, sizeof(flood));
+	g_string_append (expected, "END\n");
+
+	GString *in = g_string_new ("");
+	while (in->len < expected->len) {
+		struct pollfd pfd = {.fd = fd, .events = POLLIN};
+		g_assert_cmpint (poll (&pfd, 1, 5000), >, 0);
+		gchar buf[4096];
+		ssize_t r = read (fd, buf, sizeof(buf));
+		if (r < 0 && (errno == EAGAIN || errno == EINTR))
+			continue;
+		g_assert_cmpint (r, >, 0);
+		g_string_append_len (in, buf, r);
+	}
+	g_assert_cmpuint (in->len, ==, expected->len);
+	g_assert_true (0 == memcmp (in->str, expected->str, expected->len));
+	g_assert_cmpint (g_atomic_int_get (&corked), ==, 1);
+	g_string_free (in, TRUE);
+	g_string_free (expected, TRUE);
+
+	metautils_pclose (&fd);
+	_wait_cleaned (1);
+	_server_clean (&ts);
+}
+
+/* Slabs ------------------------------------------------------------------- */
+
+/* Reads at most 'max' bytes, without waiting */
+static gsize
+_read_some (int fd, GByteArray *out, gsize max)
+{
+	guint8 buf[8192];
+	ssize_t r = read (fd, buf, MIN(max, sizeof(buf)));
+	if (r < 0) {
+		g_assert_true (errno == EAGAIN || errno == EINTR);
+		return 0;
+	}
+	g_byte_array_append (out, buf, r);
+	return r;
+}
+
+static void
+test_slab_sequence_send (void)
+{
+	int fds[2] = {-1, -1};
+	g_assert_cmpint (0, ==, socketpair (AF_UNIX, SOCK_STREAM, 0, fds));
+	for (int i = 0; i < 2 ;++i)
+		fcntl (fds[i], F_SETFL, O_NONBLOCK|fcntl (fds[i], F_GETFL));
+
+	struct data_slab_sequence_s dss = {NULL, NULL};
+	GByteArray *expected = g_byte_array_new ();
+
+	/* A first block larger than what the socket accepts at once, so that
+	 * the first writev() ends within it */
+	const gsize big = 4 * 1024 * 1024;
+	guint8 *b = g_malloc (big);
+	for (gsize i = 0; i < big ;++i)
+		b[i] = (guint8) (i * 7 + i / 251);
+	g_byte_array_append (expected, b, big);
+	struct data_slab_s *first = data_slab_make_gbytes (g_bytes_new_take (b, big));
+	data_slab_sequence_append (&dss, first);
+
+	/* Then more slabs than a single writev() gathers, of all the kinds */
+	for (guint i = 0; i < 600 ;++i) {
+		gchar *s = g_strdup_printf ("slab-%u|", i);
+		const gsize l = strlen (s);
+		struct data_slab_s *ds;
+		switch (i % 4) {
+			case 0:
+				ds = data_slab_make_gbytes (g_bytes_new (s, l));
+				g_byte_array_append (expected, (guint8*) s, l);
+				break;
+			case 1:
+				/* only a part of the buffer is data */
+				ds = data_slab_make_buffer2 ((guint8*) g_strdup (s), TRUE,
+						2, l, l);
+				g_byte_array_append (expected, (guint8*) s + 2, l - 2);
+				break;
+			case 2:
+				ds = data_slab_make_string (s);
+				g_byte_array_append (expected, (guint8*) s, l);
+				break;
+			default:
+				ds = data_slab_make_gbytes (g_bytes_new (NULL, 0));
+				break;
+		}
+		data_slab_sequence_append (&dss, ds);
+		g_free (s);
+	}
+
+	/* Nothing after the EOF is sent */
+	data_slab_sequence_append (&dss, data_slab_make_eof ());
+	data_slab_sequence_append (&dss, data_slab_make_string ("ignored"));
+
+	/* The first call is short and stops within the GBytes slab, that is
+	 * skipped in place */
+	GByteArray *got = g_byte_array_new ();
+	g_assert_true (data_slab_sequence_send (&dss, fds[0]));
+	g_assert_true (dss.first == first);
+	g_assert_cmpuint (data_slab_size (first), >, 0);
+	g_assert_cmpuint (data_slab_size (first), <, big);
+
+	/* Then each send resumes where the previous one stopped */
+	guint calls = 1;
+	while (dss.first->type != STYPE_EOF) {
+		if (!data_slab_sequence_send (&dss, fds[0]))
+			g_assert_cmpint (errno, ==, EAGAIN);
+		++ calls;
+		while (_read_some (fds[1], got, 65536) > 0)
+			continue;
+	}
+	g_assert_cmpuint (calls, >, 2);
+
+	/* The EOF is sent alone */
+	g_assert_true (data_slab_sequence_send (&dss, fds[0]));
+	for (;;) {
+		struct pollfd pfd = {.fd = fds[1], .events = POLLIN};
+		g_assert_cmpint (poll (&pfd, 1, 5000), >, 0);
+		if (!_read_some (fds[1], got, 65536))
+			break;
+	}
+
+	g_assert_cmpuint (got->len, ==, expected->len);
+	g_assert_true (0 == memcmp (got->data, expected->data, expected->len));
+
+	data_slab_sequence_clean_data (&dss);
+	g_byte_array_free (got, TRUE);
+	g_byte_array_free (expected, TRUE);
+	close (fds[0]);
+	close (fds[1]);
+}
+
+/* Stats ------------------------------------------------------------------- */
+
+#define STAT_PUSHES 20000
+
+static GQuark gq_stat_a = 0, gq_stat_b = 0, gq_stat_reset = 0;
+static volatile gint stat_pushers = 0;
+
+static gpointer
+_stat_pusher (gpointer p)
+{
+	struct network_server_s *srv = p;
+	for (guint i=0; i<STAT_PUSHES ;++i) {
+		network_server_stat_push4 (srv, TRUE, gq_stat_a, 1, gq_stat_b, 3,
+				gq_stat_reset, 1, 0, 0);
+	}
+	g_atomic_int_add (&stat_pushers, -1);
+	return p;
+}
+
+static gpointer
+_stat_resetter (gpointer p)
+{
+	struct network_server_s *srv = p;
+	while (g_atomic_int_get (&stat_pushers) > 0)
+		network_server_stat_push2 (srv, FALSE, gq_stat_reset, 0, 0, 0);
+	return p;
+}
+
+static void
+test_stats_concurrent (void)
+{
+	gq_stat_a = g_quark_from_static_string ("test.stat.a");
+	gq_stat_b = g_quark_from_static_string ("test.stat.b");
+	gq_stat_reset = g_quark_from_static_string ("test.stat.reset");
+	struct network_server_s *srv = network_server_init ();
+
+	/* More threads than shards, some of them share a shard */
+	GThread *threads[2 * SERVER_STATS_SHARDS];
+	const guint nb = G_N_ELEMENTS(threads);
+	g_atomic_int_set (&stat_pushers, nb);
+	for (guint i=0; i<nb ;++i)
+		threads[i] = g_thread_new ("pusher", _stat_pusher, srv);
+	GThread *resetter = g_thread_new ("resetter", _stat_resetter, srv);
+
+	/* The sums never decrease while the shards are incremented */
+	guint64 last_a = 0, last_b = 0;
+	while (g_atomic_int_get (&stat_pushers) > 0) {
+		GArray *all = network_server_stat_getall (srv);
+		for (guint i=0; i<all->len ;++i) {
+			struct server_stat_s *st =
+				&g_array_index (all, struct server_stat_s, i);
+			if (st->which == gq_stat_a) {
+				g_assert_cmpuint (st->value, >=, last_a);
+				last_a = st->value;
+			} else if (st->which == gq_stat_b) {
+				g_assert_cmpuint (st->value, >=, last_b);
+				last_b = st->value;
+			}
+		}
+		g_array_free (all, TRUE);
+	}
+
+	for (guint i=0; i<nb ;++i)
+		g_thread_join (threads[i]);
+	g_thread_join (resetter);
+
+	/* No increment has been lost */
+	g_assert_cmpuint (network_server_stat_getone (srv, gq_stat_a),
+			==, (guint64) nb * STAT_PUSHES);
+	g_assert_cmpuint (network_server_stat_getone (srv, gq_stat_b),
+			==, 3 * (guint64) nb * STAT_PUSHES);
+
+	/* A reset applies to all the shards */
+	g_assert_cmpuint (network_server_stat_getone (srv, gq_stat_reset),
+			<=, (guint64) nb * STAT_PUSHES);
+	network_server_stat_push2 (srv, FALSE, gq_stat_reset, 5, 0, 0);
+	g_assert_cmpuint (network_server_stat_getone (srv, gq_stat_reset), ==, 5);
+	network_server_stat_push2 (srv, TRUE, gq_stat_reset, 2, 0, 0);
+	g_assert_cmpuint (network_server_stat_getone (srv, gq_stat_reset), ==, 7);
+
+	network_server_clean (srv);
+}
+
+static void
+test_stats_overflow (void)
+{
+	struct network_server_s *srv = network_server_init ();
+
+	/* Beyond SERVER_STATS_MAX names, the stats are ignored */
+	for (guint i=0; i<SERVER_STATS_MAX + 16 ;++i) {
+		gchar name[64];
+		g_snprintf (name, sizeof(name), "test.overflow.%u", i);
+		network_server_stat_push2 (srv, TRUE,
+				g_quark_from_string (name), 1, 0, 0);
+	}
+	GArray *all = network_server_stat_getall (srv);
+	g_assert_cmpuint (all->len, ==, SERVER_STATS_MAX);
+	g_array_free (all, TRUE);
+	g_assert_cmpuint (0, ==, network_server_stat_getone (srv,
+				g_quark_from_string ("test.overflow.1030")));
+
+	/* Told once, and not by the lookups */
+	g_assert_cmpint (1, ==, g_atomic_int_get (&srv->stats_overflow));
+
+	network_server_clean (srv);
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT (argc, argv);
+	g_test_add_func ("/server/network/echo", test_echo);
+	g_test_add_func ("/server/network/suspend/resume", test_suspend_resume);
+	g_test_add_func ("/server/network/suspend/resume_held",
+			test_resume_while_held);
+	g_test_add_func ("/server/network/suspend/expired", test_suspend_expired);
+	g_test_add_func ("/server/network/suspend/exit", test_suspend_at_exit);
+	g_test_add_func ("/server/network/output/read", test_output_read);
+	g_test_add_func ("/server/network/output/stalled", test_output_stalled);
+	g_test_add_func ("/server/network/output/corked", test_output_corked);
+	g_test_add_func ("/server/slab/sequence/send", test_slab_sequence_send);
+	g_test_add_func ("/server/network/stats/concurrent", test_stats_concurrent);
+	g_test_add_func ("/server/network/stats/overflow", test_stats_overflow);
+	return g_test_run ();
+}
@@ -0,0 +1,576 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2015-2016 OpenIO, as part of OpenIO Software Defined Storage
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <core/oio_core.h>
+#include <metautils/lib/metautils.h>
+#include <server/network_server.h>
+
+#include <meta2v2/meta2_utils_json.h>
+
+#include "../../proxy/transport_http.c"
+#include "../../proxy/reply.c"
+
+/* What the parser told, one line per call to the providers */
+static GString *told = NULL;
+static GString *body = NULL;
+
+static void
+_on_command (struct http_view_s *c, struct http_view_s *s,
+		struct http_view_s *v)
+{
+	g_string_append_printf (told, "%.*s %.*s %.*s\n", (int)c->len, c->ptr,
+			(int)s->len, s->ptr, (int)v->len, v->ptr);
+}
+
+static void
+_on_header (struct http_view_s *n, struct http_view_s *v)
+{
+	g_string_append_printf (told, "%.*s=%.*s\n", (int)n->len, n->ptr,
+			(int)v->len, v->ptr);
+}
+
+static void
+_on_body (const guint8 *data, gsize len)
+{
+	g_string_append_len (body, (const gchar*)data, len);
+}
+
+static struct http_parser_s *
+_parser (void)
+{
+	struct http_parser_s *parser = http_parser_create ();
+	parser->command_provider = _on_command;
+	parser->header_provider = _on_header;
+	parser->body_provider = _on_body;
+	g_string_set_size (told, 0);
+	g_string_set_size (body, 0);
+	return parser;
+}
+
+/* Feeds the parser with pieces of 'step' bytes at most, until a request is
+ * complete or an error occurs. Returns the status, and in 'consumed' how
+ * many bytes of 'input' belong to the request. */
+static int
+_parse (struct http_parser_s *parser, const gchar *input, gsize len,
+		gsize step, gsize *consumed)
+{
+	gsize offset = 0;
+	while (offset < len) {
+		const gsize max = MIN(step, len - offset);
+		struct http_parsing_result_s rc =
+			http_parse (parser, (const guint8*) input + offset, max);
+		g_assert_cmpuint (rc.consumed, <=, max);
+		offset += rc.consumed;
+		if (rc.status != HPRC_MORE) {
+			*consumed = offset;
+			return rc.status;
+		}
+		g_assert_cmpuint (rc.consumed, ==, max);
+	}
+	*consumed = offset;
+	return HPRC_MORE;
+}
+
+/* The same request must be parsed identically, whatever the way it is
+ * split across the inputs */
+static void
+_check_request (const gchar *input, gsize expected_len,
+		const gchar *expected_told, const gchar *expected_body)
+{
+	const gsize len = strlen (input);
+	for (gsize step = 1; step <= len ;++step) {
+		struct http_parser_s *parser = _parser ();
+		gsize consumed = 0;
+		g_assert_cmpint (HPRC_SUCCESS, ==,
+				_parse (parser, input, len, step, &consumed));
+		g_assert_cmpuint (consumed, ==, expected_len);
+		g_assert_cmpstr (told->str, ==, expected_told);
+		g_assert_cmpstr (body->str, ==, expected_body);
+		http_parser_destroy (parser);
+	}
+}
+
+static void
+_check_error (const gchar *input, gsize len)
+{
+	struct http_parser_s *parser = _parser ();
+	gsize consumed = 0;
+	g_assert_cmpint (HPRC_ERROR, ==,
+			_parse (parser, input, len, len, &consumed));
+	g_assert_nonnull (parser->error);
+	http_parser_reset (parser);
+	g_assert_null (parser->error);
+	http_parser_destroy (parser);
+}
+
+/* Parser ------------------------------------------------------------------ */
+
+static void
+test_parse_headers (void)
+{
+	static const gchar req[] =
+		"GET /v3.0/status?x=1 HTTP/1.1\r\n"
+		"Host: 127.0.0.1\r\n"
+		"X-Oio-Req-Id:   spaces around  \r\n"
+		"Empty:\r\n"
+		"\r\n";
+	_check_request (req, sizeof(req) - 1,
+			"GET /v3.0/status?x=1 HTTP/1.1\n"
+			"Host=127.0.0.1\n"
+			"X-Oio-Req-Id=spaces around\n"
+			"Empty=\n", "");
+
+	/* bare LF, and empty lines before the request line */
+	static const gchar lf[] = "\r\n\nDELETE /x HTTP/1.0\nA: b\n\n";
+	_check_request (lf, sizeof(lf) - 1, "DELETE /x HTTP/1.0\nA=b\n", "");
+}
+
+static void
+test_parse_body (void)
+{
+	static const gchar req[] =
+		"PUT /x HTTP/1.1\r\n"
+		"Content-Length: 11\r\n"
+		"\r\n"
+		"hello world";
+	_check_request (req, sizeof(req) - 1,
+			"PUT /x HTTP/1.1\nContent-Length=11\n", "hello world");
+
+	static const gchar empty[] = "PUT /x HTTP/1.1\r\nContent-Length: 0\r\n\r\n";
+	_check_request (empty, sizeof(empty) - 1,
+			"PUT /x HTTP/1.1\nContent-Length=0\n", "");
+}
+
+static void
+test_parse_chunked (void)
+{
+	static const gchar req[] =
+		"POST /x HTTP/1.1\r\n"
+		"Transfer-Encoding: gzip, chunked\r\n"
+		"\r\n"
+		"5;name=value\r\n"
+		"hello\r\n"
+		"6\r\n"
+		" world\r\n"
+		"0\r\n"
+		"X-Trailer: ignored\r\n"
+		"\r\n";
+	_check_request (req, sizeof(req) - 1,
+			"POST /x HTTP/1.1\nTransfer-Encoding=gzip, chunked\n",
+			"hello world");
+
+	/* the size may be long, with leading zeros */
+	static const gchar big[] =
+		"POST /x HTTP/1.1\r\n"
+		"Transfer-Encoding: chunked\r\n"
+		"\r\n"
+		"0000000000000000000003\r\n"
+		"abc\r\n"
+		"0\r\n"
+		"\r\n";
+	_check_request (big, sizeof(big) - 1,
+			"POST /x HTTP/1.1\nTransfer-Encoding=chunked\n", "abc");
+}
+
+static void
+test_parse_pipelined (void)
+{
+	static const gchar first[] =
+		"PUT /1 HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc";
+	static const gchar second[] =
+		"GET /2 HTTP/1.1\r\n\r\n";
+	gchar *both = g_strconcat (first, second, NULL);
+	const gsize len = strlen (both);
+
+	/* whatever the split, the second request is left untouched */
+	for (gsize step = 1; step <= len ;++step) {
+		struct http_parser_s *parser = _parser ();
+		gsize consumed = 0;
+		g_assert_cmpint (HPRC_SUCCESS, ==,
+				_parse (parser, both, len, step, &consumed));
+		g_assert_cmpuint (consumed, ==, sizeof(first) - 1);
+		g_assert_cmpstr (body->str, ==, "abc");
+
+		http_parser_reset (parser);
+		g_string_set_size (told, 0);
+		gsize rest = 0;
+		g_assert_cmpint (HPRC_SUCCESS, ==,
+				_parse (parser, both + consumed, len - consumed, step, &rest));
+		g_assert_cmpuint (rest, ==, sizeof(second) - 1);
+		g_assert_cmpstr (told->str, ==, "GET /2 HTTP/1.1\n");
+		http_parser_destroy (parser);
+	}
+	g_free (both);
+}
+
+static void
+test_parse_errors (void)
+{
+#define CHECK_ERROR(S) _check_error (S, sizeof(S) - 1)
+	CHECK_ERROR ("GET\r\n\r\n");
+	CHECK_ERROR ("GET /\r\n\r\n");
+	CHECK_ERROR ("GET / HTTP/1.1\r\nNoColon\r\n\r\n");
+	CHECK_ERROR ("GET / HTTP/1.1\r\n: no name\r\n\r\n");
+	CHECK_ERROR ("PUT / HTTP/1.1\r\nContent-Length: 12a\r\n\r\n");
+	CHECK_ERROR ("PUT / HTTP/1.1\r\nContent-Length: -1\r\n\r\n");
+	CHECK_ERROR ("PUT / HTTP/1.1\r\n"
+			"Content-Length: 99999999999999999999\r\n\r\n");
+	CHECK_ERROR ("PUT / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+			"zz\r\n");
+	CHECK_ERROR ("PUT / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+			"10000000000000000\r\n");
+	CHECK_ERROR ("PUT / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+			"3\r\nabcX\r\n");
+#undef CHECK_ERROR
+
+	/* a line too long, even without its end */
+	GString *gs = g_string_new ("GET /");
+	while (gs->len <= HTTP_MAX_LINE_SIZE)
+		g_string_append_c (gs, 'a');
+	_check_error (gs->str, gs->len);
+
+	/* headers too large, even made of short lines */
+	g_string_assign (gs, "GET / HTTP/1.1\r\n");
+	while (gs->len <= HTTP_MAX_HEAD_SIZE)
+		g_string_append (gs, "X-Header: value\r\n");
+	_check_error (gs->str, gs->len);
+	g_string_free (gs, TRUE);
+}
+
+/* Transport --------------------------------------------------------------- */
+
+static enum http_rc_e
+_handler (struct http_request_s *request, struct http_reply_ctx_s *reply)
+{
+	GString *gs = g_string_new (request->req_uri);
+	g_string_append_c (gs, ':');
+	g_string_append_len (gs, (gchar*)request->body->data, request->body->len);
+	reply->set_status (200, "OK");
+	reply->set_body_gstr (gs);
+	reply->finalize ();
+	return HTTPRC_DONE;
+}
+
+static gpointer
+_server_run (gpointer p)
+{
+	g_assert_no_error (network_server_run ((struct network_server_s *)p));
+	return p;
+}
+
+/* Sends the whole 'requests' at once to a proxy transport, then returns all
+ * that is received until the connection is closed by the server. */
+static gchar *
+_exchange_with (http_handler_f handler, const gchar *requests)
+{
+	struct network_server_s *srv = network_server_init ();
+	network_server_bind_host (srv, "127.0.0.1:0", handler,
+			(network_transport_factory) transport_http_factory0);
+	g_assert_no_error (network_server_open_servers (srv));
+	GThread *th = g_thread_new ("server", _server_run, srv);
+
+	gchar **urlv = network_server_endpoints (srv);
+	GError *err = NULL;
+	int fd = sock_connect (urlv[0], &err);
+	g_assert_no_error (err);
+	g_strfreev (urlv);
+
+	GString *out = g_string_new ("");
+	gsize sent = 0, total = strlen (requests);
+	for (;;) {
+		struct pollfd pfd = {.fd = fd, .events = POLLIN};
+		if (sent < total)
+			pfd.events |= POLLOUT;
+		int rc = poll (&pfd, 1, 5000);
+		g_assert_cmpint (rc, >, 0);
+		if (pfd.revents & POLLOUT) {
+			ssize_t w = write (fd, requests + sent, total - sent);
+			g_assert_true (w > 0 || errno == EAGAIN);
+			if (w > 0)
+				sent += w;
+		}
+		if (pfd.revents & (POLLIN|POLLHUP|POLLERR)) {
+			gchar buf[4096];
+			ssize_t r = read (fd, buf, sizeof(buf));
+			if (r < 0 && errno == EAGAIN)
+				continue;
+			if (r <= 0)
+				break;
+			g_string_append_len (out, buf, r);
+		}
+	}
+	g_assert_cmpuint (sent, ==, total);
+
+	metautils_pclose (&fd);
+	network_server_stop (srv);
+	g_thread_join (th);
+	network_server_close_servers (srv);
+	network_server_clean (srv);
+	return g_string_free (out, FALSE);
+}
+
+static gchar *
+_exchange (const gchar *requests)
+{
+	return _exchange_with (_handler, requests);
+}
+
+static void
+_check_replies (const gchar *out, const gchar **bodies)
+{
+	const gchar *p = out;
+	for (; *bodies ;++bodies) {
+		p = strstr (p, "HTTP/1.1 200 OK\r\n");
+		g_assert_nonnull (p);
+		p = strstr (p, "\r\n\r\n");
+		g_assert_nonnull (p);
+		p += 4;
+		g_assert_true (g_str_has_prefix (p, *bodies));
+		p += strlen (*bodies);
+	}
+	g_assert_null (strstr (p, "HTTP/1.1"));
+}
+
+static void
+test_transport_pipelined (void)
+{
+	gchar *out = _exchange (
+			"GET /first HTTP/1.1\r\n\r\n"
+			"PUT /second HTTP/1.1\r\nContent-Length: 4\r\n\r\nbody"
+			"POST /third HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+			"Connection: close\r\n\r\n"
+			"2\r\nch\r\n4\r\nunks\r\n0\r\n\r\n"
+			"GET /ignored HTTP/1.1\r\n\r\n");
+	const gchar *bodies[] = {"/first:", "/second:body", "/third:chunks", NULL};
+	_check_replies (out, bodies);
+	g_assert_nonnull (strstr (out, "Connection: Close\r\n"));
+	g_free (out);
+}
+
+static void
+test_transport_error (void)
+{
+	/* the connection is closed at the first malformed request */
+	gchar *out = _exchange (
+			"GET /first HTTP/1.1\r\n\r\n"
+			"BROKEN\r\n\r\n"
+			"GET /ignored HTTP/1.1\r\n\r\n");
+	const gchar *bodies[] = {"/first:", NULL};
+	_check_replies (out, bodies);
+	g_free (out);
+}
+
+/* Streamed replies ---------------------------------------------------------- */
+
+static GSList *beans = NULL;
+
+/* Appends a JSON array of 'count' items, flushing 'rs' between them */
+static void
+_append_items (GString *gs, guint count, struct reply_stream_s *rs)
+{
+	g_string_append_c (gs, '[');
+	for (guint i=0; i<count ;++i) {
+		if (i)
+			g_string_append_c (gs, ',');
+		g_string_append_printf (gs, "{\"i\":%u,\"pad\":\"%0*u\"}", i, 100, i);
+		if (rs)
+			_reply_stream_flush (rs);
+	}
+	g_string_append_c (gs, ']');
+}
+
+static void
+_stream_flush (GString *gstr UNUSED, gpointer rs)
+{
+	_reply_stream_flush (rs);
+}
+
+/* Streams the beans for "/beans", else as many items as told by the URI
+ * ("/items/<count>") */
+static enum http_rc_e
+_handler_stream (struct http_request_s *request, struct http_reply_ctx_s *reply)
+{
+	struct req_args_s args = {0};
+	args.rq = request;
+	args.rp = reply;
+
+	struct reply_stream_s rs;
+	_reply_stream_init (&rs, &args);
+	if (!strcmp (request->req_uri, "/beans")) {
+		g_string_append_c (rs.buf, '{');
+		meta2_json_dump_all_beans_flushed (rs.buf, beans, _stream_flush, &rs);
+		g_string_append_c (rs.buf, '}');
+	} else {
+		g_assert_true (g_str_has_prefix (request->req_uri, "/items/"));
+		_append_items (rs.buf, atoi (request->req_uri + 7), &rs);
+	}
+	return _reply_stream_end (&rs);
+}
+
+/* Checks the single reply in 'out' is a 200 with a body framed as expected,
+ * then returns that body */
+static GString *
+_check_streamed (const gchar *out, gboolean chunked)
+{
+	g_assert_true (g_str_has_prefix (out, "HTTP/1."));
+	g_assert_nonnull (strstr (out, " 200 OK\r\n"));
+	const gchar *p = strstr (out, "\r\n\r\n");
+	g_assert_nonnull (p);
+	gchar *head = g_strndup (out, p - out + 2);
+	p += 4;
+	g_assert_nonnull (strstr (head, "Content-Type: application/json\r\n"));
+
+	GString *gs = g_string_new ("");
+	if (!chunked) {
+		/* Either sized, or ended by the end of the connection */
+		const gchar *cl = strstr (head, "Content-Length: ");
+		if (cl)
+			g_assert_cmpuint (strlen (p), ==,
+					g_ascii_strtoull (cl + 16, NULL, 10));
+		g_assert_null (strstr (head, "chunked"));
+		g_string_append (gs, p);
+	} else {
+		g_assert_nonnull (strstr (head, "Transfer-Encoding: chunked\r\n"));
+		g_assert_null (strstr (head, "Content-Length"));
+		for (gboolean last = FALSE;;) {
+			gchar *end = NULL;
+			const guint64 len = g_ascii_strtoull (p, &end, 16);
+			g_assert_true (end != p);
+			g_assert_true (g_str_has_prefix (end, "\r\n"));
+			p = end + 2;
+			if (!len)
+				break;
+			/* Only the last chunk holds less than a piece */
+			g_assert_false (last);
+			last = len < PROXYD_STREAM_CHUNK_SIZE;
+			g_assert_cmpuint (strlen (p), >=, len + 2);
+			g_string_append_len (gs, p, len);
+			p += len;
+			g_assert_true (g_str_has_prefix (p, "\r\n"));
+			p += 2;
+		}
+		/* the zero chunk ends the body and the reply */
+		g_assert_cmpstr (p, ==, "\r\n");
+	}
+	g_free (head);
+	return gs;
+}
+
+static void
+_check_items (const gchar *version, guint count, gboolean chunked)
+{
+	gchar *req = g_strdup_printf (
+			"GET /items/%u %s\r\nConnection: close\r\n\r\n", count, version);
+	gchar *out = _exchange_with (_handler_stream, req);
+	GString *got = _check_streamed (out, chunked);
+
+	GString *expected = g_string_new ("");
+	_append_items (expected, count, NULL);
+	g_assert_cmpuint (got->len, ==, expected->len);
+	g_assert_cmpstr (got->str, ==, expected->str);
+
+	g_string_free (expected, TRUE);
+	g_string_free (got, TRUE);
+	g_free (out);
+	g_free (req);
+}
+
+static void
+test_stream_framing (void)
+{
+	/* several pieces, then a last smaller one */
+	_check_items ("HTTP/1.1", 4000, TRUE);
+	/* the end of the connection marks the end of the body */
+	_check_items ("HTTP/1.0", 4000, FALSE);
+}
+
+static void
+test_stream_small (void)
+{
+	/* below PROXYD_STREAM_CHUNK_SIZE, the reply is sent at once and sized */
+	GString *gs = g_string_new ("");
+	_append_items (gs, 100, NULL);
+	g_assert_cmpuint (gs->len, <, PROXYD_STREAM_CHUNK_SIZE);
+	g_string_free (gs, TRUE);
+	_check_items ("HTTP/1.1", 100, FALSE);
+	_check_items ("HTTP/1.1", 0, FALSE);
+}
+
+static void
+test_stream_beans (void)
+{
+	for (guint i=0; i<512 ;++i) {
+		beans = g_slist_prepend (beans, _bean_create (&descr_struct_CHUNKS));
+		_bean_randomize (beans->data, FALSE);
+		if (i % 4)
+			continue;
+		beans = g_slist_prepend (beans, _bean_create (&descr_struct_ALIASES));
+		_bean_randomize (beans->data, FALSE);
+		beans = g_slist_prepend (beans,
+				_bean_create (&descr_struct_CONTENTS_HEADERS));
+		_bean_randomize (beans->data, FALSE);
+	}
+
+	/* byte for byte, what the encoder produces at once */
+	GString *expected = g_string_new ("{");
+	meta2_json_dump_all_beans (expected, beans);
+	g_string_append_c (expected, '}');
+	g_assert_cmpuint (expected->len, >, PROXYD_STREAM_CHUNK_SIZE);
+
+	gchar *out = _exchange_with (_handler_stream,
+			"GET /beans HTTP/1.1\r\nConnection: close\r\n\r\n");
+	GString *got = _check_streamed (out, TRUE);
+	g_assert_cmpuint (got->len, ==, expected->len);
+	g_assert_true (0 == memcmp (got->str, expected->str, got->len));
+
+	g_string_free (got, TRUE);
+	g_string_free (expected, TRUE);
+	g_free (out);
+	_bean_cleanl2 (beans);
+	beans = NULL;
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT (argc, argv);
+	told = g_string_new ("");
+	body = g_string_new ("");
+	g_test_add_func ("/proxy/http/parse/headers", test_parse_headers);
+	g_test_add_func ("/proxy/http/parse/body", test_parse_body);
+	g_test_add_func ("/proxy/http/parse/chunked", test_parse_chunked);
+	g_test_add_func ("/proxy/http/parse/pipelined", test_parse_pipelined);
+	g_test_add_func ("/proxy/http/parse/errors", test_parse_errors);
+	g_test_add_func ("/proxy/http/transport/pipelined",
+			test_transport_pipelined);
+	g_test_add_func ("/proxy/http/transport/error", test_transport_error);
+	g_test_add_func ("/proxy/http/stream/framing", test_stream_framing);
+	g_test_add_func ("/proxy/http/stream/small", test_stream_small);
+	g_test_add_func ("/proxy/http/stream/beans", test_stream_beans);
+	int rc = g_test_run ();
+	g_string_free (told, TRUE);
+	g_string_free (got, TRUE);
+	return rc;
+}
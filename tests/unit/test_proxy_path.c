@@ -0,0 +1,149 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2015-2016 OpenIO, as part of OpenIO Software Defined Storage
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <string.h>
+
+#include <glib.h>
+#include <core/oio_core.h>
+#include <metautils/lib/metautils.h>
+
+#include "../../proxy/path_parser.c"
+
+static const char * const routes[] = {
+	"a/$X/c",
+	"a/b/c",
+	"a/b/$Y/d",
+	"a/$X/e",
+	"a/$X/$Z/f",
+	NULL
+};
+
+static struct path_parser_s *
+_parser (void)
+{
+	struct path_parser_s *parser = path_parser_init ();
+	for (guint i=0; routes[i] ;++i)
+		path_parser_configure (parser, routes[i], GUINT_TO_POINTER(i+1));
+	return parser;
+}
+
+/* Splits <path>, unescapes its tokens then checks it matches <route>, with
+ * the variables <vars> ("X=x,Y=y"), or nothing if <route> is NULL. */
+static void
+_check (struct path_parser_s *parser, const char *path, const char *route,
+		const char *vars)
+{
+	gchar **tokens = g_strsplit (path, "/", -1);
+	for (gchar **p = tokens; *p ;++p)
+		g_assert_true (path_unescape_inplace (*p));
+	struct path_matching_s **m = path_parser_match (parser, tokens);
+
+	if (!route) {
+		g_assert_null (m[0]);
+	} else {
+		g_assert_nonnull (m[0]);
+		g_assert_null (m[1]);
+		const gchar *found = routes[GPOINTER_TO_UINT(m[0]->last->u) - 1];
+		g_assert_cmpstr (found, ==, route);
+		gchar *joined = g_strjoinv (",", m[0]->vars);
+		g_assert_cmpstr (joined, ==, vars);
+		g_free (joined);
+	}
+
+	path_matching_cleanv (m);
+	g_strfreev (tokens);
+}
+
+static void
+test_precedence (void)
+{
+	struct path_parser_s *parser = _parser ();
+	/* The explicit word wins over the variable... */
+	_check (parser, "a/b/c", "a/b/c", "");
+	/* ... that matches any other word */
+	_check (parser, "a/z/c", "a/$X/c", "X=z");
+	_check (parser, "a/b/q/d", "a/b/$Y/d", "Y=q");
+	_check (parser, "a/$X/c", "a/$X/c", "X=$X");
+	path_parser_clean (parser);
+}
+
+static void
+test_backtracking (void)
+{
+	struct path_parser_s *parser = _parser ();
+	/* "b" leads nowhere with "e", the variable is tried then */
+	_check (parser, "a/b/e", "a/$X/e", "X=b");
+	/* "b" then "$Y" lead nowhere with "f", nor "b" then a second var */
+	_check (parser, "a/b/q/f", "a/$X/$Z/f", "X=b,Z=q");
+	/* a prefix of a route is no match */
+	_check (parser, "a/b", NULL, NULL);
+	_check (parser, "a/b/q/x", NULL, NULL);
+	_check (parser, "x/b/c", NULL, NULL);
+	path_parser_clean (parser);
+}
+
+static void
+test_depth (void)
+{
+	struct path_parser_s *parser = _parser ();
+	g_assert_cmpuint (4, ==, parser->depth);
+	/* beyond the longest route, no matching is even attempted */
+	_check (parser, "a/b/q/d/e", NULL, NULL);
+	gchar *long_path = g_strnfill (4096, '/');
+	_check (parser, long_path, NULL, NULL);
+	g_free (long_path);
+	gchar *empty[] = {NULL};
+	struct path_matching_s **m = path_parser_match (parser, empty);
+	g_assert_null (m[0]);
+	path_matching_cleanv (m);
+	path_parser_clean (parser);
+}
+
+static void
+test_escaped (void)
+{
+	struct path_parser_s *parser = _parser ();
+	/* an escaped slash stays in its token */
+	_check (parser, "a/x%2Fy/c", "a/$X/c", "X=x/y");
+	/* an escaped word matches the word */
+	_check (parser, "a/%62/c", "a/b/c", "");
+	_check (parser, "%61/b/%63", "a/b/c", "");
+	/* the incomplete or invalid sequences are kept as is */
+	_check (parser, "a/%zz%4/c", "a/$X/c", "X=%zz%4");
+	_check (parser, "a/100%25/c", "a/$X/c", "X=100%");
+	path_parser_clean (parser);
+
+	/* a NUL would truncate the token */
+	gchar *s = g_strdup ("x%00y");
+	g_assert_false (path_unescape_inplace (s));
+	g_free (s);
+	s = g_strdup ("%00");
+	g_assert_false (path_unescape_inplace (s));
+	g_free (s);
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT (argc, argv);
+	g_test_add_func ("/proxy/path/precedence", test_precedence);
+	g_test_add_func ("/proxy/path/backtracking", test_backtracking);
+	g_test_add_func ("/proxy/path/depth", test_depth);
+	g_test_add_func ("/proxy/path/escaped", test_escaped);
+	return g_test_run ();
+}
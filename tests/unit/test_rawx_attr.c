@@ -0,0 +1,190 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2015-2016 OpenIO, as part of OpenIO Software Defined Storage
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "../../rawx-lib/src/attr_handler.c"
+
+static void
+_fill (struct chunk_textinfo_s *cti)
+{
+	cti->container_id = g_strdup ("0123456789ABCDEF");
+	cti->content_path = g_strdup ("a=b;c");
+	cti->content_version = g_strdup ("1");
+	cti->chunk_id = g_strdup ("FEDCBA9876543210");
+	cti->chunk_size = g_strdup ("1024");
+	cti->chunk_position = g_strdup ("0.1");
+}
+
+static void
+_check_same (struct chunk_textinfo_s *c0, struct chunk_textinfo_s *c1)
+{
+	for (guint i=0; i<G_N_ELEMENTS(fields); ++i)
+		g_assert_cmpstr (*FIELD_PTR(c0, i), ==, *FIELD_PTR(c1, i));
+}
+
+/* Returns the FD of a fresh file, or -1 if the user attributes are not
+ * supported there */
+static int
+_tmp_file (gchar **path)
+{
+	GError *err = NULL;
+	int fd = g_file_open_tmp ("test_rawx_attr_XXXXXX", path, &err);
+	g_assert_no_error (err);
+	if (0 > fsetxattr (fd, ATTR_DOMAIN ".probe", "x", 1, 0)) {
+		g_assert_cmpint (errno, ==, ENOTSUP);
+		metautils_pclose (&fd);
+		g_unlink (*path);
+		g_free (*path);
+		return -1;
+	}
+	g_assert_cmpint (0, ==, fremovexattr (fd, ATTR_DOMAIN ".probe"));
+	return fd;
+}
+
+static void
+_set (int fd, const char *name, const char *v)
+{
+	gchar *k = g_strconcat (ATTR_DOMAIN ".", name, NULL);
+	g_assert_cmpint (0, ==, fsetxattr (fd, k, v, strlen(v), 0));
+	g_free (k);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void
+test_pack_unpack (void)
+{
+	struct chunk_textinfo_s cti = {0}, out = {0};
+	_fill (&cti);
+
+	/* The missing fields are not packed */
+	GByteArray *gba = _pack (&cti);
+	guint nuls = 0;
+	for (guint i=0; i<gba->len ;++i)
+		nuls += !gba->data[i];
+	g_assert_cmpuint (nuls, ==, 2 * 6);
+	_unpack ((gchar*) gba->data, gba->len, &out, TRUE);
+	_check_same (&cti, &out);
+	chunk_textinfo_free_content (&out);
+
+	/* A truncated value is ignored, not the ones before */
+	memset (&out, 0, sizeof(out));
+	_unpack ((gchar*) gba->data, gba->len - 1, &out, TRUE);
+	g_assert_cmpstr (out.container_id, ==, cti.container_id);
+	g_assert_null (out.chunk_position);
+	chunk_textinfo_free_content (&out);
+
+	/* The unknown names are ignored */
+	static const gchar unknown[] = "not.an.attr\0value\0" ATTR_NAME_CHUNK_ID "\0X";
+	memset (&out, 0, sizeof(out));
+	_unpack (unknown, sizeof(unknown), &out, TRUE);
+	g_assert_cmpstr (out.chunk_id, ==, "X");
+	g_assert_null (out.container_id);
+	chunk_textinfo_free_content (&out);
+
+	/* Without override, the fields already set are kept */
+	memset (&out, 0, sizeof(out));
+	out.chunk_size = g_strdup ("1");
+	_unpack ((gchar*) gba->data, gba->len, &out, FALSE);
+	g_assert_cmpstr (out.chunk_size, ==, "1");
+	g_assert_cmpstr (out.chunk_id, ==, cti.chunk_id);
+	chunk_textinfo_free_content (&out);
+
+	/* Empty */
+	memset (&out, 0, sizeof(out));
+	_unpack ("", 0, &out, TRUE);
+	for (guint i=0; i<G_N_ELEMENTS(fields); ++i)
+		g_assert_null (*FIELD_PTR(&out, i));
+
+	g_byte_array_free (gba, TRUE);
+	chunk_textinfo_free_content (&cti);
+}
+
+static void
+test_merge_existing (void)
+{
+	gchar *path = NULL;
+	int fd = _tmp_file (&path);
+	if (fd < 0) {
+		g_test_skip ("user xattr not supported");
+		return;
+	}
+
+	/* A fresh chunk has nothing to merge */
+	struct chunk_textinfo_s cti = {0};
+	cti.chunk_size = g_strdup ("1");
+	_merge_existing (fd, &cti);
+	g_assert_cmpstr (cti.chunk_size, ==, "1");
+	g_assert_null (cti.container_id);
+
+	/* The individual attributes of an older chunk complete the missing
+	 * fields */
+	_set (fd, ATTR_NAME_CONTENT_CONTAINER, "0123");
+	_set (fd, ATTR_NAME_CHUNK_SIZE, "2");
+	_set (fd, ATTR_NAME_CHUNK_ID, "ABCD");
+	_merge_existing (fd, &cti);
+	g_assert_cmpstr (cti.chunk_size, ==, "1");
+	g_assert_cmpstr (cti.container_id, ==, "0123");
+	g_assert_cmpstr (cti.chunk_id, ==, "ABCD");
+	chunk_textinfo_free_content (&cti);
+
+	/* The packed value is preferred when present */
+	struct chunk_textinfo_s packed = {0};
+	_fill (&packed);
+	g_assert_true (_set_packed (fd, NULL, &packed));
+	memset (&cti, 0, sizeof(cti));
+	cti.chunk_size = g_strdup ("1");
+	_merge_existing (fd, &cti);
+	g_assert_cmpstr (cti.chunk_size, ==, "1");
+	g_assert_cmpstr (cti.container_id, ==, packed.container_id);
+	g_assert_cmpstr (cti.chunk_id, ==, packed.chunk_id);
+	chunk_textinfo_free_content (&cti);
+
+	/* A partial update keeps the packed value whole, and the readers
+	 * find the new value */
+	GError *err = NULL;
+	memset (&cti, 0, sizeof(cti));
+	cti.chunk_hash = g_strdup ("0a1b");
+	g_assert_true (set_rawx_info_to_fd (fd, &err, &cti));
+	g_assert_no_error (err);
+	chunk_textinfo_free_content (&cti);
+	memset (&cti, 0, sizeof(cti));
+	g_assert_true (get_rawx_info_from_fd (fd, &err, &cti));
+	g_assert_no_error (err);
+	g_assert_cmpstr (cti.chunk_hash, ==, "0A1B");
+	g_free (packed.chunk_hash);
+	packed.chunk_hash = g_strdup ("0A1B");
+	_check_same (&packed, &cti);
+	chunk_textinfo_free_content (&cti);
+
+	chunk_textinfo_free_content (&packed);
+	metautils_pclose (&fd);
+	g_unlink (path);
+	g_free (path);
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT (argc, argv);
+	g_test_add_func ("/rawx/attr/pack", test_pack_unpack);
+	g_test_add_func ("/rawx/attr/merge", test_merge_existing);
+	return g_test_run ();
+}
@@ -0,0 +1,304 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2015-2016 OpenIO, as part of OpenIO Software Defined Storage
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <metautils/lib/metautils.h>
+
+/* The fsync() of the commit thread are counted, and may be held until the
+ * test releases them */
+
+static gint fsyncs = 0;
+static GMutex gate_lock;
+static GCond gate_cond;
+static gboolean gate_closed = FALSE;
+static gboolean gate_reached = FALSE;
+
+static int
+_counted_fsync (int fd)
+{
+	g_atomic_int_inc (&fsyncs);
+	g_mutex_lock (&gate_lock);
+	gate_reached = TRUE;
+	g_cond_broadcast (&gate_cond);
+	while (gate_closed)
+		g_cond_wait (&gate_cond, &gate_lock);
+	g_mutex_unlock (&gate_lock);
+	return fsync (fd);
+}
+
+#define fsync _counted_fsync
+#include "../../rawx-apache2/src/rawx_commit.c"
+#undef fsync
+
+static void
+_gate_close (void)
+{
+	g_mutex_lock (&gate_lock);
+	gate_closed = TRUE;
+	gate_reached = FALSE;
+	g_mutex_unlock (&gate_lock);
+}
+
+static void
+_gate_wait_reached (void)
+{
+	g_mutex_lock (&gate_lock);
+	while (!gate_reached)
+		g_cond_wait (&gate_cond, &gate_lock);
+	g_mutex_unlock (&gate_lock);
+}
+
+static void
+_gate_open (void)
+{
+	g_mutex_lock (&gate_lock);
+	gate_closed = FALSE;
+	g_cond_broadcast (&gate_cond);
+	g_mutex_unlock (&gate_lock);
+}
+
+struct call_s
+{
+	const char *dir;
+	int rc;
+	gint64 spent;
+	GThread *th;
+};
+
+static gpointer
+_call_run (gpointer p)
+{
+	struct call_s *c = p;
+	const gint64 start = g_get_monotonic_time ();
+	c->rc = rawx_commit_dir (c->dir);
+	c->spent = g_get_monotonic_time () - start;
+	return p;
+}
+
+static void
+_call_start (struct call_s *c, const char *dir)
+{
+	c->dir = dir;
+	c->rc = -1;
+	c->th = g_thread_new ("commit", _call_run, c);
+}
+
+static void
+_call_join (struct call_s *c)
+{
+	g_thread_join (c->th);
+	c->th = NULL;
+}
+
+/* Waits until 'count' callers wait for the pending batch of 'dir' */
+static void
+_wait_waiters (const char *dir, guint count)
+{
+	const gint64 deadline = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+	for (;;) {
+		g_mutex_lock (&lock);
+		struct commit_dir_s *d = g_hash_table_lookup (pending, dir);
+		const guint waiters = d ? d->refcount - 1 : 0;
+		g_mutex_unlock (&lock);
+		if (waiters >= count)
+			return;
+		g_assert_cmpint (g_get_monotonic_time (), <, deadline);
+		g_usleep (G_TIME_SPAN_MILLISECOND);
+	}
+}
+
+static gpointer
+_destroy_run (gpointer p)
+{
+	rawx_commit_destroy ();
+	return p;
+}
+
+static gchar *
+_make_dir (void)
+{
+	GError *err = NULL;
+	gchar *path = g_dir_make_tmp ("test_rawx_commit_XXXXXX", &err);
+	g_assert_no_error (err);
+	return path;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void
+test_no_thread (void)
+{
+	gchar *dir = _make_dir ();
+	fsyncs = 0;
+	g_assert_cmpint (0, ==, rawx_commit_dir (dir));
+	g_assert_cmpint (1, ==, fsyncs);
+	g_assert_cmpint (ENOENT, ==, rawx_commit_dir ("/nowhere/at/all"));
+	g_rmdir (dir);
+	g_free (dir);
+}
+
+static void
+test_same_dir (void)
+{
+	gchar *dir = _make_dir ();
+	g_assert_no_error (rawx_commit_init (100 * G_TIME_SPAN_MILLISECOND));
+	fsyncs = 0;
+
+	/* The callers arrived during the window share a single fsync(), that
+	 * is not done before the window */
+	struct call_s calls[8];
+	for (guint i=0; i<G_N_ELEMENTS(calls) ;i++)
+		_call_start (calls + i, dir);
+	for (guint i=0; i<G_N_ELEMENTS(calls) ;i++)
+		_call_join (calls + i);
+	gint64 longest = 0;
+	for (guint i=0; i<G_N_ELEMENTS(calls) ;i++) {
+		g_assert_cmpint (0, ==, calls[i].rc);
+		longest = MAX(longest, calls[i].spent);
+	}
+	g_assert_cmpint (fsyncs, >=, 1);
+	g_assert_cmpint (fsyncs, <, G_N_ELEMENTS(calls));
+	g_assert_cmpint (longest, >=, 100 * G_TIME_SPAN_MILLISECOND);
+
+	rawx_commit_destroy ();
+	g_rmdir (dir);
+	g_free (dir);
+}
+
+static void
+test_different_dirs (void)
+{
+	gchar *dirs[4];
+	for (guint i=0; i<G_N_ELEMENTS(dirs) ;i++)
+		dirs[i] = _make_dir ();
+	g_assert_no_error (rawx_commit_init (100 * G_TIME_SPAN_MILLISECOND));
+
+	/* Held in the first fsync(), so that all the others are in the next
+	 * batch */
+	_gate_close ();
+	fsyncs = 0;
+	struct call_s first;
+	_call_start (&first, dirs[0]);
+	_gate_wait_reached ();
+
+	struct call_s calls[2 * G_N_ELEMENTS(dirs) + 1];
+	for (guint i=0; i<G_N_ELEMENTS(calls) - 1 ;i++)
+		_call_start (calls + i, dirs[i % G_N_ELEMENTS(dirs)]);
+	_call_start (calls + G_N_ELEMENTS(calls) - 1, "/nowhere/at/all");
+	for (guint i=0; i<G_N_ELEMENTS(dirs) ;i++)
+		_wait_waiters (dirs[i], 2);
+	_wait_waiters ("/nowhere/at/all", 1);
+	_gate_open ();
+
+	/* Each directory is synced once, the error only concerns its own
+	 * waiters */
+	_call_join (&first);
+	g_assert_cmpint (0, ==, first.rc);
+	for (guint i=0; i<G_N_ELEMENTS(calls) ;i++)
+		_call_join (calls + i);
+	for (guint i=0; i<G_N_ELEMENTS(calls) - 1 ;i++)
+		g_assert_cmpint (0, ==, calls[i].rc);
+	g_assert_cmpint (ENOENT, ==, calls[G_N_ELEMENTS(calls) - 1].rc);
+	g_assert_cmpint (1 + G_N_ELEMENTS(dirs), ==, fsyncs);
+
+	rawx_commit_destroy ();
+	for (guint i=0; i<G_N_ELEMENTS(dirs) ;i++) {
+		g_rmdir (dirs[i]);
+		g_free (dirs[i]);
+	}
+}
+
+static void
+test_waiters (void)
+{
+	gchar *dir = _make_dir ();
+	g_assert_no_error (rawx_commit_init (0));
+
+	/* A caller arrived while its directory is being synced waits for the
+	 * next fsync() */
+	_gate_close ();
+	fsyncs = 0;
+	struct call_s before, after;
+	_call_start (&before, dir);
+	_gate_wait_reached ();
+	_call_start (&after, dir);
+	_wait_waiters (dir, 1);
+	g_assert_cmpint (1, ==, fsyncs);
+	_gate_open ();
+
+	_call_join (&before);
+	_call_join (&after);
+	g_assert_cmpint (0, ==, before.rc);
+	g_assert_cmpint (0, ==, after.rc);
+	g_assert_cmpint (2, ==, fsyncs);
+
+	rawx_commit_destroy ();
+	g_rmdir (dir);
+	g_free (dir);
+}
+
+static void
+test_shutdown (void)
+{
+	gchar *dir = _make_dir ();
+	g_assert_no_error (rawx_commit_init (0));
+
+	/* The batch pending at the shutdown is still synced */
+	_gate_close ();
+	fsyncs = 0;
+	struct call_s before, after;
+	_call_start (&before, dir);
+	_gate_wait_reached ();
+	_call_start (&after, dir);
+	_wait_waiters (dir, 1);
+
+	GThread *th = g_thread_new ("destroy", _destroy_run, NULL);
+	g_usleep (10 * G_TIME_SPAN_MILLISECOND);
+	_gate_open ();
+	g_thread_join (th);
+
+	_call_join (&before);
+	_call_join (&after);
+	g_assert_cmpint (0, ==, before.rc);
+	g_assert_cmpint (0, ==, after.rc);
+	g_assert_cmpint (2, ==, fsyncs);
+
+	/* Then the callers sync by themselves */
+	g_assert_null (th_commit);
+	g_assert_cmpint (0, ==, rawx_commit_dir (dir));
+	g_assert_cmpint (3, ==, fsyncs);
+
+	g_rmdir (dir);
+	g_free (dir);
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT (argc, argv);
+	g_test_add_func ("/rawx/commit/no_thread", test_no_thread);
+	g_test_add_func ("/rawx/commit/same_dir", test_same_dir);
+	g_test_add_func ("/rawx/commit/different_dirs", test_different_dirs);
+	g_test_add_func ("/rawx/commit/waiters", test_waiters);
+	g_test_add_func ("/rawx/commit/shutdown", test_shutdown);
+	return g_test_run ();
+}
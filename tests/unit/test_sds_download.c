@@ -0,0 +1,495 @@
+/*
+OpenIO SDS core library
+Copyright (C) 2015-2016 OpenIO, as part of OpenIO Software Defined Storage
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <core/oio_core.h>
+#include <core/oio_sds.h>
+#include <core/internals.h>
+
+#include "tests/common/test_http_mock.c"
+
+/* The content is made of META_COUNT metachunks of META_SIZE bytes, each
+ * with a single replica served by the mocked rawx. */
+#define META_COUNT 3
+#define META_SIZE 10000
+
+/* The version 2 of the content is served by other metachunks */
+#define V2_SHIFT 16
+
+/* So is each generation of the content, when it is replaced */
+#define GEN_SHIFT 32
+
+static struct http_mock_s *proxy = NULL;
+static struct http_mock_s *rawx = NULL;
+
+/* The metachunk the rawx fails to serve, -1 for none */
+static volatile gint fail_meta = -1;
+static int fail_code = 500;
+
+/* The current generation of the content, and the metachunks the rawx does
+ * not hold anymore (404) */
+static volatile gint generation = 0;
+static volatile gint gone_below = 0;
+
+/* The content/show requests received by the proxy */
+static volatile gint shows = 0;
+
+static guint8
+_byte_at (gsize offset)
+{
+	return (guint8) ((offset * 31) % 251);
+}
+
+static void
+_rawx_handler (struct http_mock_s *mock UNUSED, const char *method UNUSED,
+		const char *path, GHashTable *headers,
+		int *code, GString *rep_headers UNUSED, GString *body)
+{
+	const guint meta = g_ascii_strtoull (path + 1, NULL, 16);
+	if ((gint)meta == g_atomic_int_get (&fail_meta)) {
+		*code = fail_code;
+		return;
+	}
+	if ((gint)meta < g_atomic_int_get (&gone_below)) {
+		*code = 404;
+		return;
+	}
+
+	gsize start = 0, end = META_SIZE - 1;
+	if (http_mock_range (headers, &start, &end)) {
+		end = MIN(end, META_SIZE - 1);
+		*code = 206;
+	} else {
+		*code = 200;
+	}
+	/* let the parallel requests overlap */
+	g_usleep (2 * G_TIME_SPAN_MILLISECOND);
+	for (gsize i = start; i <= end ;++i)
+		g_string_append_c (body, _byte_at (meta * META_SIZE + i));
+}
+
+static void
+_proxy_handler (struct http_mock_s *mock UNUSED, const char *method UNUSED,
+		const char *path, GHashTable *headers UNUSED,
+		int *code, GString *rep_headers, GString *body)
+{
+	if (g_str_has_prefix (path, "/v3.0/NS/content/create")) {
+		*code = 200;
+		return;
+	}
+	if (g_str_has_prefix (path, "/v3.0/NS/content/delete")) {
+		*code = 204;
+		return;
+	}
+	if (!g_str_has_prefix (path, "/v3.0/NS/content/show")) {
+		*code = 404;
+		return;
+	}
+	g_atomic_int_inc (&shows);
+	*code = 200;
+	const guint shift = (strstr (path, "version=2") ? V2_SHIFT : 0)
+		+ g_atomic_int_get (&generation) * GEN_SHIFT;
+	g_string_append (rep_headers,
+			"x-oio-content-meta-chunk-method: plain\r\n");
+	g_string_append_c (body, '[');
+	for (guint i = 0; i < META_COUNT ;++i) {
+		if (i)
+			g_string_append_c (body, ',');
+		g_string_append_printf (body,
+				"{\"url\":\"http://%s/%064X\",\"pos\":\"%u\","
+				"\"size\":%u,\"hash\":\"%032d\"}",
+				rawx->url, i + shift, i, META_SIZE, 0);
+	}
+	g_string_append_c (body, ']');
+}
+
+/* Configuration ----------------------------------------------------------- */
+
+struct oio_cfg_handle_MOCK_s
+{
+	struct oio_cfg_handle_vtable_s *vtable;
+};
+
+static void
+_mock_cfg_clean (struct oio_cfg_handle_s *cfg)
+{
+	g_free (cfg);
+}
+
+static gchar **
+_mock_cfg_namespaces (struct oio_cfg_handle_s *cfg UNUSED)
+{
+	gchar **nsv = g_malloc0 (2 * sizeof(gchar*));
+	nsv[0] = g_strdup ("NS");
+	return nsv;
+}
+
+static gchar *
+_mock_cfg_get (struct oio_cfg_handle_s *cfg UNUSED, const char *ns,
+		const char *k)
+{
+	if (!strcmp (ns, "NS") && !strcmp (k, OIO_CFG_PROXY))
+		return g_strdup (proxy->url);
+	return NULL;
+}
+
+static struct oio_cfg_handle_vtable_s VTABLE_MOCK =
+{
+	_mock_cfg_clean, _mock_cfg_namespaces, _mock_cfg_get
+};
+
+/* Helpers ----------------------------------------------------------------- */
+
+static struct oio_sds_s *
+_sds_init (int parallelism, int buffer_size)
+{
+	struct oio_sds_s *sds = NULL;
+	struct oio_error_s *err = oio_sds_init (&sds, "NS");
+	g_assert_no_error ((GError*)err);
+	g_assert_cmpint (0, ==, oio_sds_configure (sds,
+				OIOSDS_CFG_DL_PARALLELISM, &parallelism, sizeof(int)));
+	g_assert_cmpint (0, ==, oio_sds_configure (sds,
+				OIOSDS_CFG_DL_BUFFER_SIZE, &buffer_size, sizeof(int)));
+	return sds;
+}
+
+static GString *
+_expected (struct oio_sds_dl_range_s **ranges)
+{
+	GString *gs = g_string_new ("");
+	for (; *ranges ;++ranges) {
+		for (gsize i = 0; i < (*ranges)->size ;++i)
+			g_string_append_c (gs, _byte_at ((*ranges)->offset + i));
+	}
+	return gs;
+}
+
+static gint
+_append (void *ctx, const unsigned char *b, size_t l)
+{
+	g_string_append_len ((GString*)ctx, (const char*)b, l);
+	return l;
+}
+
+static GError *
+_download_url (struct oio_sds_s *sds, struct oio_url_s *url,
+		struct oio_sds_dl_range_s **ranges, GString *out)
+{
+	struct oio_sds_dl_src_s src = { .url = url, .ranges = ranges };
+	struct oio_sds_dl_dst_s dst = {
+		.type = OIO_DL_DST_HOOK_SEQUENTIAL,
+		.data = { .hook = {
+			.cb = _append,
+			.ctx = out,
+			.length = (size_t)-1,
+		} }
+	};
+	GError *err = (GError*) oio_sds_download (sds, &src, &dst);
+	if (!err)
+		g_assert_cmpuint (dst.out_size, ==, out->len);
+	return err;
+}
+
+static GError *
+_download (struct oio_sds_s *sds, struct oio_sds_dl_range_s **ranges,
+		GString *out)
+{
+	struct oio_url_s *url = oio_url_init ("NS/ACCT/JFS//plop");
+	GError *err = _download_url (sds, url, ranges, out);
+	oio_url_pclean (&url);
+	return err;
+}
+
+static struct oio_sds_s *
+_sds_init_cached (int parallelism, int hedge_delay)
+{
+	struct oio_sds_s *sds = _sds_init (parallelism, 4096);
+	int cache_size = 16;
+	g_assert_cmpint (0, ==, oio_sds_configure (sds,
+				OIOSDS_CFG_CACHE_SIZE, &cache_size, sizeof(int)));
+	g_assert_cmpint (0, ==, oio_sds_configure (sds,
+				OIOSDS_CFG_HEDGE_DELAY, &hedge_delay, sizeof(int)));
+	return sds;
+}
+
+/* Downloads the whole content and checks it is the given generation */
+static void
+_check_generation (struct oio_sds_s *sds, gint gen)
+{
+	GString *out = g_string_new ("");
+	GError *err = _download (sds, NULL, out);
+	g_assert_no_error (err);
+	g_assert_cmpuint (out->len, ==, META_COUNT * META_SIZE);
+	const gsize base = gen * GEN_SHIFT * META_SIZE;
+	for (gsize i = 0; i < out->len ;++i)
+		g_assert_cmpuint ((guint8)out->str[i], ==, _byte_at (base + i));
+	g_string_free (out, TRUE);
+}
+
+static void
+_reset_generation (void)
+{
+	g_atomic_int_set (&generation, 0);
+	g_atomic_int_set (&gone_below, 0);
+}
+
+static void
+_check_download (int parallelism, struct oio_sds_dl_range_s **ranges)
+{
+	struct oio_sds_dl_range_s whole = {0, META_COUNT * META_SIZE};
+	struct oio_sds_dl_range_s *wholev[2] = {&whole, NULL};
+
+	struct oio_sds_s *sds = _sds_init (parallelism, 4096);
+	GString *out = g_string_new ("");
+	GString *expected = _expected (ranges ? ranges : wholev);
+
+	g_atomic_int_set (&rawx->max_inflight, 0);
+	GError *err = _download (sds, ranges, out);
+	g_assert_no_error (err);
+	g_assert_cmpuint (out->len, ==, expected->len);
+	g_assert (0 == memcmp (out->str, expected->str, out->len));
+	g_assert_cmpint (g_atomic_int_get (&rawx->max_inflight), <=, parallelism);
+
+	g_string_free (expected, TRUE);
+	g_string_free (out, TRUE);
+	oio_sds_pfree (&sds);
+}
+
+/* Tests ------------------------------------------------------------------- */
+
+static void
+test_sequential (void)
+{
+	_check_download (1, NULL);
+}
+
+static void
+test_parallel_hook (void)
+{
+	/* 4096 bytes of budget among 4 workers: parts of 1024 bytes, the
+	 * metachunks are not multiple of it. */
+	const gint before = g_atomic_int_get (&rawx->requests);
+	_check_download (4, NULL);
+	g_assert_cmpint (g_atomic_int_get (&rawx->requests) - before, ==,
+			META_COUNT * ((META_SIZE + 1023) / 1024));
+}
+
+static void
+test_parallel_ranges (void)
+{
+	/* across a boundary of metachunks, then inside the last one */
+	struct oio_sds_dl_range_s r0 = {META_SIZE - 1000, 2500};
+	struct oio_sds_dl_range_s r1 = {2 * META_SIZE + 10, 100};
+	struct oio_sds_dl_range_s *rv[3] = {&r0, &r1, NULL};
+	_check_download (4, rv);
+}
+
+static void
+test_parallel_file (void)
+{
+	gchar *path = g_strdup_printf ("%s/test_sds_download-%d-%"G_GINT64_FORMAT,
+			g_get_tmp_dir (), getpid (), g_get_monotonic_time ());
+	struct oio_sds_s *sds = _sds_init (4, 4096);
+	struct oio_url_s *url = oio_url_init ("NS/ACCT/JFS//plop");
+
+	struct oio_error_s *err = oio_sds_download_to_file (sds, url, path);
+	g_assert_no_error ((GError*)err);
+
+	/* each part is written at its place */
+	gchar *data = NULL;
+	gsize len = 0;
+	g_assert_true (g_file_get_contents (path, &data, &len, NULL));
+	g_assert_cmpuint (len, ==, META_COUNT * META_SIZE);
+	for (gsize i = 0; i < len ;++i)
+		g_assert_cmpuint ((guint8)data[i], ==, _byte_at (i));
+
+	g_free (data);
+	unlink (path);
+	g_free (path);
+	oio_url_pclean (&url);
+	oio_sds_pfree (&sds);
+}
+
+static void
+test_parallel_error (void)
+{
+	struct oio_sds_s *sds = _sds_init (4, 4096);
+	GString *out = g_string_new ("");
+
+	g_atomic_int_set (&fail_meta, 1);
+	GError *err = _download (sds, NULL, out);
+	g_atomic_int_set (&fail_meta, -1);
+
+	g_assert_nonnull (err);
+	/* nothing past the failed part has been delivered */
+	g_assert_cmpuint (out->len, <=, META_SIZE);
+	g_clear_error (&err);
+	g_string_free (out, TRUE);
+	oio_sds_pfree (&sds);
+}
+
+static void
+test_cache_versions (void)
+{
+	struct oio_sds_s *sds = _sds_init (1, 4096);
+	int cache_size = 16;
+	g_assert_cmpint (0, ==, oio_sds_configure (sds,
+				OIOSDS_CFG_CACHE_SIZE, &cache_size, sizeof(int)));
+
+	/* Each version has its own entry in the cache, the second download of
+	 * a version does not ask the proxy */
+	const gint before = g_atomic_int_get (&proxy->requests);
+	for (int round = 0; round < 2 ;++round) {
+		for (guint v = 1; v <= 2 ;++v) {
+			struct oio_url_s *url = oio_url_init ("NS/ACCT/JFS//plop");
+			oio_url_set (url, OIOURL_VERSION, v == 1 ? "1" : "2");
+			GString *out = g_string_new ("");
+			GError *err = _download_url (sds, url, NULL, out);
+			g_assert_no_error (err);
+			g_assert_cmpuint (out->len, ==, META_COUNT * META_SIZE);
+			const gsize base = v == 1 ? 0 : V2_SHIFT * META_SIZE;
+			for (gsize i = 0; i < out->len ;++i)
+				g_assert_cmpuint ((guint8)out->str[i], ==, _byte_at (base + i));
+			g_string_free (out, TRUE);
+			oio_url_pclean (&url);
+		}
+	}
+	g_assert_cmpint (g_atomic_int_get (&proxy->requests) - before, ==, 2);
+
+	oio_sds_pfree (&sds);
+}
+
+static void
+_check_stale (int parallelism, int hedge_delay)
+{
+	struct oio_sds_s *sds = _sds_init_cached (parallelism, hedge_delay);
+	const gint before = g_atomic_int_get (&shows);
+	_check_generation (sds, 0);
+	g_assert_cmpint (g_atomic_int_get (&shows) - before, ==, 1);
+
+	/* The content is replaced behind the client, the cached chunks are
+	 * gone: the entry is dropped and the proxy asked again */
+	g_atomic_int_set (&generation, 1);
+	g_atomic_int_set (&gone_below, GEN_SHIFT);
+	_check_generation (sds, 1);
+	g_assert_cmpint (g_atomic_int_get (&shows) - before, ==, 2);
+
+	/* The new locations are cached in turn */
+	_check_generation (sds, 1);
+	g_assert_cmpint (g_atomic_int_get (&shows) - before, ==, 2);
+
+	_reset_generation ();
+	oio_sds_pfree (&sds);
+}
+
+static void
+test_cache_stale_sequential (void)
+{
+	_check_stale (1, 0);
+}
+
+static void
+test_cache_stale_hedged (void)
+{
+	_check_stale (1, 5);
+}
+
+static void
+test_cache_stale_parallel (void)
+{
+	_check_stale (4, 0);
+}
+
+static void
+test_cache_forget (void)
+{
+	struct oio_sds_s *sds = _sds_init_cached (1, 0);
+	struct oio_url_s *url = oio_url_init ("NS/ACCT/JFS//plop");
+	const gint before = g_atomic_int_get (&shows);
+	_check_generation (sds, 0);
+
+	/* The former chunks are still served, only the writes of the client
+	 * tell the cached entry is stale */
+	g_atomic_int_set (&generation, 1);
+	_check_generation (sds, 0);
+	g_assert_cmpint (g_atomic_int_get (&shows) - before, ==, 1);
+
+	/* Deleted */
+	struct oio_error_s *err = oio_sds_delete (sds, url);
+	g_assert_no_error ((GError*)err);
+	_check_generation (sds, 1);
+	g_assert_cmpint (g_atomic_int_get (&shows) - before, ==, 2);
+
+	/* Uploaded */
+	g_atomic_int_set (&generation, 2);
+	struct oio_sds_ul_dst_s dst = OIO_SDS_UPLOAD_DST_INIT;
+	dst.url = url;
+	dst.content_id = "0123456789ABCDEF";
+	struct oio_sds_ul_s *ul = oio_sds_upload_init (sds, &dst);
+	g_assert_nonnull (ul);
+	err = oio_sds_upload_commit (ul);
+	g_assert_no_error ((GError*)err);
+	oio_sds_upload_clean (ul);
+	_check_generation (sds, 2);
+	g_assert_cmpint (g_atomic_int_get (&shows) - before, ==, 3);
+
+	_reset_generation ();
+	oio_url_pclean (&url);
+	oio_sds_pfree (&sds);
+}
+
+int
+main (int argc, char **argv)
+{
+	OIO_TEST_INIT (argc, argv);
+	oio_sds_no_shuffle = 1;
+
+	struct oio_cfg_handle_MOCK_s *cfg = g_malloc0 (sizeof(*cfg));
+	cfg->vtable = &VTABLE_MOCK;
+	oio_cfg_set_handle ((struct oio_cfg_handle_s*) cfg);
+	rawx = http_mock_start (_rawx_handler, NULL);
+	proxy = http_mock_start (_proxy_handler, NULL);
+
+	g_test_add_func ("/core/sds/download/sequential", test_sequential);
+	g_test_add_func ("/core/sds/download/parallel/hook", test_parallel_hook);
+	g_test_add_func ("/core/sds/download/parallel/ranges",
+			test_parallel_ranges);
+	g_test_add_func ("/core/sds/download/parallel/file", test_parallel_file);
+	g_test_add_func ("/core/sds/download/parallel/error",
+			test_parallel_error);
+	g_test_add_func ("/core/sds/download/cache/versions",
+			test_cache_versions);
+	g_test_add_func ("/core/sds/download/cache/stale/sequential",
+			test_cache_stale_sequential);
+	g_test_add_func ("/core/sds/download/cache/stale/hedged",
+			test_cache_stale_hedged);
+	g_test_add_func ("/core/sds/download/cache/stale/parallel",
+			test_cache_stale_parallel);
+	g_test_add_func ("/core/sds/download/cache/forget", test_cache_forget);
+	int rc = g_test_run ();
+
+	http_mock_stop (proxy);
+	http_mock_stop (rawx);
+	oio_cfg_set_handle (NULL);
+	oio_cfg_handle_clean ((struct oio_cfg_handle_s*) cfg);
+	return rc;
+}
@@ -87,6 +87,91 @@ test_lock (void)
 	sqlx_cache_clean(cache);
 }
 
+static guint visits = 0;
+
+static void
+sqlite_visit (gpointer handle)
+{
+	g_debug("Visiting base with handle %p", handle);
+	++ visits;
+}
+
+static void
+test_idle (void)
+{
+	sqlx_cache_t *cache = sqlx_cache_init();
+	g_assert(cache != NULL);
+	sqlx_cache_set_max_bases (cache, 16);
+	sqlx_cache_set_close_hook(cache, sqlite_close);
+
+	/* no hook, no visit */
+	_round_lock (cache);
+	g_assert_cmpuint(0, ==, sqlx_cache_visit_idle(cache, 16, 0));
+
+	sqlx_cache_set_idle_hook(cache, sqlite_visit);
+	visits = 0;
+	g_assert_cmpuint(2, ==, sqlx_cache_visit_idle(cache, 16, 0));
+	g_assert_cmpuint(2, ==, visits);
+	/* not used since the last visit */
+	g_assert_cmpuint(0, ==, sqlx_cache_visit_idle(cache, 16, 0));
+	/* not idle for long enough */
+	_round_lock (cache);
+	g_assert_cmpuint(0, ==, sqlx_cache_visit_idle(cache, 16, G_TIME_SPAN_HOUR));
+	g_assert_cmpuint(1, ==, sqlx_cache_visit_idle(cache, 1, 0));
+	g_assert_cmpuint(3, ==, visits);
+
+	/* the visited bases are still reachable */
+	_round_lock (cache);
+	sqlx_cache_debug(cache);
+	sqlx_cache_expire(cache, 0, 0);
+	sqlx_cache_clean(cache);
+}
+
+static GString *closed = NULL;
+
+static void
+sqlite_close_trace (gpointer handle)
+{
+	g_string_append_c (closed, GPOINTER_TO_INT(handle));
+}
+
+static void
+_open_close (sqlx_cache_t *cache, const char *n, char tag)
+{
+	hashstr_t *hn = NULL;
+	HASHSTR_ALLOCA(hn, n);
+	gint id = -1;
+	GError *err = sqlx_cache_open_and_lock_base(cache, hn, FALSE, &id);
+	g_assert_no_error (err);
+	sqlx_cache_set_handle(cache, id, GINT_TO_POINTER(tag));
+	err = sqlx_cache_unlock_and_close_base(cache, id, FALSE);
+	g_assert_no_error (err);
+}
+
+static void
+test_idle_order (void)
+{
+	sqlx_cache_t *cache = sqlx_cache_init();
+	sqlx_cache_set_max_bases (cache, 16);
+	sqlx_cache_set_close_hook(cache, sqlite_close_trace);
+	sqlx_cache_set_idle_hook(cache, sqlite_visit);
+	closed = g_string_new ("");
+
+	/* A visit does not make a base younger than one used after it */
+	_open_close (cache, name0, 'A');
+	g_assert_cmpuint(1, ==, sqlx_cache_visit_idle(cache, 16, 0));
+	g_usleep (1000);
+	_open_close (cache, name1, 'B');
+	g_assert_cmpuint(1, ==, sqlx_cache_visit_idle(cache, 16, 0));
+
+	g_assert_cmpuint(2, ==, sqlx_cache_expire_all(cache));
+	g_assert_cmpstr(closed->str, ==, "AB");
+
+	sqlx_cache_clean(cache);
+	g_string_free (closed, TRUE);
+	closed = NULL;
+}
+
 static void
 _round_init (void)
 {
@@ -112,6 +197,8 @@ main(int argc, char ** argv)
 	HC_TEST_INIT(argc, argv);
 	g_test_add_func("/sqliterepo/cache/init", test_init);
 	g_test_add_func("/sqliterepo/cache/lock", test_lock);
+	g_test_add_func("/sqliterepo/cache/idle", test_idle);
+	g_test_add_func("/sqliterepo/cache/idle/order", test_idle_order);
 	return g_test_run();
 }
 
@@ -571,6 +571,15 @@ test_single (void)
 	g_array_free (iv, TRUE);
 }
 
+static guint
+_count_step (struct election_manager_s *manager, enum election_step_e step)
+{
+	guint count = 0;
+	for (guint i=0; i<SQLX_ELECTION_SHARDS ;++i)
+		count += manager->shards[i].count_by_step[step];
+	return count;
+}
+
 static void
 test_sets (void)
 {
@@ -612,14 +621,224 @@ test_sets (void)
 		m->myid = 1;
 		m->master_id = 1;
 	}
-	g_assert_cmpuint(NB, ==, manager->members_by_state[STEP_PRELEAD].count);
+	g_assert_cmpuint(NB, ==, _count_step (manager, STEP_PRELEAD));
 	CLOCK += manager->delay_fail_pending + 1;
 	g_assert_cmpuint (1, ==, election_manager_play_timers (manager, 1));
-	g_assert_cmpuint(1, ==, manager->members_by_state[STEP_FAILED].count);
-	g_assert_cmpuint(NB-1, ==, manager->members_by_state[STEP_PRELEAD].count);
+	g_assert_cmpuint(1, ==, _count_step (manager, STEP_FAILED));
+	g_assert_cmpuint(NB-1, ==, _count_step (manager, STEP_PRELEAD));
 	g_assert_cmpuint (2, ==, election_manager_play_timers (manager, 2));
-	g_assert_cmpuint(3, ==, manager->members_by_state[STEP_FAILED].count);
-	g_assert_cmpuint(NB-3, ==, manager->members_by_state[STEP_PRELEAD].count);
+	g_assert_cmpuint(3, ==, _count_step (manager, STEP_FAILED));
+	g_assert_cmpuint(NB-3, ==, _count_step (manager, STEP_PRELEAD));
+
+	election_manager_clean (manager);
+	sqlx_peering__destroy (peering);
+	sqlx_sync_close (sync);
+	sqlx_sync_clear (sync);
+}
+
+static void
+test_shards_fairness (void)
+{
+	struct replication_config_s config = {
+		_get_id, _get_peers, _get_vers, NULL, ELECTION_MODE_GROUP
+	};
+	struct sqlx_sync_s *sync = NULL;
+	struct sqlx_peering_s *peering = NULL;
+	struct election_manager_s *manager = NULL;
+
+	CLOCK_START = CLOCK = oio_ext_rand_int ();
+
+	sync = _sync_factory__noop ();
+	peering = _peering_noop ();
+	g_assert_no_error (election_manager_create (&config, &manager));
+	election_manager_set_sync (manager, sync);
+	election_manager_set_peering (manager, peering);
+
+	/* Enough bases to populate every shard */
+	CLOCK ++;
+#define NB_FAIR (SQLX_ELECTION_SHARDS * 16)
+	for (int i=0; i<NB_FAIR ;++i) {
+		gchar tmp[128];
+		g_snprintf (tmp, sizeof(tmp), "base-%d", i);
+		struct sqlx_name_s name = { .base = tmp, .type = "type", .ns = "NS", };
+		g_assert_no_error (_election_init (manager, &name));
+
+		hashstr_t *_k = sqliterepo_hash_name (&name);
+		struct election_member_s *m = manager_get_member (manager, _k);
+		g_free (_k);
+
+		member_set_status (m, STEP_PRELEAD);
+		m->last_USE = CLOCK;
+		m->last_atime = CLOCK;
+		m->myid = 1;
+		m->master_id = 1;
+		member_unref (m);
+	}
+	for (guint i=0; i<SQLX_ELECTION_SHARDS ;++i)
+		g_assert_cmpuint (0, <, manager->shards[i].count_by_step[STEP_PRELEAD]);
+
+	/* Bounded rounds start on a different shard each time, so that none of
+	 * the shards waits for the lower ones to be drained. */
+	CLOCK += manager->delay_fail_pending + 1;
+	for (guint i=0; i<SQLX_ELECTION_SHARDS ;++i)
+		g_assert_cmpuint (1, ==, election_manager_play_timers (manager, 1));
+	for (guint i=0; i<SQLX_ELECTION_SHARDS ;++i)
+		g_assert_cmpuint (1, ==, manager->shards[i].count_by_step[STEP_FAILED]);
+
+	election_manager_clean (manager);
+	sqlx_peering__destroy (peering);
+	sqlx_sync_close (sync);
+	sqlx_sync_clear (sync);
+}
+
+static void
+test_wheel (void)
+{
+	struct timer_wheel_s wheel = {0};
+	const gint64 start = oio_ext_rand_int ();
+	wheel.tick = _WHEEL_tick (start);
+
+	/* deadlines on each level of the wheel, and beyond */
+	static const gint64 delays[] = {
+		0, 1, WHEEL_SLOTS - 1, WHEEL_SLOTS, WHEEL_SLOTS + 1,
+		WHEEL_SLOTS * WHEEL_SLOTS, WHEEL_SLOTS * WHEEL_SLOTS * 3 + 7,
+		WHEEL_SPAN - 1, WHEEL_SPAN + 5,
+	};
+#define NB_DELAYS (sizeof(delays) / sizeof(delays[0]))
+	struct election_member_s members[NB_DELAYS];
+	memset (members, 0, sizeof(members));
+	for (guint i=0; i<NB_DELAYS ;++i) {
+		members[i].deadline = start + delays[i] * SQLX_ELECTION_TICK;
+		_WHEEL_insert (&wheel, members + i);
+		g_assert_nonnull (members[i].slot);
+	}
+
+	/* Each member is extracted once, never before its deadline. Those on the
+	 * lower levels are extracted exactly at the tick of their deadline, the
+	 * one beyond the span is extracted at the end of the span. */
+	guint total = 0;
+	for (gint64 t = 0; t <= WHEEL_SPAN + WHEEL_SLOTS && total < NB_DELAYS ;) {
+		const gint64 now = start + t * SQLX_ELECTION_TICK;
+		GSList *l = _WHEEL_advance (&wheel, now);
+		for (GSList *p = l; p ;p = p->next) {
+			struct election_member_s *m = p->data;
+			const gint64 delay = (m->deadline - start) / SQLX_ELECTION_TICK;
+			g_assert_null (m->slot);
+			if (delay >= WHEEL_SPAN)
+				g_assert_cmpint (t, >=, WHEEL_SPAN - 1);
+			else if (delay < WHEEL_SLOTS * WHEEL_SLOTS * 4)
+				g_assert_cmpint (delay, ==, t);
+			else
+				g_assert_cmpint (delay, <=, t);
+			++ total;
+		}
+		g_slist_free (l);
+
+		/* then jump from slot to slot */
+		t += (t < WHEEL_SLOTS * WHEEL_SLOTS * 4) ? 1 : WHEEL_SLOTS;
+	}
+	g_assert_cmpuint (total, ==, NB_DELAYS);
+
+	/* A member whose deadline is already reached is played at once */
+	members[0].deadline = start;
+	_WHEEL_insert (&wheel, members + 0);
+	g_assert (members[0].slot == &wheel.late);
+	GSList *l = _WHEEL_advance (&wheel, start);
+	g_assert_cmpuint (1, ==, g_slist_length (l));
+	g_slist_free (l);
+}
+
+static void
+test_lease (void)
+{
+	struct sqlx_name_s name = {
+		.base = "base", .type = "type", .ns = "NS",
+	};
+	struct replication_config_s config = {
+		_get_id, _get_peers, _get_vers, NULL, ELECTION_MODE_GROUP
+	};
+	struct election_manager_s *manager = NULL;
+
+	CLOCK_START = CLOCK = oio_ext_rand_int ();
+
+	struct sqlx_sync_s *sync = _sync_factory__noop ();
+	struct sqlx_peering_s *peering = _peering_noop ();
+	g_assert_no_error (election_manager_create (&config, &manager));
+	election_manager_set_sync (manager, sync);
+	election_manager_set_peering (manager, peering);
+
+	g_assert_no_error (_election_init (manager, &name));
+	hashstr_t *_k = sqliterepo_hash_name (&name);
+	struct election_member_s *m = manager_get_member (manager, _k);
+	g_free (_k);
+
+	/* Valid until its deadline */
+	g_assert_false (election_lease_valid (NULL));
+	member_set_status (m, STEP_LEADER);
+	struct election_lease_s *lease = member_grant_lease (m);
+	g_assert_nonnull (lease);
+	g_assert_true (election_lease_valid (lease));
+	CLOCK += manager->delay_lease + G_TIME_SPAN_SECOND;
+	g_assert_false (election_lease_valid (lease));
+
+	/* Renewed with the status, its uses are reported to the member */
+	g_assert (lease == member_grant_lease (m));
+	election_lease_unref (lease);
+	g_assert_true (election_lease_valid (lease));
+	m->last_atime = 0;
+	member_fold_lease (m);
+	g_assert_cmpint (m->last_atime, ==,
+			(CLOCK / G_TIME_SPAN_SECOND) * G_TIME_SPAN_SECOND);
+
+	/* Revoked as soon as the member leaves the step */
+	member_set_status (m, STEP_LEAVING);
+	g_assert_false (election_lease_valid (lease));
+	/* ... where no timer plays it */
+	g_assert_cmpint (_member_get_next_deadline (m), ==, G_MAXINT64);
+	member_unref (m);
+
+	/* The base may keep it longer than the member lives */
+	election_manager_clean (manager);
+	g_assert_false (election_lease_valid (lease));
+	election_lease_unref (lease);
+
+	sqlx_peering__destroy (peering);
+	sqlx_sync_close (sync);
+	sqlx_sync_clear (sync);
+}
+
+static void
+test_late_creation (void)
+{
+	struct sqlx_name_s name = {
+		.base = "base", .type = "type", .ns = "NS",
+	};
+	struct replication_config_s config = {
+		_get_id, _get_peers, _get_vers, NULL, ELECTION_MODE_GROUP
+	};
+	struct election_manager_s *manager = NULL;
+
+	struct sqlx_sync_s *sync = _sync_factory__noop ();
+	struct sqlx_peering_s *peering = _peering_noop ();
+	g_assert_no_error (election_manager_create (&config, &manager));
+	election_manager_set_sync (manager, sync);
+	election_manager_set_peering (manager, peering);
+
+	g_assert_no_error (_election_init (manager, &name));
+	hashstr_t *_k = sqliterepo_hash_name (&name);
+	struct election_member_s *m = manager_get_member (manager, _k);
+	g_free (_k);
+
+	/* The member stopped waiting for its node, the node created later is
+	 * deleted and the member is left untouched */
+	member_set_status (m, STEP_FAILED);
+	g_array_set_size (sync->pending, 0);
+	member_ref (m);
+	step_StartElection_completion (ZOK, "/el/XYZ-0000000007", m);
+	_pending (DELETE, 0);
+	g_assert_cmpint (m->step, ==, STEP_FAILED);
+	g_assert_cmpint (m->myid, ==, -1);
+	member_unref (m);
 
 	election_manager_clean (manager);
 	sqlx_peering__destroy (peering);
@@ -751,6 +970,66 @@ test_sequence (void)
 	sqlx_sync_clear (sync);
 }
 
+static GTree *
+_versions (gint64 v)
+{
+	GTree *t = version_empty ();
+	struct object_version_s *o = g_malloc0 (sizeof(*o));
+	o->version = v;
+	g_tree_insert (t, hashstr_create ("main.t"), o);
+	return t;
+}
+
+static GError*
+_get_vers_1 (gpointer ctx, const struct sqlx_name_s *n, GTree **result)
+{
+	(void) ctx, (void) n;
+	*result = _versions (1);
+	return NULL;
+}
+
+static guint count_outdated = 0;
+
+static void
+_notify_outdated (gpointer ctx, const struct sqlx_name_s *n, gboolean outdated)
+{
+	(void) ctx;
+	g_assert_cmpstr (n->base, ==, "base");
+	if (outdated)
+		++ count_outdated;
+}
+
+static void
+test_getvers_outdated (void)
+{
+	struct replication_config_s config = {
+		_get_id, _get_peers, _get_vers_1, NULL, ELECTION_MODE_GROUP,
+		_notify_outdated
+	};
+	struct election_manager_s *manager = NULL;
+	g_assert_no_error (election_manager_create (&config, &manager));
+	struct sqlx_name_s name = { .base = "base", .type = "type", .ns = "NS", };
+
+	/* the same version or an older one on the peer */
+	count_outdated = 0;
+	for (gint64 v = 0; v <= 1 ;++v) {
+		GTree *vremote = _versions (v);
+		_result_GETVERS (NULL, manager, &name, 1, vremote);
+		g_tree_destroy (vremote);
+	}
+	g_assert_cmpuint (count_outdated, ==, 0);
+
+	/* the local base is behind */
+	for (gint64 v = 2; v <= 3 ;++v) {
+		GTree *vremote = _versions (v);
+		_result_GETVERS (NULL, manager, &name, 1, vremote);
+		g_tree_destroy (vremote);
+	}
+	g_assert_cmpuint (count_outdated, ==, 2);
+
+	election_manager_clean (manager);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -762,6 +1041,11 @@ main(int argc, char **argv)
 	g_test_add_func("/sqlx/election/election_init", test_election_init);
 	g_test_add_func ("/sqliterepo/election/single", test_single);
 	g_test_add_func ("/sqliterepo/election/sets", test_sets);
+	g_test_add_func ("/sqliterepo/election/fairness", test_shards_fairness);
+	g_test_add_func ("/sqliterepo/election/wheel", test_wheel);
+	g_test_add_func ("/sqliterepo/election/lease", test_lease);
+	g_test_add_func ("/sqliterepo/election/late", test_late_creation);
 	g_test_add_func ("/sqliterepo/manager/sequence", test_sequence);
+	g_test_add_func ("/sqliterepo/election/outdated", test_getvers_outdated);
 	return g_test_run();
 }
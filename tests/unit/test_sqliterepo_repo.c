@@ -19,6 +19,9 @@ License along with this library.
 
 #include <unistd.h>
 #include <stdio.h>
+#include <sys/stat.h>
+
+#include <sqlite3.h>
 
 #include <metautils/lib/metautils.h>
 
@@ -27,6 +30,9 @@ License along with this library.
 #include <sqliterepo/cache.h>
 #include <sqliterepo/internals.h>
 
+/* for the layout of the leases */
+#include "../../sqliterepo/election.c"
+
 #define SCHEMA \
 	"CREATE TABLE IF NOT EXISTS admin (k TEXT PRIMARY KEY, v NOT NULL);" \
 	"CREATE TABLE IF NOT EXISTS content (" \
@@ -130,12 +136,299 @@ test_open_close (void)
 		_round_open_close ();
 }
 
+static void
+test_lag (void)
+{
+	sqlx_repository_t *repo = NULL;
+	GError *err = sqlx_repository_init("/tmp", NULL, &repo);
+	g_assert_no_error (err);
+
+	struct sqlx_name_s n0 = { .base = name, .type = type, .ns = nsname, };
+	struct sqlx_name_s n1 = { .base = name+1, .type = type, .ns = nsname, };
+
+	g_assert_cmpint (0, ==, sqlx_repository_get_lag (repo, &n0));
+	sqlx_repository_notify_fresh (repo, &n0);
+	g_assert_cmpint (0, ==, sqlx_repository_get_lag (repo, &n0));
+
+	sqlx_repository_notify_stale (repo, &n0);
+	const gint64 lag = sqlx_repository_get_lag (repo, &n0);
+	g_assert_cmpint (lag, >, 0);
+	g_assert_cmpint (0, ==, sqlx_repository_get_lag (repo, &n1));
+
+	/* the lag starts with the first change missed */
+	g_usleep (1000);
+	sqlx_repository_notify_stale (repo, &n0);
+	g_assert_cmpint (sqlx_repository_get_lag (repo, &n0), >=, lag + 1000);
+
+	sqlx_repository_notify_fresh (repo, &n1);
+	g_assert_cmpint (0, <, sqlx_repository_get_lag (repo, &n0));
+	sqlx_repository_notify_fresh (repo, &n0);
+	g_assert_cmpint (0, ==, sqlx_repository_get_lag (repo, &n0));
+
+	sqlx_repository_clean(repo);
+}
+
+static void
+_locator_file (gpointer u, const struct sqlx_name_s *n, GString *file_name)
+{
+	g_string_printf (file_name, "%s/%s.%s", (gchar*)u, n->base, n->type);
+}
+
+static gint64
+_count_contents (struct sqlx_sqlite3_s *sq3)
+{
+	sqlite3_stmt *stmt = NULL;
+	g_assert_cmpint (SQLITE_OK, ==, sqlite3_prepare_v2 (sq3->db,
+				"SELECT COUNT(*) FROM content", -1, &stmt, NULL));
+	g_assert_cmpint (SQLITE_ROW, ==, sqlite3_step (stmt));
+	gint64 count = sqlite3_column_int64 (stmt, 0);
+	sqlite3_finalize (stmt);
+	return count;
+}
+
+static gboolean
+_journal_is_wal (struct sqlx_sqlite3_s *sq3)
+{
+	sqlite3_stmt *stmt = NULL;
+	g_assert_cmpint (SQLITE_OK, ==, sqlite3_prepare_v2 (sq3->db,
+				"PRAGMA journal_mode", -1, &stmt, NULL));
+	g_assert_cmpint (SQLITE_ROW, ==, sqlite3_step (stmt));
+	gboolean rc = !g_ascii_strcasecmp ("wal",
+			(const char*) sqlite3_column_text (stmt, 0));
+	sqlite3_finalize (stmt);
+	return rc;
+}
+
+static void
+test_wal_dump_restore (void)
+{
+	gchar *basedir = g_dir_make_tmp ("test_sqliterepo_repo-XXXXXX", NULL);
+	g_assert_nonnull (basedir);
+	gchar *tmpdir = g_strconcat (basedir, "/tmp", NULL);
+	g_assert_cmpint (0, ==, g_mkdir (tmpdir, 0755));
+
+	sqlx_repository_t *repo = NULL;
+	GError *err = sqlx_repository_init (basedir, NULL, &repo);
+	g_assert_no_error (err);
+	err = sqlx_repository_configure_type (repo, type, SCHEMA);
+	g_assert_no_error (err);
+	sqlx_repository_set_locator (repo, _locator_file, basedir);
+	sqlx_repository_configure_wal (repo, type, TRUE);
+
+	struct sqlx_name_s n0 = { .base = name, .type = type, .ns = nsname, };
+	struct sqlx_name_s n1 = { .base = name+1, .type = type, .ns = nsname, };
+	struct sqlx_sqlite3_s *sq3 = NULL;
+
+	/* the changes are in the WAL, not yet in the base */
+	err = sqlx_repository_open_and_lock (repo, &n0,
+			SQLX_OPEN_LOCAL|SQLX_OPEN_CREATE, &sq3, NULL);
+	g_assert_no_error (err);
+	g_assert_true (sq3->wal);
+	g_assert_true (_journal_is_wal (sq3));
+	struct sqlx_repctx_s *repctx = NULL;
+	err = sqlx_transaction_begin (sq3, &repctx);
+	g_assert_no_error (err);
+	for (int i = 0; i < 8 ;++i) {
+		gchar *sql = g_strdup_printf (
+				"INSERT INTO content (path,size) VALUES ('c%d',%d)", i, i);
+		g_assert_cmpint (SQLITE_OK, ==, sqlx_exec (sq3->db, sql));
+		g_free (sql);
+	}
+	err = sqlx_transaction_end (repctx, NULL);
+	g_assert_no_error (err);
+	gchar *wal = g_strconcat (sq3->path, "-wal", NULL);
+	struct stat st = {0};
+	g_assert_cmpint (0, ==, stat (wal, &st));
+	g_assert_cmpint (st.st_size, >, 0);
+	g_free (wal);
+
+	/* the dump holds them, and is a plain base */
+	GByteArray *dump = NULL;
+	err = sqlx_repository_dump_base_gba (sq3, &dump);
+	g_assert_no_error (err);
+	g_assert_nonnull (dump);
+	g_assert_cmpuint (dump->len, >, 20);
+	g_assert_cmpint (1, ==, dump->data[18]);
+	g_assert_cmpint (1, ==, dump->data[19]);
+	err = sqlx_repository_unlock_and_close (sq3);
+	g_assert_no_error (err);
+
+	/* restored into another WAL base, that stays in WAL mode */
+	err = sqlx_repository_open_and_lock (repo, &n1,
+			SQLX_OPEN_LOCAL|SQLX_OPEN_CREATE, &sq3, NULL);
+	g_assert_no_error (err);
+	g_assert_cmpint (0, ==, _count_contents (sq3));
+	err = sqlx_repository_restore_base (sq3, dump->data, dump->len);
+	g_assert_no_error (err);
+	g_assert_cmpint (8, ==, _count_contents (sq3));
+	g_assert_true (_journal_is_wal (sq3));
+	err = sqlx_repository_unlock_and_close (sq3);
+	g_assert_no_error (err);
+
+	/* still there once reopened */
+	err = sqlx_repository_open_and_lock (repo, &n1, SQLX_OPEN_LOCAL, &sq3, NULL);
+	g_assert_no_error (err);
+	g_assert_cmpint (8, ==, _count_contents (sq3));
+	err = sqlx_repository_unlock_and_close (sq3);
+	g_assert_no_error (err);
+
+	g_byte_array_unref (dump);
+	sqlx_repository_clean (repo);
+
+	gchar *argv[] = {"rm", "-rf", basedir, NULL};
+	g_assert_true (g_spawn_sync (NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+				NULL, NULL, NULL, NULL, NULL, NULL));
+	g_free (tmpdir);
+	g_free (basedir);
+}
+
+/* An election manager that always tells the local service is the MASTER,
+ * with a lease, and counts the questions. */
+struct fake_election_s
+{
+	struct election_manager_vtable_s *vtable;
+	struct election_lease_s *lease;
+	guint asked_peers;
+	guint asked_status;
+};
+
+static void _fake_clean (struct election_manager_s *m) { (void) m; }
+
+static enum election_mode_e
+_fake_get_mode (const struct election_manager_s *m)
+{
+	(void) m;
+	return ELECTION_MODE_GROUP;
+}
+
+static const char *
+_fake_get_local (const struct election_manager_s *m)
+{
+	(void) m;
+	return "127.0.0.1:6000";
+}
+
+static GError *
+_fake_get_peers (struct election_manager_s *m, const struct sqlx_name_s *n,
+		gboolean nocache, gchar ***peers)
+{
+	(void) n, (void) nocache;
+	((struct fake_election_s*)m)->asked_peers ++;
+	*peers = g_strsplit ("127.0.0.1:6001,127.0.0.1:6002", ",", -1);
+	return NULL;
+}
+
+static GError *
+_fake_noop (struct election_manager_s *m, const struct sqlx_name_s *n)
+{
+	(void) m, (void) n;
+	return NULL;
+}
+
+static enum election_status_e
+_fake_get_status (struct election_manager_s *m, const struct sqlx_name_s *n,
+		gchar **master_url, struct election_lease_s **lease)
+{
+	struct fake_election_s *fake = (struct fake_election_s*) m;
+	(void) n;
+	fake->asked_status ++;
+	if (master_url)
+		*master_url = NULL;
+	if (lease) {
+		g_atomic_int_inc (&fake->lease->refcount);
+		*lease = fake->lease;
+	}
+	return ELECTION_LEADER;
+}
+
+static struct election_manager_vtable_s vtable_fake =
+{
+	_fake_clean, _fake_get_mode, _fake_get_local, _fake_get_peers,
+	_fake_noop, _fake_noop, _fake_noop, _fake_get_status, _fake_noop
+};
+
+static void
+_open_and_close (sqlx_repository_t *repo, const struct sqlx_name_s *n,
+		enum sqlx_open_type_e how)
+{
+	struct sqlx_sqlite3_s *sq3 = NULL;
+	GError *err = sqlx_repository_open_and_lock (repo, n, how, &sq3, NULL);
+	g_assert_no_error (err);
+	g_assert_nonnull (sq3);
+	g_assert_cmpint (sq3->election, ==, ELECTION_LEADER);
+	err = sqlx_repository_unlock_and_close (sq3);
+	g_assert_no_error (err);
+}
+
+static void
+test_lease (void)
+{
+	struct fake_election_s fake = {0};
+	fake.vtable = &vtable_fake;
+	fake.lease = g_malloc0 (sizeof(struct election_lease_s));
+	fake.lease->refcount = 1;
+	fake.lease->deadline = (gint) oio_ext_monotonic_seconds () + 3600;
+
+	sqlx_repository_t *repo = NULL;
+	GError *err = sqlx_repository_init ("/tmp", NULL, &repo);
+	g_assert_no_error (err);
+	err = sqlx_repository_configure_type (repo, type, SCHEMA);
+	g_assert_no_error (err);
+	sqlx_repository_set_locator (repo, _locator, NULL);
+	sqlx_repository_set_elections (repo, (struct election_manager_s*) &fake);
+
+	struct sqlx_name_s n = { .base = name, .type = type, .ns = nsname, };
+
+	/* Not cached yet, the election is asked and grants the lease */
+	_open_and_close (repo, &n, SQLX_OPEN_MASTERONLY);
+	g_assert_cmpuint (1, ==, fake.asked_status);
+	g_assert_cmpuint (1, ==, fake.asked_peers);
+
+	/* Cached with a valid lease: the election is not asked, the peers
+	 * still are */
+	_open_and_close (repo, &n, SQLX_OPEN_MASTERONLY);
+	_open_and_close (repo, &n, SQLX_OPEN_MASTERONLY);
+	g_assert_cmpuint (1, ==, fake.asked_status);
+	g_assert_cmpuint (3, ==, fake.asked_peers);
+
+	/* The reads that a SLAVE could serve do not use the lease */
+	_open_and_close (repo, &n, SQLX_OPEN_MASTERSLAVE);
+	g_assert_cmpuint (2, ==, fake.asked_status);
+
+	/* The lease expired: back to the election, that renews it */
+	fake.lease->deadline = (gint) oio_ext_monotonic_seconds () - 1;
+	_open_and_close (repo, &n, SQLX_OPEN_MASTERONLY);
+	g_assert_cmpuint (3, ==, fake.asked_status);
+	fake.lease->deadline = (gint) oio_ext_monotonic_seconds () + 3600;
+	_open_and_close (repo, &n, SQLX_OPEN_MASTERONLY);
+	g_assert_cmpuint (3, ==, fake.asked_status);
+
+	/* Without the peers checked, the base is not known as replicated and
+	 * is served locally, even with a lease */
+	struct sqlx_sqlite3_s *sq3 = NULL;
+	err = sqlx_repository_open_and_lock (repo, &n,
+			SQLX_OPEN_MASTERONLY|SQLX_OPEN_NOREFCHECK, &sq3, NULL);
+	g_assert_no_error (err);
+	g_assert_cmpint (sq3->election, ==, 0);
+	err = sqlx_repository_unlock_and_close (sq3);
+	g_assert_no_error (err);
+	g_assert_cmpuint (3, ==, fake.asked_status);
+	g_assert_cmpuint (6, ==, fake.asked_peers);
+
+	sqlx_repository_clean (repo);
+	g_assert_cmpint (1, ==, fake.lease->refcount);
+	election_lease_unref (fake.lease);
+}
+
 int
 main(int argc, char **argv)
 {
 	HC_TEST_INIT(argc,argv);
 	g_test_add_func("/sqliterepo/init", test_init);
 	g_test_add_func("/sqliterepo/open", test_open_close);
+	g_test_add_func("/sqliterepo/lag", test_lag);
+	g_test_add_func("/sqliterepo/wal/dump_restore", test_wal_dump_restore);
+	g_test_add_func("/sqliterepo/lease", test_lease);
 	return g_test_run();
 }
 
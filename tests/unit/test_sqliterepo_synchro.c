@@ -0,0 +1,709 @@
+/*
+OpenIO SDS sqliterepo
+Copyright (C) 2015 OpenIO, original work as part of OpenIO Software Defined Storage
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <metautils/lib/metautils.h>
+#include <sqliterepo/synchro.h>
+
+/* In-process ZooKeeper ------------------------------------------------------
+ * Works on the unmangled paths, with one level of hashed directories (the
+ * first character of the path). The operations are applied at once, but
+ * their completions and the watch events are only delivered by _zk_pump(),
+ * as the ZooKeeper's thread would do later. */
+
+enum zk_job_type_e
+{
+	JOB_CREATE = 1,
+	JOB_MULTI,
+	JOB_DELETE,
+	JOB_GET,
+	JOB_EXISTS,
+	JOB_LIST,
+	JOB_EVENT,
+};
+
+struct zk_job_s
+{
+	enum zk_job_type_e type;
+	int rc;
+	gchar *path;
+	gchar *value;
+	const void *data;
+	union {
+		string_completion_t on_string;
+		void_completion_t on_void;
+		data_completion_t on_data;
+		stat_completion_t on_stat;
+		strings_completion_t on_strings;
+		watcher_fn on_event;
+	} cb;
+	int event;
+};
+
+struct zk_watch_s
+{
+	gchar *dir;
+	watcher_fn watcher;
+	void *ctx;
+};
+
+struct sqlx_sync_s
+{
+	struct sqlx_sync_vtable_s *vtable;
+	GTree *nodes;
+	guint sequence;
+	GQueue *jobs;
+	GSList *watches;
+	gboolean multi_fails;
+
+	/* When set, the creations and the listings are refused with it, after
+	 * a call to 'reenter' that plays another thread sending its own
+	 * operation meanwhile. */
+	int fail_rc;
+	void (*reenter) (void);
+
+	guint nb_create;
+	guint nb_multi;
+	guint nb_list;
+	guint nb_watches;
+};
+
+static gchar *
+_zk_dir (const char *path)
+{
+	return g_strndup (path, 1);
+}
+
+static void
+_zk_push (struct sqlx_sync_s *zk, struct zk_job_s *job)
+{
+	g_queue_push_tail (zk->jobs, job);
+}
+
+static struct zk_job_s *
+_zk_job (enum zk_job_type_e type, const char *path, const void *data)
+{
+	struct zk_job_s *job = g_malloc0 (sizeof(*job));
+	job->type = type;
+	job->path = g_strdup (path);
+	job->data = data;
+	return job;
+}
+
+static int
+_zk_do_create (struct sqlx_sync_s *zk, const char *path, const char *v,
+		int vlen, int flags, gchar **out)
+{
+	gchar *p = (flags & ZOO_SEQUENCE)
+		? g_strdup_printf ("%s%010u", path, zk->sequence++)
+		: g_strdup (path);
+	if (g_tree_lookup (zk->nodes, p)) {
+		g_free (p);
+		return ZNODEEXISTS;
+	}
+	g_tree_replace (zk->nodes, p, vlen > 0 ? g_strndup (v, vlen) : g_strdup(""));
+	*out = p;
+	return ZOK;
+}
+
+/* Removes the node and fires the watches on its directory */
+static void
+_zk_remove (struct sqlx_sync_s *zk, const char *path)
+{
+	g_assert (g_tree_remove (zk->nodes, path));
+	gchar *dir = _zk_dir (path);
+	GSList *kept = NULL;
+	for (GSList *l = zk->watches; l ;l = l->next) {
+		struct zk_watch_s *w = l->data;
+		if (strcmp (w->dir, dir)) {
+			kept = g_slist_prepend (kept, w);
+		} else {
+			struct zk_job_s *job = _zk_job (JOB_EVENT, dir, w->ctx);
+			job->cb.on_event = w->watcher;
+			job->event = ZOO_CHILD_EVENT;
+			_zk_push (zk, job);
+			g_free (w->dir);
+			g_free (w);
+		}
+	}
+	g_slist_free (zk->watches);
+	zk->watches = kept;
+	g_free (dir);
+}
+
+static gboolean
+_zk_list_one (gpointer k, gpointer v, gpointer u)
+{
+	(void) v;
+	gpointer *pv = u;
+	if (g_str_has_prefix (k, pv[0]))
+		g_ptr_array_add (pv[1], k);
+	return FALSE;
+}
+
+static guint
+_zk_pump (struct sqlx_sync_s *zk)
+{
+	guint count = 0;
+	GQueue *jobs = zk->jobs;
+	zk->jobs = g_queue_new ();
+
+	for (struct zk_job_s *job; (job = g_queue_pop_head (jobs)) ;++count) {
+		switch (job->type) {
+			case JOB_CREATE:
+				job->cb.on_string (job->rc, job->value, job->data);
+				break;
+			case JOB_MULTI:
+			case JOB_DELETE:
+				job->cb.on_void (job->rc, job->data);
+				break;
+			case JOB_GET:
+				job->cb.on_data (job->rc, job->value,
+						job->value ? strlen(job->value) : 0, NULL, job->data);
+				break;
+			case JOB_EXISTS:
+				job->cb.on_stat (job->rc, NULL, job->data);
+				break;
+			case JOB_LIST: {
+				gchar *dir = _zk_dir (job->path);
+				GPtrArray *names = g_ptr_array_new ();
+				gpointer u[2] = {dir, names};
+				g_tree_foreach (zk->nodes, _zk_list_one, u);
+				struct String_vector sv = {names->len, (char**) names->pdata};
+				job->cb.on_strings (ZOK, &sv, job->data);
+				g_ptr_array_free (names, TRUE);
+				g_free (dir);
+				break;
+			}
+			case JOB_EVENT:
+				job->cb.on_event (NULL, job->event, ZOO_CONNECTED_STATE,
+						job->path, (void*) job->data);
+				break;
+		}
+		g_free (job->path);
+		g_free (job->value);
+		g_free (job);
+	}
+
+	g_queue_free (jobs);
+	return count;
+}
+
+static void
+_zk_clear (struct sqlx_sync_s *zk)
+{
+	g_assert_cmpuint (0, ==, g_queue_get_length (zk->jobs));
+	g_queue_free (zk->jobs);
+	g_tree_destroy (zk->nodes);
+	for (GSList *l = zk->watches; l ;l = l->next) {
+		struct zk_watch_s *w = l->data;
+		g_free (w->dir);
+		g_free (w);
+	}
+	g_slist_free (zk->watches);
+	g_free (zk);
+}
+
+static GError *
+_zk_open (struct sqlx_sync_s *zk)
+{
+	(void) zk;
+	return NULL;
+}
+
+static void
+_zk_close (struct sqlx_sync_s *zk)
+{
+	(void) zk;
+}
+
+static int
+_zk_acreate (struct sqlx_sync_s *zk, const char *path, const char *v,
+		int vlen, int flags, string_completion_t completion, const void *data)
+{
+	if (zk->fail_rc) {
+		if (zk->reenter)
+			zk->reenter ();
+		return zk->fail_rc;
+	}
+	zk->nb_create ++;
+	struct zk_job_s *job = _zk_job (JOB_CREATE, path, data);
+	job->cb.on_string = completion;
+	job->rc = _zk_do_create (zk, path, v, vlen, flags, &job->value);
+	_zk_push (zk, job);
+	return ZOK;
+}
+
+static int
+_zk_adelete (struct sqlx_sync_s *zk, const char *path, int version,
+		void_completion_t completion, const void *data)
+{
+	(void) version;
+	struct zk_job_s *job = _zk_job (JOB_DELETE, path, data);
+	job->cb.on_void = completion;
+	if (g_tree_lookup (zk->nodes, path))
+		_zk_remove (zk, path);
+	else
+		job->rc = ZNONODE;
+	_zk_push (zk, job);
+	return ZOK;
+}
+
+static int
+_zk_awexists (struct sqlx_sync_s *zk, const char *path,
+		watcher_fn watcher, void* watcherCtx,
+		stat_completion_t completion, const void *data)
+{
+	/* the per-node watches are what the batch layer saves */
+	g_assert_null (watcher);
+	(void) watcherCtx;
+	struct zk_job_s *job = _zk_job (JOB_EXISTS, path, data);
+	job->cb.on_stat = completion;
+	job->rc = g_tree_lookup (zk->nodes, path) ? ZOK : ZNONODE;
+	_zk_push (zk, job);
+	return ZOK;
+}
+
+static int
+_zk_awget (struct sqlx_sync_s *zk, const char *path,
+		watcher_fn watcher, void* watcherCtx,
+		data_completion_t completion, const void *data)
+{
+	g_assert_null (watcher);
+	(void) watcherCtx;
+	struct zk_job_s *job = _zk_job (JOB_GET, path, data);
+	job->cb.on_data = completion;
+	const gchar *v = g_tree_lookup (zk->nodes, path);
+	job->rc = v ? ZOK : ZNONODE;
+	job->value = g_strdup (v);
+	_zk_push (zk, job);
+	return ZOK;
+}
+
+static int
+_zk_awget_children (struct sqlx_sync_s *zk, const char *path,
+		watcher_fn watcher, void* watcherCtx,
+		strings_completion_t completion, const void *data)
+{
+	(void) zk, (void) path, (void) watcher, (void) watcherCtx;
+	(void) completion, (void) data;
+	g_assert_not_reached ();
+	return ZUNIMPLEMENTED;
+}
+
+static int
+_zk_awget_siblings (struct sqlx_sync_s *zk, const char *path,
+		watcher_fn watcher, void* watcherCtx,
+		strings_completion_t completion, const void *data)
+{
+	if (zk->fail_rc) {
+		if (zk->reenter)
+			zk->reenter ();
+		return zk->fail_rc;
+	}
+	zk->nb_list ++;
+	gchar *dir = _zk_dir (path);
+	if (watcher) {
+		/* Like ZooKeeper, the same watcher is registered once */
+		gboolean found = FALSE;
+		for (GSList *l = zk->watches; l && !found ;l = l->next) {
+			struct zk_watch_s *w = l->data;
+			found = !strcmp (w->dir, dir)
+				&& w->watcher == watcher && w->ctx == watcherCtx;
+		}
+		if (!found) {
+			struct zk_watch_s *w = g_malloc0 (sizeof(*w));
+			w->dir = g_strdup (dir);
+			w->watcher = watcher;
+			w->ctx = watcherCtx;
+			zk->watches = g_slist_prepend (zk->watches, w);
+			zk->nb_watches ++;
+		}
+	}
+	g_free (dir);
+
+	struct zk_job_s *job = _zk_job (JOB_LIST, path, data);
+	job->cb.on_strings = completion;
+	_zk_push (zk, job);
+	return ZOK;
+}
+
+static void
+_zk_set_exit_hook (struct sqlx_sync_s *zk, void (*on_exit) (void*),
+		void *on_exit_ctx)
+{
+	(void) zk, (void) on_exit, (void) on_exit_ctx;
+}
+
+static int
+_zk_amulti (struct sqlx_sync_s *zk, int count, const zoo_op_t *ops,
+		zoo_op_result_t *results, void_completion_t completion,
+		const void *data)
+{
+	zk->nb_multi ++;
+	struct zk_job_s *job = _zk_job (JOB_MULTI, NULL, data);
+	job->cb.on_void = completion;
+
+	if (zk->multi_fails) {
+		/* the first op fails, the others are rolled back */
+		for (int i=0; i<count ;i++)
+			results[i].err = i ? ZRUNTIMEINCONSISTENCY : ZNODEEXISTS;
+		job->rc = ZNODEEXISTS;
+	} else {
+		for (int i=0; i<count ;i++) {
+			const struct CreateOp *op = &ops[i].create_op;
+			g_assert_cmpint (ops[i].type, ==, ZOO_CREATE_OP);
+			gchar *p = NULL;
+			results[i].err = _zk_do_create (zk, op->path, op->data,
+					op->datalen, op->flags, &p);
+			results[i].value = op->buf;
+			if (p) {
+				g_strlcpy (op->buf, p, op->buflen);
+				g_free (p);
+			}
+		}
+	}
+
+	_zk_push (zk, job);
+	return ZOK;
+}
+
+static struct sqlx_sync_vtable_s vtable_sync_LOCAL =
+{
+	_zk_clear, _zk_open, _zk_close,
+	_zk_acreate, _zk_adelete, _zk_awexists,
+	_zk_awget, _zk_awget_children, _zk_awget_siblings,
+	_zk_set_exit_hook, _zk_amulti
+};
+
+static struct sqlx_sync_s *
+_zk_create (void)
+{
+	struct sqlx_sync_s *zk = g_malloc0 (sizeof(*zk));
+	zk->vtable = &vtable_sync_LOCAL;
+	zk->nodes = g_tree_new_full (metautils_strcmp3, NULL, g_free, g_free);
+	zk->jobs = g_queue_new ();
+	return zk;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static GPtrArray *created = NULL;
+static guint created_ok = 0;
+
+static void
+_on_created (int rc, const char *path, const void *data)
+{
+	(void) data;
+	if (rc == ZOK) {
+		created_ok ++;
+		g_ptr_array_add (created, g_strdup (path));
+	}
+}
+
+static void
+_test_create (gboolean multi_fails)
+{
+	struct sqlx_sync_s *zk = _zk_create ();
+	zk->multi_fails = multi_fails;
+	struct sqlx_sync_s *ss = sqlx_sync_factory__create_batch (zk, 1, 1);
+
+	created = g_ptr_array_new_with_free_func (g_free);
+	created_ok = 0;
+
+	/* Nothing in flight, the first one is sent alone */
+	for (int i=0; i<5 ;i++) {
+		gchar path[32];
+		g_snprintf (path, sizeof(path), "A%d-", i);
+		g_assert_cmpint (ZOK, ==, sqlx_sync_acreate (ss, path, "url", 3,
+					ZOO_EPHEMERAL|ZOO_SEQUENCE, _on_created, NULL));
+	}
+	g_assert_cmpuint (1, ==, zk->nb_create);
+	g_assert_cmpuint (0, ==, zk->nb_multi);
+
+	/* Its completion sends the others, together */
+	g_assert_cmpuint (1, ==, _zk_pump (zk));
+	g_assert_cmpuint (1, ==, created_ok);
+	g_assert_cmpuint (1, ==, zk->nb_multi);
+
+	/* If the transaction fails, each creation is retried alone */
+	g_assert_cmpuint (1, ==, _zk_pump (zk));
+	if (multi_fails) {
+		g_assert_cmpuint (1, ==, created_ok);
+		g_assert_cmpuint (5, ==, zk->nb_create);
+		g_assert_cmpuint (4, ==, _zk_pump (zk));
+	}
+	g_assert_cmpuint (5, ==, created_ok);
+	g_assert_cmpuint (0, ==, _zk_pump (zk));
+
+	/* The paths of the sequential nodes are returned */
+	for (guint i=0; i<created->len ;i++) {
+		const gchar *p = created->pdata[i];
+		g_assert_true (g_str_has_prefix (p, "A"));
+		g_assert_cmpuint (strlen(p), ==, 3 + 10);
+	}
+
+	g_ptr_array_free (created, TRUE);
+	sqlx_sync_clear (ss);
+}
+
+static void
+test_create_multi (void)
+{
+	_test_create (FALSE);
+}
+
+static void
+test_create_fallback (void)
+{
+	_test_create (TRUE);
+}
+
+static guint exists_ok = 0, exists_none = 0, deleted = 0;
+static gchar *deleted_path = NULL;
+
+static void
+_on_exists (int rc, const struct Stat *s, const void *data)
+{
+	(void) s, (void) data;
+	if (rc == ZOK)
+		exists_ok ++;
+	else if (rc == ZNONODE)
+		exists_none ++;
+}
+
+static void
+_on_deleted (zhandle_t *zh, int type, int state, const char *path, void *ctx)
+{
+	(void) zh, (void) state, (void) ctx;
+	g_assert_cmpint (type, ==, ZOO_DELETED_EVENT);
+	deleted ++;
+	oio_str_replace (&deleted_path, path);
+}
+
+static void
+test_watch (void)
+{
+	struct sqlx_sync_s *zk = _zk_create ();
+	struct sqlx_sync_s *ss = sqlx_sync_factory__create_batch (zk, 1, 1);
+	static const char *nodes[] = {"A1", "A2", "A3", "B1", NULL};
+	for (const char **p = nodes; *p ;p++) {
+		gchar *out = NULL;
+		g_assert_cmpint (ZOK, ==, _zk_do_create (zk, *p, NULL, 0, 0, &out));
+		g_free (out);
+	}
+
+	exists_ok = exists_none = deleted = 0;
+
+	/* The first request lists the directory, the others wait for it */
+	static const char *watched[] = {"A1", "A2", "A3", "A9", "B1", NULL};
+	for (const char **p = watched; *p ;p++)
+		g_assert_cmpint (ZOK, ==, sqlx_sync_awexists (ss, *p,
+					_on_deleted, NULL, _on_exists, NULL));
+	g_assert_cmpuint (2, ==, zk->nb_list);
+	g_assert_cmpuint (2, ==, _zk_pump (zk));
+	g_assert_cmpuint (2, ==, exists_ok);
+	g_assert_cmpuint (3, ==, zk->nb_list);
+	g_assert_cmpuint (1, ==, _zk_pump (zk));
+	g_assert_cmpuint (4, ==, exists_ok);
+	g_assert_cmpuint (1, ==, exists_none);
+
+	/* A single watch per directory */
+	g_assert_cmpuint (2, ==, zk->nb_watches);
+
+	/* Only the watcher of the node removed is notified */
+	_zk_remove (zk, "A2");
+	g_assert_cmpuint (1, ==, _zk_pump (zk));
+	g_assert_cmpuint (1, ==, _zk_pump (zk));
+	g_assert_cmpuint (1, ==, deleted);
+	g_assert_cmpstr (deleted_path, ==, "A2");
+
+	/* The watch is set back for the nodes still watched */
+	_zk_remove (zk, "A3");
+	g_assert_cmpuint (1, ==, _zk_pump (zk));
+	g_assert_cmpuint (1, ==, _zk_pump (zk));
+	g_assert_cmpuint (2, ==, deleted);
+	g_assert_cmpstr (deleted_path, ==, "A3");
+	g_assert_cmpuint (0, ==, _zk_pump (zk));
+
+	oio_str_clean (&deleted_path);
+	sqlx_sync_clear (ss);
+}
+
+static guint listed = 0;
+
+static void
+_on_listed (int rc, const struct String_vector *sv, const void *data)
+{
+	(void) data;
+	g_assert_cmpint (rc, ==, ZOK);
+	g_assert_cmpint (sv->count, ==, 2);
+	listed ++;
+}
+
+static void
+test_siblings (void)
+{
+	struct sqlx_sync_s *zk = _zk_create ();
+	struct sqlx_sync_s *ss = sqlx_sync_factory__create_batch (zk, 1, 1);
+	gchar *out = NULL;
+	g_assert_cmpint (ZOK, ==, _zk_do_create (zk, "C1", NULL, 0, 0, &out));
+	oio_str_clean (&out);
+	g_assert_cmpint (ZOK, ==, _zk_do_create (zk, "C2", NULL, 0, 0, &out));
+	oio_str_clean (&out);
+
+	/* The listings of the same directory are shared */
+	listed = 0;
+	for (int i=0; i<10 ;i++)
+		g_assert_cmpint (ZOK, ==, sqlx_sync_awget_siblings (ss, "C1",
+					NULL, NULL, _on_listed, NULL));
+	g_assert_cmpuint (1, ==, zk->nb_list);
+	g_assert_cmpuint (1, ==, _zk_pump (zk));
+	g_assert_cmpuint (1, ==, listed);
+	g_assert_cmpuint (2, ==, zk->nb_list);
+	g_assert_cmpuint (1, ==, _zk_pump (zk));
+	g_assert_cmpuint (10, ==, listed);
+	g_assert_cmpuint (0, ==, _zk_pump (zk));
+
+	sqlx_sync_clear (ss);
+}
+
+static struct sqlx_sync_s *batch = NULL;
+static gint failed = 0;
+
+static void
+_on_create_failed (int rc, const char *path, const void *data)
+{
+	(void) path, (void) data;
+	g_assert_cmpint (rc, ==, ZCONNECTIONLOSS);
+	g_atomic_int_inc (&failed);
+}
+
+static void
+_on_exists_failed (int rc, const struct Stat *s, const void *data)
+{
+	(void) data;
+	g_assert_cmpint (rc, ==, ZCONNECTIONLOSS);
+	g_assert_null (s);
+	g_atomic_int_inc (&failed);
+}
+
+static void
+_reenter_create (void)
+{
+	g_assert_cmpint (ZOK, ==, sqlx_sync_acreate (batch, "A-", NULL, 0,
+				ZOO_EPHEMERAL|ZOO_SEQUENCE, _on_create_failed, NULL));
+}
+
+static void
+_reenter_watch (void)
+{
+	g_assert_cmpint (ZOK, ==, sqlx_sync_awexists (batch, "A2",
+				_on_deleted, NULL, _on_exists_failed, NULL));
+}
+
+/* The operations accepted are failed by another thread */
+static void
+_wait_failed (gint expected)
+{
+	const gint64 deadline = oio_ext_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+	while (g_atomic_int_get (&failed) < expected) {
+		g_assert_cmpint (oio_ext_monotonic_time (), <, deadline);
+		g_usleep (G_TIME_SPAN_MILLISECOND);
+	}
+}
+
+static void
+test_create_failed (void)
+{
+	struct sqlx_sync_s *zk = _zk_create ();
+	batch = sqlx_sync_factory__create_batch (zk, 1, 1);
+	failed = 0;
+
+	/* The first creation fails at once, the one queued meanwhile is not
+	 * forgotten */
+	zk->fail_rc = ZCONNECTIONLOSS;
+	zk->reenter = _reenter_create;
+	g_assert_cmpint (ZCONNECTIONLOSS, ==, sqlx_sync_acreate (batch, "A-",
+				NULL, 0, ZOO_EPHEMERAL|ZOO_SEQUENCE, _on_create_failed, NULL));
+	_wait_failed (1);
+	g_assert_cmpuint (0, ==, zk->nb_create);
+
+	/* Nothing stays in flight, the next one is sent at once */
+	zk->fail_rc = ZOK;
+	created = g_ptr_array_new_with_free_func (g_free);
+	created_ok = 0;
+	g_assert_cmpint (ZOK, ==, sqlx_sync_acreate (batch, "A-", "url", 3,
+				ZOO_EPHEMERAL|ZOO_SEQUENCE, _on_created, NULL));
+	g_assert_cmpuint (1, ==, zk->nb_create);
+	g_assert_cmpuint (1, ==, _zk_pump (zk));
+	g_assert_cmpuint (1, ==, created_ok);
+
+	g_ptr_array_free (created, TRUE);
+	sqlx_sync_clear (batch);
+	g_assert_cmpint (1, ==, failed);
+}
+
+static void
+test_watch_failed (void)
+{
+	struct sqlx_sync_s *zk = _zk_create ();
+	batch = sqlx_sync_factory__create_batch (zk, 1, 1);
+	gchar *out = NULL;
+	g_assert_cmpint (ZOK, ==, _zk_do_create (zk, "A1", NULL, 0, 0, &out));
+	oio_str_clean (&out);
+	failed = 0;
+	exists_ok = exists_none = deleted = 0;
+
+	/* The listing fails at once, the request queued meanwhile is not
+	 * forgotten */
+	zk->fail_rc = ZCONNECTIONLOSS;
+	zk->reenter = _reenter_watch;
+	g_assert_cmpint (ZCONNECTIONLOSS, ==, sqlx_sync_awexists (batch, "A1",
+				_on_deleted, NULL, _on_exists_failed, NULL));
+	_wait_failed (1);
+	g_assert_cmpuint (0, ==, zk->nb_list);
+
+	/* No listing stays in flight, the next request is served */
+	zk->fail_rc = ZOK;
+	g_assert_cmpint (ZOK, ==, sqlx_sync_awexists (batch, "A1",
+				_on_deleted, NULL, _on_exists, NULL));
+	g_assert_cmpuint (1, ==, zk->nb_list);
+	g_assert_cmpuint (1, ==, _zk_pump (zk));
+	g_assert_cmpuint (1, ==, exists_ok);
+
+	sqlx_sync_clear (batch);
+	g_assert_cmpint (1, ==, failed);
+	g_assert_cmpuint (0, ==, deleted);
+}
+
+int
+main(int argc, char **argv)
+{
+	HC_TEST_INIT(argc,argv);
+	g_test_add_func("/sqliterepo/sync/create/multi", test_create_multi);
+	g_test_add_func("/sqliterepo/sync/create/fallback", test_create_fallback);
+	g_test_add_func("/sqliterepo/sync/watch", test_watch);
+	g_test_add_func("/sqliterepo/sync/siblings", test_siblings);
+	g_test_add_func("/sqliterepo/sync/create/failed", test_create_failed);
+	g_test_add_func("/sqliterepo/sync/watch/failed", test_watch_failed);
+	return g_test_run();
+}
@@ -42,11 +42,75 @@ test_rrd (void)
 		_round_rrd ();
 }
 
+static void
+test_histogram (void)
+{
+	struct grid_histogram_s *h = grid_histogram_create();
+	g_assert_cmpuint(grid_histogram_quantile(h, 0.5), ==, 0);
+
+	for (guint64 v=1; v<=1000 ;++v)
+		grid_histogram_add(h, v);
+	g_assert_cmpuint(h->count, ==, 1000);
+	g_assert_cmpuint(h->max, ==, 1000);
+
+	/* The buckets are precise to 1/8 */
+	guint64 p50 = grid_histogram_quantile(h, 0.5);
+	g_assert_cmpuint(p50, >=, 500);
+	g_assert_cmpuint(p50, <=, 500 + 500/8);
+	guint64 p99 = grid_histogram_quantile(h, 0.99);
+	g_assert_cmpuint(p99, >=, 990);
+	g_assert_cmpuint(p99, <=, 1000);
+	g_assert_cmpuint(grid_histogram_quantile(h, 1.0), ==, 1000);
+
+	/* small values are exact */
+	grid_histogram_destroy(h);
+	h = grid_histogram_create();
+	for (guint64 v=0; v<8 ;++v)
+		grid_histogram_add(h, v);
+	g_assert_cmpuint(grid_histogram_quantile(h, 0.5), ==, 3);
+
+	/* huge values do not overflow */
+	grid_histogram_add(h, G_MAXUINT64);
+	g_assert_cmpuint(grid_histogram_quantile(h, 1.0), >, 0);
+	grid_histogram_destroy(h);
+}
+
+static void
+test_rrd_histogram (void)
+{
+	struct grid_histogram_s h = {0};
+	struct grid_rrd_histogram_s *rh = grid_rrd_histogram_create(6, 10);
+
+	grid_rrd_histogram_get(rh, 1000, &h);
+	g_assert_cmpuint(h.count, ==, 0);
+
+	/* 100 values per period of 10 seconds, during 2 minutes */
+	for (time_t now=1000; now<1120 ;++now) {
+		for (guint64 v=1; v<=10 ;++v)
+			grid_rrd_histogram_add(rh, now, v * (now < 1060 ? 1000 : 1));
+	}
+
+	/* only the last minute is known */
+	grid_rrd_histogram_get(rh, 1119, &h);
+	g_assert_cmpuint(h.count, ==, 600);
+	g_assert_cmpuint(h.max, ==, 10);
+
+	/* the oldest periods expire */
+	grid_rrd_histogram_get(rh, 1140, &h);
+	g_assert_cmpuint(h.count, ==, 300);
+	grid_rrd_histogram_get(rh, 1200, &h);
+	g_assert_cmpuint(h.count, ==, 0);
+
+	grid_rrd_histogram_destroy(rh);
+}
+
 int
 main (int argc, char **argv)
 {
 	HC_TEST_INIT(argc,argv);
 	g_test_add_func("/server/rrd", test_rrd);
+	g_test_add_func("/server/histogram", test_histogram);
+	g_test_add_func("/server/histogram/rrd", test_rrd_histogram);
 	return g_test_run();
 }
 
@@ -0,0 +1,272 @@
+/*
+OpenIO SDS unit tests
+Copyright (C) 2015-2016 OpenIO, as part of OpenIO Software Defined Storage
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.
+*/
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <core/oio_core.h>
+#include <metautils/lib/metautils.h>
+#include <server/network_server.h>
+#include <server/transport_gridd.h>
+
+/* A gridd server only serving the common requests, fed with requests split
+ * and packed in every way. */
+
+static struct network_server_s *srv = NULL;
+static struct gridd_request_dispatcher_s *disp = NULL;
+static GThread *th = NULL;
+
+static gpointer
+_server_run (gpointer p)
+{
+	g_assert_no_error (network_server_run ((struct network_server_s *)p));
+	return p;
+}
+
+static int
+_connect (void)
+{
+	gchar **urlv = network_server_endpoints (srv);
+	GError *err = NULL;
+	int fd = sock_connect (urlv[0], &err);
+	g_assert_no_error (err);
+	g_strfreev (urlv);
+	return fd;
+}
+
+static void
+_send (int fd, const guint8 *b, gsize len)
+{
+	while (len > 0) {
+		struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+		g_assert_cmpint (1, ==, poll (&pfd, 1, 5000));
+		ssize_t w = write (fd, b, len);
+		if (w < 0 && (errno == EAGAIN || errno == EINTR))
+			continue;
+		g_assert_cmpint (w, >, 0);
+		b += w, len -= w;
+	}
+}
+
+/* Reads exactly 'len' bytes, returns FALSE if the connection is closed
+ * before. */
+static gboolean
+_read (int fd, guint8 *b, gsize len)
+{
+	while (len > 0) {
+		struct pollfd pfd = {.fd = fd, .events = POLLIN};
+		g_assert_cmpint (1, ==, poll (&pfd, 1, 5000));
+		ssize_t r = read (fd, b, len);
+		if (r < 0 && (errno == EAGAIN || errno == EINTR))
+			continue;
+		if (r <= 0)
+			return FALSE;
+		b += r, len -= r;
+	}
+	return TRUE;
+}
+
+static GByteArray *
+_ping (void)
+{
+	return message_marshall_gba_and_clean (
+			metautils_message_create_named ("REQ_PING"));
+}
+
+static void
+_expect_reply (int fd, guint expected)
+{
+	guint32 size = 0;
+	g_assert_true (_read (fd, (guint8*)&size, 4));
+	size = g_ntohl (size);
+	guint8 *buf = g_malloc (4 + size);
+	*((guint32*)buf) = g_htonl (size);
+	g_assert_true (_read (fd, buf + 4, size));
+
+	GError *err = NULL;
+	MESSAGE reply = message_unmarshall (buf, 4 + size, &err);
+	g_assert_no_error (err);
+	guint status = 0;
+	gchar *msg = NULL;
+	err = metaXClient_reply_simple (reply, &status, &msg);
+	g_assert_no_error (err);
+	g_assert_cmpuint (status, ==, expected);
+	g_free (msg);
+	metautils_message_destroy (reply);
+	g_free (buf);
+}
+
+static void
+_expect_closed (int fd)
+{
+	guint8 b;
+	g_assert_false (_read (fd, &b, 1));
+}
+
+static gsize
+_vm_size (void)
+{
+	gsize kb = 0;
+	gchar *status = NULL;
+	g_assert_true (g_file_get_contents ("/proc/self/status", &status,
+				NULL, NULL));
+	gchar *p = strstr (status, "VmSize:");
+	g_assert_nonnull (p);
+	g_assert_cmpint (1, ==, sscanf (p, "VmSize: %"G_GSIZE_FORMAT, &kb));
+	g_free (status);
+	return kb * 1024;
+}
+
+/* Tests ------------------------------------------------------------------- */
+
+static void
+test_whole (void)
+{
+	int fd = _connect ();
+	GByteArray *req = _ping ();
+	_send (fd, req->data, req->len);
+	_expect_reply (fd, CODE_FINAL_OK);
+	g_byte_array_unref (req);
+	metautils_pclose (&fd);
+}
+
+static void
+test_split (void)
+{
+	/* byte per byte, the size itself being split */
+	int fd = _connect ();
+	GByteArray *req = _ping ();
+	for (guint i = 0; i < req->len ;++i) {
+		_send (fd, req->data + i, 1);
+		g_usleep (100);
+	}
+	_expect_reply (fd, CODE_FINAL_OK);
+	g_byte_array_unref (req);
+	metautils_pclose (&fd);
+}
+
+static void
+test_pipelined (void)
+{
+	/* several requests in a single write, the last one being incomplete */
+	int fd = _connect ();
+	GByteArray *req = _ping ();
+	GByteArray *all = g_byte_array_new ();
+	for (int i = 0; i < 3 ;++i)
+		g_byte_array_append (all, req->data, req->len);
+	_send (fd, all->data, all->len - 2);
+	for (int i = 0; i < 2 ;++i)
+		_expect_reply (fd, CODE_FINAL_OK);
+	_send (fd, all->data + all->len - 2, 2);
+	_expect_reply (fd, CODE_FINAL_OK);
+	g_byte_array_unref (all);
+	g_byte_array_unref (req);
+	metautils_pclose (&fd);
+}
+
+static void
+test_too_big (void)
+{
+	int fd = _connect ();
+	guint32 size = g_htonl (1024 * 1024 * 1024 + 1);
+	_send (fd, (guint8*)&size, 4);
+	_expect_closed (fd);
+	metautils_pclose (&fd);
+}
+
+static void
+test_long_name (void)
+{
+	/* the name is copied on the stack of the worker, only a short one is
+	 * accepted */
+	gchar *name = g_strnfill (SERVER_REQNAME_MAX + 1, 'A');
+	GByteArray *req = message_marshall_gba_and_clean (
+			metautils_message_create_named (name));
+	int fd = _connect ();
+	_send (fd, req->data, req->len);
+	_expect_reply (fd, CODE_BAD_REQUEST);
+	g_byte_array_unref (req);
+	g_free (name);
+
+	/* the connection is still usable */
+	req = _ping ();
+	_send (fd, req->data, req->len);
+	_expect_reply (fd, CODE_FINAL_OK);
+	g_byte_array_unref (req);
+	metautils_pclose (&fd);
+}
+
+static void
+test_announced_big (void)
+{
+	/* the clients announce huge requests but only send a few bytes: the
+	 * server does not reserve the announced size */
+	const gsize before = _vm_size ();
+	int fdv[4];
+	for (guint i = 0; i < G_N_ELEMENTS(fdv) ;++i) {
+		guint8 buf[16] = {0};
+		*((guint32*)buf) = g_htonl (1024 * 1024 * 1024 - 1);
+		fdv[i] = _connect ();
+		_send (fdv[i], buf, sizeof(buf));
+	}
+
+	/* the server still answers, meanwhile */
+	int fd = _connect ();
+	GByteArray *req = _ping ();
+	_send (fd, req->data, req->len);
+	_expect_reply (fd, CODE_FINAL_OK);
+	g_byte_array_unref (req);
+	metautils_pclose (&fd);
+
+	g_usleep (200 * G_TIME_SPAN_MILLISECOND);
+	g_assert_cmpuint (_vm_size (), <, before + 256 * 1024 * 1024);
+
+	for (guint i = 0; i < G_N_ELEMENTS(fdv) ;++i)
+		metautils_pclose (fdv + i);
+}
+
+int
+main (int argc, char **argv)
+{
+	HC_TEST_INIT (argc, argv);
+
+	disp = transport_gridd_build_dispatcher (gridd_get_common_requests (), NULL);
+	srv = network_server_init ();
+	grid_daemon_bind_host (srv, "127.0.0.1:0", disp);
+	g_assert_no_error (network_server_open_servers (srv));
+	th = g_thread_new ("server", _server_run, srv);
+
+	g_test_add_func ("/server/gridd/whole", test_whole);
+	g_test_add_func ("/server/gridd/split", test_split);
+	g_test_add_func ("/server/gridd/pipelined", test_pipelined);
+	g_test_add_func ("/server/gridd/too_big", test_too_big);
+	g_test_add_func ("/server/gridd/long_name", test_long_name);
+	g_test_add_func ("/server/gridd/announced_big", test_announced_big);
+	int rc = g_test_run ();
+
+	network_server_stop (srv);
+	g_thread_join (th);
+	network_server_close_servers (srv);
+	network_server_clean (srv);
+	gridd_request_dispatcher_clean (disp);
+	return rc;
+}
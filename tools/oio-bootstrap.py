@@ -212,9 +212,17 @@ grid_fsync             disabled
 # At the end of an upload, perform a fsync() on the directory holding the chunk
 grid_fsync_dir         enabled
 
+# How long (in milliseconds) the fsync() on a directory waits for the
+# concurrent uploads in the same directory (0 by default)
+#grid_fsync_dir_window  2
+
 # Preallocate space for the chunk file (enabled by default)
 #grid_fallocate enabled
 
+# Write the uncompressed chunks with O_DIRECT, out of the page cache
+# (disabled by default)
+grid_direct_io ${DIRECT_IO}
+
 # Triggers Access Control List (acl)
 # DO NOT USE, this is broken
 #grid_acl disabled
@@ -1182,6 +1190,8 @@ def generate(options):
                           'SRVNUM': num + 1,
                           'PORT': next_port(),
                           'COMPRESSION': compression,
+                          # one rawx writes with O_DIRECT, for the tests
+                          'DIRECT_IO': ('enabled' if num == 0 else 'disabled'),
                           'EXTRASLOT': ('rawx-even' if num % 2 else 'rawx-odd')
                           })
             add_service(env)